@@ -3,8 +3,26 @@
 #include <string.h>
 
 #include "raylib.h"
+#include "pixel_anim.h"
+#include "pixel_assets.h"
 #include "pixel_core.h"
+#include "pixel_gif.h"
+#include "pixel_grid.h"
+#include "pixel_jobs.h"
+#include "pixel_journal.h"
+#include "pixel_layers.h"
+#include "pixel_library.h"
+#include "pixel_live.h"
+#include "pixel_palette.h"
+#include "pixel_palette_import.h"
+#include "pixel_palette_layout.h"
+#include "pixel_palette_loader.h"
+#include "pixel_raylib.h"
+#include "pixel_saver.h"
+#include "pixel_selection.h"
+#include "pixel_startup.h"
 #include "pixel_ui_logic.h"
+#include "pixel_watch.h"
 
 #define RAYGUI_IMPLEMENTATION  // Define this in one source file
 #if defined(__GNUC__)
@@ -19,11 +37,10 @@
 
 #include "../styles/style_dark.h"              // raygui style: dark
 
+// raylib's desktop backend bundles GLFW, whose empty event is the only way to end
+// EnableEventWaiting from another thread.
+extern void glfwPostEmptyEvent(void);
 
-// Define the maximum number of colors and palettes
-#define MAX_COLORS 64
-#define MAX_PALETTES 16
-#define MAX_PALETTE_NAME 64
 
 // Define UI dimensions
 #define TOP_BAR_HEIGHT 30
@@ -34,38 +51,131 @@
 #define GRID_SIZE 16
 #define PIXEL_SIZE 32
 #define PALLETE_SIZE 64
-
-// Structure to hold color palette data
-typedef struct {
-  Color colors[MAX_COLORS];     // Array of colors in the palette
-  int count;                    // Number of colors in the palette
-  char name[MAX_PALETTE_NAME];  // Name of the palette
-} Palette;
+#define DEFAULT_PALETTE "pico-8"
+#define OFF_PALETTE_SHOWN 4  // Off-palette colors flagged in the status bar
 
 // Runtime paths (local repo by default, overridden for installed runs)
 static char libraryDir[512] = "library";
 static char fontPath[512] = "fonts/PressStart2P-Regular.ttf";
 static char palettesDir[512] = "palettes";
+static char paletteCachePath[512] = "library/palette-cache.bin";
+static char journalPath[512] = "library/autosave.journal";
+static char thumbnailCachePath[512] = "library/thumbnail-cache.bin";
+static bool palettesDirOverride = false;  // Set from PIXEL_PALETTES_DIR; replaces bundled palettes
+
+// Launch phase timings, printed after the first frame with --profile-startup
+static PixelStartupProfile startupProfile;
 
 // Global variables for palettes and UI state
-Palette palettes[MAX_PALETTES];  // Array of palettes
-int paletteCount = 0;            // Current number of loaded palettes
-int currentPaletteIndex = 6;     // Index of the currently selected palette
+PixelPaletteRegistry paletteRegistry;  // Every loaded palette, compactly stored
+PixelPaletteLoader *paletteLoader = NULL;  // Streams the palette library in until finished
+int currentPaletteIndex = 0;           // Index of the currently selected palette
+PixelPaletteLayout swatchLayout;       // Swatch panel geometry shared by hit-testing and drawing
+int selectedSwatch = 0;                // Swatch the current color was picked from
 PixelUiLogic uiState = {0};
 char textInput[256] = { 0 };
 
-// Rectangle for dropdown menu bounds
+// Palette picker header and the list it opens below itself
 Rectangle dropdownBounds;
-
-// Canvas grid for pixel drawing
-Color canvas[GRID_SIZE][GRID_SIZE];  // 2D array for pixel colors
-Color currentColor;                  // Currently selected color
+Rectangle paletteListBounds;
+
+// Layered canvas document; the flattened result is mirrored into a texture
+PixelLayerStack document;
+Texture2D canvasTexture;
+PixelJobPool *jobPool = NULL;  // Shared workers for tile compositing
+
+// Selection: while any pixel is selected, painting only changes selected pixels. M cycles the canvas tool;
+// dragging a selection replaces it, with Shift it adds, Alt subtracts and Shift+Alt intersects
+typedef enum { TOOL_BRUSH = 0, TOOL_SELECT_RECT, TOOL_SELECT_LASSO, TOOL_MAGIC_WAND, TOOL_MOVE, TOOL_COUNT } CanvasTool;
+static const char *const canvasToolNames[TOOL_COUNT] = {"Brush", "Rect select", "Lasso", "Magic wand", "Move"};
+#define MAGIC_WAND_TOLERANCE 16
+CanvasTool canvasTool = TOOL_BRUSH;
+PixelMask selection;
+PixelMask selectionShape;          // Shape being added, combined into selection on release
+bool selectionActive = false;      // selection is not empty
+int selectionAnchorX, selectionAnchorY;
+PixelMaskPoint *lassoPoints = NULL;
+int lassoCount = 0, lassoCapacity = 0;
+PixelColor selectionOverlay[GRID_SIZE * GRID_SIZE];
+Texture2D selectionTexture;        // selectionOverlay: a tint over selected pixels
+
+// Move tool: the selection (or the whole layer) is cut into a floating buffer that is drawn as its own
+// texture, so dragging only moves a quad. H/V flip it, R/Shift+R rotate it, Enter or Escape drops it
+PixelFloating floating;
+bool floatingActive = false;
+int floatingGrabX, floatingGrabY;  // Pointer cell relative to the floating origin while dragging
+Texture2D floatingTexture;         // floating.pixels, re-uploaded when lifted or transformed
+bool floatingPreviewDue = false;   // The live link still shows the floating pixels somewhere else
+
+// Animation timeline; the document layers always hold the current frame
+PixelAnim animation;
+bool frameEdited = false;  // Document edits not yet encoded into the current frame
+int frameEditX0, frameEditY0, frameEditX1, frameEditY1;
+
+// Autosave journal: each finished stroke appends its tiles, layer and frame
+// changes append a full snapshot, and a background thread does the writing
+#define JOURNAL_TILES_PER_SIDE ((GRID_SIZE + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE)
+#define JOURNAL_COMPACT_RATIO 4  // Compact once the journal is this many snapshots long
+PixelJournal *journal = NULL;
+unsigned char journalTiles[JOURNAL_TILES_PER_SIDE * JOURNAL_TILES_PER_SIDE];  // Tiles painted since the last record
+int journalTileLayer = -1;        // Layer journalTiles refers to; -1 when nothing is pending
+bool journalSnapshotDue = false;  // The layer list or frame changed since the last record
+
+// Library browser: projects listed with lazily produced thumbnails. Visible
+// cells upload into a small ring of textures indexed by project modulo its size
+#define LIBRARY_CELL 96
+#define LIBRARY_TEXTURES 64
+PixelLibrary *library = NULL;    // Open while the browser is shown
+PixelLibrary *closingLibrary = NULL;  // Closed browser whose thread is still refreshing the cache
+int libraryScrollRow = 0;
+Texture2D libraryTextures[LIBRARY_TEXTURES];
+int libraryTextureIndex[LIBRARY_TEXTURES];  // Project shown by each texture, -1 for none
+
+// TXT saves are written by a background thread; the status bar shows the last result until the next stroke
+PixelSaver *saver = NULL;
+char saveStatus[48] = {0};
+int saveStatusRevision = 0;  // Bumped whenever saveStatus changes, to key the status bar
+
+// The palette and library directories are watched so edits made in other tools apply without a rescan
+enum { WATCH_PALETTES, WATCH_LIBRARY };
+PixelWatcher *watcher = NULL;
+int paletteRevision = 0;  // Bumped when a palette's colors are reloaded in place
+
+// Colors in use that the palette lacks, looked up again only when the counts or the palette change
+struct {
+  unsigned usage;
+  const PixelColor *colors;
+  int count;
+  int revision;
+} offPaletteKey;
+PixelColor offPaletteColors[OFF_PALETTE_SHOWN];
+size_t offPaletteCounts[OFF_PALETTE_SHOWN];
+int offPaletteFound = 0;
+size_t offPalettePixels = 0;
+int offPaletteGeneration = 0;  // Bumped when what the status bar shows of them changes
+
+// Live link (--live-link[=/name]): the canvas is mirrored into shared memory for a running game to display
+PixelLivePublisher *livePublisher = NULL;
+PixelColor currentColor;  // Currently selected color
 
 // Origin coordinates for the grid
 int gridOriginX, gridOriginY;
+int gridMajorEvery = 0;  // Cells per tile boundary drawn as a major grid line; 0 for none
 
-// Buffer for concatenated palette names for dropdown
-char dropdownBuffer[1024] = {0};
+// Retained UI chrome: a region rendered once into a texture and redrawn only
+// when the key describing its inputs (or its bounds) changes
+#define UI_LAYER_KEY_MAX 64
+typedef struct {
+  RenderTexture2D target;
+  Rectangle bounds;
+  unsigned char key[UI_LAYER_KEY_MAX];
+  size_t keySize;
+  bool valid;
+} UiLayer;
+
+UiLayer topBarLayer, pickerLayer, swatchLayer, statusLayer;
+
+typedef enum { TOP_BAR_NONE = 0, TOP_BAR_SAVE_PNG, TOP_BAR_SAVE_TXT, TOP_BAR_LOAD_TXT, TOP_BAR_NEW_CANVAS } TopBarAction;
 
 //----------------------------------------------------------------------------------
 // Functions Declaration
@@ -74,17 +184,66 @@ void ShowTextInputBox(bool *showBox, const char *title, void (*callback)(const c
 static void btnSaveAsPNG(const char *);
 static void btnSaveText(const char *filename);
 static void btnLoadText(const char *filename);
+static void btnSaveGif(const char *filename);
 static void NewCanvas();
+static void SyncCanvasTexture(void);
+static void RefreshOffPalette(const PixelColor *colors, int count);
+static void HandleLayerShortcuts(void);
+static void HandleCanvasTransformShortcuts(void);
+static void HandleFrameShortcuts(void);
+static void PaintActiveLayer(int gx, int gy, PixelColor color, int brushSize);
+static void HandleSelectionShortcuts(void);
+static void BeginSelectionDrag(int gx, int gy);
+static void TrackSelectionDrag(int gx, int gy);
+static void FinishSelectionDrag(int gx, int gy);
+static void SelectionChanged(void);
+static void DrawSelection(Rectangle bounds, bool dragging, int gx, int gy);
+static bool LiftFloating(void);
+static void CommitFloating(void);
+static void DropFloating(void);
+static bool BuildFloatingPreview(PixelLayerStack *preview);
+static void FloatingChanged(void);
+static void HandleFloatingShortcuts(void);
+static void TrackFrameEdit(int x, int y, int width, int height);
+static void JournalPendingTiles(void);
+static void UpdateAutosave(void);
+static void StoreCurrentFrame(void);
+static void ShowFrame(int index);
 static void InitRuntimePaths(void);
 static void InitUserLibraryDir(void);
-
-void LoadPalettesFromDir(const char *dirPath);
-void DropdownBufferString();
+static void SetUserDataPaths(const char *appDir);
+static Font LoadUiFont(void);
+static bool SelectPalette(int index);
+static void RecolorAllFrames(const PixelColor *from, const PixelColor *to, int count);
+static void SwapPalette(int index);
+static bool UiLayerBegin(UiLayer *layer, Rectangle bounds, const void *key, size_t keySize);
+static void UiLayerEnd(void);
+static void UiLayerDraw(const UiLayer *layer);
+static void UiLayerUnload(UiLayer *layer);
+static TopBarAction DrawTopBar(bool showButtons, int *themeToggle);
+static void DrawSwatches(const PixelColor *colors, int hoveredSwatch);
+static uint64_t VisibleSwatchUsage(const PixelColor *colors);
+static void DrawGridOverlay(Rectangle bounds);
+static void ShowLibraryBrowser(void);
+static void CloseLibraryBrowser(void);
+static void ApplyWatchEvents(void);
+static void WakeEventLoop(void *user);
+static bool DetectPng(const unsigned char *data, size_t size);
+static int ParsePngSwatches(const unsigned char *data, size_t size, PixelColor *out, int capacity);
 
 //------------------------------------------------------------------------------------
 // Program main entry point
 //------------------------------------------------------------------------------------
-int main(void) {
+int main(int argc, char **argv) {
+  PixelStartupProfileInit(&startupProfile);
+  bool profileStartup = false;
+  const char *liveLinkName = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--profile-startup") == 0) profileStartup = true;
+    else if (strcmp(argv[i], "--live-link") == 0) liveLinkName = PIXEL_LIVE_DEFAULT_NAME;
+    else if (strncmp(argv[i], "--live-link=", 12) == 0) liveLinkName = argv[i] + 12;
+  }
+
   const int gridPixels = GRID_SIZE * PIXEL_SIZE;
   const int screenWidth = gridPixels + PALETTE_WIDTH + 3 * MARGIN;
   const int screenHeight = gridPixels + TOP_BAR_HEIGHT + BOTTOM_BAR_HEIGHT + 2 * MARGIN;
@@ -92,24 +251,49 @@ int main(void) {
   InitWindow(screenWidth, screenHeight, "Raylib Pixel Editor");
   SetExitKey(KEY_NULL);
   SetTargetFPS(60);
+  PixelStartupMark(&startupProfile, "InitWindow");
 
   InitRuntimePaths();
-
-  Font uiFont = LoadFont(fontPath);
-
-  // Load palettes from directory
-  LoadPalettesFromDir(palettesDir);
-  if (paletteCount == 0) {
+  PixelStartupMark(&startupProfile, "paths");
+
+  Font uiFont = LoadUiFont();
+  PixelStartupMark(&startupProfile, "font");
+
+  // Swatch panel right of the grid, one 64px swatch per cell with gaps between columns
+  float paletteX = MARGIN + gridPixels + MARGIN;
+  PixelPaletteLayoutInit(&swatchLayout,
+                         (PixelLayoutRect){paletteX, TOP_BAR_HEIGHT + MARGIN, screenWidth - paletteX, gridPixels},
+                         PALLETE_SIZE, MARGIN);
+
+  // Only the default palette is ready before the first frame; the rest of
+  // the library streams in from the background loader
+  PixelPaletteRegistryInit(&paletteRegistry);
+  PixelPaletteRegisterImporter(&(PixelPaletteImporter){"PNG swatches", ".png", DetectPng, ParsePngSwatches});
+#if defined(PIXEL_EMBED_ASSETS)
+  for (int i = 0; i < pixelEmbeddedPaletteCount && !palettesDirOverride; i++) {
+    PixelPaletteRegistryAdd(&paletteRegistry, pixelEmbeddedPalettes[i].name, pixelEmbeddedPalettes[i].colors,
+                            pixelEmbeddedPalettes[i].count);
+  }
+#endif
+  if (paletteRegistry.count == 0) {
+    PixelPaletteRegistryLoadFile(&paletteRegistry, TextFormat("%s/%s.txt", palettesDir, DEFAULT_PALETTE));
+  }
+  paletteLoader = PixelPaletteLoaderStart(palettesDir, paletteCachePath, -1);
+  if (paletteRegistry.count == 0) {
+    PixelPaletteLoaderWait(paletteLoader);
+    PixelPaletteLoaderDrain(paletteLoader, &paletteRegistry);
+  }
+  bool paletteSelected = SelectPalette(PixelPaletteRegistryFind(&paletteRegistry, DEFAULT_PALETTE));
+  for (int i = 0; i < paletteRegistry.count && !paletteSelected; i++) paletteSelected = SelectPalette(i);
+  if (!paletteSelected) {
     TraceLog(LOG_WARNING, "No palettes found.");
+    PixelPaletteLoaderDestroy(paletteLoader);
     CloseWindow();
     return 1;
   }
+  PixelStartupMark(&startupProfile, "palettes");
 
-  // create 'library' folder for user saving
-  MakeDirectory(libraryDir);
-
-  // Set initial color and grid origin
-  currentColor = palettes[0].colors[0];
+  // Set grid origin
   gridOriginX = MARGIN;
   gridOriginY = TOP_BAR_HEIGHT + MARGIN;
 
@@ -120,35 +304,146 @@ int main(void) {
       GRID_SIZE * PIXEL_SIZE   // Height of the grid
   };
 
-  // Initialize the canvas with blank colors
+  jobPool = PixelJobPoolCreate(-1);
+  saver = PixelSaverCreate();
+  const char *watchDirs[] = {palettesDir, libraryDir};
+  watcher = PixelWatcherStart(watchDirs, 2, false);
+  PixelWatcherSetWake(watcher, WakeEventLoop, NULL);
+
+  // Initialize the canvas with a single blank layer
+  if (!PixelLayerStackInit(&document, GRID_SIZE, GRID_SIZE)) {
+    TraceLog(LOG_ERROR, "Could not allocate canvas.");
+    CloseWindow();
+    return 1;
+  }
   NewCanvas();
-  PixelUiLogicInit(&uiState);
 
-  // Create a string for the dropdown containing palette names
-  DropdownBufferString();
+  // Bring back whatever the last session had not saved when it ended
+  PixelJournalRecovery recovery;
+  if (PixelJournalRecover(journalPath, &document, &recovery)) {
+    if (document.width != GRID_SIZE || document.height != GRID_SIZE) {
+      TraceLog(LOG_WARNING, "Ignoring autosave journal for a %dx%d canvas.", document.width, document.height);
+      PixelLayerStackFree(&document);
+      PixelLayerStackInit(&document, GRID_SIZE, GRID_SIZE);
+      NewCanvas();
+    } else {
+      TraceLog(LOG_INFO, "Recovered autosave: %d stroke(s) after the last snapshot%s.", recovery.tileRecordCount,
+               recovery.truncated ? ", torn tail dropped" : "");
+      PixelAnimFree(&animation);
+      PixelAnimInit(&animation, GRID_SIZE, GRID_SIZE, document.layerCount, PIXEL_ANIM_DEFAULT_FPS);
+      TrackFrameEdit(0, 0, GRID_SIZE, GRID_SIZE);
+    }
+  }
+  // The new journal starts from the recovered document; the old file stays until it is written
+  journal = PixelJournalOpen(journalPath, &document);
+  if (!journal) TraceLog(LOG_WARNING, "Autosave disabled: could not open %s", journalPath);
+  journalSnapshotDue = false;
+  canvasTexture = LoadTextureFromImage(PixelImageView(PixelLayerStackFlatten(&document), GRID_SIZE, GRID_SIZE));
+  if (!PixelMaskInit(&selection, GRID_SIZE, GRID_SIZE) || !PixelMaskInit(&selectionShape, GRID_SIZE, GRID_SIZE)) {
+    TraceLog(LOG_ERROR, "Could not allocate selection mask.");
+    CloseWindow();
+    return 1;
+  }
+  selectionTexture = LoadTextureFromImage(PixelImageView(selectionOverlay, GRID_SIZE, GRID_SIZE));
+  SelectionChanged();
+  PixelLayerStackTakeChangedRows(&document, NULL, NULL);
+  if (liveLinkName) {
+    livePublisher = PixelLivePublisherCreate(liveLinkName, GRID_SIZE, GRID_SIZE);
+    if (livePublisher) PixelLivePublish(livePublisher, PixelLayerStackFlatten(&document), 0, 0, GRID_SIZE, GRID_SIZE);
+    else TraceLog(LOG_WARNING, "Live link disabled: could not create shared memory %s", liveLinkName);
+  }
+  PixelUiLogicInit(&uiState);
+  PixelStartupMark(&startupProfile, "canvas");
 
   int dropdownActive = 0;
-  int selectedPaletteIndex = 6;
+  int paletteListScroll = 0;
   int toggleThemeSliderActive = 0;
   int prevToggleThemeSliderActive = 1;
   int brushSize = 1;
   bool drawingStrokeActive = false;
 
+  // Idle mode: once nothing changes on its own, EndDrawing blocks until the next input event
+  PixelRedrawState redraw;
+  PixelRedrawInit(&redraw);
+  bool waitingForEvents = false;
+
   while (!WindowShouldClose()) {
     bool suppressUiActionsThisFrame = false;
 
+    // Time spent asleep is not animation time
+    float frameSeconds = waitingForEvents ? 0.0f : GetFrameTime();
+    if (waitingForEvents) PixelRedrawInvalidate(&redraw);
+
+    if (paletteLoader) {
+      PixelPaletteLoaderDrain(paletteLoader, &paletteRegistry);
+      if (PixelPaletteLoaderFinished(paletteLoader)) {
+        PixelPaletteLoaderDestroy(paletteLoader);
+        paletteLoader = NULL;
+      }
+    }
+    // Changes queue up in the watcher until the initial load has registered every palette
+    if (!paletteLoader) ApplyWatchEvents();
+
     if ((IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL)) && IsKeyPressed(KEY_Q)) {
       PixelUiLogicOpenQuitConfirm(&uiState);
     }
 
+    if (!uiState.showQuitConfirm && !PixelUiLogicDialogOpen(&uiState) &&
+        (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL)) && IsKeyPressed(KEY_G)) {
+      PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_SAVE_GIF);
+    }
+
+    // Ctrl+T cycles major grid lines on 8/16/32-cell tile boundaries
+    if (!uiState.showQuitConfirm && !PixelUiLogicDialogOpen(&uiState) &&
+        (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL)) && IsKeyPressed(KEY_T)) {
+      gridMajorEvery = gridMajorEvery == 0 ? 8 : (gridMajorEvery < 32 ? gridMajorEvery * 2 : 0);
+    }
+
+    // Saving or loading takes the floating pixels as they are now
+    if (floatingActive && PixelUiLogicDialogOpen(&uiState)) CommitFloating();
+    if (!uiState.showQuitConfirm && !PixelUiLogicDialogOpen(&uiState)) {
+      if (floatingActive) {
+        HandleFloatingShortcuts();
+      } else {
+        HandleLayerShortcuts();
+        HandleCanvasTransformShortcuts();
+        HandleFrameShortcuts();
+        HandleSelectionShortcuts();
+      }
+    }
+
+    if (animation.playing) {
+      StoreCurrentFrame();
+      if (PixelAnimAdvance(&animation, frameSeconds)) ShowFrame(animation.currentFrame);
+    }
+
     dropdownBounds = (Rectangle){gridOriginX + GRID_SIZE * PIXEL_SIZE + MARGIN, 5, PALLETE_SIZE * 2 + MARGIN, 30};
+    paletteListBounds = (Rectangle){dropdownBounds.x, dropdownBounds.y + dropdownBounds.height, dropdownBounds.width,
+                                    GRID_SIZE * PIXEL_SIZE / 2};
 
     // Handle mouse
     Vector2 mouse = GetMousePosition();
     int gx = (mouse.x - gridOriginX) / PIXEL_SIZE;
     int gy = (mouse.y - gridOriginY) / PIXEL_SIZE;
+
+    // Swatch under the mouse, found once per frame for clicks and drawing alike
+    int paletteCount = 0;
+    const PixelColor *paletteColors = PixelPaletteColors(&paletteRegistry, currentPaletteIndex, &paletteCount);
+    PixelPaletteLayoutSetCount(&swatchLayout, paletteCount);
+    bool swatchesCovered = uiState.showQuitConfirm || PixelUiLogicDialogOpen(&uiState) ||
+                           (dropdownActive && CheckCollisionPointRec(mouse, paletteListBounds));
+    int hoveredSwatch = swatchesCovered ? -1 : PixelPaletteLayoutHitTest(&swatchLayout, mouse.x, mouse.y);
+    bool overSwatches = !swatchesCovered && CheckCollisionPointRec(mouse, (Rectangle){swatchLayout.bounds.x,
+                            swatchLayout.bounds.y, swatchLayout.bounds.width, swatchLayout.bounds.height});
+
+    // The wheel scrolls long palettes over the swatch panel and sizes the brush elsewhere
     float wheel = GetMouseWheelMove();
-    if (wheel > 0.0f) brushSize++;
+    if (uiState.showLibraryBrowser) {
+      libraryScrollRow -= (int)wheel;
+    } else if (overSwatches && wheel != 0.0f) {
+      PixelPaletteLayoutScroll(&swatchLayout, wheel > 0.0f ? -1 : 1);
+      hoveredSwatch = PixelPaletteLayoutHitTest(&swatchLayout, mouse.x, mouse.y);
+    } else if (wheel > 0.0f) brushSize++;
     else if (wheel < 0.0f) brushSize--;
     if (brushSize < 1) brushSize = 1;
     if (brushSize > GRID_SIZE) brushSize = GRID_SIZE;
@@ -156,51 +451,61 @@ int main(void) {
     // ─────────── Logic ─────────────
     if (!uiState.showQuitConfirm && IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
         CheckCollisionPointRec(mouse, gridBounds) &&
-        !uiState.showSavePngDialog && !uiState.showSaveTxtDialog && !uiState.showLoadTxtDialog) {
+        !PixelUiLogicDialogOpen(&uiState)) {
       drawingStrokeActive = true;
+      if (canvasTool != TOOL_BRUSH) BeginSelectionDrag(gx, gy);
     }
 
     if (drawingStrokeActive && IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
       drawingStrokeActive = false;
       suppressUiActionsThisFrame = true;
+      if (canvasTool != TOOL_BRUSH) FinishSelectionDrag(gx, gy);
     }
 
     if (!uiState.showQuitConfirm && IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
       if (drawingStrokeActive) {
-        if (CheckCollisionPointRec(mouse, gridBounds)) {
-          PixelPaintBrush(&canvas[0][0], GRID_SIZE, gx, gy, currentColor, brushSize);
+        if (canvasTool != TOOL_BRUSH) {
+          TrackSelectionDrag(gx, gy);
+        } else if (CheckCollisionPointRec(mouse, gridBounds)) {
+          PaintActiveLayer(gx, gy, currentColor, brushSize);
         }
-      } else if (CheckCollisionPointRec(mouse, dropdownBounds)) {
-        selectedPaletteIndex = !selectedPaletteIndex;  // Toggle dropdown
+      } else if (CheckCollisionPointRec(mouse, dropdownBounds) ||
+                 (dropdownActive && CheckCollisionPointRec(mouse, paletteListBounds))) {
+        // Clicks on the palette picker never reach the canvas or swatches
 
         // Set the canvas color at the calculated grid position
-      } else if (CheckCollisionPointRec(mouse, gridBounds) && !uiState.showSavePngDialog && !uiState.showSaveTxtDialog && !uiState.showLoadTxtDialog) {
-        PixelPaintBrush(&canvas[0][0], GRID_SIZE, gx, gy, currentColor, brushSize);
-
-        // Set the palette color at the calculated palette position
-      } else {
-        int px = gridOriginX + GRID_SIZE * PIXEL_SIZE + MARGIN;
-        int count = palettes[currentPaletteIndex].count;
-        int maxPerColumn = 8;  // Maximum number of items per column
-
-        for (int i = 0; i < count; i++) {
-          // Calculate the column and row based on the index
-          int column = i / maxPerColumn;  // 0 for first column, 1 for second column, etc.
-          int row = i % maxPerColumn;     // Row within the column
-
-          // Define rectangle for the color
-          Rectangle colRect = {px + column * (PALLETE_SIZE + MARGIN),
-                               gridOriginY + row * PALLETE_SIZE, PALLETE_SIZE, PALLETE_SIZE};
-
-          // Check if the mouse is over the color rectangle
-          if (CheckCollisionPointRec(mouse, colRect)) {
-            currentColor = palettes[currentPaletteIndex].colors[i];
-          }
+      } else if (CheckCollisionPointRec(mouse, gridBounds) && !PixelUiLogicDialogOpen(&uiState)) {
+        if (canvasTool == TOOL_BRUSH) PaintActiveLayer(gx, gy, currentColor, brushSize);
+
+        // Set the palette color at the swatch under the mouse
+      } else if (hoveredSwatch >= 0) {
+        // Alt+click recolors every pixel of the current color to the clicked swatch
+        if ((IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT)) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+          RecolorAllFrames(&currentColor, &paletteColors[hoveredSwatch], 1);
         }
+        currentColor = paletteColors[hoveredSwatch];
+        selectedSwatch = hoveredSwatch;
       }
     } else if (!uiState.showQuitConfirm && IsMouseButtonDown(MOUSE_RIGHT_BUTTON) && !GuiIsLocked()) {
       // Clear pixel on right-click if within bounds
-      if (CheckCollisionPointRec(mouse, gridBounds)) PixelPaintBrush(&canvas[0][0], GRID_SIZE, gx, gy, BLANK, brushSize);
+      if (CheckCollisionPointRec(mouse, gridBounds)) {
+        PaintActiveLayer(gx, gy, PIXEL_BLANK, brushSize);
+      }
+    }
+    UpdateAutosave();
+
+    PixelSaveEvent saveEvent;
+    while (PixelSaverPoll(saver, &saveEvent)) {
+      if (saveEvent.ok) {
+        TraceLog(LOG_INFO, "Saved %s (%zu bytes, %.1f ms)", saveEvent.path, saveEvent.bytesWritten,
+                 saveEvent.seconds * 1000.0);
+        snprintf(saveStatus, sizeof(saveStatus), "Saved %.1f KB in %.0f ms", saveEvent.bytesWritten / 1024.0,
+                 saveEvent.seconds * 1000.0);
+      } else {
+        TraceLog(LOG_ERROR, "Error saving file: %s", saveEvent.path);
+        snprintf(saveStatus, sizeof(saveStatus), "Save failed");
+      }
+      saveStatusRevision++;
     }
 
     // ─────────── Drawing UI ─────────────
@@ -209,72 +514,96 @@ int main(void) {
     ClearBackground(GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR)));
 
     // ==== Top bar ====
-    if (!uiState.showQuitConfirm &&
-        GuiButton((Rectangle){ 10, 5, 100, 30 }, GuiIconText(ICON_FILE_SAVE, "Save as PNG")) &&
-        !drawingStrokeActive && !suppressUiActionsThisFrame) {
-      PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_SAVE_PNG);
-    }
-
-    if (!uiState.showQuitConfirm &&
-        GuiButton((Rectangle){ 120, 5, 100, 30 }, GuiIconText(ICON_FILE_EXPORT, "Save as TXT")) &&
-        !drawingStrokeActive && !suppressUiActionsThisFrame) {
-      PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_SAVE_TXT);
+    // Cached chrome is keyed on the loaded style, which trails the slider by one frame.
+    // Controls only react under the mouse, so they run live just while hovered
+    int loadedTheme = prevToggleThemeSliderActive;
+    Rectangle topBarBounds = {0, 0, dropdownBounds.x, gridOriginY};
+    if (CheckCollisionPointRec(mouse, topBarBounds)) {
+      TopBarAction action = DrawTopBar(!uiState.showQuitConfirm, &toggleThemeSliderActive);
+      if (!drawingStrokeActive && !suppressUiActionsThisFrame) {
+        if (action == TOP_BAR_SAVE_PNG) PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_SAVE_PNG);
+        else if (action == TOP_BAR_SAVE_TXT) PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_SAVE_TXT);
+        else if (action == TOP_BAR_LOAD_TXT) PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_LIBRARY);
+        else if (action == TOP_BAR_NEW_CANVAS) NewCanvas();
+      }
+    } else {
+      int topBarKey[3] = {loadedTheme, uiState.showQuitConfirm, toggleThemeSliderActive};
+      _Static_assert(sizeof(topBarKey) <= UI_LAYER_KEY_MAX, "top bar key exceeds UI_LAYER_KEY_MAX");
+      if (UiLayerBegin(&topBarLayer, topBarBounds, topBarKey, sizeof(topBarKey))) {
+        DrawTopBar(!uiState.showQuitConfirm, &toggleThemeSliderActive);
+        UiLayerEnd();
+      }
+      UiLayerDraw(&topBarLayer);
     }
 
-    if (!uiState.showQuitConfirm &&
-        GuiButton((Rectangle){ 230, 5, 100, 30 }, GuiIconText(ICON_FILE_OPEN, "Load TXT")) &&
-        !drawingStrokeActive && !suppressUiActionsThisFrame) {
-      PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_LOAD_TXT);
+    // Grid: flattened layers are drawn as one scaled texture over the background
+    SyncCanvasTexture();
+    DrawRectangleRec(gridBounds, GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR)));
+    DrawTexturePro(canvasTexture, (Rectangle){0, 0, GRID_SIZE, GRID_SIZE}, gridBounds, (Vector2){0, 0}, 0.0f, WHITE);
+    DrawGridOverlay(gridBounds);
+    DrawSelection(gridBounds, drawingStrokeActive && canvasTool != TOOL_BRUSH, gx, gy);
+
+    // Counts an edit could not record for lack of memory are rebuilt before anything reads them
+    if (document.colorsStale) PixelLayerStackRecountColors(&document);
+
+    // Palette: the colors pointer changes whenever a lazy palette is loaded or the registry grows,
+    // the revision when a file edit is reloaded in place, the usage when a visible badge would change
+    struct {
+      const PixelColor *colors;
+      int count;
+      int revision;
+      int theme;
+      int selected;
+      int hovered;
+      int scrollColumn;
+      uint64_t usage;
+    } swatchKey;
+    memset(&swatchKey, 0, sizeof(swatchKey));
+    swatchKey.colors = paletteColors;
+    swatchKey.count = paletteCount;
+    swatchKey.revision = paletteRevision;
+    swatchKey.theme = loadedTheme;
+    swatchKey.selected = selectedSwatch;
+    swatchKey.hovered = hoveredSwatch;
+    swatchKey.scrollColumn = swatchLayout.scrollColumn;
+    swatchKey.usage = VisibleSwatchUsage(paletteColors);
+    Rectangle swatchBounds = {swatchLayout.bounds.x, swatchLayout.bounds.y, swatchLayout.bounds.width,
+                              swatchLayout.bounds.height};
+    _Static_assert(sizeof(swatchKey) <= UI_LAYER_KEY_MAX, "swatch key exceeds UI_LAYER_KEY_MAX");
+    if (UiLayerBegin(&swatchLayer, swatchBounds, &swatchKey, sizeof(swatchKey))) {
+      DrawSwatches(paletteColors, hoveredSwatch);
+      UiLayerEnd();
     }
-
-    if (!uiState.showQuitConfirm &&
-        GuiButton((Rectangle){ 340, 5, 100, 30 }, GuiIconText(ICON_RUBBER, "New Canvas")) &&
-        !drawingStrokeActive && !suppressUiActionsThisFrame) NewCanvas();
-
-    // Light / Dark Slider
-    GuiSetStyle(SLIDER, SLIDER_PADDING, 2);
-    GuiToggleSlider((Rectangle){ 450, 5, 60, 30 }, "#142#;#142#", &toggleThemeSliderActive);
-    GuiSetStyle(SLIDER, SLIDER_PADDING, 0);
-
-    // Grid
-    for (int y = 0; y < GRID_SIZE; y++) {
-      for (int x = 0; x < GRID_SIZE; x++) {
-        Color col = (canvas[y][x].a == 0) ? GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR)) : canvas[y][x];
-        DrawRectangle(gridOriginX + x * PIXEL_SIZE, gridOriginY + y * PIXEL_SIZE, PIXEL_SIZE,
-                      PIXEL_SIZE, col);
-        DrawRectangleLines(gridOriginX + x * PIXEL_SIZE, gridOriginY + y * PIXEL_SIZE, PIXEL_SIZE,
-                           PIXEL_SIZE, GetColor(GuiGetStyle(DEFAULT, LINE_COLOR)));
+    UiLayerDraw(&swatchLayer);
+
+    // Palette picker: the list view reads names straight from the registry and
+    // only draws the visible rows, so thousands of palettes stay cheap
+    if (uiState.showQuitConfirm || !CheckCollisionPointRec(mouse, dropdownBounds)) {
+      int pickerKey[3] = {loadedTheme, uiState.showQuitConfirm ? -1 : currentPaletteIndex, dropdownActive};
+      _Static_assert(sizeof(pickerKey) <= UI_LAYER_KEY_MAX, "picker key exceeds UI_LAYER_KEY_MAX");
+      if (UiLayerBegin(&pickerLayer, dropdownBounds, pickerKey, sizeof(pickerKey))) {
+        if (!uiState.showQuitConfirm) {
+          GuiButton(dropdownBounds, GuiIconText(dropdownActive ? ICON_ARROW_UP_FILL : ICON_ARROW_DOWN_FILL,
+                                                PixelPaletteName(&paletteRegistry, currentPaletteIndex)));
+        }
+        UiLayerEnd();
       }
+      UiLayerDraw(&pickerLayer);
+    } else if (GuiButton(dropdownBounds, GuiIconText(dropdownActive ? ICON_ARROW_UP_FILL : ICON_ARROW_DOWN_FILL,
+                                                     PixelPaletteName(&paletteRegistry, currentPaletteIndex))) &&
+               !drawingStrokeActive && !suppressUiActionsThisFrame) {
+      dropdownActive = !dropdownActive;
     }
-
-    // Palette
-    int paletteX = gridOriginX + GRID_SIZE * PIXEL_SIZE + MARGIN;
-    int count = palettes[currentPaletteIndex].count;
-    int maxPerColumn = 8;  // Maximum number of items per column
-    for (int i = 0; i < count; i++) {
-      // Calculate the column and row based on the index
-      int column = i / maxPerColumn;  // 0 for first column, 1 for second column, etc.
-      int row = i % maxPerColumn;     // Row within the column
-      // Calculate the x and y positions
-      int xPosition = paletteX + column * (PALLETE_SIZE + MARGIN);  // Adjust x for each column
-      int yPosition = gridOriginY + row * PALLETE_SIZE;             // Y position based on row
-      // 1st option draw full rectangle (white palette colors not visible in light theme )
-      // DrawRectangle(xPosition, yPosition, PALLETE_SIZE, PALLETE_SIZE,
-      //               palettes[currentPaletteIndex].colors[i]);
-      // 2nd option - add paddings to rectangle and draw lines to get better contrast (though I do like it as much)
-      Rectangle recLines = {xPosition + PADDING, yPosition + PADDING, PALLETE_SIZE - PADDING * 2, PALLETE_SIZE - PADDING * 2};
-      DrawRectanglePro(recLines, (Vector2){0,0}, 0.0f, palettes[currentPaletteIndex].colors[i]);
-      DrawRectangleLinesEx(recLines, 1.0f, GetColor(GuiGetStyle(DEFAULT, LINE_COLOR)));
-    }
-
-    // Draw dropdown for palette selection using Raygui
-    if (!uiState.showQuitConfirm &&
-        GuiDropdownBox(dropdownBounds, dropdownBuffer, &selectedPaletteIndex, dropdownActive) &&
-        !drawingStrokeActive && !suppressUiActionsThisFrame) {
-      dropdownActive = !dropdownActive;                        // Toggle dropdown state
-      currentPaletteIndex = selectedPaletteIndex;              // Update the current palette index
-      currentColor = palettes[currentPaletteIndex].colors[0];  // Set the current color to the first
-                                                               // color of the selected palette
+    if (!uiState.showQuitConfirm && dropdownActive) {
+      int picked = currentPaletteIndex;
+      GuiListViewEx(paletteListBounds, (const char **)PixelPaletteRegistryNames(&paletteRegistry),
+                    paletteRegistry.count, &paletteListScroll, &picked, NULL);
+      if (picked != currentPaletteIndex) {
+        // Clicking the active row deselects it; keep the palette. Alt repaints the canvas in the new one
+        if (picked >= 0 && (IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT))) SwapPalette(picked);
+        else if (picked >= 0) SelectPalette(picked);
+        dropdownActive = 0;
+      }
     }
 
     if (!uiState.showQuitConfirm && uiState.showSavePngDialog) {
@@ -283,20 +612,91 @@ int main(void) {
         ShowTextInputBox(&uiState.showSaveTxtDialog, "Save file as TXT", btnSaveText);
     } else if (!uiState.showQuitConfirm && uiState.showLoadTxtDialog) {
         ShowTextInputBox(&uiState.showLoadTxtDialog, "Load TXT file", btnLoadText);
+    } else if (!uiState.showQuitConfirm && uiState.showSaveGifDialog) {
+        ShowTextInputBox(&uiState.showSaveGifDialog, "Save animation as GIF", btnSaveGif);
+    } else if (!uiState.showQuitConfirm && uiState.showLibraryBrowser) {
+        ShowLibraryBrowser();
+    }
+    if (library && !uiState.showLibraryBrowser) CloseLibraryBrowser();
+    if (closingLibrary && !PixelLibraryBusy(closingLibrary)) {
+      PixelLibraryClose(closingLibrary, NULL);
+      closingLibrary = NULL;
     }
 
-    // Bottom status bar
-    DrawRectangle(0, screenHeight - BOTTOM_BAR_HEIGHT, screenWidth, BOTTOM_BAR_HEIGHT, LIGHTGRAY);
-    DrawTextEx(uiFont,
-               TextFormat("Palette: %s | Color: #%02X%02X%02X | Brush: %d", palettes[currentPaletteIndex].name,
-                          currentColor.r, currentColor.g, currentColor.b, brushSize),
-               (Vector2){10, screenHeight - BOTTOM_BAR_HEIGHT + 8}, uiFont.baseSize * 0.26f, 1,
-               BLACK);
-    const char *quitHint = "Quit: Ctrl+Q";
-    DrawTextEx(uiFont, quitHint,
-               (Vector2){screenWidth - MeasureTextEx(uiFont, quitHint, uiFont.baseSize * 0.26f, 1).x - 10,
-                         screenHeight - BOTTOM_BAR_HEIGHT + 8},
-               uiFont.baseSize * 0.26f, 1, DARKGRAY);
+    RefreshOffPalette(paletteColors, paletteCount);
+    int offPaletteShown = offPaletteFound < OFF_PALETTE_SHOWN ? offPaletteFound : OFF_PALETTE_SHOWN;
+
+    // Bottom status bar, re-rendered only when one of the values it shows changes; text and
+    // off-palette chips are keyed by revision counters so the key stays within UI_LAYER_KEY_MAX
+    const PixelLayer *activeLayer = &document.layers[document.activeLayer];
+    struct {
+      int paletteIndex;
+      PixelColor color;
+      int brushSize;
+      int activeLayer;
+      int layerCount;
+      bool layerVisible;
+      int frame;
+      int frameCount;
+      int playbackFps;
+      int tool;
+      bool selectionActive;
+      int offPaletteGeneration;
+      int saveStatusRevision;
+    } statusKey;
+    memset(&statusKey, 0, sizeof(statusKey));
+    statusKey.paletteIndex = currentPaletteIndex;
+    statusKey.color = currentColor;
+    statusKey.brushSize = brushSize;
+    statusKey.activeLayer = document.activeLayer;
+    statusKey.layerCount = document.layerCount;
+    statusKey.layerVisible = activeLayer->visible;
+    statusKey.frame = animation.currentFrame;
+    statusKey.frameCount = animation.frameCount;
+    statusKey.playbackFps = animation.playing ? animation.fps : 0;
+    statusKey.tool = canvasTool;
+    statusKey.selectionActive = selectionActive;
+    statusKey.offPaletteGeneration = offPaletteGeneration;
+    statusKey.saveStatusRevision = saveStatusRevision;
+    Rectangle statusBounds = {0, screenHeight - BOTTOM_BAR_HEIGHT, screenWidth, BOTTOM_BAR_HEIGHT};
+    _Static_assert(sizeof(statusKey) <= UI_LAYER_KEY_MAX, "status key exceeds UI_LAYER_KEY_MAX");
+    if (UiLayerBegin(&statusLayer, statusBounds, &statusKey, sizeof(statusKey))) {
+      DrawRectangleRec(statusBounds, LIGHTGRAY);
+      char playback[16] = {0};
+      if (animation.playing) snprintf(playback, sizeof(playback), " @%dfps", animation.fps);
+      char tool[32] = {0};
+      if (canvasTool != TOOL_BRUSH || selectionActive) {
+        snprintf(tool, sizeof(tool), " | %s%s", canvasToolNames[canvasTool], selectionActive ? " (sel)" : "");
+      }
+      DrawTextEx(uiFont,
+                 TextFormat("Palette: %s | #%02X%02X%02X | Brush: %d%s | Layer: %d/%d%s | Frame: %d/%d%s",
+                            PixelPaletteName(&paletteRegistry, currentPaletteIndex), currentColor.r, currentColor.g,
+                            currentColor.b, brushSize, tool, document.activeLayer + 1, document.layerCount,
+                            activeLayer->visible ? "" : " (hidden)", animation.currentFrame + 1,
+                            animation.frameCount, playback),
+                 (Vector2){10, screenHeight - BOTTOM_BAR_HEIGHT + 8}, uiFont.baseSize * 0.26f, 1,
+                 BLACK);
+      const char *quitHint = saveStatus[0] != '\0' ? saveStatus : "Quit: Ctrl+Q";
+      float quitX = screenWidth - MeasureTextEx(uiFont, quitHint, uiFont.baseSize * 0.26f, 1).x - 10;
+      DrawTextEx(uiFont, quitHint, (Vector2){quitX, screenHeight - BOTTOM_BAR_HEIGHT + 8}, uiFont.baseSize * 0.26f, 1,
+                 DARKGRAY);
+      if (offPalettePixels > 0) {
+        // Flag pixels the palette cannot reproduce, with chips of the most used such colors
+        const char *offText = TextFormat("%zu px off palette", offPalettePixels);
+        float chipSize = BOTTOM_BAR_HEIGHT - 16;
+        float x = quitX - 20 - offPaletteShown * (chipSize + 4);
+        for (int i = 0; i < offPaletteShown; i++) {
+          Rectangle chip = {x + i * (chipSize + 4), screenHeight - BOTTOM_BAR_HEIGHT + 8, chipSize, chipSize};
+          DrawRectangleRec(chip, PixelToRaylibColor(offPaletteColors[i]));
+          DrawRectangleLinesEx(chip, 1.0f, DARKGRAY);
+        }
+        x -= MeasureTextEx(uiFont, offText, uiFont.baseSize * 0.26f, 1).x + 6;
+        DrawTextEx(uiFont, offText, (Vector2){x, screenHeight - BOTTOM_BAR_HEIGHT + 8}, uiFont.baseSize * 0.26f, 1,
+                   MAROON);
+      }
+      UiLayerEnd();
+    }
+    UiLayerDraw(&statusLayer);
 
     // Switch Light / Dark
     if (toggleThemeSliderActive != prevToggleThemeSliderActive)
@@ -322,15 +722,183 @@ int main(void) {
       }
     }
 
+    // Keep polling while frames change without input: playback, or background work to drain.
+    // File changes wake a sleeping loop through the watcher, which then runs until they are applied
+    bool idle = PixelRedrawFrameDone(&redraw, animation.playing || paletteLoader != NULL || PixelSaverBusy(saver) ||
+                                     PixelLibraryBusy(library) || PixelLibraryBusy(closingLibrary) ||
+                                     PixelWatcherPending(watcher));
+    if (idle != waitingForEvents) {
+      if (idle) EnableEventWaiting();
+      else DisableEventWaiting();
+      waitingForEvents = idle;
+    }
     EndDrawing();
+    if (profileStartup) {
+      PixelStartupMark(&startupProfile, "first frame");
+      PixelStartupDump(&startupProfile, stderr);
+      profileStartup = false;
+    }
     if (uiState.shouldQuit) break;
   }
 
+  UiLayerUnload(&topBarLayer);
+  UiLayerUnload(&pickerLayer);
+  UiLayerUnload(&swatchLayer);
+  UiLayerUnload(&statusLayer);
+  CloseLibraryBrowser();
+  PixelLibraryClose(closingLibrary, NULL);
+  PixelWatcherStop(watcher);
+  PixelLivePublisherDestroy(livePublisher);
+  // Saves already started are finished; leaving through the quit
+  // confirmation abandons unsaved work on purpose
+  PixelSaverDestroy(saver);
+  PixelJournalClose(journal, true);
+  UnloadTexture(canvasTexture);
+  UnloadTexture(selectionTexture);
+  DropFloating();
+  PixelMaskFree(&selection);
+  PixelMaskFree(&selectionShape);
+  free(lassoPoints);
+  PixelAnimFree(&animation);
+  PixelLayerStackFree(&document);
+  PixelJobPoolDestroy(jobPool);
   UnloadFont(uiFont);
+  PixelPaletteLoaderDestroy(paletteLoader);
+  PixelPaletteRegistryFree(&paletteRegistry);
   CloseWindow();
   return 0;
 }
 
+// Modal grid of library projects. Thumbnails are requested for the visible
+// rows only and drawn once they arrive; clicking a project loads it.
+static void ShowLibraryBrowser(void) {
+    if (!library) {
+        library = PixelLibraryOpen(libraryDir, thumbnailCachePath, -1);
+        for (int i = 0; i < LIBRARY_TEXTURES; i++) {
+            if (libraryTextures[i].id == 0) {
+                static const PixelColor blank[PIXEL_THUMB_SIZE * PIXEL_THUMB_SIZE];
+                libraryTextures[i] = LoadTextureFromImage(PixelImageView(blank, PIXEL_THUMB_SIZE, PIXEL_THUMB_SIZE));
+            }
+            libraryTextureIndex[i] = -1;
+        }
+    }
+
+    DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), Fade(DARKGRAY, 0.8f));
+    Rectangle bounds = {MARGIN * 2, TOP_BAR_HEIGHT + MARGIN, GetScreenWidth() - MARGIN * 4,
+                        GetScreenHeight() - TOP_BAR_HEIGHT - BOTTOM_BAR_HEIGHT - MARGIN * 2};
+    if (GuiWindowBox(bounds, GuiIconText(ICON_FILE_OPEN, TextFormat("Library (%d)", PixelLibraryCount(library)))) ||
+        IsKeyPressed(KEY_ESCAPE)) {
+        PixelUiLogicCloseDialog(&uiState, PIXEL_DIALOG_LIBRARY);
+        return;
+    }
+    if (GuiButton((Rectangle){bounds.x + bounds.width - 130, bounds.y + bounds.height - 34, 120, 24}, "By name...")) {
+        PixelUiLogicOpenDialog(&uiState, PIXEL_DIALOG_LOAD_TXT);
+        return;
+    }
+
+    Rectangle area = {bounds.x + 12, bounds.y + 32, bounds.width - 24, bounds.height - 76};
+    int columns = (int)(area.width / LIBRARY_CELL);
+    int rows = (int)(area.height / LIBRARY_CELL);
+    if (columns < 1) columns = 1;
+    if (rows < 1) rows = 1;
+    int count = PixelLibraryCount(library);
+    int totalRows = (count + columns - 1) / columns;
+    if (libraryScrollRow > totalRows - rows) libraryScrollRow = totalRows - rows;
+    if (libraryScrollRow < 0) libraryScrollRow = 0;
+
+    int first = libraryScrollRow * columns;
+    int end = first + rows * columns < count ? first + rows * columns : count;
+    PixelLibraryRequest(library, first, end);
+    if (count == 0) GuiLabel((Rectangle){area.x, area.y, area.width, 20}, "No saved projects yet.");
+
+    Vector2 mouse = GetMousePosition();
+    float thumbSize = LIBRARY_CELL - 32;
+    for (int index = first; index < end; index++) {
+        int cell = index - first;
+        Rectangle cellBounds = {area.x + (float)(cell % columns) * LIBRARY_CELL, area.y + (float)(cell / columns) * LIBRARY_CELL,
+                                LIBRARY_CELL - 4, LIBRARY_CELL - 4};
+        Rectangle thumbBounds = {cellBounds.x + (cellBounds.width - thumbSize) / 2, cellBounds.y + 4, thumbSize, thumbSize};
+        bool hovered = CheckCollisionPointRec(mouse, cellBounds);
+        DrawRectangleLinesEx(cellBounds, 1, GetColor(GuiGetStyle(DEFAULT, hovered ? BORDER_COLOR_FOCUSED : BORDER_COLOR_NORMAL)));
+
+        const PixelColor *thumb = PixelLibraryThumbnail(library, index);
+        int slot = index % LIBRARY_TEXTURES;
+        if (thumb && libraryTextureIndex[slot] != index) {
+            UpdateTexture(libraryTextures[slot], thumb);
+            libraryTextureIndex[slot] = index;
+        }
+        if (thumb) {
+            DrawTexturePro(libraryTextures[slot], (Rectangle){0, 0, PIXEL_THUMB_SIZE, PIXEL_THUMB_SIZE}, thumbBounds,
+                           (Vector2){0, 0}, 0.0f, WHITE);
+        } else {
+            DrawRectangleRec(thumbBounds, Fade(LIGHTGRAY, 0.5f));
+        }
+        GuiLabel((Rectangle){cellBounds.x + 4, thumbBounds.y + thumbSize + 4, cellBounds.width - 8, 16},
+                 PixelLibraryFileName(library, index));
+
+        if (hovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            btnLoadText(PixelLibraryFileName(library, index));
+            PixelUiLogicCloseDialog(&uiState, PIXEL_DIALOG_LIBRARY);
+            return;
+        }
+    }
+}
+
+// Release the browser's textures and stop its library, which writes the
+// thumbnail cache on its own thread and is freed once that is done.
+static void CloseLibraryBrowser(void) {
+    if (!library) return;
+    PixelLibraryClose(closingLibrary, NULL);  // One cache writer at a time
+    PixelLibraryStop(library);
+    closingLibrary = library;
+    library = NULL;
+    libraryScrollRow = 0;
+    for (int i = 0; i < LIBRARY_TEXTURES; i++) {
+        if (libraryTextures[i].id != 0) UnloadTexture(libraryTextures[i]);
+        libraryTextures[i] = (Texture2D){0};
+    }
+}
+
+// Runs on the watcher thread once changes are queued.
+static void WakeEventLoop(void *user) {
+    (void)user;
+    glfwPostEmptyEvent();
+}
+
+// Apply the file changes the watcher reported since the last frame. Only the
+// palette files that changed are parsed again; an open library browser is
+// reopened at the same row, and its cache re-renders just the changed projects.
+static void ApplyWatchEvents(void) {
+    PixelWatchEvent event;
+    bool libraryChanged = false;
+    while (PixelWatcherPoll(watcher, &event)) {
+        if (event.kind == PIXEL_WATCH_OVERFLOW) {
+            // Changes were dropped: reload every palette file and the browser
+            PixelPaletteFile *files = NULL;
+            int count = PixelPaletteListDir(palettesDir, &files);
+            for (int i = 0; i < count; i++) PixelPaletteRegistryReloadFile(&paletteRegistry, files[i].path);
+            PixelPaletteFreeFileList(files, count);
+            paletteRevision++;
+            libraryChanged = true;
+        } else if (event.dir == WATCH_PALETTES && PixelPaletteHasImporter(event.fileName)) {
+            const char *path = TextFormat("%s/%s", palettesDir, event.fileName);
+            if (event.kind == PIXEL_WATCH_REMOVED) {
+                TraceLog(LOG_INFO, "Palette file %s was removed; it stays listed until restart.", event.fileName);
+            } else if (PixelPaletteRegistryReloadFile(&paletteRegistry, path) >= 0) {
+                TraceLog(LOG_INFO, "Reloaded palette %s", event.fileName);
+                paletteRevision++;
+            }
+        } else if (event.dir == WATCH_LIBRARY && IsFileExtension(event.fileName, ".txt")) {
+            libraryChanged = true;
+        }
+    }
+    if (libraryChanged && library) {
+        int row = libraryScrollRow;
+        CloseLibraryBrowser();
+        libraryScrollRow = row;
+    }
+}
+
 //------------------------------------------------------------------------------------
 // Controls Functions Definitions
 //------------------------------------------------------------------------------------
@@ -373,23 +941,26 @@ static void btnSaveAsPNG(const char * textInput) {
   char pngPath[1024];
   if (!PixelBuildFilePath(libraryDir, textInput, ".png", pngPath, sizeof(pngPath))) return;
 
-  Image image = GenImageColor(GRID_SIZE, GRID_SIZE, BLANK);
-  for (int y = 0; y < GRID_SIZE; y++)
-    for (int x = 0; x < GRID_SIZE; x++) ImageDrawPixel(&image, x, y, canvas[y][x]);
-  ExportImage(image, pngPath);
-  UnloadImage(image);
+  ExportImage(PixelImageView(PixelLayerStackFlatten(&document), GRID_SIZE, GRID_SIZE), pngPath);
 
   // Keep a loadable project snapshot alongside every PNG export.
   btnSaveText(textInput);
 }
 
-// Save current canvas in reloadable text format.
+// Save current canvas in reloadable text format. The flattened pixels are
+// copied and written in the background; the result arrives as a save event.
 static void btnSaveText(const char *filename) {
     char newFilename[1024];
     if (!PixelBuildFilePath(libraryDir, filename, ".txt", newFilename, sizeof(newFilename))) return;
-    if (!PixelSaveCanvasText(newFilename, &canvas[0][0], GRID_SIZE)) {
+    if (!PixelSaverSubmit(saver, newFilename, PixelLayerStackFlatten(&document), GRID_SIZE)) {
       TraceLog(LOG_ERROR, "Error saving file: %s", newFilename);
+      return;
     }
+    snprintf(saveStatus, sizeof(saveStatus), "Saving...");
+    saveStatusRevision++;
+    // The TXT file only keeps the flattened image, so the journal restarts from a full snapshot
+    JournalPendingTiles();
+    PixelJournalCompact(journal, &document);
 }
 
 // Load canvas from text project format.
@@ -401,24 +972,567 @@ static void btnLoadText(const char *filename) {
         return;
     }
 
-    // Reset the canvas to transparent values
+    // Reset the canvas to a single transparent layer
     NewCanvas();
 
-    if (!PixelLoadCanvasText(newFilename, &canvas[0][0], GRID_SIZE)) {
+    PixelLayerStackBeginEdit(&document, document.activeLayer, 0, 0, GRID_SIZE, GRID_SIZE);
+    if (!PixelLoadCanvasText(newFilename, document.layers[document.activeLayer].pixels, GRID_SIZE)) {
       TraceLog(LOG_ERROR, "Could not parse file: %s", newFilename);
     }
+    PixelLayerStackEndEdit(&document, document.activeLayer, 0, 0, GRID_SIZE, GRID_SIZE);
+    TrackFrameEdit(0, 0, GRID_SIZE, GRID_SIZE);
+}
+
+// Export every animation frame to GIF using the active palette.
+static void btnSaveGif(const char *filename) {
+  char gifPath[1024];
+  if (!PixelBuildFilePath(libraryDir, filename, ".gif", gifPath, sizeof(gifPath))) return;
+
+  StoreCurrentFrame();
+  int shownFrame = animation.currentFrame;
+  size_t frameBytes = (size_t)document.width * (size_t)document.height * sizeof(PixelColor);
+  PixelColor **frames = (PixelColor **)calloc((size_t)animation.frameCount, sizeof(PixelColor *));
+  bool ok = frames != NULL;
+
+  // Frames are flattened by stepping the document through the timeline.
+  for (int i = 0; ok && i < animation.frameCount; i++) {
+    frames[i] = (PixelColor *)malloc(frameBytes);
+    if (!frames[i]) {
+      ok = false;
+      break;
+    }
+    ShowFrame(i);
+    memcpy(frames[i], PixelLayerStackFlattenRect(&document, jobPool, 0, 0, document.width, document.height), frameBytes);
+  }
+  ShowFrame(shownFrame);
+
+  if (ok) {
+    int paletteCount = 0;
+    const PixelColor *palette = PixelPaletteColors(&paletteRegistry, currentPaletteIndex, &paletteCount);
+    PixelGifOptions options = {
+        .palette = palette,
+        .paletteCount = paletteCount,
+        .perFramePalette = false,
+        .fps = animation.fps,
+        .loopCount = 0,
+    };
+    ok = PixelGifSave(gifPath, (const PixelColor *const *)frames, animation.frameCount, document.width,
+                      document.height, &options, jobPool);
+  }
+  if (!ok) TraceLog(LOG_ERROR, "Error saving file: %s", gifPath);
+
+  for (int i = 0; frames && i < animation.frameCount; i++) free(frames[i]);
+  free(frames);
 }
 
-// Reset all canvas cells to transparent.
+// Reset the document to one transparent layer and a single-frame timeline.
 static void NewCanvas() {
-  for (int y = 0; y < GRID_SIZE; y++) {
-      for (int x = 0; x < GRID_SIZE; x++)
-          canvas[y][x] = BLANK;
+  DropFloating();
+  while (document.layerCount > 0) PixelLayerStackRemoveLayer(&document, document.layerCount - 1);
+  PixelLayerStackAddLayer(&document, NULL);
+  PixelLayerStackMarkAllDirty(&document);
+
+  PixelAnimFree(&animation);
+  PixelAnimInit(&animation, GRID_SIZE, GRID_SIZE, document.layerCount, PIXEL_ANIM_DEFAULT_FPS);
+  frameEdited = false;
+  journalTileLayer = -1;
+  journalSnapshotDue = true;
+}
+
+// Paint into the active layer and remember the area for frame encoding.
+static void PaintActiveLayer(int gx, int gy, PixelColor color, int brushSize) {
+  PixelLayerStackPaintBrushMasked(&document, document.activeLayer, gx, gy, color, brushSize,
+                                  selectionActive ? &selection : NULL);
+  TrackFrameEdit(gx - brushSize / 2, gy - brushSize / 2, brushSize, brushSize);
+  if (saveStatus[0] != '\0') {
+    saveStatus[0] = '\0';
+    saveStatusRevision++;
+  }
+
+  if (journalTileLayer != document.activeLayer) JournalPendingTiles();
+  journalTileLayer = document.activeLayer;
+  int x0 = gx - brushSize / 2, y0 = gy - brushSize / 2;
+  for (int ty = y0 / PIXEL_TILE_SIZE; ty <= (y0 + brushSize - 1) / PIXEL_TILE_SIZE; ty++) {
+    for (int tx = x0 / PIXEL_TILE_SIZE; tx <= (x0 + brushSize - 1) / PIXEL_TILE_SIZE; tx++) {
+      if (tx >= 0 && ty >= 0 && tx < JOURNAL_TILES_PER_SIDE && ty < JOURNAL_TILES_PER_SIDE) {
+        journalTiles[ty * JOURNAL_TILES_PER_SIDE + tx] = 1;
+      }
+    }
+  }
+}
+
+// Append the tiles painted since the last record, if any.
+static void JournalPendingTiles(void) {
+  if (journalTileLayer >= 0 && journalTileLayer < document.layerCount) {
+    PixelJournalWriteTiles(journal, &document, journalTileLayer, journalTiles);
+  }
+  memset(journalTiles, 0, sizeof(journalTiles));
+  journalTileLayer = -1;
+}
+
+// Record finished strokes and structural changes once no button is held and
+// playback is stopped, then compact when the journal has grown long.
+static void UpdateAutosave(void) {
+  if (!journal || animation.playing || IsMouseButtonDown(MOUSE_LEFT_BUTTON) || IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) {
+    return;
+  }
+  size_t snapshotBytes = (size_t)document.layerCount * (size_t)GRID_SIZE * GRID_SIZE * sizeof(PixelColor);
+  bool compactDue = PixelJournalSize(journal) > JOURNAL_COMPACT_RATIO * snapshotBytes;
+  // Moved pixels are journaled as if dropped where they are, so a crash mid-move keeps them
+  PixelLayerStack preview;
+  const PixelLayerStack *saved = &document;
+  if (floatingActive && (journalSnapshotDue || journalTileLayer >= 0 || compactDue)) {
+    if (!BuildFloatingPreview(&preview)) return;
+    saved = &preview;
+    journalSnapshotDue = true;
+  }
+  if (journalSnapshotDue) {
+    journalTileLayer = -1;
+    memset(journalTiles, 0, sizeof(journalTiles));
+    PixelJournalWriteSnapshot(journal, saved);
+    journalSnapshotDue = false;
+  } else {
+    JournalPendingTiles();
+  }
+  if (compactDue) PixelJournalCompact(journal, saved);
+  if (saved == &preview) PixelLayerStackFree(&preview);
+}
+
+static void TrackFrameEdit(int x, int y, int width, int height) {
+  if (!frameEdited) {
+    frameEditX0 = x;
+    frameEditY0 = y;
+    frameEditX1 = x + width;
+    frameEditY1 = y + height;
+    frameEdited = true;
+    return;
+  }
+  if (x < frameEditX0) frameEditX0 = x;
+  if (y < frameEditY0) frameEditY0 = y;
+  if (x + width > frameEditX1) frameEditX1 = x + width;
+  if (y + height > frameEditY1) frameEditY1 = y + height;
+}
+
+// Layer pixel buffers in stack order, as animation planes; caller frees.
+static PixelColor **DocumentPlanes(void) {
+  PixelColor **planes = (PixelColor **)malloc((size_t)document.layerCount * sizeof(PixelColor *));
+  if (!planes) return NULL;
+  for (int i = 0; i < document.layerCount; i++) planes[i] = document.layers[i].pixels;
+  return planes;
+}
+
+// Encode pending edits of the document layers into the current frame.
+static void StoreCurrentFrame(void) {
+  if (!frameEdited || document.layerCount <= 0) return;
+
+  PixelColor **planes = DocumentPlanes();
+  if (!planes) return;
+  PixelAnimStoreFrameRect(&animation, animation.currentFrame, planes, frameEditX0, frameEditY0,
+                          frameEditX1 - frameEditX0, frameEditY1 - frameEditY0);
+  free(planes);
+  frameEdited = false;
+}
+
+// Decoded tiles replace layer pixels wholesale; uncount and recount just those tiles.
+static void BeginDecodedTile(void *user, int plane, int x, int y, int width, int height) {
+  (void)user;
+  PixelLayerStackBeginEdit(&document, plane, x, y, width, height);
+}
+
+static void EndDecodedTile(void *user, int plane, int x, int y, int width, int height) {
+  (void)user;
+  PixelLayerStackEndEdit(&document, plane, x, y, width, height);
+}
+
+// Switch to a frame; only tiles that differ are rewritten and re-uploaded.
+static void ShowFrame(int index) {
+  StoreCurrentFrame();
+  if (index < 0 || index >= animation.frameCount) return;
+  animation.currentFrame = index;
+
+  PixelColor **planes = DocumentPlanes();
+  if (!planes) return;
+  PixelAnimDecodeFrameEx(&animation, index, planes, BeginDecodedTile, EndDecodedTile, NULL);
+  free(planes);
+  journalSnapshotDue = true;
+}
+
+// Frame keys: Left/Right step, Ctrl+D duplicate as delta frame, Ctrl+K toggle
+// keyframe, Shift+Delete remove frame, Space play/pause, -/= change FPS.
+static void HandleFrameShortcuts(void) {
+  bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+  bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+  int current = animation.currentFrame;
+
+  if (IsKeyPressed(KEY_RIGHT)) {
+    ShowFrame((current + 1) % animation.frameCount);
+  } else if (IsKeyPressed(KEY_LEFT)) {
+    ShowFrame((current + animation.frameCount - 1) % animation.frameCount);
+  } else if (ctrl && IsKeyPressed(KEY_D)) {
+    StoreCurrentFrame();
+    PixelColor **planes = DocumentPlanes();
+    if (!planes) return;
+    if (PixelAnimInsertFrame(&animation, current + 1, false, planes) >= 0) animation.currentFrame = current + 1;
+    free(planes);
+  } else if (ctrl && IsKeyPressed(KEY_K)) {
+    StoreCurrentFrame();
+    PixelAnimSetKeyframe(&animation, current, !animation.frames[current].keyframe);
+  } else if (shift && IsKeyPressed(KEY_DELETE) && animation.frameCount > 1) {
+    frameEdited = false;
+    PixelAnimDeleteFrame(&animation, current);
+    ShowFrame(animation.currentFrame);
+  } else if (IsKeyPressed(KEY_SPACE)) {
+    StoreCurrentFrame();
+    animation.playing = !animation.playing;
+    animation.frameTimer = 0.0;
+  } else if (IsKeyPressed(KEY_MINUS)) {
+    PixelAnimSetFps(&animation, animation.fps - 1);
+  } else if (IsKeyPressed(KEY_EQUAL)) {
+    PixelAnimSetFps(&animation, animation.fps + 1);
+  }
+}
+
+// Recomposite stale visible tiles in parallel and upload only the changed rows (also to the live link).
+static void SyncCanvasTexture(void) {
+  const PixelColor *flattened = PixelLayerStackFlattenRect(&document, jobPool, 0, 0, document.width, document.height);
+  int y0 = 0, y1 = 0;
+  bool changed = PixelLayerStackTakeChangedRows(&document, &y0, &y1);
+  if (changed) {
+    UpdateTextureRec(canvasTexture, (Rectangle){0, (float)y0, (float)document.width, (float)(y1 - y0)},
+                     flattened + (size_t)y0 * (size_t)document.width);
+  }
+  if (!livePublisher) return;
+
+  // The floating pixels are drawn as their own quad here, but the game sees them in place
+  PixelLayerStack preview;
+  if (floatingActive && (changed || floatingPreviewDue) && BuildFloatingPreview(&preview)) {
+    PixelLivePublish(livePublisher, PixelLayerStackFlatten(&preview), 0, 0, document.width, document.height);
+    PixelLayerStackFree(&preview);
+    floatingPreviewDue = false;
+  } else if (changed) {
+    PixelLivePublish(livePublisher, flattened, 0, y0, document.width, y1 - y0);
+  }
+}
+
+// Look up the off-palette colors again if the counts or the palette changed since the last frame.
+static void RefreshOffPalette(const PixelColor *colors, int count) {
+  if (offPaletteKey.usage == document.colors.revision && offPaletteKey.colors == colors &&
+      offPaletteKey.count == count && offPaletteKey.revision == paletteRevision) {
+    return;
+  }
+  offPaletteKey.usage = document.colors.revision;
+  offPaletteKey.colors = colors;
+  offPaletteKey.count = count;
+  offPaletteKey.revision = paletteRevision;
+
+  PixelColor shownColors[OFF_PALETTE_SHOWN];
+  memcpy(shownColors, offPaletteColors, sizeof(shownColors));
+  size_t shownPixels = offPalettePixels;
+  int shownFound = offPaletteFound;
+  offPalettePixels = PixelHistogramPaletteUsage(&document.colors, colors, count, NULL);
+  offPaletteFound = offPalettePixels > 0 ? PixelHistogramOffPalette(&document.colors, colors, count, offPaletteColors,
+                                                                    offPaletteCounts, OFF_PALETTE_SHOWN)
+                                         : 0;
+  int shown = offPaletteFound < OFF_PALETTE_SHOWN ? offPaletteFound : OFF_PALETTE_SHOWN;
+  if (offPalettePixels != shownPixels || offPaletteFound != shownFound ||
+      memcmp(shownColors, offPaletteColors, (size_t)shown * sizeof(PixelColor)) != 0) {
+    offPaletteGeneration++;
+  }
+}
+
+// Selection keys: M cycles the canvas tool, Ctrl+A selects all, Ctrl+I inverts, Escape deselects.
+static void HandleSelectionShortcuts(void) {
+  bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+  if (!ctrl && IsKeyPressed(KEY_M)) {
+    canvasTool = (CanvasTool)((canvasTool + 1) % TOOL_COUNT);
+  } else if (ctrl && IsKeyPressed(KEY_A)) {
+    PixelMaskSelectAll(&selection);
+    SelectionChanged();
+  } else if (ctrl && IsKeyPressed(KEY_I)) {
+    PixelMaskInvert(&selection);
+    SelectionChanged();
+  } else if (IsKeyPressed(KEY_ESCAPE) && selectionActive) {
+    PixelMaskClear(&selection);
+    SelectionChanged();
+  }
+}
+
+static int ClampToGrid(int cell) {
+  return cell < 0 ? 0 : (cell >= GRID_SIZE ? GRID_SIZE - 1 : cell);
+}
+
+static void BeginSelectionDrag(int gx, int gy) {
+  if (canvasTool == TOOL_MOVE) {
+    if (!floatingActive && (animation.playing || !LiftFloating())) return;
+    floatingGrabX = gx - floating.x;
+    floatingGrabY = gy - floating.y;
+    return;
+  }
+  selectionAnchorX = ClampToGrid(gx);
+  selectionAnchorY = ClampToGrid(gy);
+  lassoCount = 0;
+  TrackSelectionDrag(gx, gy);
+}
+
+// A lasso records every cell the pointer enters and a move drags the floating
+// pixels along; other tools only need the anchor.
+static void TrackSelectionDrag(int gx, int gy) {
+  if (canvasTool == TOOL_MOVE && floatingActive && (floating.x != gx - floatingGrabX || floating.y != gy - floatingGrabY)) {
+    floating.x = gx - floatingGrabX;
+    floating.y = gy - floatingGrabY;
+    FloatingChanged();
+  }
+  if (canvasTool != TOOL_SELECT_LASSO) return;
+  PixelMaskPoint point = {ClampToGrid(gx), ClampToGrid(gy)};
+  if (lassoCount > 0 && lassoPoints[lassoCount - 1].x == point.x && lassoPoints[lassoCount - 1].y == point.y) return;
+  if (lassoCount == lassoCapacity) {
+    int capacity = lassoCapacity > 0 ? lassoCapacity * 2 : 64;
+    PixelMaskPoint *points = (PixelMaskPoint *)realloc(lassoPoints, (size_t)capacity * sizeof(PixelMaskPoint));
+    if (!points) return;
+    lassoPoints = points;
+    lassoCapacity = capacity;
+  }
+  lassoPoints[lassoCount++] = point;
+}
+
+// Build the dragged shape and combine it into the selection using the held modifiers.
+static void FinishSelectionDrag(int gx, int gy) {
+  if (canvasTool == TOOL_MOVE) return;  // The pixels keep floating until dropped
+  int x = ClampToGrid(gx), y = ClampToGrid(gy);
+  if (canvasTool == TOOL_SELECT_RECT) {
+    int x0 = x < selectionAnchorX ? x : selectionAnchorX, y0 = y < selectionAnchorY ? y : selectionAnchorY;
+    PixelMaskRect(&selectionShape, x0, y0, abs(x - selectionAnchorX) + 1, abs(y - selectionAnchorY) + 1);
+  } else if (canvasTool == TOOL_SELECT_LASSO) {
+    TrackSelectionDrag(gx, gy);
+    PixelMaskPolygon(&selectionShape, lassoPoints, lassoCount);
+  } else {
+    PixelMaskMagicWand(&selectionShape, document.layers[document.activeLayer].pixels, selectionAnchorX,
+                       selectionAnchorY, MAGIC_WAND_TOLERANCE);
+  }
+
+  bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+  bool alt = IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
+  PixelMaskOp op = shift && alt ? PIXEL_MASK_INTERSECT :
+                   shift        ? PIXEL_MASK_UNION :
+                   alt          ? PIXEL_MASK_SUBTRACT : PIXEL_MASK_REPLACE;
+  PixelMaskCombine(&selection, &selectionShape, op);
+  SelectionChanged();
+}
+
+// Refresh what depends on the selection: whether painting is clipped, and the overlay.
+static void SelectionChanged(void) {
+  selectionActive = !PixelMaskEmpty(&selection);
+  PixelMaskExpand(&selection, selectionOverlay, (PixelColor){102, 191, 255, 96}, PIXEL_BLANK);
+  UpdateTexture(selectionTexture, selectionOverlay);
+}
+
+// Draw floating pixels, tint the selected ones and outline the shape being dragged out.
+static void DrawSelection(Rectangle bounds, bool dragging, int gx, int gy) {
+  if (floatingActive) {
+    Rectangle target = {bounds.x + floating.x * PIXEL_SIZE, bounds.y + floating.y * PIXEL_SIZE,
+                        floating.mask.width * PIXEL_SIZE, floating.mask.height * PIXEL_SIZE};
+    BeginScissorMode((int)bounds.x, (int)bounds.y, (int)bounds.width, (int)bounds.height);
+    DrawTexturePro(floatingTexture, (Rectangle){0, 0, floating.mask.width, floating.mask.height}, target,
+                   (Vector2){0, 0}, 0.0f, WHITE);
+    DrawRectangleLinesEx(target, 2, Fade(BLUE, 0.7f));
+    EndScissorMode();
+  }
+  if (selectionActive) {
+    DrawTexturePro(selectionTexture, (Rectangle){0, 0, GRID_SIZE, GRID_SIZE}, bounds, (Vector2){0, 0}, 0.0f, WHITE);
+  }
+  if (!dragging) return;
+  int x = ClampToGrid(gx), y = ClampToGrid(gy);
+  if (canvasTool == TOOL_SELECT_RECT) {
+    int x0 = x < selectionAnchorX ? x : selectionAnchorX, y0 = y < selectionAnchorY ? y : selectionAnchorY;
+    DrawRectangleLinesEx((Rectangle){bounds.x + x0 * PIXEL_SIZE, bounds.y + y0 * PIXEL_SIZE,
+                                     (abs(x - selectionAnchorX) + 1) * PIXEL_SIZE,
+                                     (abs(y - selectionAnchorY) + 1) * PIXEL_SIZE},
+                         2, BLUE);
+  } else if (canvasTool == TOOL_SELECT_LASSO) {
+    for (int i = 0; i < lassoCount; i++) {
+      const PixelMaskPoint *a = &lassoPoints[i], *b = &lassoPoints[(i + 1) % lassoCount];
+      DrawLineEx((Vector2){bounds.x + (a->x + 0.5f) * PIXEL_SIZE, bounds.y + (a->y + 0.5f) * PIXEL_SIZE},
+                 (Vector2){bounds.x + (b->x + 0.5f) * PIXEL_SIZE, bounds.y + (b->y + 0.5f) * PIXEL_SIZE}, 2,
+                 i + 1 == lassoCount ? Fade(BLUE, 0.4f) : BLUE);
+    }
+  }
+}
+
+static void UploadFloatingTexture(void) {
+  if (floatingTexture.id != 0) UnloadTexture(floatingTexture);
+  floatingTexture = LoadTextureFromImage(PixelImageView(floating.pixels, floating.mask.width, floating.mask.height));
+}
+
+// Cut the selection, or the whole layer when nothing is selected, out of the active layer.
+// The lifted pixels stay in the color counts until the floating buffer is dropped.
+static bool LiftFloating(void) {
+  if (!selectionActive) PixelMaskSelectAll(&selection);
+  PixelColor *pixels = document.layers[document.activeLayer].pixels;
+  if (!PixelFloatingLift(&floating, pixels, GRID_SIZE, GRID_SIZE, &selection)) {
+    if (!selectionActive) PixelMaskClear(&selection);
+    return false;
+  }
+  floatingActive = true;
+  PixelLayerStackMarkDirty(&document, floating.x, floating.y, floating.mask.width, floating.mask.height);
+  TrackFrameEdit(floating.x, floating.y, floating.mask.width, floating.mask.height);
+  FloatingChanged();
+  PixelMaskClear(&selection);
+  SelectionChanged();
+  UploadFloatingTexture();
+  return true;
+}
+
+// Write the floating pixels into the active layer where they are now; they stay selected.
+static void CommitFloating(void) {
+  if (!floatingActive) return;
+  PixelLayerStackBeginEdit(&document, document.activeLayer, floating.x, floating.y, floating.mask.width,
+                           floating.mask.height);
+  PixelFloatingBlit(&floating, document.layers[document.activeLayer].pixels, GRID_SIZE, GRID_SIZE);
+  PixelLayerStackEndEdit(&document, document.activeLayer, floating.x, floating.y, floating.mask.width,
+                         floating.mask.height);
+  TrackFrameEdit(floating.x, floating.y, floating.mask.width, floating.mask.height);
+  journalSnapshotDue = true;
+  PixelFloatingPlaceMask(&floating, &selection);
+  SelectionChanged();
+  DropFloating();
+}
+
+// Discard the floating pixels without writing them back.
+static void DropFloating(void) {
+  if (floatingActive) {
+    PixelHistogramRemovePixels(&document.colors, floating.pixels, (size_t)floating.mask.width * floating.mask.height);
+  }
+  if (floatingTexture.id != 0) UnloadTexture(floatingTexture);
+  floatingTexture = (Texture2D){0};
+  PixelFloatingFree(&floating);
+  floatingActive = false;
+  floatingPreviewDue = false;
+}
+
+// The floating pixels moved or changed shape: the journal and the live link need them again.
+static void FloatingChanged(void) {
+  journalSnapshotDue = true;
+  floatingPreviewDue = true;
+}
+
+// The document as it will be once the floating pixels are dropped where they are now, as a
+// separate stack for the journal and the live link. Caller frees it.
+static bool BuildFloatingPreview(PixelLayerStack *preview) {
+  if (!PixelLayerStackInit(preview, document.width, document.height)) return false;
+  size_t layerBytes = (size_t)document.width * (size_t)document.height * sizeof(PixelColor);
+  for (int i = 0; i < document.layerCount; i++) {
+    const PixelLayer *layer = &document.layers[i];
+    int index = PixelLayerStackAddLayer(preview, layer->name);
+    if (index < 0) {
+      PixelLayerStackFree(preview);
+      return false;
+    }
+    PixelLayer *copy = &preview->layers[index];
+    copy->visible = layer->visible;
+    copy->opacity = layer->opacity;
+    copy->blendMode = layer->blendMode;
+    memcpy(copy->pixels, layer->pixels, layerBytes);
+  }
+  preview->activeLayer = document.activeLayer;
+  PixelFloatingBlit(&floating, preview->layers[preview->activeLayer].pixels, preview->width, preview->height);
+  return true;
+}
+
+// Floating keys: H and V flip, R rotates clockwise (Shift+R counter-clockwise),
+// Enter or Escape drop the pixels, M drops them and switches tool.
+static void HandleFloatingShortcuts(void) {
+  bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+  bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+  if (ctrl) return;
+  if (IsKeyPressed(KEY_H) || IsKeyPressed(KEY_V)) {
+    if (PixelFloatingFlip(&floating, IsKeyPressed(KEY_H))) {
+      UploadFloatingTexture();
+      FloatingChanged();
+    }
+  } else if (IsKeyPressed(KEY_R)) {
+    if (PixelFloatingRotate(&floating, !shift)) {
+      UploadFloatingTexture();
+      FloatingChanged();
+    }
+  } else if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_ESCAPE)) {
+    CommitFloating();
+  } else if (IsKeyPressed(KEY_M)) {
+    CommitFloating();
+    canvasTool = (CanvasTool)((canvasTool + 1) % TOOL_COUNT);
+  }
+}
+
+// Canvas keys: Ctrl+R turns every layer clockwise (Ctrl+Shift+R counter-clockwise), Ctrl+M mirrors
+// them left to right (Ctrl+Shift+M top to bottom). The selection would no longer match, so it is dropped.
+static void HandleCanvasTransformShortcuts(void) {
+  bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+  bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+  if (!ctrl) return;
+  PixelTransform transform;
+  if (IsKeyPressed(KEY_R)) {
+    transform = shift ? PIXEL_TRANSFORM_ROTATE_270 : PIXEL_TRANSFORM_ROTATE_90;
+  } else if (IsKeyPressed(KEY_M)) {
+    transform = shift ? PIXEL_TRANSFORM_FLIP_VERTICAL : PIXEL_TRANSFORM_FLIP_HORIZONTAL;
+  } else {
+    return;
+  }
+
+  // The canvas is square, so every transform runs in place
+  for (int i = 0; i < document.layerCount; i++) {
+    PixelTransformCanvas(document.layers[i].pixels, GRID_SIZE, GRID_SIZE, transform);
+  }
+  PixelLayerStackMarkAllDirty(&document);
+  TrackFrameEdit(0, 0, GRID_SIZE, GRID_SIZE);
+  journalSnapshotDue = true;
+  PixelMaskClear(&selection);
+  SelectionChanged();
+}
+
+// Layer keys: Ctrl+L add, Ctrl+Delete remove, PageUp/PageDown select,
+// Ctrl+H toggle visibility, Ctrl+B cycle blend mode, [ and ] change opacity.
+static void HandleLayerShortcuts(void) {
+  bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+  int active = document.activeLayer;
+  const PixelLayer *layer = &document.layers[active];
+
+  // Selecting a layer is not journaled; every other change needs a snapshot
+  if (ctrl && IsKeyPressed(KEY_L)) {
+    journalSnapshotDue = true;
+    int added = PixelLayerStackAddLayer(&document, NULL);
+    if (added >= 0) PixelAnimInsertPlane(&animation, added);
+  } else if (ctrl && IsKeyPressed(KEY_DELETE) && document.layerCount > 1) {
+    // The layer disappears from every frame of the timeline.
+    StoreCurrentFrame();
+    journalSnapshotDue = true;
+    PixelLayerStackRemoveLayer(&document, active);
+    PixelAnimRemovePlane(&animation, active);
+  } else if (IsKeyPressed(KEY_PAGE_UP) && active + 1 < document.layerCount) {
+    document.activeLayer = active + 1;
+  } else if (IsKeyPressed(KEY_PAGE_DOWN) && active > 0) {
+    document.activeLayer = active - 1;
+  } else if (ctrl && IsKeyPressed(KEY_H)) {
+    journalSnapshotDue = true;
+    PixelLayerStackSetVisible(&document, active, !layer->visible);
+  } else if (ctrl && IsKeyPressed(KEY_B)) {
+    journalSnapshotDue = true;
+    PixelLayerStackSetBlendMode(&document, active, (PixelBlendMode)((layer->blendMode + 1) % PIXEL_BLEND_COUNT));
+  } else if (IsKeyPressed(KEY_LEFT_BRACKET)) {
+    journalSnapshotDue = true;
+    PixelLayerStackSetOpacity(&document, active, (unsigned char)(layer->opacity > 32 ? layer->opacity - 32 : 0));
+  } else if (IsKeyPressed(KEY_RIGHT_BRACKET)) {
+    journalSnapshotDue = true;
+    PixelLayerStackSetOpacity(&document, active, (unsigned char)(layer->opacity < 223 ? layer->opacity + 32 : 255));
   }
 }
 
 // Resolve runtime asset and user data paths for the active platform/layout.
 static void InitRuntimePaths(void) {
+#if defined(PIXEL_EMBED_ASSETS)
+  // Font and palettes are compiled in, so nothing is probed; the palettes
+  // directory defaults to the user's own collection next to the library
+  fontPath[0] = '\0';
+  palettesDir[0] = '\0';
+#else
   // Development mode defaults (assets from repository root)
   TextCopy(fontPath, "fonts/PressStart2P-Regular.ttf");
   TextCopy(palettesDir, "palettes");
@@ -433,114 +1547,286 @@ static void InitRuntimePaths(void) {
       snprintf(palettesDir, sizeof(palettesDir), "%s/palettes", shareDir);
     }
   }
+#endif
+
+  // Explicit overrides replace the bundled or installed assets
+  const char *fontOverride = getenv("PIXEL_FONT");
+  if (fontOverride && fontOverride[0] != '\0') snprintf(fontPath, sizeof(fontPath), "%s", fontOverride);
+  const char *palettesOverride = getenv("PIXEL_PALETTES_DIR");
+  if (palettesOverride && palettesOverride[0] != '\0') {
+    snprintf(palettesDir, sizeof(palettesDir), "%s", palettesOverride);
+    palettesDirOverride = true;
+  }
 
   InitUserLibraryDir();
 }
 
+// Point per-user caches and the default palettes directory at appDir.
+static void SetUserDataPaths(const char *appDir) {
+  snprintf(paletteCachePath, sizeof(paletteCachePath), "%s/palette-cache.bin", appDir);
+  snprintf(journalPath, sizeof(journalPath), "%s/autosave.journal", appDir);
+  snprintf(thumbnailCachePath, sizeof(thumbnailCachePath), "%s/thumbnail-cache.bin", appDir);
+  if (palettesDir[0] == '\0') snprintf(palettesDir, sizeof(palettesDir), "%s/palettes", appDir);
+}
+
 // Initialize user-writable library directory on Linux/Windows with fallbacks.
 static void InitUserLibraryDir(void) {
-#if defined(_WIN32)
-  const char *base = getenv("LOCALAPPDATA");
-  if (!base || base[0] == '\0') base = getenv("APPDATA");
-  if (base && base[0] != '\0') {
-    char appDir[512] = {0};
-    snprintf(appDir, sizeof(appDir), "%s/pixel", base);
-    MakeDirectory(appDir);
-    snprintf(libraryDir, sizeof(libraryDir), "%s/library", appDir);
-    MakeDirectory(libraryDir);
-    return;
-  }
-#else
-  const char *xdgData = getenv("XDG_DATA_HOME");
-  if (xdgData && xdgData[0] != '\0') {
-    char appDir[512] = {0};
-    MakeDirectory(xdgData);
-    snprintf(appDir, sizeof(appDir), "%s/pixel", xdgData);
-    MakeDirectory(appDir);
+  char appDir[512] = {0};
+  if (PixelUserDataDir(appDir, sizeof(appDir))) {
+    SetUserDataPaths(appDir);
     snprintf(libraryDir, sizeof(libraryDir), "%s/library", appDir);
-    MakeDirectory(libraryDir);
-    return;
+  } else {
+    // Last-resort fallback if no platform env path is available.
+    TextCopy(libraryDir, "library");
+    SetUserDataPaths("library");
   }
-
-  const char *home = getenv("HOME");
-  if (home && home[0] != '\0') {
-    char path[512] = {0};
-    snprintf(path, sizeof(path), "%s/.local", home);
-    MakeDirectory(path);
-    snprintf(path, sizeof(path), "%s/.local/share", home);
-    MakeDirectory(path);
-    snprintf(path, sizeof(path), "%s/.local/share/pixel", home);
-    MakeDirectory(path);
-    snprintf(libraryDir, sizeof(libraryDir), "%s/.local/share/pixel/library", home);
-    MakeDirectory(libraryDir);
-    return;
-  }
-#endif
-
-  // Last-resort fallback if no platform env path is available.
-  TextCopy(libraryDir, "library");
-  MakeDirectory(libraryDir);
+  // Creates the app dir and any missing parents on the way
+  PixelMakeDirectories(libraryDir);
 }
 
 //------------------------------------------------------------------------------------
 // Helper Functions Definitions
 //------------------------------------------------------------------------------------
-// Load palette files from directory into in-memory palette list.
-void LoadPalettesFromDir(const char *dirPath) {
-  FilePathList files = LoadDirectoryFiles(dirPath);
-  for (unsigned int i = 0; i < files.count && paletteCount < MAX_PALETTES; i++) {
-    if (!IsPathFile(files.paths[i])) continue;
-
-    FILE *fp = fopen(files.paths[i], "r");
-    if (!fp) continue;
-
-    Palette p = {0};
-    strncpy(p.name, GetFileNameWithoutExt(files.paths[i]), MAX_PALETTE_NAME - 1);
-    char line[256];
-
-    while (fgets(line, sizeof(line), fp)) {
-      if (line[0] == ';' || strlen(line) < 8) continue;
-      unsigned int r, g, b;
-      if (sscanf(line, "FF%02x%02x%02x", &r, &g, &b) == 3 && p.count < MAX_COLORS) {
-        p.colors[p.count++] = (Color){r, g, b, 255};
-      }
+// Make a palette current and pick its first color, parsing it first if it is still lazy.
+static bool SelectPalette(int index) {
+  int count = 0;
+  if (!PixelPaletteRegistryEnsureLoaded(&paletteRegistry, index)) return false;
+  const PixelColor *colors = PixelPaletteColors(&paletteRegistry, index, &count);
+  if (count == 0) return false;
+  currentPaletteIndex = index;
+  currentColor = colors[0];
+  selectedSwatch = 0;
+  PixelPaletteLayoutSetCount(&swatchLayout, count);
+  PixelPaletteLayoutScrollTo(&swatchLayout, 0);
+  return true;
+}
+
+// Repaint from[i] as to[i] in every layer of every frame, ending on the frame that was showing.
+static void RecolorAllFrames(const PixelColor *from, const PixelColor *to, int count) {
+  if (count <= 0) return;
+  CommitFloating();
+  int shown = animation.currentFrame;
+  bool changed = false;
+  for (int frame = 0; frame < animation.frameCount; frame++) {
+    ShowFrame(frame);
+    size_t frameChanged = 0;
+    for (int i = 0; i < document.layerCount; i++) {
+      PixelColor *pixels = document.layers[i].pixels;
+      size_t layerChanged = 0;
+      PixelLayerStackBeginEdit(&document, i, 0, 0, GRID_SIZE, GRID_SIZE);
+      if (count == 1) layerChanged = PixelReplaceColor(pixels, (size_t)GRID_SIZE * GRID_SIZE, from[0], to[0]);
+      else PixelSwapPalette(pixels, (size_t)GRID_SIZE * GRID_SIZE, from, to, count, &layerChanged);
+      PixelLayerStackEndEdit(&document, i, 0, 0, GRID_SIZE, GRID_SIZE);
+      frameChanged += layerChanged;
     }
+    if (frameChanged > 0) {
+      TrackFrameEdit(0, 0, GRID_SIZE, GRID_SIZE);
+      changed = true;
+    }
+  }
+  ShowFrame(shown);
+  if (changed) {
+    PixelLayerStackMarkAllDirty(&document);
+    journalSnapshotDue = true;
+  }
+}
 
-    fclose(fp);
-    if (p.count > 0) {
-      palettes[paletteCount++] = p;
+// Make a palette current and give the canvas its colors: pixels of the old
+// palette's color i take the new palette's color i.
+static void SwapPalette(int index) {
+  int oldCount = 0, newCount = 0;
+  const PixelColor *oldColors = PixelPaletteColors(&paletteRegistry, currentPaletteIndex, &oldCount);
+  // Loading the new palette may move the registry's color storage
+  PixelColor *from = oldCount > 0 ? (PixelColor *)malloc((size_t)oldCount * sizeof(PixelColor)) : NULL;
+  if (!from) return;
+  memcpy(from, oldColors, (size_t)oldCount * sizeof(PixelColor));
+  if (SelectPalette(index)) {
+    const PixelColor *newColors = PixelPaletteColors(&paletteRegistry, index, &newCount);
+    RecolorAllFrames(from, newColors, oldCount < newCount ? oldCount : newCount);
+  }
+  free(from);
+}
+
+// Start re-rendering a cached region if its bounds or key changed. Drawing
+// between Begin and End uses screen coordinates with the GUI locked, so
+// controls render in their normal state. Returns false if the texture is current.
+static bool UiLayerBegin(UiLayer *layer, Rectangle bounds, const void *key, size_t keySize) {
+  // Keys are checked at compile time; one that still does not fit is redrawn every frame, never dropped
+  bool cacheable = keySize <= UI_LAYER_KEY_MAX;
+  bool sameBounds = layer->bounds.x == bounds.x && layer->bounds.y == bounds.y && layer->bounds.width == bounds.width &&
+                    layer->bounds.height == bounds.height;
+  if (cacheable && layer->valid && sameBounds && layer->keySize == keySize && memcmp(layer->key, key, keySize) == 0) {
+    return false;
+  }
+
+  if (!layer->valid || !sameBounds) {
+    if (layer->target.id != 0) UnloadRenderTexture(layer->target);
+    layer->target = LoadRenderTexture((int)bounds.width, (int)bounds.height);
+  }
+  layer->bounds = bounds;
+  if (cacheable) memcpy(layer->key, key, keySize);
+  layer->keySize = cacheable ? keySize : 0;
+  layer->valid = layer->target.id != 0;
+
+  BeginTextureMode(layer->target);
+  ClearBackground(GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR)));
+  BeginMode2D((Camera2D){{0, 0}, {bounds.x, bounds.y}, 0.0f, 1.0f});
+  GuiLock();
+  return true;
+}
+
+static void UiLayerEnd(void) {
+  GuiUnlock();
+  EndMode2D();
+  EndTextureMode();
+}
+
+// One quad; render textures are stored upside down.
+static void UiLayerDraw(const UiLayer *layer) {
+  if (!layer->valid) return;
+  Rectangle source = {0, 0, (float)layer->target.texture.width, -(float)layer->target.texture.height};
+  DrawTextureRec(layer->target.texture, source, (Vector2){layer->bounds.x, layer->bounds.y}, WHITE);
+}
+
+static void UiLayerUnload(UiLayer *layer) {
+  if (layer->target.id != 0) UnloadRenderTexture(layer->target);
+  *layer = (UiLayer){0};
+}
+
+// File buttons and the theme slider; returns the button clicked this frame.
+static TopBarAction DrawTopBar(bool showButtons, int *themeToggle) {
+  TopBarAction action = TOP_BAR_NONE;
+  if (showButtons) {
+    if (GuiButton((Rectangle){ 10, 5, 100, 30 }, GuiIconText(ICON_FILE_SAVE, "Save as PNG"))) action = TOP_BAR_SAVE_PNG;
+    if (GuiButton((Rectangle){ 120, 5, 100, 30 }, GuiIconText(ICON_FILE_EXPORT, "Save as TXT"))) action = TOP_BAR_SAVE_TXT;
+    if (GuiButton((Rectangle){ 230, 5, 100, 30 }, GuiIconText(ICON_FILE_OPEN, "Load TXT"))) action = TOP_BAR_LOAD_TXT;
+    if (GuiButton((Rectangle){ 340, 5, 100, 30 }, GuiIconText(ICON_RUBBER, "New Canvas"))) action = TOP_BAR_NEW_CANVAS;
+  }
+
+  // Light / Dark Slider
+  GuiSetStyle(SLIDER, SLIDER_PADDING, 2);
+  GuiToggleSlider((Rectangle){ 450, 5, 60, 30 }, "#142#;#142#", themeToggle);
+  GuiSetStyle(SLIDER, SLIDER_PADDING, 0);
+  return action;
+}
+
+// Hash of the usage badges the visible swatches show, one count lookup each.
+static uint64_t VisibleSwatchUsage(const PixelColor *colors) {
+  int first = 0, end = 0;
+  PixelPaletteLayoutVisibleRange(&swatchLayout, &first, &end);
+  uint64_t hash = 14695981039346656037ull;
+  for (int i = first; i < end; i++) {
+    size_t used = PixelHistogramCount(&document.colors, colors[i]);
+    hash = (hash ^ (used > 999 ? 1000 : used)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Visible palette swatches from the shared layout: the selected one outlined
+// thicker, the hovered one in the focus color, each with its pixel count,
+// plus a scroll thumb for long palettes.
+static void DrawSwatches(const PixelColor *colors, int hoveredSwatch) {
+  int first = 0, end = 0;
+  PixelPaletteLayoutVisibleRange(&swatchLayout, &first, &end);
+  for (int i = first; i < end; i++) {
+    PixelLayoutRect cell;
+    if (!PixelPaletteLayoutCellRect(&swatchLayout, i, &cell)) continue;
+    // Padding plus an outline keeps colors close to the background visible
+    Rectangle recLines = {cell.x + PADDING, cell.y + PADDING, cell.width - PADDING * 2, cell.height - PADDING * 2};
+    Color outline = GetColor(GuiGetStyle(DEFAULT, i == hoveredSwatch ? BORDER_COLOR_FOCUSED : LINE_COLOR));
+    DrawRectangleRec(recLines, PixelToRaylibColor(colors[i]));
+    DrawRectangleLinesEx(recLines, i == selectedSwatch ? 3.0f : 1.0f, outline);
+
+    // Usage badge: how many canvas pixels use this color, in a corner that contrasts with it
+    size_t used = PixelHistogramCount(&document.colors, colors[i]);
+    if (used > 0) {
+      const char *badge = used > 999 ? "999+" : TextFormat("%zu", used);
+      Font font = GuiGetFont();
+      Vector2 size = MeasureTextEx(font, badge, 10.0f, 1);
+      bool light = colors[i].a > 127 && colors[i].r * 299 + colors[i].g * 587 + colors[i].b * 114 > 128000;
+      Vector2 at = {recLines.x + recLines.width - size.x - 2, recLines.y + recLines.height - size.y - 1};
+      DrawTextEx(font, badge, at, 10.0f, 1, light ? BLACK : WHITE);
     }
   }
-  UnloadDirectoryFiles(files);
+
+  int columns = PixelPaletteLayoutColumns(&swatchLayout);
+  if (columns > swatchLayout.visibleColumns) {
+    PixelLayoutRect bounds = swatchLayout.bounds;
+    float trackY = bounds.y + swatchLayout.rows * swatchLayout.cellSize - PADDING;
+    float thumbWidth = bounds.width * swatchLayout.visibleColumns / columns;
+    float thumbX = bounds.x + bounds.width * swatchLayout.scrollColumn / columns;
+    DrawRectangleRec((Rectangle){thumbX, trackY, thumbWidth, PADDING}, GetColor(GuiGetStyle(DEFAULT, LINE_COLOR)));
+  }
 }
 
-// Build semicolon-separated palette list expected by raygui dropdown.
-void DropdownBufferString() {
-  size_t currentLength = strlen(dropdownBuffer);  // Start with the current length (initially 0)
+// Grid lines as thin quads, each boundary once; they share one texture so
+// raylib batches them into a single draw call. Majors are two pixels wide.
+static void DrawGridOverlay(Rectangle bounds) {
+  static PixelGridLine lines[2 * (GRID_SIZE + 1)];
+  PixelGridSpec spec = {GRID_SIZE, GRID_SIZE, bounds.x, bounds.y, bounds.width / GRID_SIZE, gridMajorEvery,
+                        0.0f, 0.0f, (float)GetScreenWidth(), (float)GetScreenHeight()};
+  int count = PixelGridBuild(&spec, lines, 2 * (GRID_SIZE + 1));
+  Color minorColor = GetColor(GuiGetStyle(DEFAULT, LINE_COLOR));
+  Color majorColor = GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL));
+  for (int i = 0; i < count && i < 2 * (GRID_SIZE + 1); i++) {
+    const PixelGridLine *line = &lines[i];
+    float width = line->major && gridMajorEvery > 0 ? 2.0f : 1.0f;
+    // Center majors on the boundary and keep the far canvas edge inside the grid
+    float along = (line->vertical ? line->x : line->y) - (width > 1.0f ? 1.0f : 0.0f);
+    float start = line->vertical ? bounds.x : bounds.y;
+    float end = start + (line->vertical ? bounds.width : bounds.height) - width;
+    along = along < start ? start : (along > end ? end : along);
+    Rectangle rect = line->vertical ? (Rectangle){along, line->y, width, line->length}
+                                    : (Rectangle){line->x, along, line->length, width};
+    Color color = line->major && gridMajorEvery > 0 ? majorColor : minorColor;
+    color.a = (unsigned char)(color.a * line->alpha / 255);
+    DrawRectangleRec(rect, color);
+  }
+}
 
-  for (int i = 0; i < paletteCount; i++) {
-    // Format the new item
-    char item[256];  // Temporary buffer for the item
-    snprintf(item, sizeof(item), "%s",
-             palettes[i].name);  // Create the item string
+static bool DetectPng(const unsigned char *data, size_t size) {
+  static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  return size >= sizeof(signature) && memcmp(data, signature, sizeof(signature)) == 0;
+}
 
-    // Calculate the length of the new item
-    size_t itemLength = strlen(item);
+// Decode a swatch strip with raylib and sample one pixel per cell in the core.
+static int ParsePngSwatches(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  Image image = LoadImageFromMemory(".png", data, (int)size);
+  if (!image.data) return -1;
+  ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  int count = PixelPaletteFromSwatchImage((const PixelColor *)image.data, image.width, image.height, out, capacity);
+  UnloadImage(image);
+  return count;
+}
 
-    // Check if adding this item would exceed the buffer size
-    if (currentLength + itemLength + (size_t)(i > 0 ? 1 : 0) < sizeof(dropdownBuffer)) {
-      if (i > 0) {
-        strncat(dropdownBuffer, ";",
-                sizeof(dropdownBuffer) - currentLength - 1);  // Add separator
-        currentLength += 1;  // Update the current length for the separator
-      }
-      strncat(dropdownBuffer, item,
-              sizeof(dropdownBuffer) - currentLength - 1);  // Append the item
-      currentLength += itemLength;                          // Update the current length
-    } else {
-      // Handle the case where the buffer is too small
-      TraceLog(LOG_WARNING, "Dropdown buffer size exceeded. Some palettes may not be displayed.");
-      break;  // Exit the loop if the buffer is full
+// Load the UI font from an explicit path, else the prebaked atlas when assets are embedded.
+static Font LoadUiFont(void) {
+#if defined(PIXEL_EMBED_ASSETS)
+  if (fontPath[0] == '\0') {
+    const PixelEmbeddedFont *source = &pixelEmbeddedFont;
+    int pixelCount = source->atlasWidth * source->atlasHeight;
+    unsigned char *grayAlpha = (unsigned char *)MemAlloc((unsigned int)pixelCount * 2);
+    for (int i = 0; i < pixelCount; i++) {
+      grayAlpha[i * 2] = 255;
+      grayAlpha[i * 2 + 1] = source->atlasAlpha[i];
     }
+    Image atlas = {grayAlpha, source->atlasWidth, source->atlasHeight, 1, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA};
+
+    Font font = {0};
+    font.baseSize = source->baseSize;
+    font.glyphCount = source->glyphCount;
+    font.glyphPadding = source->glyphPadding;
+    font.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    font.glyphs = (GlyphInfo *)MemAlloc((unsigned int)(source->glyphCount * (int)sizeof(GlyphInfo)));
+    font.recs = (Rectangle *)MemAlloc((unsigned int)(source->glyphCount * (int)sizeof(Rectangle)));
+    for (int i = 0; i < source->glyphCount; i++) {
+      const PixelEmbeddedGlyph *glyph = &source->glyphs[i];
+      font.glyphs[i] = (GlyphInfo){glyph->value, glyph->offsetX, glyph->offsetY, glyph->advanceX, {0}};
+      font.recs[i] = (Rectangle){glyph->x, glyph->y, glyph->width, glyph->height};
+    }
+    return font;
   }
+#endif
+  return LoadFont(fontPath);
 }
@@ -0,0 +1,443 @@
+#include "pixel_anim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int MinInt(int a, int b) { return a < b ? a : b; }
+static int MaxInt(int a, int b) { return a > b ? a : b; }
+
+static int TileCount(const PixelAnim *anim) {
+  return anim->tilesX * anim->tilesY;
+}
+
+static void TileRect(const PixelAnim *anim, int tile, int *x, int *y, int *w, int *h) {
+  *x = (tile % anim->tilesX) * PIXEL_TILE_SIZE;
+  *y = (tile / anim->tilesX) * PIXEL_TILE_SIZE;
+  *w = MinInt(PIXEL_TILE_SIZE, anim->width - *x);
+  *h = MinInt(PIXEL_TILE_SIZE, anim->height - *y);
+}
+
+static size_t TilePixels(const PixelAnim *anim, int tile) {
+  int x, y, w, h;
+  TileRect(anim, tile, &x, &y, &w, &h);
+  return (size_t)w * (size_t)h;
+}
+
+static bool SpanIsBlank(const PixelColor *span, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (span[i].r | span[i].g | span[i].b | span[i].a) return false;
+  }
+  return true;
+}
+
+// Compare two stored tiles where NULL stands for a fully transparent tile.
+static bool TilesEqual(const PixelAnim *anim, int tile, const PixelColor *a, const PixelColor *b) {
+  if (a == b) return true;
+  size_t count = TilePixels(anim, tile);
+  if (!a) return SpanIsBlank(b, count);
+  if (!b) return SpanIsBlank(a, count);
+  return memcmp(a, b, count * sizeof(PixelColor)) == 0;
+}
+
+// Compare a stored tile (NULL = transparent) with the same tile of a plane.
+static bool TileMatchesPlane(const PixelAnim *anim, int tile, const PixelColor *data, const PixelColor *plane) {
+  int x, y, w, h;
+  TileRect(anim, tile, &x, &y, &w, &h);
+  for (int row = 0; row < h; row++) {
+    const PixelColor *src = plane + (size_t)(y + row) * (size_t)anim->width + (size_t)x;
+    if (data) {
+      if (memcmp(data + (size_t)row * (size_t)w, src, (size_t)w * sizeof(PixelColor)) != 0) return false;
+    } else if (!SpanIsBlank(src, (size_t)w)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static PixelColor *DupTile(const PixelAnim *anim, int tile, const PixelColor *data) {
+  size_t count = TilePixels(anim, tile);
+  PixelColor *copy = (PixelColor *)malloc(count * sizeof(PixelColor));
+  if (!copy) return NULL;
+  if (data) memcpy(copy, data, count * sizeof(PixelColor));
+  else memset(copy, 0, count * sizeof(PixelColor));
+  return copy;
+}
+
+static void ReadTileFromPlane(const PixelAnim *anim, int tile, PixelColor *data, const PixelColor *plane) {
+  int x, y, w, h;
+  TileRect(anim, tile, &x, &y, &w, &h);
+  for (int row = 0; row < h; row++) {
+    memcpy(data + (size_t)row * (size_t)w, plane + (size_t)(y + row) * (size_t)anim->width + (size_t)x,
+           (size_t)w * sizeof(PixelColor));
+  }
+}
+
+static void WriteTileToPlane(const PixelAnim *anim, int tile, const PixelColor *data, PixelColor *plane) {
+  int x, y, w, h;
+  TileRect(anim, tile, &x, &y, &w, &h);
+  for (int row = 0; row < h; row++) {
+    PixelColor *dst = plane + (size_t)(y + row) * (size_t)anim->width + (size_t)x;
+    if (data) memcpy(dst, data + (size_t)row * (size_t)w, (size_t)w * sizeof(PixelColor));
+    else memset(dst, 0, (size_t)w * sizeof(PixelColor));
+  }
+}
+
+// Index of the first keyframe after index, or frameCount.
+static int NextKeyframe(const PixelAnim *anim, int index) {
+  int next = index + 1;
+  while (next < anim->frameCount && !anim->frames[next].keyframe) next++;
+  return next;
+}
+
+// Nearest keyframe at or before index; frame 0 is always a keyframe.
+int PixelAnimKeyframeOf(const PixelAnim *anim, int index) {
+  if (!anim || index < 0 || index >= anim->frameCount) return -1;
+  while (index > 0 && !anim->frames[index].keyframe) index--;
+  return index;
+}
+
+static const PixelColor *ResolveTile(const PixelAnim *anim, int index, int slot) {
+  const PixelAnimFrame *frame = &anim->frames[index];
+  if (frame->tiles[slot] || frame->keyframe) return frame->tiles[slot];
+  return anim->frames[PixelAnimKeyframeOf(anim, index)].tiles[slot];
+}
+
+// Re-express frames [first, last) against newKey instead of oldKey while
+// keeping their decoded content; -1 stands for an all-transparent key.
+static bool RekeyRange(PixelAnim *anim, int first, int last, int oldKey, int newKey) {
+  int tileCount = TileCount(anim);
+  int slots = anim->planeCount * tileCount;
+  for (int f = first; f < last; f++) {
+    PixelColor **tiles = anim->frames[f].tiles;
+    for (int slot = 0; slot < slots; slot++) {
+      int tile = slot % tileCount;
+      const PixelColor *oldTile = oldKey >= 0 ? anim->frames[oldKey].tiles[slot] : NULL;
+      const PixelColor *newTile = newKey >= 0 ? anim->frames[newKey].tiles[slot] : NULL;
+      const PixelColor *resolved = tiles[slot] ? tiles[slot] : oldTile;
+
+      if (TilesEqual(anim, tile, resolved, newTile)) {
+        free(tiles[slot]);
+        tiles[slot] = NULL;
+      } else if (!tiles[slot]) {
+        tiles[slot] = DupTile(anim, tile, oldTile);
+        if (!tiles[slot]) return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Fill a freshly inserted frame with the tiles of planes that differ from
+// baseKey (-1 = transparent); NULL planes encode a blank frame.
+static bool EncodeNewFrame(PixelAnim *anim, int index, PixelColor *const *planes, int baseKey) {
+  int tileCount = TileCount(anim);
+  PixelColor **tiles = anim->frames[index].tiles;
+  for (int p = 0; p < anim->planeCount; p++) {
+    for (int tile = 0; tile < tileCount; tile++) {
+      int slot = p * tileCount + tile;
+      const PixelColor *base = baseKey >= 0 ? anim->frames[baseKey].tiles[slot] : NULL;
+      if (planes ? TileMatchesPlane(anim, tile, base, planes[p]) : TilesEqual(anim, tile, base, NULL)) continue;
+
+      tiles[slot] = DupTile(anim, tile, NULL);
+      if (!tiles[slot]) return false;
+      if (planes) ReadTileFromPlane(anim, tile, tiles[slot], planes[p]);
+    }
+  }
+  return true;
+}
+
+static void FreeFrame(PixelAnim *anim, PixelAnimFrame *frame) {
+  int slots = anim->planeCount * TileCount(anim);
+  for (int i = 0; i < slots; i++) free(frame->tiles[i]);
+  free(frame->tiles);
+  frame->tiles = NULL;
+}
+
+// Create a timeline with one blank keyframe.
+bool PixelAnimInit(PixelAnim *anim, int width, int height, int planeCount, int fps) {
+  if (!anim || width <= 0 || height <= 0 || planeCount < 0) return false;
+  *anim = (PixelAnim){0};
+  anim->width = width;
+  anim->height = height;
+  anim->tilesX = (width + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+  anim->tilesY = (height + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+  anim->planeCount = planeCount;
+  PixelAnimSetFps(anim, fps);
+
+  if (PixelAnimInsertFrame(anim, 0, true, NULL) != 0) {
+    PixelAnimFree(anim);
+    return false;
+  }
+  return true;
+}
+
+void PixelAnimFree(PixelAnim *anim) {
+  if (!anim) return;
+  for (int i = 0; i < anim->frameCount; i++) FreeFrame(anim, &anim->frames[i]);
+  free(anim->frames);
+  *anim = (PixelAnim){0};
+}
+
+// Insert a frame before index holding planes (NULL planes = blank frame).
+// A new keyframe takes over the delta frames that follow it.
+int PixelAnimInsertFrame(PixelAnim *anim, int index, bool keyframe, PixelColor *const *planes) {
+  if (!anim || index < 0 || index > anim->frameCount) return -1;
+  if (index == 0) keyframe = true;
+
+  if (anim->frameCount == anim->frameCapacity) {
+    int capacity = anim->frameCapacity > 0 ? anim->frameCapacity * 2 : 8;
+    PixelAnimFrame *frames = (PixelAnimFrame *)realloc(anim->frames, (size_t)capacity * sizeof(PixelAnimFrame));
+    if (!frames) return -1;
+    anim->frames = frames;
+    anim->frameCapacity = capacity;
+  }
+
+  size_t slots = (size_t)anim->planeCount * (size_t)TileCount(anim);
+  PixelAnimFrame frame = {0};
+  frame.tiles = (PixelColor **)calloc(slots > 0 ? slots : 1, sizeof(PixelColor *));
+  if (!frame.tiles) return -1;
+
+  memmove(&anim->frames[index + 1], &anim->frames[index], (size_t)(anim->frameCount - index) * sizeof(PixelAnimFrame));
+  anim->frameCount++;
+
+  frame.keyframe = keyframe;
+  anim->frames[index] = frame;
+  if (anim->frameCount > 1 && anim->currentFrame >= index) anim->currentFrame++;
+
+  int base = keyframe ? -1 : PixelAnimKeyframeOf(anim, index);
+  if (!EncodeNewFrame(anim, index, planes, base)) return -1;
+
+  // A new keyframe takes over the deltas that used to follow the old one.
+  if (keyframe && index + 1 < anim->frameCount && !anim->frames[index + 1].keyframe) {
+    int oldKey = PixelAnimKeyframeOf(anim, index - 1);
+    if (!RekeyRange(anim, index + 1, NextKeyframe(anim, index), oldKey, index)) return -1;
+  }
+  return index;
+}
+
+// Remove a frame; deltas of a removed keyframe move to the previous keyframe.
+bool PixelAnimDeleteFrame(PixelAnim *anim, int index) {
+  if (!anim || index < 0 || index >= anim->frameCount || anim->frameCount <= 1) return false;
+
+  if (anim->frames[index].keyframe) {
+    int next = NextKeyframe(anim, index);
+    if (index > 0) {
+      if (!RekeyRange(anim, index + 1, next, index, PixelAnimKeyframeOf(anim, index - 1))) return false;
+    } else if (next > 1) {
+      if (!RekeyRange(anim, 1, 2, 0, -1)) return false;
+      anim->frames[1].keyframe = true;
+      if (!RekeyRange(anim, 2, next, 0, 1)) return false;
+    }
+  }
+
+  FreeFrame(anim, &anim->frames[index]);
+  memmove(&anim->frames[index], &anim->frames[index + 1], (size_t)(anim->frameCount - index - 1) * sizeof(PixelAnimFrame));
+  anim->frameCount--;
+  if (anim->currentFrame > index || anim->currentFrame >= anim->frameCount) anim->currentFrame--;
+  if (anim->currentFrame < 0) anim->currentFrame = 0;
+  return true;
+}
+
+// Promote a delta to a keyframe or demote a keyframe, preserving all content.
+bool PixelAnimSetKeyframe(PixelAnim *anim, int index, bool keyframe) {
+  if (!anim || index <= 0 || index >= anim->frameCount) return false;
+  if (anim->frames[index].keyframe == keyframe) return true;
+
+  int next = NextKeyframe(anim, index);
+  if (keyframe) {
+    int oldKey = PixelAnimKeyframeOf(anim, index);
+    if (!RekeyRange(anim, index, index + 1, oldKey, -1)) return false;
+    anim->frames[index].keyframe = true;
+    return RekeyRange(anim, index + 1, next, oldKey, index);
+  }
+
+  int newKey = PixelAnimKeyframeOf(anim, index - 1);
+  if (!RekeyRange(anim, index + 1, next, index, newKey)) return false;
+  if (!RekeyRange(anim, index, index + 1, -1, newKey)) return false;
+  anim->frames[index].keyframe = false;
+  return true;
+}
+
+bool PixelAnimStoreFrame(PixelAnim *anim, int index, PixelColor *const *planes) {
+  if (!anim) return false;
+  return PixelAnimStoreFrameRect(anim, index, planes, 0, 0, anim->width, anim->height);
+}
+
+// Encode the tiles of planes overlapping a pixel rectangle into a frame.
+// Keyframe edits copy the old tile into dependent deltas that relied on it.
+bool PixelAnimStoreFrameRect(PixelAnim *anim, int index, PixelColor *const *planes, int x, int y, int width, int height) {
+  if (!anim || !planes || index < 0 || index >= anim->frameCount) return false;
+
+  int x0 = MaxInt(x, 0), y0 = MaxInt(y, 0);
+  int x1 = MinInt(x + width, anim->width), y1 = MinInt(y + height, anim->height);
+  if (x0 >= x1 || y0 >= y1) return true;
+
+  PixelAnimFrame *frame = &anim->frames[index];
+  int key = PixelAnimKeyframeOf(anim, index);
+  int next = NextKeyframe(anim, index);
+  int tileCount = TileCount(anim);
+
+  for (int p = 0; p < anim->planeCount; p++) {
+    for (int ty = y0 / PIXEL_TILE_SIZE; ty <= (y1 - 1) / PIXEL_TILE_SIZE; ty++) {
+      for (int tx = x0 / PIXEL_TILE_SIZE; tx <= (x1 - 1) / PIXEL_TILE_SIZE; tx++) {
+        int tile = ty * anim->tilesX + tx;
+        int slot = p * tileCount + tile;
+        PixelColor **stored = &frame->tiles[slot];
+        const PixelColor *base = frame->keyframe ? NULL : anim->frames[key].tiles[slot];
+
+        if (frame->keyframe) {
+          if (TileMatchesPlane(anim, tile, *stored, planes[p])) continue;
+          for (int f = index + 1; f < next; f++) {
+            PixelColor **dependent = &anim->frames[f].tiles[slot];
+            if (*dependent) continue;
+            *dependent = DupTile(anim, tile, *stored);
+            if (!*dependent) return false;
+          }
+        }
+
+        if (TileMatchesPlane(anim, tile, base, planes[p])) {
+          free(*stored);
+          *stored = NULL;
+          continue;
+        }
+        if (!*stored) {
+          *stored = (PixelColor *)malloc(TilePixels(anim, tile) * sizeof(PixelColor));
+          if (!*stored) return false;
+        }
+        ReadTileFromPlane(anim, tile, *stored, planes[p]);
+
+        if (frame->keyframe) {
+          // Dependents that now match the new key tile no longer need a copy.
+          for (int f = index + 1; f < next; f++) {
+            PixelColor **dependent = &anim->frames[f].tiles[slot];
+            if (*dependent && TilesEqual(anim, tile, *dependent, *stored)) {
+              free(*dependent);
+              *dependent = NULL;
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Write a frame into planes, touching only tiles whose content differs.
+// onTile (optional) is told about each rewritten tile, e.g. to dirty the
+// compositor so the texture upload stays partial. Returns tiles rewritten.
+int PixelAnimDecodeFrame(const PixelAnim *anim, int index, PixelColor *const *planes, PixelAnimTileFn onTile, void *user) {
+  return PixelAnimDecodeFrameEx(anim, index, planes, NULL, onTile, user);
+}
+
+// Like PixelAnimDecodeFrame, also reporting each tile just before it is overwritten.
+int PixelAnimDecodeFrameEx(const PixelAnim *anim, int index, PixelColor *const *planes, PixelAnimTileFn beforeTile,
+                           PixelAnimTileFn afterTile, void *user) {
+  if (!anim || !planes || index < 0 || index >= anim->frameCount) return 0;
+
+  int tileCount = TileCount(anim);
+  int rewritten = 0;
+  for (int p = 0; p < anim->planeCount; p++) {
+    for (int tile = 0; tile < tileCount; tile++) {
+      const PixelColor *data = ResolveTile(anim, index, p * tileCount + tile);
+      if (TileMatchesPlane(anim, tile, data, planes[p])) continue;
+
+      int x, y, w, h;
+      TileRect(anim, tile, &x, &y, &w, &h);
+      if (beforeTile) beforeTile(user, p, x, y, w, h);
+      WriteTileToPlane(anim, tile, data, planes[p]);
+      rewritten++;
+      if (afterTile) afterTile(user, p, x, y, w, h);
+    }
+  }
+  return rewritten;
+}
+
+// Add a transparent plane at the given position in every frame.
+bool PixelAnimInsertPlane(PixelAnim *anim, int plane) {
+  if (!anim || plane < 0 || plane > anim->planeCount) return false;
+
+  int tileCount = TileCount(anim);
+  size_t slots = (size_t)(anim->planeCount + 1) * (size_t)tileCount;
+  for (int f = 0; f < anim->frameCount; f++) {
+    PixelColor **tiles = (PixelColor **)realloc(anim->frames[f].tiles, slots * sizeof(PixelColor *));
+    if (!tiles) return false;
+    size_t at = (size_t)plane * (size_t)tileCount;
+    memmove(&tiles[at + (size_t)tileCount], &tiles[at],
+            (size_t)(anim->planeCount - plane) * (size_t)tileCount * sizeof(PixelColor *));
+    memset(&tiles[at], 0, (size_t)tileCount * sizeof(PixelColor *));
+    anim->frames[f].tiles = tiles;
+  }
+  anim->planeCount++;
+  return true;
+}
+
+bool PixelAnimRemovePlane(PixelAnim *anim, int plane) {
+  if (!anim || plane < 0 || plane >= anim->planeCount) return false;
+
+  int tileCount = TileCount(anim);
+  size_t at = (size_t)plane * (size_t)tileCount;
+  for (int f = 0; f < anim->frameCount; f++) {
+    PixelColor **tiles = anim->frames[f].tiles;
+    for (int t = 0; t < tileCount; t++) free(tiles[at + (size_t)t]);
+    memmove(&tiles[at], &tiles[at + (size_t)tileCount],
+            (size_t)(anim->planeCount - plane - 1) * (size_t)tileCount * sizeof(PixelColor *));
+  }
+  anim->planeCount--;
+  return true;
+}
+
+// Reorder planes the same way PixelLayerStackMoveLayer reorders layers.
+bool PixelAnimMovePlane(PixelAnim *anim, int from, int to) {
+  if (!anim || from < 0 || to < 0 || from >= anim->planeCount || to >= anim->planeCount) return false;
+  if (from == to) return true;
+
+  int tileCount = TileCount(anim);
+  size_t planeBytes = (size_t)tileCount * sizeof(PixelColor *);
+  PixelColor **moved = (PixelColor **)malloc(planeBytes);
+  if (!moved) return false;
+
+  for (int f = 0; f < anim->frameCount; f++) {
+    PixelColor **tiles = anim->frames[f].tiles;
+    memcpy(moved, &tiles[(size_t)from * tileCount], planeBytes);
+    if (from < to) {
+      memmove(&tiles[(size_t)from * tileCount], &tiles[(size_t)(from + 1) * tileCount], (size_t)(to - from) * planeBytes);
+    } else {
+      memmove(&tiles[(size_t)(to + 1) * tileCount], &tiles[(size_t)to * tileCount], (size_t)(from - to) * planeBytes);
+    }
+    memcpy(&tiles[(size_t)to * tileCount], moved, planeBytes);
+  }
+  free(moved);
+  return true;
+}
+
+// Number of tiles actually held in memory across all frames.
+size_t PixelAnimStoredTileCount(const PixelAnim *anim) {
+  if (!anim) return 0;
+  size_t count = 0;
+  int slots = anim->planeCount * TileCount(anim);
+  for (int f = 0; f < anim->frameCount; f++) {
+    for (int i = 0; i < slots; i++) count += anim->frames[f].tiles[i] != NULL;
+  }
+  return count;
+}
+
+void PixelAnimSetFps(PixelAnim *anim, int fps) {
+  if (!anim) return;
+  if (fps < 1) fps = 1;
+  if (fps > PIXEL_ANIM_MAX_FPS) fps = PIXEL_ANIM_MAX_FPS;
+  anim->fps = fps;
+}
+
+// Step playback by elapsed time; returns true when the current frame changed.
+bool PixelAnimAdvance(PixelAnim *anim, double elapsedSeconds) {
+  if (!anim || !anim->playing || anim->frameCount <= 1 || elapsedSeconds <= 0.0) return false;
+
+  double frameTime = 1.0 / (double)anim->fps;
+  anim->frameTimer += elapsedSeconds;
+  if (anim->frameTimer < frameTime) return false;
+
+  int steps = (int)(anim->frameTimer / frameTime);
+  anim->frameTimer -= steps * frameTime;
+  anim->currentFrame = (anim->currentFrame + steps) % anim->frameCount;
+  return true;
+}
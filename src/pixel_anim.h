@@ -0,0 +1,59 @@
+#ifndef PIXEL_ANIM_H
+#define PIXEL_ANIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_core.h"
+#include "pixel_layers.h"
+
+#define PIXEL_ANIM_DEFAULT_FPS 12
+#define PIXEL_ANIM_MAX_FPS 60
+
+// One timeline frame holding planeCount * tileCount tile pointers.
+// Keyframe: NULL tile is fully transparent.
+// Delta frame: NULL tile is identical to the nearest preceding keyframe.
+typedef struct {
+  PixelColor **tiles;
+  bool keyframe;
+} PixelAnimFrame;
+
+// Multi-frame document timeline stored at PIXEL_TILE_SIZE granularity, so
+// memory grows with the tiles that differ from each frame's keyframe.
+typedef struct {
+  int width;
+  int height;
+  int tilesX;
+  int tilesY;
+  int planeCount;                  // Usually one plane per document layer
+  PixelAnimFrame *frames;
+  int frameCount;
+  int frameCapacity;
+  int currentFrame;
+  int fps;
+  bool playing;
+  double frameTimer;
+} PixelAnim;
+
+// Receives the pixel rectangle of each tile rewritten by a frame decode.
+typedef void (*PixelAnimTileFn)(void *user, int plane, int x, int y, int width, int height);
+
+bool PixelAnimInit(PixelAnim *anim, int width, int height, int planeCount, int fps);
+void PixelAnimFree(PixelAnim *anim);
+int PixelAnimInsertFrame(PixelAnim *anim, int index, bool keyframe, PixelColor *const *planes);
+bool PixelAnimDeleteFrame(PixelAnim *anim, int index);
+bool PixelAnimSetKeyframe(PixelAnim *anim, int index, bool keyframe);
+bool PixelAnimStoreFrame(PixelAnim *anim, int index, PixelColor *const *planes);
+bool PixelAnimStoreFrameRect(PixelAnim *anim, int index, PixelColor *const *planes, int x, int y, int width, int height);
+int PixelAnimDecodeFrame(const PixelAnim *anim, int index, PixelColor *const *planes, PixelAnimTileFn onTile, void *user);
+int PixelAnimDecodeFrameEx(const PixelAnim *anim, int index, PixelColor *const *planes, PixelAnimTileFn beforeTile,
+                           PixelAnimTileFn afterTile, void *user);
+bool PixelAnimInsertPlane(PixelAnim *anim, int plane);
+bool PixelAnimRemovePlane(PixelAnim *anim, int plane);
+bool PixelAnimMovePlane(PixelAnim *anim, int from, int to);
+int PixelAnimKeyframeOf(const PixelAnim *anim, int index);
+size_t PixelAnimStoredTileCount(const PixelAnim *anim);
+void PixelAnimSetFps(PixelAnim *anim, int fps);
+bool PixelAnimAdvance(PixelAnim *anim, double elapsedSeconds);
+
+#endif
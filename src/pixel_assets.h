@@ -0,0 +1,41 @@
+#ifndef PIXEL_ASSETS_H
+#define PIXEL_ASSETS_H
+
+#include "pixel_core.h"
+
+// Bundled assets baked into the editor at build time by tools/pixel_embed.c.
+// Only linked into builds defining PIXEL_EMBED_ASSETS.
+
+typedef struct {
+  const char *name;
+  const PixelColor *colors;
+  int count;
+} PixelEmbeddedPalette;
+
+typedef struct {
+  int value;                       // Unicode codepoint
+  int offsetX;
+  int offsetY;
+  int advanceX;
+  int x;                           // Glyph rectangle inside the atlas
+  int y;
+  int width;
+  int height;
+} PixelEmbeddedGlyph;
+
+// Prebaked glyph atlas with the same metrics raylib's LoadFont produces.
+typedef struct {
+  int baseSize;
+  int glyphCount;
+  int glyphPadding;
+  const PixelEmbeddedGlyph *glyphs;
+  int atlasWidth;
+  int atlasHeight;
+  const unsigned char *atlasAlpha; // One coverage byte per pixel
+} PixelEmbeddedFont;
+
+extern const PixelEmbeddedFont pixelEmbeddedFont;
+extern const PixelEmbeddedPalette pixelEmbeddedPalettes[];
+extern const int pixelEmbeddedPaletteCount;
+
+#endif
@@ -1,13 +1,38 @@
 #include "pixel_core.h"
 
 #include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <io.h>
+#include <windows.h>
+#define SyncFile(fp) _commit(_fileno(fp))
+// rename() refuses an existing destination on Windows; MoveFileEx replaces it in one step
+#define MoveOver(from, to) (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define SyncFile(fp) fsync(fileno(fp))
+#define MoveOver(from, to) (rename(from, to) == 0)
+#endif
+
 static int PixelIndex(int x, int y, int gridSize) {
   return y * gridSize + x;
 }
 
+// Compare all four channels of two pixels.
+bool PixelColorEqual(PixelColor a, PixelColor b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
 static const char *SkipSpaces(const char *s) {
   while (*s != '\0' && isspace((unsigned char)*s)) s++;
   return s;
@@ -44,8 +69,13 @@ bool PixelBuildFilePath(const char *dir, const char *input, const char *ext, cha
 }
 
 // Paint square brush area centered on grid cell and clamp to canvas bounds.
-void PixelPaintBrush(Color *canvas, int gridSize, int gx, int gy, Color color, int brushSize) {
-  if (!canvas || gridSize <= 0 || brushSize <= 0) return;
+void PixelPaintBrush(PixelColor *canvas, int gridSize, int gx, int gy, PixelColor color, int brushSize) {
+  PixelPaintBrushEx(canvas, gridSize, gridSize, gx, gy, color, brushSize);
+}
+
+// Paint square brush area on a width x height canvas, clamped to its bounds.
+void PixelPaintBrushEx(PixelColor *canvas, int width, int height, int gx, int gy, PixelColor color, int brushSize) {
+  if (!canvas || width <= 0 || height <= 0 || brushSize <= 0) return;
 
   int startX = gx - brushSize / 2;
   int startY = gy - brushSize / 2;
@@ -54,37 +84,109 @@ void PixelPaintBrush(Color *canvas, int gridSize, int gx, int gy, Color color, i
     for (int x = 0; x < brushSize; x++) {
       int px = startX + x;
       int py = startY + y;
-      if (px < 0 || px >= gridSize || py < 0 || py >= gridSize) continue;
-      canvas[PixelIndex(px, py, gridSize)] = color;
+      if (px < 0 || px >= width || py < 0 || py >= height) continue;
+      canvas[PixelIndex(px, py, width)] = color;
     }
   }
 }
 
+// Flush and fsync a fully written temp file, then rename it over path.
+// A crash at any point leaves either the old or the new file, never a mix.
+// fp is closed and, on failure, the temp file removed.
+bool PixelCommitTempFile(FILE *fp, const char *tempPath, const char *path) {
+  if (!fp) return false;
+  bool ok = fflush(fp) == 0 && SyncFile(fp) == 0;
+  ok = fclose(fp) == 0 && ok;
+  ok = ok && MoveOver(tempPath, path);
+  if (!ok) {
+    remove(tempPath);
+    return false;
+  }
+
+#if !defined(_WIN32)
+  // The rename itself is durable only once the directory entry is synced
+  char dir[1024] = ".";
+  const char *slash = strrchr(path, '/');
+  if (slash == path) snprintf(dir, sizeof(dir), "/");
+  else if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+  int fd = open(dir, O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+#endif
+  return true;
+}
+
+static char *PutChannel(char *p, unsigned char value) {
+  p[0] = (char)('0' + value / 100);
+  p[1] = (char)('0' + value / 10 % 10);
+  p[2] = (char)('0' + value % 10);
+  return p + 3;
+}
+
 // Save canvas as row-based text format that can be reloaded robustly.
-bool PixelSaveCanvasText(const char *path, const Color *canvas, int gridSize) {
-  if (!path || !canvas || gridSize <= 0) return false;
+bool PixelSaveCanvasText(const char *path, const PixelColor *canvas, int gridSize) {
+  return PixelSaveCanvasTextEx(path, canvas, gridSize, NULL);
+}
 
-  FILE *fp = fopen(path, "w");
-  if (!fp) return false;
+// Same as PixelSaveCanvasText, reporting the file size. The text goes to
+// "<path>.tmp" first and replaces path only once it is safely on disk.
+bool PixelSaveCanvasTextEx(const char *path, const PixelColor *canvas, int gridSize, size_t *bytesWritten) {
+  if (bytesWritten) *bytesWritten = 0;
+  if (!path || !canvas || gridSize <= 0) return false;
 
-  fprintf(fp, "Canvas Data (GRID_SIZE: %d)\n", gridSize);
-  fprintf(fp, "# Format: r,g,b,a\n\n");
+  // Rows are formatted by hand into one buffer; "rrr,ggg,bbb,aaa | " is 18 bytes a pixel
+  size_t rowCapacity = 32 + (size_t)gridSize * 18;
+  char *row = (char *)malloc(rowCapacity);
+  char tempPath[1024];
+  int written = snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+  FILE *fp = NULL;
+  if (row && written > 0 && (size_t)written < sizeof(tempPath)) fp = fopen(tempPath, "w");
+  if (!fp) {
+    free(row);
+    return false;
+  }
 
-  for (int y = 0; y < gridSize; y++) {
-    fprintf(fp, "Row %03d: ", y);
+  long header = fprintf(fp, "Canvas Data (GRID_SIZE: %d)\n", gridSize);
+  header += fprintf(fp, "# Format: r,g,b,a\n\n");
+  size_t total = header > 0 ? (size_t)header : 0;
+  bool ok = header > 0;
+  for (int y = 0; ok && y < gridSize; y++) {
+    char *p = row + snprintf(row, 32, "Row %03d: ", y);
+    const PixelColor *pixels = canvas + (size_t)PixelIndex(0, y, gridSize);
     for (int x = 0; x < gridSize; x++) {
-      Color c = canvas[PixelIndex(x, y, gridSize)];
-      fprintf(fp, "%03d,%03d,%03d,%03d", c.r, c.g, c.b, c.a);
-      if (x < gridSize - 1) fprintf(fp, " | ");
+      p = PutChannel(p, pixels[x].r);
+      *p++ = ',';
+      p = PutChannel(p, pixels[x].g);
+      *p++ = ',';
+      p = PutChannel(p, pixels[x].b);
+      *p++ = ',';
+      p = PutChannel(p, pixels[x].a);
+      if (x < gridSize - 1) {
+        memcpy(p, " | ", 3);
+        p += 3;
+      }
     }
-    fputc('\n', fp);
+    *p++ = '\n';
+    size_t length = (size_t)(p - row);
+    ok = fwrite(row, 1, length, fp) == length;
+    total += length;
   }
+  free(row);
 
-  return fclose(fp) == 0;
+  if (!ok) {
+    fclose(fp);
+    remove(tempPath);
+    return false;
+  }
+  if (!PixelCommitTempFile(fp, tempPath, path)) return false;
+  if (bytesWritten) *bytesWritten = total;
+  return true;
 }
 
 // Parse one "Row NNN:" line into canvas row, ignoring malformed values.
-static void PixelParseLine(char *line, Color *canvas, int gridSize) {
+static void PixelParseLine(char *line, PixelColor *canvas, int gridSize) {
   int rowIndex = -1;
   if (sscanf(line, "Row %d:", &rowIndex) != 1) return;
   if (rowIndex < 0 || rowIndex >= gridSize) return;
@@ -94,8 +196,14 @@ static void PixelParseLine(char *line, Color *canvas, int gridSize) {
   dataPart++;
   while (*dataPart != '\0' && isspace((unsigned char)*dataPart)) dataPart++;
 
-  char *token = strtok(dataPart, "|");
-  for (int x = 0; x < gridSize && token != NULL; x++) {
+  // Split on '|' with a local cursor: thumbnails parse projects on worker threads
+  char *cursor = dataPart;
+  for (int x = 0; x < gridSize; x++) {
+    while (*cursor == '|') cursor++;
+    if (*cursor == '\0') break;
+    char *token = cursor;
+    cursor += strcspn(cursor, "|");
+    if (*cursor != '\0') *cursor++ = '\0';
     token = (char *)SkipSpaces(token);
 
     int r, g, b, a;
@@ -103,14 +211,24 @@ static void PixelParseLine(char *line, Color *canvas, int gridSize) {
         r >= 0 && r <= 255 && g >= 0 && g <= 255 &&
         b >= 0 && b <= 255 && a >= 0 && a <= 255) {
       canvas[PixelIndex(x, rowIndex, gridSize)] =
-          (Color){(unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a};
+          (PixelColor){(unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a};
     }
-    token = strtok(NULL, "|");
   }
 }
 
+// Grid size declared in a text project's header line, or 0 if it has none.
+int PixelCanvasTextGridSize(const char *path) {
+  FILE *fp = path ? fopen(path, "r") : NULL;
+  if (!fp) return 0;
+  char line[128];
+  int gridSize = 0;
+  if (!fgets(line, sizeof(line), fp) || sscanf(line, "Canvas Data (GRID_SIZE: %d)", &gridSize) != 1) gridSize = 0;
+  fclose(fp);
+  return gridSize > 0 ? gridSize : 0;
+}
+
 // Load canvas text format by row labels, independent of file line ordering.
-bool PixelLoadCanvasText(const char *path, Color *canvas, int gridSize) {
+bool PixelLoadCanvasText(const char *path, PixelColor *canvas, int gridSize) {
   if (!path || !canvas || gridSize <= 0) return false;
 
   FILE *fp = fopen(path, "r");
@@ -128,3 +246,496 @@ bool PixelLoadCanvasText(const char *path, Color *canvas, int gridSize) {
 
   return fclose(fp) == 0;
 }
+
+#if defined(__SSE2__)
+static inline void Transpose4x4Epi32(__m128i r[4]) {
+  __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+  __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+  __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+  __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+  r[0] = _mm_unpacklo_epi64(t0, t1);
+  r[1] = _mm_unpackhi_epi64(t0, t1);
+  r[2] = _mm_unpacklo_epi64(t2, t3);
+  r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Rows in the low halves of r[0..7]; r[k] comes back holding output rows 2k and 2k + 1.
+static inline void Transpose8x8Epi8(__m128i r[8]) {
+  __m128i a0 = _mm_unpacklo_epi8(r[0], r[1]);
+  __m128i a1 = _mm_unpacklo_epi8(r[2], r[3]);
+  __m128i a2 = _mm_unpacklo_epi8(r[4], r[5]);
+  __m128i a3 = _mm_unpacklo_epi8(r[6], r[7]);
+  __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+  __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+  __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+  __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+  r[0] = _mm_unpacklo_epi32(b0, b2);
+  r[1] = _mm_unpackhi_epi32(b0, b2);
+  r[2] = _mm_unpacklo_epi32(b1, b3);
+  r[3] = _mm_unpackhi_epi32(b1, b3);
+}
+
+static inline void Load4x4(__m128i r[4], const PixelColor *src, ptrdiff_t stride) {
+  for (int i = 0; i < 4; i++) r[i] = _mm_loadu_si128((const __m128i *)(src + i * stride));
+}
+
+static inline void Store4x4(PixelColor *dst, ptrdiff_t stride, const __m128i r[4]) {
+  for (int i = 0; i < 4; i++) _mm_storeu_si128((__m128i *)(dst + i * stride), r[i]);
+}
+
+static inline void Load8x8(__m128i r[8], const unsigned char *src, ptrdiff_t stride) {
+  for (int i = 0; i < 8; i++) r[i] = _mm_loadl_epi64((const __m128i *)(src + i * stride));
+}
+
+static inline void Store8x8(unsigned char *dst, ptrdiff_t stride, const __m128i r[4]) {
+  for (int i = 0; i < 4; i++) {
+    _mm_storel_epi64((__m128i *)(dst + 2 * i * stride), r[i]);
+    _mm_storel_epi64((__m128i *)(dst + (2 * i + 1) * stride), _mm_unpackhi_epi64(r[i], r[i]));
+  }
+}
+
+// SSE2 has no byte shuffle: reverse the dwords, the words in each, then the bytes in each word.
+static inline __m128i ReverseEpi8(__m128i v) {
+  v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+  v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+// Transpose one 4x4 block of pixels.
+static inline void TransposeBlock4(PixelColor *dst, ptrdiff_t dstStride, const PixelColor *src, ptrdiff_t srcStride) {
+#if defined(__SSE2__)
+  __m128i r[4];
+  Load4x4(r, src, srcStride);
+  Transpose4x4Epi32(r);
+  Store4x4(dst, dstStride, r);
+#else
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) dst[x * dstStride + y] = src[y * srcStride + x];
+  }
+#endif
+}
+
+// Exchange the 4x4 blocks at a and b, transposing both; a == b transposes one block in place.
+static inline void SwapTransposeBlock4(PixelColor *a, PixelColor *b, ptrdiff_t stride) {
+#if defined(__SSE2__)
+  __m128i ra[4], rb[4];
+  Load4x4(ra, a, stride);
+  Load4x4(rb, b, stride);
+  Transpose4x4Epi32(ra);
+  Transpose4x4Epi32(rb);
+  Store4x4(b, stride, ra);
+  Store4x4(a, stride, rb);
+#else
+  PixelColor block[16];
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) block[x * 4 + y] = a[y * stride + x];
+  }
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) a[x * stride + y] = b[y * stride + x];
+  }
+  for (int y = 0; y < 4; y++) memcpy(b + y * stride, block + y * 4, 4 * sizeof(PixelColor));
+#endif
+}
+
+static inline void TransposeBlock8(unsigned char *dst, ptrdiff_t dstStride, const unsigned char *src, ptrdiff_t srcStride) {
+#if defined(__SSE2__)
+  __m128i r[8];
+  Load8x8(r, src, srcStride);
+  Transpose8x8Epi8(r);
+  Store8x8(dst, dstStride, r);
+#else
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) dst[x * dstStride + y] = src[y * srcStride + x];
+  }
+#endif
+}
+
+static inline void SwapTransposeBlock8(unsigned char *a, unsigned char *b, ptrdiff_t stride) {
+#if defined(__SSE2__)
+  __m128i ra[8], rb[8];
+  Load8x8(ra, a, stride);
+  Load8x8(rb, b, stride);
+  Transpose8x8Epi8(ra);
+  Transpose8x8Epi8(rb);
+  Store8x8(b, stride, ra);
+  Store8x8(a, stride, rb);
+#else
+  unsigned char block[64];
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) block[x * 8 + y] = a[y * stride + x];
+  }
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) a[x * stride + y] = b[y * stride + x];
+  }
+  for (int y = 0; y < 8; y++) memcpy(b + y * stride, block + y * 8, 8);
+#endif
+}
+
+// Blocked transposes. Tiles of PIXEL_TRANSPOSE_BLOCK squared keep both the
+// rows read and the columns written in cache, and each tile moves in 4x4
+// (RGBA) or 8x8 (indexed) register blocks; only the ragged right and bottom
+// strips go a pixel at a time. Blocks are visited along destination rows, so
+// writes stream and the strided side is the reads. A negative stride walks
+// rows bottom up, which is how quarter turns fold their flip into the pass.
+static void TransposePixels(PixelColor *dst, ptrdiff_t dstStride, const PixelColor *src, ptrdiff_t srcStride, int width,
+                            int height) {
+  int alignedWidth = width & ~3, alignedHeight = height & ~3;
+  for (int by = 0; by < alignedHeight; by += PIXEL_TRANSPOSE_BLOCK) {
+    int y1 = by + PIXEL_TRANSPOSE_BLOCK < alignedHeight ? by + PIXEL_TRANSPOSE_BLOCK : alignedHeight;
+    for (int bx = 0; bx < alignedWidth; bx += PIXEL_TRANSPOSE_BLOCK) {
+      int x1 = bx + PIXEL_TRANSPOSE_BLOCK < alignedWidth ? bx + PIXEL_TRANSPOSE_BLOCK : alignedWidth;
+      for (int x = bx; x < x1; x += 4) {
+        for (int y = by; y < y1; y += 4) TransposeBlock4(dst + x * dstStride + y, dstStride, src + y * srcStride + x, srcStride);
+      }
+    }
+  }
+  for (int y = 0; y < height; y++) {
+    const PixelColor *in = src + y * srcStride;
+    for (int x = y < alignedHeight ? alignedWidth : 0; x < width; x++) dst[x * dstStride + y] = in[x];
+  }
+}
+
+static void TransposeIndexed(unsigned char *dst, ptrdiff_t dstStride, const unsigned char *src, ptrdiff_t srcStride,
+                             int width, int height) {
+  int alignedWidth = width & ~7, alignedHeight = height & ~7;
+  for (int by = 0; by < alignedHeight; by += PIXEL_TRANSPOSE_BLOCK) {
+    int y1 = by + PIXEL_TRANSPOSE_BLOCK < alignedHeight ? by + PIXEL_TRANSPOSE_BLOCK : alignedHeight;
+    for (int bx = 0; bx < alignedWidth; bx += PIXEL_TRANSPOSE_BLOCK) {
+      int x1 = bx + PIXEL_TRANSPOSE_BLOCK < alignedWidth ? bx + PIXEL_TRANSPOSE_BLOCK : alignedWidth;
+      for (int x = bx; x < x1; x += 8) {
+        for (int y = by; y < y1; y += 8) TransposeBlock8(dst + x * dstStride + y, dstStride, src + y * srcStride + x, srcStride);
+      }
+    }
+  }
+  for (int y = 0; y < height; y++) {
+    const unsigned char *in = src + y * srcStride;
+    for (int x = y < alignedHeight ? alignedWidth : 0; x < width; x++) dst[x * dstStride + y] = in[x];
+  }
+}
+
+// Square transposes in place: each block above the diagonal trades places
+// with its mirror below it, so no second buffer is needed.
+static void TransposeSquarePixels(PixelColor *pixels, int size) {
+  int aligned = size & ~3;
+  for (int by = 0; by < aligned; by += PIXEL_TRANSPOSE_BLOCK) {
+    int y1 = by + PIXEL_TRANSPOSE_BLOCK < aligned ? by + PIXEL_TRANSPOSE_BLOCK : aligned;
+    for (int bx = by; bx < aligned; bx += PIXEL_TRANSPOSE_BLOCK) {
+      int x1 = bx + PIXEL_TRANSPOSE_BLOCK < aligned ? bx + PIXEL_TRANSPOSE_BLOCK : aligned;
+      for (int y = by; y < y1; y += 4) {
+        for (int x = bx == by ? y : bx; x < x1; x += 4) {
+          SwapTransposeBlock4(pixels + (ptrdiff_t)y * size + x, pixels + (ptrdiff_t)x * size + y, size);
+        }
+      }
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = y + 1 > aligned ? y + 1 : aligned; x < size; x++) {
+      PixelColor swap = pixels[(ptrdiff_t)y * size + x];
+      pixels[(ptrdiff_t)y * size + x] = pixels[(ptrdiff_t)x * size + y];
+      pixels[(ptrdiff_t)x * size + y] = swap;
+    }
+  }
+}
+
+static void TransposeSquareIndexed(unsigned char *pixels, int size) {
+  int aligned = size & ~7;
+  for (int by = 0; by < aligned; by += PIXEL_TRANSPOSE_BLOCK) {
+    int y1 = by + PIXEL_TRANSPOSE_BLOCK < aligned ? by + PIXEL_TRANSPOSE_BLOCK : aligned;
+    for (int bx = by; bx < aligned; bx += PIXEL_TRANSPOSE_BLOCK) {
+      int x1 = bx + PIXEL_TRANSPOSE_BLOCK < aligned ? bx + PIXEL_TRANSPOSE_BLOCK : aligned;
+      for (int y = by; y < y1; y += 8) {
+        for (int x = bx == by ? y : bx; x < x1; x += 8) {
+          SwapTransposeBlock8(pixels + (ptrdiff_t)y * size + x, pixels + (ptrdiff_t)x * size + y, size);
+        }
+      }
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = y + 1 > aligned ? y + 1 : aligned; x < size; x++) {
+      unsigned char swap = pixels[(ptrdiff_t)y * size + x];
+      pixels[(ptrdiff_t)y * size + x] = pixels[(ptrdiff_t)x * size + y];
+      pixels[(ptrdiff_t)x * size + y] = swap;
+    }
+  }
+}
+
+// Reverse a run of pixels in place, four at a time from both ends.
+static void ReversePixels(PixelColor *pixels, size_t count) {
+  size_t left = 0, right = count;
+#if defined(__SSE2__)
+  for (; right - left >= 8; left += 4, right -= 4) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(pixels + left));
+    __m128i b = _mm_loadu_si128((const __m128i *)(pixels + right - 4));
+    _mm_storeu_si128((__m128i *)(pixels + left), _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3)));
+    _mm_storeu_si128((__m128i *)(pixels + right - 4), _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 1, 2, 3)));
+  }
+#endif
+  for (; right - left >= 2; left++) {
+    PixelColor swap = pixels[left];
+    pixels[left] = pixels[--right];
+    pixels[right] = swap;
+  }
+}
+
+static void ReverseIndexed(unsigned char *pixels, size_t count) {
+  size_t left = 0, right = count;
+#if defined(__SSE2__)
+  for (; right - left >= 32; left += 16, right -= 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(pixels + left));
+    __m128i b = _mm_loadu_si128((const __m128i *)(pixels + right - 16));
+    _mm_storeu_si128((__m128i *)(pixels + left), ReverseEpi8(b));
+    _mm_storeu_si128((__m128i *)(pixels + right - 16), ReverseEpi8(a));
+  }
+#endif
+  for (; right - left >= 2; left++) {
+    unsigned char swap = pixels[left];
+    pixels[left] = pixels[--right];
+    pixels[right] = swap;
+  }
+}
+
+// Swap the rows of a block top to bottom in place, a chunk at a time.
+static void FlipRows(unsigned char *pixels, size_t strideBytes, size_t rowBytes, int height) {
+  unsigned char chunk[1024];
+  for (int top = 0, bottom = height - 1; top < bottom; top++, bottom--) {
+    unsigned char *a = pixels + (size_t)top * strideBytes;
+    unsigned char *b = pixels + (size_t)bottom * strideBytes;
+    for (size_t offset = 0; offset < rowBytes; offset += sizeof(chunk)) {
+      size_t bytes = rowBytes - offset < sizeof(chunk) ? rowBytes - offset : sizeof(chunk);
+      memcpy(chunk, a + offset, bytes);
+      memcpy(a + offset, b + offset, bytes);
+      memcpy(b + offset, chunk, bytes);
+    }
+  }
+}
+
+// Copy a width x height block into dst transposed (dst is height x width);
+// strides are in pixels.
+void PixelTransposeRect(PixelColor *dst, int dstStride, const PixelColor *src, int srcStride, int width, int height) {
+  if (!dst || !src || width <= 0 || height <= 0) return;
+  TransposePixels(dst, dstStride, src, srcStride, width, height);
+}
+
+// Mirror every row of a block in place.
+void PixelFlipHorizontal(PixelColor *pixels, int stride, int width, int height) {
+  if (!pixels || width <= 1 || height <= 0) return;
+  for (int y = 0; y < height; y++) ReversePixels(pixels + (size_t)y * (size_t)stride, (size_t)width);
+}
+
+void PixelFlipVertical(PixelColor *pixels, int stride, int width, int height) {
+  if (!pixels || width <= 0 || height <= 1) return;
+  FlipRows((unsigned char *)pixels, (size_t)stride * sizeof(PixelColor), (size_t)width * sizeof(PixelColor), height);
+}
+
+// Quarter turns and the transpose leave a height x width canvas.
+bool PixelTransformSwapsAxes(PixelTransform transform) {
+  return transform == PIXEL_TRANSFORM_ROTATE_90 || transform == PIXEL_TRANSFORM_ROTATE_270 ||
+         transform == PIXEL_TRANSFORM_TRANSPOSE;
+}
+
+// Transform a width x height canvas into dst, which must not overlap it.
+// Every transform is a single pass: quarter turns transpose with the source
+// (clockwise) or destination (counter-clockwise) rows walked bottom up.
+void PixelTransformCanvasCopy(PixelColor *dst, const PixelColor *src, int width, int height, PixelTransform transform) {
+  if (!dst || !src || width <= 0 || height <= 0) return;
+  size_t count = (size_t)width * (size_t)height;
+  switch (transform) {
+    case PIXEL_TRANSFORM_ROTATE_90:
+      TransposePixels(dst, height, src + (count - (size_t)width), -(ptrdiff_t)width, width, height);
+      return;
+    case PIXEL_TRANSFORM_ROTATE_270:
+      TransposePixels(dst + (count - (size_t)height), -(ptrdiff_t)height, src, width, width, height);
+      return;
+    case PIXEL_TRANSFORM_TRANSPOSE:
+      TransposePixels(dst, height, src, width, width, height);
+      return;
+    default:
+      memcpy(dst, src, count * sizeof(PixelColor));
+      PixelTransformCanvas(dst, width, height, transform);
+      return;
+  }
+}
+
+// Transform a canvas in place. Flips and the half turn always are; quarter
+// turns of a square canvas transpose it in place and then flip. Only quarter
+// turns of other shapes need a scratch copy, so they can fail for memory.
+bool PixelTransformCanvas(PixelColor *canvas, int width, int height, PixelTransform transform) {
+  if (!canvas || width <= 0 || height <= 0) return false;
+  size_t count = (size_t)width * (size_t)height;
+  switch (transform) {
+    case PIXEL_TRANSFORM_FLIP_HORIZONTAL:
+      PixelFlipHorizontal(canvas, width, width, height);
+      return true;
+    case PIXEL_TRANSFORM_FLIP_VERTICAL:
+      PixelFlipVertical(canvas, width, width, height);
+      return true;
+    case PIXEL_TRANSFORM_ROTATE_180:
+      ReversePixels(canvas, count);
+      return true;
+    default:
+      break;
+  }
+  if (width == height) {
+    TransposeSquarePixels(canvas, width);
+    if (transform == PIXEL_TRANSFORM_ROTATE_90) PixelFlipHorizontal(canvas, width, width, height);
+    else if (transform == PIXEL_TRANSFORM_ROTATE_270) PixelFlipVertical(canvas, width, width, height);
+    return true;
+  }
+  PixelColor *scratch = (PixelColor *)malloc(count * sizeof(PixelColor));
+  if (!scratch) return false;
+  PixelTransformCanvasCopy(scratch, canvas, width, height, transform);
+  memcpy(canvas, scratch, count * sizeof(PixelColor));
+  free(scratch);
+  return true;
+}
+
+// Same transforms for indexed canvases, one palette index per byte.
+void PixelTransformIndexedCopy(unsigned char *dst, const unsigned char *src, int width, int height,
+                               PixelTransform transform) {
+  if (!dst || !src || width <= 0 || height <= 0) return;
+  size_t count = (size_t)width * (size_t)height;
+  switch (transform) {
+    case PIXEL_TRANSFORM_ROTATE_90:
+      TransposeIndexed(dst, height, src + (count - (size_t)width), -(ptrdiff_t)width, width, height);
+      return;
+    case PIXEL_TRANSFORM_ROTATE_270:
+      TransposeIndexed(dst + (count - (size_t)height), -(ptrdiff_t)height, src, width, width, height);
+      return;
+    case PIXEL_TRANSFORM_TRANSPOSE:
+      TransposeIndexed(dst, height, src, width, width, height);
+      return;
+    default:
+      memcpy(dst, src, count);
+      PixelTransformIndexed(dst, width, height, transform);
+      return;
+  }
+}
+
+bool PixelTransformIndexed(unsigned char *canvas, int width, int height, PixelTransform transform) {
+  if (!canvas || width <= 0 || height <= 0) return false;
+  size_t count = (size_t)width * (size_t)height;
+  switch (transform) {
+    case PIXEL_TRANSFORM_FLIP_HORIZONTAL:
+      for (int y = 0; y < height; y++) ReverseIndexed(canvas + (size_t)y * (size_t)width, (size_t)width);
+      return true;
+    case PIXEL_TRANSFORM_FLIP_VERTICAL:
+      FlipRows(canvas, (size_t)width, (size_t)width, height);
+      return true;
+    case PIXEL_TRANSFORM_ROTATE_180:
+      ReverseIndexed(canvas, count);
+      return true;
+    default:
+      break;
+  }
+  if (width == height) {
+    TransposeSquareIndexed(canvas, width);
+    if (transform == PIXEL_TRANSFORM_ROTATE_90) PixelTransformIndexed(canvas, width, height, PIXEL_TRANSFORM_FLIP_HORIZONTAL);
+    else if (transform == PIXEL_TRANSFORM_ROTATE_270) FlipRows(canvas, (size_t)width, (size_t)width, height);
+    return true;
+  }
+  unsigned char *scratch = (unsigned char *)malloc(count);
+  if (!scratch) return false;
+  PixelTransformIndexedCopy(scratch, canvas, width, height, transform);
+  memcpy(canvas, scratch, count);
+  free(scratch);
+  return true;
+}
+
+static uint32_t PackColor(PixelColor color) {
+  uint32_t packed;
+  memcpy(&packed, &color, sizeof(packed));
+  return packed;
+}
+
+// Repaint every pixel of color from as to; returns how many changed. Four
+// pixels are compared at once and blended through the match mask, and
+// blocks without a match are not written back, so untouched memory stays clean.
+size_t PixelReplaceColor(PixelColor *pixels, size_t count, PixelColor from, PixelColor to) {
+  if (!pixels || PixelColorEqual(from, to)) return 0;
+  size_t replaced = 0, i = 0;
+#if defined(__SSE2__)
+  const __m128i vFrom = _mm_set1_epi32((int)PackColor(from));
+  const __m128i vTo = _mm_set1_epi32((int)PackColor(to));
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pixels + i));
+    __m128i match = _mm_cmpeq_epi32(v, vFrom);
+    int bits = _mm_movemask_ps(_mm_castsi128_ps(match));
+    if (bits == 0) continue;
+    _mm_storeu_si128((__m128i *)(pixels + i), _mm_or_si128(_mm_and_si128(match, vTo), _mm_andnot_si128(match, v)));
+    bits = (bits & 5) + ((bits >> 1) & 5);
+    replaced += (size_t)((bits & 3) + (bits >> 2));
+  }
+#endif
+  for (; i < count; i++) {
+    if (!PixelColorEqual(pixels[i], from)) continue;
+    pixels[i] = to;
+    replaced++;
+  }
+  return replaced;
+}
+
+// Swap one palette for another at the same index: pixels of from[i] become
+// to[i], all in one pass, so A->B together with B->A trades the two colors.
+// from's colors go into an open-addressed table of palette indices (the
+// first of duplicate colors wins), and runs of one color reuse the last
+// lookup. Returns false only when the table cannot be allocated.
+bool PixelSwapPalette(PixelColor *pixels, size_t count, const PixelColor *from, const PixelColor *to, int colorCount,
+                      size_t *changed) {
+  if (changed) *changed = 0;
+  if (!pixels || !from || !to || colorCount <= 0) return true;
+  size_t capacity = 16;
+  while (capacity < (size_t)colorCount * 2) capacity *= 2;
+  int *slots = (int *)malloc(capacity * sizeof(int));
+  if (!slots) return false;
+  memset(slots, 0xFF, capacity * sizeof(int));
+
+  // Fibonacci hashing: the top bits of key * 2^32/phi index the table
+  int shift = 32;
+  for (size_t bits = capacity; bits > 1; bits >>= 1) shift--;
+  for (int i = 0; i < colorCount; i++) {
+    uint32_t key = PackColor(from[i]);
+    size_t slot = (size_t)((key * 2654435769u) >> shift);
+    while (slots[slot] >= 0 && PackColor(from[slots[slot]]) != key) slot = (slot + 1) & (capacity - 1);
+    if (slots[slot] < 0) slots[slot] = i;
+  }
+
+  size_t swapped = 0;
+  uint32_t lastIn = 0, lastOut = 0;
+  bool haveLast = false;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t in = PackColor(pixels[i]);
+    if (!haveLast || in != lastIn) {
+      size_t slot = (size_t)((in * 2654435769u) >> shift);
+      lastOut = in;
+      for (; slots[slot] >= 0; slot = (slot + 1) & (capacity - 1)) {
+        if (PackColor(from[slots[slot]]) == in) {
+          lastOut = PackColor(to[slots[slot]]);
+          break;
+        }
+      }
+      lastIn = in;
+      haveLast = true;
+    }
+    if (lastOut != in) {
+      memcpy(&pixels[i], &lastOut, sizeof(lastOut));
+      swapped++;
+    }
+  }
+  free(slots);
+  if (changed) *changed = swapped;
+  return true;
+}
+
+// Indexed canvases swap palettes through a 256-entry index map.
+void PixelRemapIndexed(unsigned char *pixels, size_t count, const unsigned char map[256]) {
+  if (!pixels || !map) return;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    pixels[i] = map[pixels[i]];
+    pixels[i + 1] = map[pixels[i + 1]];
+    pixels[i + 2] = map[pixels[i + 2]];
+    pixels[i + 3] = map[pixels[i + 3]];
+  }
+  for (; i < count; i++) pixels[i] = map[pixels[i]];
+}
@@ -3,13 +3,52 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
-#include "raylib.h"
+// RGBA8 pixel with straight (non-premultiplied) alpha.
+// Layout matches raylib Color so buffers can be shared without conversion.
+typedef struct PixelColor {
+  unsigned char r;
+  unsigned char g;
+  unsigned char b;
+  unsigned char a;
+} PixelColor;
 
+#define PIXEL_BLANK ((PixelColor){0, 0, 0, 0})
+#define PIXEL_TRANSPOSE_BLOCK 32       // Tile edge of blocked transposes: two 4 KB tiles stay in L1
+
+// Whole-canvas transforms; quarter turns and the transpose swap width and height.
+typedef enum {
+  PIXEL_TRANSFORM_FLIP_HORIZONTAL = 0,
+  PIXEL_TRANSFORM_FLIP_VERTICAL,
+  PIXEL_TRANSFORM_ROTATE_90,           // Clockwise
+  PIXEL_TRANSFORM_ROTATE_180,
+  PIXEL_TRANSFORM_ROTATE_270,
+  PIXEL_TRANSFORM_TRANSPOSE
+} PixelTransform;
+
+bool PixelColorEqual(PixelColor a, PixelColor b);
 bool PixelNormalizeBaseName(const char *input, char *out, size_t outSize);
 bool PixelBuildFilePath(const char *dir, const char *input, const char *ext, char *out, size_t outSize);
-void PixelPaintBrush(Color *canvas, int gridSize, int gx, int gy, Color color, int brushSize);
-bool PixelSaveCanvasText(const char *path, const Color *canvas, int gridSize);
-bool PixelLoadCanvasText(const char *path, Color *canvas, int gridSize);
+void PixelPaintBrush(PixelColor *canvas, int gridSize, int gx, int gy, PixelColor color, int brushSize);
+void PixelPaintBrushEx(PixelColor *canvas, int width, int height, int gx, int gy, PixelColor color, int brushSize);
+bool PixelSaveCanvasText(const char *path, const PixelColor *canvas, int gridSize);
+bool PixelSaveCanvasTextEx(const char *path, const PixelColor *canvas, int gridSize, size_t *bytesWritten);
+bool PixelCommitTempFile(FILE *fp, const char *tempPath, const char *path);
+bool PixelLoadCanvasText(const char *path, PixelColor *canvas, int gridSize);
+int PixelCanvasTextGridSize(const char *path);
+void PixelTransposeRect(PixelColor *dst, int dstStride, const PixelColor *src, int srcStride, int width, int height);
+void PixelFlipHorizontal(PixelColor *pixels, int stride, int width, int height);
+void PixelFlipVertical(PixelColor *pixels, int stride, int width, int height);
+bool PixelTransformSwapsAxes(PixelTransform transform);
+bool PixelTransformCanvas(PixelColor *canvas, int width, int height, PixelTransform transform);
+void PixelTransformCanvasCopy(PixelColor *dst, const PixelColor *src, int width, int height, PixelTransform transform);
+bool PixelTransformIndexed(unsigned char *canvas, int width, int height, PixelTransform transform);
+void PixelTransformIndexedCopy(unsigned char *dst, const unsigned char *src, int width, int height,
+                               PixelTransform transform);
+size_t PixelReplaceColor(PixelColor *pixels, size_t count, PixelColor from, PixelColor to);
+bool PixelSwapPalette(PixelColor *pixels, size_t count, const PixelColor *from, const PixelColor *to, int colorCount,
+                      size_t *changed);
+void PixelRemapIndexed(unsigned char *pixels, size_t count, const unsigned char map[256]);
 
 #endif
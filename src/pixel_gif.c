@@ -0,0 +1,452 @@
+#include "pixel_gif.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GIF_MAX_CODE 4096
+#define GIF_HASH_SIZE 5003        // Prime a little over the 4096-entry code table
+#define GIF_COLOR_CACHE_SIZE 1024
+
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+  bool failed;
+} GifBuffer;
+
+typedef struct {
+  int x, y, w, h;                  // Frame rectangle on the logical screen
+  int clearX0, clearY0, clearX1, clearY1;
+  bool needsClear;                 // Some pixels turn transparent vs the previous frame
+  bool explicitPixels;             // Previous frame is disposed, so draw every pixel
+  int disposal;                    // 1 = keep, 2 = restore to background
+} GifFrameInfo;
+
+typedef struct {
+  const PixelColor *const *frames;
+  int frameCount;
+  int width;
+  int height;
+  const PixelGifOptions *options;
+  int colorCount;
+  unsigned char **indexed;         // Per-frame global palette indices
+  GifFrameInfo *info;
+  GifBuffer *encoded;
+} GifJob;
+
+static int MinInt(int a, int b) { return a < b ? a : b; }
+static int MaxInt(int a, int b) { return a > b ? a : b; }
+
+//------------------------------------------------------------------------------------
+// Byte buffer helpers
+//------------------------------------------------------------------------------------
+static void BufPut(GifBuffer *buf, const void *data, size_t size) {
+  if (buf->failed) return;
+  if (buf->size + size > buf->capacity) {
+    size_t capacity = buf->capacity > 0 ? buf->capacity : 1024;
+    while (capacity < buf->size + size) capacity *= 2;
+    unsigned char *grown = (unsigned char *)realloc(buf->data, capacity);
+    if (!grown) {
+      buf->failed = true;
+      return;
+    }
+    buf->data = grown;
+    buf->capacity = capacity;
+  }
+  memcpy(buf->data + buf->size, data, size);
+  buf->size += size;
+}
+
+static void BufByte(GifBuffer *buf, unsigned int value) {
+  unsigned char b = (unsigned char)value;
+  BufPut(buf, &b, 1);
+}
+
+static void BufU16(GifBuffer *buf, unsigned int value) {
+  BufByte(buf, value & 0xFF);
+  BufByte(buf, (value >> 8) & 0xFF);
+}
+
+//------------------------------------------------------------------------------------
+// LZW encoder with a hashed (prefix, byte) -> code table
+//------------------------------------------------------------------------------------
+typedef struct {
+  GifBuffer *out;
+  unsigned char block[255];
+  int blockSize;
+  uint32_t bits;
+  int bitCount;
+} GifBitWriter;
+
+static void FlushBlock(GifBitWriter *w) {
+  if (w->blockSize == 0) return;
+  BufByte(w->out, (unsigned int)w->blockSize);
+  BufPut(w->out, w->block, (size_t)w->blockSize);
+  w->blockSize = 0;
+}
+
+static void WriteCode(GifBitWriter *w, int code, int codeSize) {
+  w->bits |= (uint32_t)code << w->bitCount;
+  w->bitCount += codeSize;
+  while (w->bitCount >= 8) {
+    w->block[w->blockSize++] = (unsigned char)(w->bits & 0xFF);
+    if (w->blockSize == 255) FlushBlock(w);
+    w->bits >>= 8;
+    w->bitCount -= 8;
+  }
+}
+
+static void LzwEncode(GifBuffer *out, const unsigned char *indices, size_t count, int minCodeSize) {
+  int32_t *keys = (int32_t *)malloc(GIF_HASH_SIZE * sizeof(int32_t));
+  int16_t *codes = (int16_t *)malloc(GIF_HASH_SIZE * sizeof(int16_t));
+  if (!keys || !codes) {
+    free(keys);
+    free(codes);
+    out->failed = true;
+    return;
+  }
+
+  const int clearCode = 1 << minCodeSize;
+  const int endCode = clearCode + 1;
+  int nextCode = endCode + 1;
+  int codeSize = minCodeSize + 1;
+  GifBitWriter w = {.out = out};
+
+  BufByte(out, (unsigned int)minCodeSize);
+  memset(keys, -1, GIF_HASH_SIZE * sizeof(int32_t));
+  WriteCode(&w, clearCode, codeSize);
+
+  int prefix = indices[0];
+  for (size_t i = 1; i < count; i++) {
+    int c = indices[i];
+    int32_t key = (prefix << 8) | c;
+    int h = (int)(((uint32_t)key * 2654435761u) % GIF_HASH_SIZE);
+    while (keys[h] != -1 && keys[h] != key) {
+      if (++h == GIF_HASH_SIZE) h = 0;
+    }
+    if (keys[h] == key) {
+      prefix = codes[h];
+      continue;
+    }
+
+    WriteCode(&w, prefix, codeSize);
+    if (nextCode < GIF_MAX_CODE) {
+      keys[h] = key;
+      codes[h] = (int16_t)nextCode++;
+      // Decoders widen codes one entry late, once the next code needs the extra bit.
+      if (nextCode > (1 << codeSize) && codeSize < 12) codeSize++;
+    } else {
+      WriteCode(&w, clearCode, codeSize);
+      memset(keys, -1, GIF_HASH_SIZE * sizeof(int32_t));
+      nextCode = endCode + 1;
+      codeSize = minCodeSize + 1;
+    }
+    prefix = c;
+  }
+
+  WriteCode(&w, prefix, codeSize);
+  WriteCode(&w, endCode, codeSize);
+  if (w.bitCount > 0) WriteCode(&w, 0, 8 - w.bitCount);
+  FlushBlock(&w);
+  BufByte(out, 0);
+
+  free(keys);
+  free(codes);
+}
+
+//------------------------------------------------------------------------------------
+// Frame analysis
+//------------------------------------------------------------------------------------
+static int TableBits(int entries) {
+  int bits = 1;
+  while ((1 << bits) < entries) bits++;
+  return bits;
+}
+
+static int NearestColor(const PixelColor *palette, int count, PixelColor c) {
+  int best = 0;
+  int bestDist = 1 << 30;
+  for (int i = 0; i < count; i++) {
+    int dr = (int)c.r - palette[i].r, dg = (int)c.g - palette[i].g, db = (int)c.b - palette[i].b;
+    int dist = dr * dr + dg * dg + db * db;
+    if (dist < bestDist) {
+      bestDist = dist;
+      best = i;
+    }
+  }
+  return best;
+}
+
+// Convert one frame to global palette indices; off-palette colors snap to the
+// nearest entry and mostly transparent pixels use the reserved index.
+static void MapFrameJob(void *user, int frame) {
+  GifJob *job = (GifJob *)user;
+  const PixelColor *pixels = job->frames[frame];
+  unsigned char *out = job->indexed[frame];
+  const unsigned char transparent = (unsigned char)job->colorCount;
+
+  uint32_t cacheKeys[GIF_COLOR_CACHE_SIZE];
+  unsigned char cacheValues[GIF_COLOR_CACHE_SIZE];
+  memset(cacheKeys, 0, sizeof(cacheKeys));
+
+  size_t count = (size_t)job->width * (size_t)job->height;
+  for (size_t i = 0; i < count; i++) {
+    PixelColor c = pixels[i];
+    if (c.a < 128) {
+      out[i] = transparent;
+      continue;
+    }
+    // Key keeps bit 24 set so a zero slot always means empty.
+    uint32_t key = 0x1000000u | ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+    uint32_t h = (key * 2654435761u) >> 22;
+    if (cacheKeys[h] != key) {
+      cacheKeys[h] = key;
+      cacheValues[h] = (unsigned char)NearestColor(job->options->palette, job->colorCount, c);
+    }
+    out[i] = cacheValues[h];
+  }
+}
+
+// Bounding box of pixels that differ from the previous frame, and of those
+// that turn transparent (which a non-disposing frame cannot express).
+static void DiffFrameJob(void *user, int frame) {
+  GifJob *job = (GifJob *)user;
+  GifFrameInfo *info = &job->info[frame];
+  const unsigned char *cur = job->indexed[frame];
+  const unsigned char *prev = job->indexed[frame > 0 ? frame - 1 : job->frameCount - 1];
+  const unsigned char transparent = (unsigned char)job->colorCount;
+
+  int x0 = job->width, y0 = job->height, x1 = 0, y1 = 0;
+  int cx0 = job->width, cy0 = job->height, cx1 = 0, cy1 = 0;
+  for (int y = 0; y < job->height; y++) {
+    const unsigned char *a = prev + (size_t)y * (size_t)job->width;
+    const unsigned char *b = cur + (size_t)y * (size_t)job->width;
+    for (int x = 0; x < job->width; x++) {
+      if (a[x] == b[x]) continue;
+      x0 = MinInt(x0, x); y0 = MinInt(y0, y); x1 = MaxInt(x1, x + 1); y1 = MaxInt(y1, y + 1);
+      if (b[x] == transparent) {
+        cx0 = MinInt(cx0, x); cy0 = MinInt(cy0, y); cx1 = MaxInt(cx1, x + 1); cy1 = MaxInt(cy1, y + 1);
+      }
+    }
+  }
+
+  info->disposal = 1;
+  if (frame == 0) {
+    info->x = 0; info->y = 0; info->w = job->width; info->h = job->height;
+    info->explicitPixels = true;
+  } else if (x0 < x1) {
+    info->x = x0; info->y = y0; info->w = x1 - x0; info->h = y1 - y0;
+  } else {
+    // Unchanged frame still carries its delay as one transparent pixel.
+    info->x = 0; info->y = 0; info->w = 1; info->h = 1;
+  }
+  info->needsClear = cx0 < cx1;
+  info->clearX0 = cx0; info->clearY0 = cy0; info->clearX1 = cx1; info->clearY1 = cy1;
+}
+
+static void UnionRect(GifFrameInfo *info, int x0, int y0, int x1, int y1) {
+  int nx0 = MinInt(info->x, x0), ny0 = MinInt(info->y, y0);
+  int nx1 = MaxInt(info->x + info->w, x1), ny1 = MaxInt(info->y + info->h, y1);
+  info->x = nx0; info->y = ny0; info->w = nx1 - nx0; info->h = ny1 - ny0;
+}
+
+// Frames that erase pixels dispose their predecessor to background, and the
+// predecessor's rectangle grows to cover every pixel that must be erased.
+static void PlanDisposal(GifJob *job) {
+  for (int i = 1; i <= job->frameCount; i++) {
+    int frame = i % job->frameCount;
+    GifFrameInfo *info = &job->info[frame];
+    if (!info->needsClear) continue;
+
+    GifFrameInfo *prev = &job->info[(frame + job->frameCount - 1) % job->frameCount];
+    prev->disposal = 2;
+    UnionRect(prev, info->clearX0, info->clearY0, info->clearX1, info->clearY1);
+    info->explicitPixels = true;
+    UnionRect(info, prev->x, prev->y, prev->x + prev->w, prev->y + prev->h);
+  }
+}
+
+//------------------------------------------------------------------------------------
+// Frame encoding
+//------------------------------------------------------------------------------------
+static void WriteColorTable(GifBuffer *out, const PixelColor *palette, const int *entries, int count, int bits) {
+  for (int i = 0; i < (1 << bits); i++) {
+    PixelColor c = (i < count && entries[i] >= 0) ? palette[entries[i]] : PIXEL_BLANK;
+    BufByte(out, c.r);
+    BufByte(out, c.g);
+    BufByte(out, c.b);
+  }
+}
+
+// Encode one frame (extension, descriptor, optional local table, LZW data).
+// Frames only read shared analysis results, so they encode independently.
+static void EncodeFrameJob(void *user, int frame) {
+  GifJob *job = (GifJob *)user;
+  const GifFrameInfo *info = &job->info[frame];
+  GifBuffer *out = &job->encoded[frame];
+  const unsigned char *cur = job->indexed[frame];
+  const unsigned char *prev = frame > 0 ? job->indexed[frame - 1] : NULL;
+  const int transparent = job->colorCount;
+
+  unsigned char *pixels = (unsigned char *)malloc((size_t)info->w * (size_t)info->h);
+  if (!pixels) {
+    out->failed = true;
+    return;
+  }
+
+  size_t n = 0;
+  for (int y = info->y; y < info->y + info->h; y++) {
+    size_t row = (size_t)y * (size_t)job->width;
+    for (int x = info->x; x < info->x + info->w; x++) {
+      unsigned char value = cur[row + (size_t)x];
+      // Unchanged pixels become transparent so the previous frame shows through.
+      if (!info->explicitPixels && prev && prev[row + (size_t)x] == value) value = (unsigned char)transparent;
+      pixels[n++] = value;
+    }
+  }
+
+  int localMap[PIXEL_GIF_MAX_COLORS + 1];
+  int localEntries[PIXEL_GIF_MAX_COLORS + 1];
+  int tableEntries = job->colorCount + 1;
+  int localTransparent = transparent;
+  if (job->options->perFramePalette) {
+    for (int i = 0; i <= job->colorCount; i++) localMap[i] = -1;
+    tableEntries = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (pixels[i] == transparent || localMap[pixels[i]] >= 0) continue;
+      localEntries[tableEntries] = pixels[i];
+      localMap[pixels[i]] = tableEntries++;
+    }
+    localTransparent = tableEntries;
+    localEntries[tableEntries++] = -1;
+    localMap[transparent] = localTransparent;
+    for (size_t i = 0; i < n; i++) pixels[i] = (unsigned char)localMap[pixels[i]];
+  }
+
+  int delay = (100 + job->options->fps / 2) / MaxInt(job->options->fps, 1);
+  BufByte(out, 0x21);
+  BufByte(out, 0xF9);
+  BufByte(out, 4);
+  BufByte(out, (unsigned int)(info->disposal << 2) | 1u);
+  BufU16(out, (unsigned int)MaxInt(delay, 2));
+  BufByte(out, (unsigned int)localTransparent);
+  BufByte(out, 0);
+
+  int bits = TableBits(tableEntries);
+  BufByte(out, 0x2C);
+  BufU16(out, (unsigned int)info->x);
+  BufU16(out, (unsigned int)info->y);
+  BufU16(out, (unsigned int)info->w);
+  BufU16(out, (unsigned int)info->h);
+  if (job->options->perFramePalette) {
+    BufByte(out, 0x80u | (unsigned int)(bits - 1));
+    WriteColorTable(out, job->options->palette, localEntries, tableEntries, bits);
+  } else {
+    BufByte(out, 0);
+  }
+
+  LzwEncode(out, pixels, n, MaxInt(bits, 2));
+  free(pixels);
+}
+
+// Encode frames (straight-alpha RGBA) as a looping GIF in memory. Mapping,
+// diffing and LZW run per frame on the pool; only disposal planning and the
+// final concatenation are sequential. Caller frees *outData.
+bool PixelGifEncode(const PixelColor *const *frames, int frameCount, int width, int height,
+                    const PixelGifOptions *options, PixelJobPool *pool, unsigned char **outData, size_t *outSize) {
+  if (!frames || frameCount <= 0 || width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF) return false;
+  if (!options || !options->palette || options->paletteCount <= 0 || !outData || !outSize) return false;
+
+  GifJob job = {
+      .frames = frames,
+      .frameCount = frameCount,
+      .width = width,
+      .height = height,
+      .options = options,
+      .colorCount = MinInt(options->paletteCount, PIXEL_GIF_MAX_COLORS),
+  };
+  job.indexed = (unsigned char **)calloc((size_t)frameCount, sizeof(unsigned char *));
+  job.info = (GifFrameInfo *)calloc((size_t)frameCount, sizeof(GifFrameInfo));
+  job.encoded = (GifBuffer *)calloc((size_t)frameCount, sizeof(GifBuffer));
+  int *order = (int *)malloc((size_t)frameCount * sizeof(int));
+
+  bool ok = job.indexed && job.info && job.encoded && order;
+  for (int i = 0; ok && i < frameCount; i++) {
+    order[i] = i;
+    job.indexed[i] = (unsigned char *)malloc((size_t)width * (size_t)height);
+    ok = job.indexed[i] != NULL;
+  }
+
+  GifBuffer out = {0};
+  if (ok) {
+    PixelJobPoolParallelFor(pool, order, frameCount, MapFrameJob, &job);
+    PixelJobPoolParallelFor(pool, order, frameCount, DiffFrameJob, &job);
+    if (frameCount > 1) PlanDisposal(&job);
+    else job.info[0].needsClear = false;
+    PixelJobPoolParallelFor(pool, order, frameCount, EncodeFrameJob, &job);
+
+    int globalEntries[PIXEL_GIF_MAX_COLORS + 1];
+    for (int i = 0; i < job.colorCount; i++) globalEntries[i] = i;
+    globalEntries[job.colorCount] = -1;
+    int bits = TableBits(job.colorCount + 1);
+
+    BufPut(&out, "GIF89a", 6);
+    BufU16(&out, (unsigned int)width);
+    BufU16(&out, (unsigned int)height);
+    BufByte(&out, options->perFramePalette ? 0u : 0x80u | (unsigned int)((bits - 1) << 4) | (unsigned int)(bits - 1));
+    BufByte(&out, 0);
+    BufByte(&out, 0);
+    if (!options->perFramePalette) WriteColorTable(&out, options->palette, globalEntries, job.colorCount + 1, bits);
+
+    if (frameCount > 1) {
+      BufPut(&out, "\x21\xFF\x0BNETSCAPE2.0\x03\x01", 16);
+      BufU16(&out, (unsigned int)MaxInt(options->loopCount, 0));
+      BufByte(&out, 0);
+    }
+    for (int i = 0; i < frameCount; i++) {
+      if (job.encoded[i].failed) out.failed = true;
+      BufPut(&out, job.encoded[i].data, job.encoded[i].size);
+    }
+    BufByte(&out, 0x3B);
+    ok = !out.failed;
+  }
+
+  for (int i = 0; i < frameCount; i++) {
+    if (job.indexed) free(job.indexed[i]);
+    if (job.encoded) free(job.encoded[i].data);
+  }
+  free(job.indexed);
+  free(job.info);
+  free(job.encoded);
+  free(order);
+
+  if (!ok) {
+    free(out.data);
+    return false;
+  }
+  *outData = out.data;
+  *outSize = out.size;
+  return true;
+}
+
+// Encode and write a GIF file.
+bool PixelGifSave(const char *path, const PixelColor *const *frames, int frameCount, int width, int height,
+                  const PixelGifOptions *options, PixelJobPool *pool) {
+  if (!path) return false;
+
+  unsigned char *data = NULL;
+  size_t size = 0;
+  if (!PixelGifEncode(frames, frameCount, width, height, options, pool, &data, &size)) return false;
+
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    free(data);
+    return false;
+  }
+  bool ok = fwrite(data, 1, size, fp) == size;
+  ok = (fclose(fp) == 0) && ok;
+  free(data);
+  return ok;
+}
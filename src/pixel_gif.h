@@ -0,0 +1,25 @@
+#ifndef PIXEL_GIF_H
+#define PIXEL_GIF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_core.h"
+#include "pixel_jobs.h"
+
+#define PIXEL_GIF_MAX_COLORS 255   // One of the 256 indices is reserved for transparency
+
+typedef struct {
+  const PixelColor *palette;       // Colors of the active palette
+  int paletteCount;                // Entries past PIXEL_GIF_MAX_COLORS are ignored
+  bool perFramePalette;            // Local table with only the colors each frame uses
+  int fps;                         // Playback rate, stored as centisecond delays
+  int loopCount;                   // 0 loops forever
+} PixelGifOptions;
+
+bool PixelGifEncode(const PixelColor *const *frames, int frameCount, int width, int height,
+                    const PixelGifOptions *options, PixelJobPool *pool, unsigned char **outData, size_t *outSize);
+bool PixelGifSave(const char *path, const PixelColor *const *frames, int frameCount, int width, int height,
+                  const PixelGifOptions *options, PixelJobPool *pool);
+
+#endif
@@ -0,0 +1,74 @@
+#include "pixel_grid.h"
+
+#include <math.h>
+
+// Opacity (0..1) for a family of lines this many screen pixels apart.
+float PixelGridFade(float spacing) {
+  if (spacing <= PIXEL_GRID_FADE_MIN_PIXELS) return 0.0f;
+  if (spacing >= PIXEL_GRID_FADE_FULL_PIXELS) return 1.0f;
+  return (spacing - PIXEL_GRID_FADE_MIN_PIXELS) / (PIXEL_GRID_FADE_FULL_PIXELS - PIXEL_GRID_FADE_MIN_PIXELS);
+}
+
+static void Emit(PixelGridLine *out, int capacity, int *count, PixelGridLine line) {
+  if (*count < capacity) out[*count] = line;
+  (*count)++;
+}
+
+// Lines of one orientation. Vertical lines sit at column boundaries and span
+// the visible rows; only boundaries inside the clip region are visited, and
+// when minor lines are hidden only every majorEvery-th one is.
+static void BuildFamily(const PixelGridSpec *spec, bool vertical, PixelGridLine *out, int capacity, int *count) {
+  int cells = vertical ? spec->columns : spec->rows;
+  int crossCells = vertical ? spec->rows : spec->columns;
+  float origin = vertical ? spec->originX : spec->originY;
+  float crossOrigin = vertical ? spec->originY : spec->originX;
+  float clipStart = vertical ? spec->clipX : spec->clipY;
+  float clipEnd = clipStart + (vertical ? spec->clipWidth : spec->clipHeight);
+  float crossClipStart = vertical ? spec->clipY : spec->clipX;
+  float crossClipEnd = crossClipStart + (vertical ? spec->clipHeight : spec->clipWidth);
+
+  float spanStart = fmaxf(crossOrigin, crossClipStart);
+  float spanEnd = fminf(crossOrigin + crossCells * spec->cellSize, crossClipEnd);
+  if (spanEnd <= spanStart) return;
+
+  int first = (int)ceilf((clipStart - origin) / spec->cellSize);
+  int last = (int)floorf((clipEnd - origin) / spec->cellSize);
+  if (first < 0) first = 0;
+  if (last > cells) last = cells;
+  if (first > last) return;
+
+  float minorFade = PixelGridFade(spec->cellSize);
+  float majorFade = spec->majorEvery > 0 ? fmaxf(PixelGridFade(spec->cellSize * spec->majorEvery), minorFade) : 0.0f;
+  int step = 1;
+  if (minorFade == 0.0f) step = majorFade > 0.0f ? spec->majorEvery : cells;
+
+  // Start on a multiple of step; the canvas border is always visited.
+  int i = (first + step - 1) / step * step;
+  for (;;) {
+    if (i > last) {
+      if (last != cells || i - step >= cells) break;
+      i = cells;
+    }
+    bool border = i == 0 || i == cells;
+    bool major = border || (spec->majorEvery > 0 && i % spec->majorEvery == 0);
+    float fade = border ? 1.0f : (major ? majorFade : minorFade);
+    if (fade > 0.0f) {
+      float position = origin + i * spec->cellSize;
+      PixelGridLine line = {vertical ? position : spanStart, vertical ? spanStart : position, spanEnd - spanStart,
+                            vertical, major, (unsigned char)(fade * 255.0f + 0.5f)};
+      Emit(out, capacity, count, line);
+    }
+    if (i == cells) break;
+    i += step;
+  }
+}
+
+// Visible grid lines, each boundary exactly once. Writes at most capacity
+// lines and returns how many there are, so a larger buffer can be retried.
+int PixelGridBuild(const PixelGridSpec *spec, PixelGridLine *out, int capacity) {
+  if (!spec || spec->columns <= 0 || spec->rows <= 0 || spec->cellSize <= 0.0f) return 0;
+  int count = 0;
+  BuildFamily(spec, true, out, capacity, &count);
+  BuildFamily(spec, false, out, capacity, &count);
+  return count;
+}
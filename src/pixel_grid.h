@@ -0,0 +1,38 @@
+#ifndef PIXEL_GRID_H
+#define PIXEL_GRID_H
+
+#include <stdbool.h>
+
+// Line spacing (screen pixels) below which a line family is hidden, and at
+// or above which it is fully opaque; spacings in between fade linearly.
+#define PIXEL_GRID_FADE_MIN_PIXELS 3.0f
+#define PIXEL_GRID_FADE_FULL_PIXELS 8.0f
+
+// Canvas grid placement on screen and the region actually visible.
+typedef struct {
+  int columns;
+  int rows;
+  float originX;                   // Screen position of cell (0, 0)
+  float originY;
+  float cellSize;                  // Screen pixels per cell at the current zoom
+  int majorEvery;                  // Cells per tile boundary (e.g. 8, 16, 32); 0 for none
+  float clipX;                     // Visible screen region
+  float clipY;
+  float clipWidth;
+  float clipHeight;
+} PixelGridSpec;
+
+// One grid line, already clipped to the visible region.
+typedef struct {
+  float x;
+  float y;
+  float length;                    // Along x for horizontal lines, along y for vertical ones
+  bool vertical;
+  bool major;                      // Tile boundary or canvas border
+  unsigned char alpha;
+} PixelGridLine;
+
+float PixelGridFade(float spacing);
+int PixelGridBuild(const PixelGridSpec *spec, PixelGridLine *out, int capacity);
+
+#endif
@@ -0,0 +1,176 @@
+#include "pixel_histogram.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+
+static uint32_t PackColor(PixelColor color) {
+  uint32_t packed;
+  memcpy(&packed, &color, sizeof(packed));
+  return packed;
+}
+
+static PixelColor UnpackColor(uint32_t packed) {
+  PixelColor color;
+  memcpy(&color, &packed, sizeof(color));
+  return color;
+}
+
+// Slot holding key, or the empty slot where it would go.
+static size_t FindSlot(const PixelHistogram *histogram, uint32_t key) {
+  size_t mask = histogram->capacity - 1;
+  size_t slot = (size_t)((key * 2654435769u) >> histogram->shift);
+  while (histogram->entries[slot].color != 0 && histogram->entries[slot].color != key) slot = (slot + 1) & mask;
+  return slot;
+}
+
+// Rebuild the table for the live colors plus room to grow; emptied colors are dropped.
+static bool Rehash(PixelHistogram *histogram) {
+  size_t live = 0;
+  for (size_t i = 0; i < histogram->capacity; i++) live += histogram->entries[i].count > 0;
+  size_t capacity = MIN_CAPACITY;
+  while (capacity < (live + 1) * 2) capacity *= 2;
+  PixelHistogramEntry *entries = (PixelHistogramEntry *)calloc(capacity, sizeof(PixelHistogramEntry));
+  if (!entries) return false;
+
+  PixelHistogram rebuilt = *histogram;
+  rebuilt.entries = entries;
+  rebuilt.capacity = capacity;
+  rebuilt.used = live;
+  rebuilt.shift = 32;
+  for (size_t bits = capacity; bits > 1; bits >>= 1) rebuilt.shift--;
+  for (size_t i = 0; i < histogram->capacity; i++) {
+    const PixelHistogramEntry *entry = &histogram->entries[i];
+    if (entry->count > 0) entries[FindSlot(&rebuilt, entry->color)] = *entry;
+  }
+  free(histogram->entries);
+  *histogram = rebuilt;
+  return true;
+}
+
+void PixelHistogramInit(PixelHistogram *histogram) {
+  if (histogram) *histogram = (PixelHistogram){0};
+}
+
+void PixelHistogramFree(PixelHistogram *histogram) {
+  if (!histogram) return;
+  free(histogram->entries);
+  *histogram = (PixelHistogram){0};
+}
+
+// Forget every count but keep the table for the next recount.
+void PixelHistogramClear(PixelHistogram *histogram) {
+  if (!histogram) return;
+  if (histogram->entries) memset(histogram->entries, 0, histogram->capacity * sizeof(PixelHistogramEntry));
+  histogram->used = 0;
+  histogram->total = 0;
+  histogram->revision++;
+}
+
+// Count pixels of one color; false only if the table could not grow.
+bool PixelHistogramAdd(PixelHistogram *histogram, PixelColor color, size_t count) {
+  if (!histogram || color.a == 0 || count == 0) return true;
+  // Keep at least half the slots free so probes stay short
+  if ((histogram->used + 1) * 2 > histogram->capacity && !Rehash(histogram)) return false;
+  PixelHistogramEntry *entry = &histogram->entries[FindSlot(histogram, PackColor(color))];
+  if (entry->color == 0) {
+    entry->color = PackColor(color);
+    histogram->used++;
+  }
+  entry->count += count;
+  histogram->total += count;
+  histogram->revision++;
+  return true;
+}
+
+void PixelHistogramRemove(PixelHistogram *histogram, PixelColor color, size_t count) {
+  if (!histogram || !histogram->entries || color.a == 0 || count == 0) return;
+  PixelHistogramEntry *entry = &histogram->entries[FindSlot(histogram, PackColor(color))];
+  if (entry->color == 0) return;
+  if (count > entry->count) count = entry->count;
+  entry->count -= count;
+  histogram->total -= count;
+  histogram->revision++;
+}
+
+// Count a run of pixels; runs of one color are added in one step. False if
+// any color could not be added, leaving the counts short of those pixels.
+bool PixelHistogramAddPixels(PixelHistogram *histogram, const PixelColor *pixels, size_t count) {
+  if (!histogram || !pixels) return true;
+  bool counted = true;
+  for (size_t i = 0; i < count;) {
+    size_t run = 1;
+    while (i + run < count && PixelColorEqual(pixels[i + run], pixels[i])) run++;
+    counted = PixelHistogramAdd(histogram, pixels[i], run) && counted;
+    i += run;
+  }
+  return counted;
+}
+
+void PixelHistogramRemovePixels(PixelHistogram *histogram, const PixelColor *pixels, size_t count) {
+  if (!histogram || !pixels) return;
+  for (size_t i = 0; i < count;) {
+    size_t run = 1;
+    while (i + run < count && PixelColorEqual(pixels[i + run], pixels[i])) run++;
+    PixelHistogramRemove(histogram, pixels[i], run);
+    i += run;
+  }
+}
+
+size_t PixelHistogramCount(const PixelHistogram *histogram, PixelColor color) {
+  if (!histogram || !histogram->entries || color.a == 0) return 0;
+  return histogram->entries[FindSlot(histogram, PackColor(color))].count;
+}
+
+// Pixels per palette color into usage (when not NULL); returns how many
+// counted pixels have a color that is not in the palette. Each palette
+// color is one lookup, and the stamp keeps duplicates from counting twice.
+size_t PixelHistogramPaletteUsage(PixelHistogram *histogram, const PixelColor *palette, int paletteCount, size_t *usage) {
+  if (!histogram) return 0;
+  uint32_t stamp = ++histogram->stamp;
+  size_t onPalette = 0;
+  for (int i = 0; i < paletteCount; i++) {
+    size_t count = 0;
+    if (histogram->entries && palette[i].a != 0) {
+      PixelHistogramEntry *entry = &histogram->entries[FindSlot(histogram, PackColor(palette[i]))];
+      count = entry->count;
+      if (entry->color != 0 && entry->stamp != stamp) {
+        entry->stamp = stamp;
+        onPalette += count;
+      }
+    }
+    if (usage) usage[i] = count;
+  }
+  return histogram->total - onPalette;
+}
+
+// The colors in use that the palette lacks, most used first, up to
+// capacity of them; returns how many there are in all. Costs the palette
+// plus the table, which grows with distinct colors, never with pixels.
+int PixelHistogramOffPalette(PixelHistogram *histogram, const PixelColor *palette, int paletteCount, PixelColor *colors,
+                             size_t *counts, int capacity) {
+  if (!histogram || !histogram->entries) return 0;
+  PixelHistogramPaletteUsage(histogram, palette, paletteCount, NULL);
+  uint32_t stamp = histogram->stamp;
+  int found = 0;
+  for (size_t i = 0; i < histogram->capacity; i++) {
+    const PixelHistogramEntry *entry = &histogram->entries[i];
+    if (entry->count == 0 || entry->stamp == stamp) continue;
+    // Insertion into the short, sorted output list
+    int at = found < capacity ? found : capacity;
+    while (at > 0 && counts[at - 1] < entry->count) {
+      if (at < capacity) {
+        colors[at] = colors[at - 1];
+        counts[at] = counts[at - 1];
+      }
+      at--;
+    }
+    if (at < capacity) {
+      colors[at] = UnpackColor(entry->color);
+      counts[at] = entry->count;
+    }
+    found++;
+  }
+  return found;
+}
@@ -0,0 +1,41 @@
+#ifndef PIXEL_HISTOGRAM_H
+#define PIXEL_HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pixel_core.h"
+
+// Pixel counts per color, updated from the old and new values of whatever
+// changes, so palette queries cost O(palette) instead of a pass over the
+// canvas. Transparent pixels (alpha 0) are not counted.
+typedef struct {
+  uint32_t color;                  // PixelColor bytes as one word; 0 marks an empty slot
+  uint32_t stamp;                  // Last query that visited the entry
+  size_t count;
+} PixelHistogramEntry;
+
+typedef struct {
+  PixelHistogramEntry *entries;    // Open addressing; colors counted down to 0 stay until a rehash
+  size_t capacity;                 // Power of two, 0 until the first color
+  size_t used;                     // Occupied slots, emptied colors included
+  int shift;                       // 32 - log2(capacity), for Fibonacci hashing
+  size_t total;                    // Counted pixels
+  uint32_t stamp;
+  unsigned revision;               // Bumped on every change, to key anything drawn from the counts
+} PixelHistogram;
+
+void PixelHistogramInit(PixelHistogram *histogram);
+void PixelHistogramFree(PixelHistogram *histogram);
+void PixelHistogramClear(PixelHistogram *histogram);
+bool PixelHistogramAdd(PixelHistogram *histogram, PixelColor color, size_t count);
+void PixelHistogramRemove(PixelHistogram *histogram, PixelColor color, size_t count);
+bool PixelHistogramAddPixels(PixelHistogram *histogram, const PixelColor *pixels, size_t count);
+void PixelHistogramRemovePixels(PixelHistogram *histogram, const PixelColor *pixels, size_t count);
+size_t PixelHistogramCount(const PixelHistogram *histogram, PixelColor color);
+size_t PixelHistogramPaletteUsage(PixelHistogram *histogram, const PixelColor *palette, int paletteCount, size_t *usage);
+int PixelHistogramOffPalette(PixelHistogram *histogram, const PixelColor *palette, int paletteCount, PixelColor *colors,
+                             size_t *counts, int capacity);
+
+#endif
@@ -0,0 +1,205 @@
+#include "pixel_jobs.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Range [head, tail) of batch item positions owned by one participant.
+typedef struct {
+  pthread_mutex_t lock;
+  int head;
+  int tail;
+} PixelJobDeque;
+
+typedef struct {
+  PixelJobPool *pool;
+  int slot;
+} PixelJobWorker;
+
+struct PixelJobPool {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  pthread_t *threads;
+  PixelJobWorker *workers;
+  PixelJobDeque *deques;      // One per worker plus one for the calling thread
+  int workerCount;
+  int busyWorkers;
+  unsigned long generation;
+  bool shutdown;
+
+  // Current batch, only valid while a ParallelFor call is in progress.
+  const int *items;
+  PixelJobFn fn;
+  void *user;
+};
+
+// Number of online CPUs, at least 1.
+int PixelJobCpuCount(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (count > 0) return (int)count;
+#endif
+  return 1;
+}
+
+static bool PopOwn(PixelJobPool *pool, int slot, int *position) {
+  PixelJobDeque *deque = &pool->deques[slot];
+  bool found = false;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    *position = deque->head++;
+    found = true;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// Take the back half of another participant's range; keep one item to run now.
+static bool Steal(PixelJobPool *pool, int slot, int *position) {
+  int participants = pool->workerCount + 1;
+  for (int i = 1; i < participants; i++) {
+    PixelJobDeque *victim = &pool->deques[(slot + i) % participants];
+
+    pthread_mutex_lock(&victim->lock);
+    int available = victim->tail - victim->head;
+    int begin = 0, end = 0;
+    if (available > 0) {
+      int take = (available + 1) / 2;
+      end = victim->tail;
+      begin = end - take;
+      victim->tail = begin;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (begin == end) continue;
+
+    PixelJobDeque *own = &pool->deques[slot];
+    pthread_mutex_lock(&own->lock);
+    own->head = begin + 1;
+    own->tail = end;
+    pthread_mutex_unlock(&own->lock);
+    *position = begin;
+    return true;
+  }
+  return false;
+}
+
+static void RunBatch(PixelJobPool *pool, int slot) {
+  int position;
+  while (PopOwn(pool, slot, &position) || Steal(pool, slot, &position)) {
+    pool->fn(pool->user, pool->items[position]);
+  }
+}
+
+static void *WorkerMain(void *arg) {
+  PixelJobWorker *worker = (PixelJobWorker *)arg;
+  PixelJobPool *pool = worker->pool;
+  unsigned long seen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->shutdown && pool->generation == seen) pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->shutdown) break;
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    RunBatch(pool, worker->slot);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busyWorkers == 0) pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// Start workerCount threads; a negative count uses one worker per extra CPU.
+// A pool with zero workers runs every loop on the calling thread.
+PixelJobPool *PixelJobPoolCreate(int workerCount) {
+  if (workerCount < 0) workerCount = PixelJobCpuCount() - 1;
+  if (workerCount < 0) workerCount = 0;
+
+  PixelJobPool *pool = (PixelJobPool *)calloc(1, sizeof(PixelJobPool));
+  if (!pool) return NULL;
+
+  pool->deques = (PixelJobDeque *)calloc((size_t)workerCount + 1, sizeof(PixelJobDeque));
+  pool->threads = (pthread_t *)calloc((size_t)workerCount + 1, sizeof(pthread_t));
+  pool->workers = (PixelJobWorker *)calloc((size_t)workerCount + 1, sizeof(PixelJobWorker));
+  if (!pool->deques || !pool->threads || !pool->workers) {
+    free(pool->deques);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (int i = 0; i <= workerCount; i++) pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+  for (int i = 0; i < workerCount; i++) {
+    pool->workers[i] = (PixelJobWorker){pool, i};
+    if (pthread_create(&pool->threads[i], NULL, WorkerMain, &pool->workers[i]) != 0) break;
+    pool->workerCount++;
+  }
+  return pool;
+}
+
+// Stop and join all workers; must not be called during ParallelFor.
+void PixelJobPoolDestroy(PixelJobPool *pool) {
+  if (!pool) return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->workerCount; i++) pthread_join(pool->threads[i], NULL);
+
+  for (int i = 0; i <= pool->workerCount; i++) pthread_mutex_destroy(&pool->deques[i].lock);
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->deques);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
+}
+
+int PixelJobPoolWorkerCount(const PixelJobPool *pool) {
+  return pool ? pool->workerCount : 0;
+}
+
+// Run fn(user, items[i]) for every item and return once all have finished.
+// The calling thread participates; a NULL pool runs the loop serially.
+void PixelJobPoolParallelFor(PixelJobPool *pool, const int *items, int count, PixelJobFn fn, void *user) {
+  if (!items || count <= 0 || !fn) return;
+
+  if (!pool || pool->workerCount == 0 || count == 1) {
+    for (int i = 0; i < count; i++) fn(user, items[i]);
+    return;
+  }
+
+  int participants = pool->workerCount + 1;
+  pthread_mutex_lock(&pool->lock);
+  pool->items = items;
+  pool->fn = fn;
+  pool->user = user;
+  for (int i = 0; i < participants; i++) {
+    pool->deques[i].head = (int)((long long)count * i / participants);
+    pool->deques[i].tail = (int)((long long)count * (i + 1) / participants);
+  }
+  pool->busyWorkers = pool->workerCount;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  RunBatch(pool, pool->workerCount);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busyWorkers > 0) pthread_cond_wait(&pool->done, &pool->lock);
+  pool->items = NULL;
+  pool->fn = NULL;
+  pool->user = NULL;
+  pthread_mutex_unlock(&pool->lock);
+}
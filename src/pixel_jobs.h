@@ -0,0 +1,18 @@
+#ifndef PIXEL_JOBS_H
+#define PIXEL_JOBS_H
+
+// Fixed-size worker pool for fork-join loops over independent items.
+// Each participant owns a slice of the items and steals half of another
+// participant's remaining slice when it runs dry.
+
+typedef struct PixelJobPool PixelJobPool;
+
+typedef void (*PixelJobFn)(void *user, int item);
+
+int PixelJobCpuCount(void);
+PixelJobPool *PixelJobPoolCreate(int workerCount);
+void PixelJobPoolDestroy(PixelJobPool *pool);
+int PixelJobPoolWorkerCount(const PixelJobPool *pool);
+void PixelJobPoolParallelFor(PixelJobPool *pool, const int *items, int count, PixelJobFn fn, void *user);
+
+#endif
@@ -0,0 +1,520 @@
+#include "pixel_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixel_core.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#define SyncFile(fd) _commit(fd)
+#define JOURNAL_OPEN_FLAGS O_BINARY
+#else
+#include <unistd.h>
+#define SyncFile(fd) fsync(fd)
+#define JOURNAL_OPEN_FLAGS 0
+#endif
+
+#define FILE_HEADER_SIZE 8             // "PXJL", version
+#define RECORD_HEADER_SIZE 12          // type, payload size, payload checksum
+#define SNAPSHOT_HEADER_SIZE 16        // width, height, layer count, active layer
+#define LAYER_HEADER_SIZE (4 + PIXEL_LAYER_NAME_SIZE)  // visible, opacity, blend mode, pad, name
+#define TILE_HEADER_SIZE 4             // tile x, tile y
+#define MAX_SIDE 16384
+#define MAX_LAYERS 1024
+
+enum { RECORD_SNAPSHOT = 1, RECORD_TILES = 2 };
+
+typedef struct JournalJob {
+  unsigned char *data;
+  size_t size;
+  bool replace;                    // Swap the file for data instead of appending
+  struct JournalJob *next;
+} JournalJob;
+
+struct PixelJournal {
+  char *path;
+  char *tempPath;
+  int fd;                          // Writer thread only; -1 until the first snapshot lands
+  pthread_t thread;
+  bool threadStarted;
+
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  JournalJob *head;                // Records waiting for the writer, oldest first
+  JournalJob *tail;
+  long queuedCount;
+  long writtenCount;               // Written or dropped; equals queuedCount when idle
+  bool unsynced;                   // Appended bytes not yet fsynced
+  bool syncRequested;              // A Flush wants the fsync now rather than batched
+  bool failed;                     // Last write failed; cleared by a successful snapshot swap
+  bool stop;
+  size_t size;                     // File size once every queued record is written
+};
+
+static void PutU32(unsigned char *p, uint32_t value) {
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8);
+  p[2] = (unsigned char)(value >> 16);
+  p[3] = (unsigned char)(value >> 24);
+}
+
+static void PutU16(unsigned char *p, uint32_t value) {
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8);
+}
+
+static uint32_t GetU32(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t GetU16(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t Checksum(const unsigned char *data, size_t size) {
+  uint32_t hash = 2166136261u;  // FNV-1a
+  for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 16777619u;
+  return hash;
+}
+
+static double Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static char *CopyString(const char *text, const char *suffix) {
+  size_t length = strlen(text), suffixLength = strlen(suffix);
+  char *copy = (char *)malloc(length + suffixLength + 1);
+  if (!copy) return NULL;
+  memcpy(copy, text, length);
+  memcpy(copy + length, suffix, suffixLength + 1);
+  return copy;
+}
+
+// Allocate a job holding prefix bytes plus one record; the payload is filled by the caller.
+static JournalJob *NewRecordJob(size_t prefix, uint32_t type, size_t payloadSize, unsigned char **payload) {
+  JournalJob *job = (JournalJob *)calloc(1, sizeof(JournalJob));
+  if (!job) return NULL;
+  job->size = prefix + RECORD_HEADER_SIZE + payloadSize;
+  job->data = (unsigned char *)malloc(job->size);
+  if (!job->data) {
+    free(job);
+    return NULL;
+  }
+  PutU32(job->data + prefix, type);
+  PutU32(job->data + prefix + 4, (uint32_t)payloadSize);
+  *payload = job->data + prefix + RECORD_HEADER_SIZE;
+  return job;
+}
+
+static void SealRecord(JournalJob *job, size_t prefix) {
+  unsigned char *header = job->data + prefix;
+  PutU32(header + 8, Checksum(header + RECORD_HEADER_SIZE, job->size - prefix - RECORD_HEADER_SIZE));
+}
+
+static void FreeJob(JournalJob *job) {
+  if (!job) return;
+  free(job->data);
+  free(job);
+}
+
+// Every layer with its properties. With replace set the job is a complete
+// journal file (header plus this one record) that supersedes the current one.
+static JournalJob *EncodeSnapshot(const PixelLayerStack *stack, bool replace) {
+  if (!stack || stack->layerCount <= 0 || stack->width > MAX_SIDE || stack->height > MAX_SIDE) return NULL;
+  size_t layerBytes = (size_t)stack->width * (size_t)stack->height * sizeof(PixelColor);
+  size_t payloadSize = SNAPSHOT_HEADER_SIZE + (size_t)stack->layerCount * (LAYER_HEADER_SIZE + layerBytes);
+  size_t prefix = replace ? FILE_HEADER_SIZE : 0;
+  unsigned char *p;
+  JournalJob *job = NewRecordJob(prefix, RECORD_SNAPSHOT, payloadSize, &p);
+  if (!job) return NULL;
+  job->replace = replace;
+  if (replace) {
+    memcpy(job->data, "PXJL", 4);
+    PutU32(job->data + 4, PIXEL_JOURNAL_VERSION);
+  }
+
+  PutU32(p, (uint32_t)stack->width);
+  PutU32(p + 4, (uint32_t)stack->height);
+  PutU32(p + 8, (uint32_t)stack->layerCount);
+  PutU32(p + 12, (uint32_t)stack->activeLayer);
+  p += SNAPSHOT_HEADER_SIZE;
+  for (int i = 0; i < stack->layerCount; i++) {
+    const PixelLayer *layer = &stack->layers[i];
+    p[0] = layer->visible ? 1 : 0;
+    p[1] = layer->opacity;
+    p[2] = (unsigned char)layer->blendMode;
+    p[3] = 0;
+    memcpy(p + 4, layer->name, PIXEL_LAYER_NAME_SIZE);
+    memcpy(p + LAYER_HEADER_SIZE, layer->pixels, layerBytes);
+    p += LAYER_HEADER_SIZE + layerBytes;
+  }
+  SealRecord(job, prefix);
+  return job;
+}
+
+static bool WriteAll(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    data += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+// Write a complete journal next to the live one, fsync it and rename it in.
+// A crash at any point leaves either the old or the new journal intact.
+static bool ReplaceJournal(PixelJournal *journal, const JournalJob *job) {
+  FILE *fp = fopen(journal->tempPath, "wb");
+  if (!fp) return false;
+  if (fwrite(job->data, 1, job->size, fp) != job->size) {
+    fclose(fp);
+    remove(journal->tempPath);
+    return false;
+  }
+  if (journal->fd >= 0) close(journal->fd);
+  journal->fd = -1;
+  if (!PixelCommitTempFile(fp, journal->tempPath, journal->path)) return false;
+  journal->fd = open(journal->path, O_WRONLY | O_APPEND | JOURNAL_OPEN_FLAGS);
+  return journal->fd >= 0;
+}
+
+static void *WriterMain(void *arg) {
+  PixelJournal *journal = (PixelJournal *)arg;
+  double lastSync = Now();
+  double interval = PIXEL_JOURNAL_SYNC_INTERVAL_MS / 1000.0;
+
+  pthread_mutex_lock(&journal->lock);
+  for (;;) {
+    if (journal->head) {
+      // Take the whole queue so records arriving together share one fsync.
+      JournalJob *jobs = journal->head;
+      journal->head = journal->tail = NULL;
+      bool failed = journal->failed;
+      pthread_mutex_unlock(&journal->lock);
+
+      long count = 0;
+      bool appended = false, replaced = false;
+      while (jobs) {
+        JournalJob *next = jobs->next;
+        if (jobs->replace) {
+          failed = !ReplaceJournal(journal, jobs);
+          replaced = replaced || !failed;
+          appended = appended && failed;
+        } else if (!failed) {
+          failed = journal->fd < 0 || !WriteAll(journal->fd, jobs->data, jobs->size);
+          appended = appended || !failed;
+        }
+        FreeJob(jobs);
+        count++;
+        jobs = next;
+      }
+
+      pthread_mutex_lock(&journal->lock);
+      if (replaced) {
+        journal->unsynced = false;
+        lastSync = Now();
+      }
+      journal->unsynced = journal->unsynced || appended;
+      journal->failed = failed;
+      journal->writtenCount += count;
+      pthread_cond_broadcast(&journal->changed);
+      continue;
+    }
+
+    double now = Now();
+    if (journal->unsynced && (journal->syncRequested || journal->stop || now - lastSync >= interval)) {
+      int fd = journal->fd;
+      pthread_mutex_unlock(&journal->lock);
+      if (fd >= 0) SyncFile(fd);
+      pthread_mutex_lock(&journal->lock);
+      journal->unsynced = false;
+      journal->syncRequested = false;
+      lastSync = Now();
+      pthread_cond_broadcast(&journal->changed);
+      continue;
+    }
+    journal->syncRequested = false;
+    if (journal->stop) break;
+
+    if (journal->unsynced) {
+      double deadline = lastSync + interval;
+      struct timespec until = {(time_t)deadline, (long)((deadline - (double)(time_t)deadline) * 1e9)};
+      pthread_cond_timedwait(&journal->changed, &journal->lock, &until);
+    } else {
+      pthread_cond_wait(&journal->changed, &journal->lock);
+    }
+  }
+  pthread_mutex_unlock(&journal->lock);
+  return NULL;
+}
+
+static bool Enqueue(PixelJournal *journal, JournalJob *job) {
+  if (!journal || !job) {
+    FreeJob(job);
+    return false;
+  }
+  pthread_mutex_lock(&journal->lock);
+  if (job->replace) journal->size = job->size;
+  else journal->size += job->size;
+  if (journal->tail) journal->tail->next = job;
+  else journal->head = job;
+  journal->tail = job;
+  journal->queuedCount++;
+  pthread_cond_broadcast(&journal->changed);
+  pthread_mutex_unlock(&journal->lock);
+  return true;
+}
+
+// Start a journal at path seeded with a snapshot of stack. The previous file
+// stays in place until the new one is complete on disk, so recover first.
+PixelJournal *PixelJournalOpen(const char *path, const PixelLayerStack *stack) {
+  if (!path || !stack) return NULL;
+  PixelJournal *journal = (PixelJournal *)calloc(1, sizeof(PixelJournal));
+  if (!journal) return NULL;
+  journal->fd = -1;
+  journal->path = CopyString(path, "");
+  journal->tempPath = CopyString(path, ".tmp");
+  pthread_mutex_init(&journal->lock, NULL);
+  pthread_cond_init(&journal->changed, NULL);
+  if (!journal->path || !journal->tempPath || pthread_create(&journal->thread, NULL, WriterMain, journal) != 0) {
+    PixelJournalClose(journal, false);
+    return NULL;
+  }
+  journal->threadStarted = true;
+  if (!PixelJournalCompact(journal, stack)) {
+    PixelJournalClose(journal, false);
+    return NULL;
+  }
+  return journal;
+}
+
+// Write everything still queued, stop the writer and, when the document is
+// safely saved or deliberately abandoned, delete the journal.
+void PixelJournalClose(PixelJournal *journal, bool discard) {
+  if (!journal) return;
+  pthread_mutex_lock(&journal->lock);
+  journal->stop = true;
+  pthread_cond_broadcast(&journal->changed);
+  pthread_mutex_unlock(&journal->lock);
+  if (journal->threadStarted) pthread_join(journal->thread, NULL);
+
+  while (journal->head) {
+    JournalJob *next = journal->head->next;
+    FreeJob(journal->head);
+    journal->head = next;
+  }
+  if (journal->fd >= 0) close(journal->fd);
+  if (discard && journal->path) remove(journal->path);
+  pthread_cond_destroy(&journal->changed);
+  pthread_mutex_destroy(&journal->lock);
+  free(journal->path);
+  free(journal->tempPath);
+  free(journal);
+}
+
+// Append a full snapshot, e.g. after a load or a change to the layer list.
+bool PixelJournalWriteSnapshot(PixelJournal *journal, const PixelLayerStack *stack) {
+  return journal && Enqueue(journal, EncodeSnapshot(stack, false));
+}
+
+// Append the tiles of one layer flagged in tileMask (tilesX * tilesY bytes).
+// Pixels are copied here, so the caller may keep painting right away.
+bool PixelJournalWriteTiles(PixelJournal *journal, const PixelLayerStack *stack, int layer,
+                            const unsigned char *tileMask) {
+  if (!journal || !stack || !tileMask || layer < 0 || layer >= stack->layerCount) return false;
+  int tileCount = 0;
+  size_t payloadSize = 8;
+  for (int ty = 0; ty < stack->tilesY; ty++) {
+    for (int tx = 0; tx < stack->tilesX; tx++) {
+      if (!tileMask[ty * stack->tilesX + tx]) continue;
+      int width = stack->width - tx * PIXEL_TILE_SIZE < PIXEL_TILE_SIZE ? stack->width - tx * PIXEL_TILE_SIZE : PIXEL_TILE_SIZE;
+      int height = stack->height - ty * PIXEL_TILE_SIZE < PIXEL_TILE_SIZE ? stack->height - ty * PIXEL_TILE_SIZE : PIXEL_TILE_SIZE;
+      payloadSize += TILE_HEADER_SIZE + (size_t)width * (size_t)height * sizeof(PixelColor);
+      tileCount++;
+    }
+  }
+  if (tileCount == 0) return true;
+
+  unsigned char *p;
+  JournalJob *job = NewRecordJob(0, RECORD_TILES, payloadSize, &p);
+  if (!job) return false;
+  PutU32(p, (uint32_t)layer);
+  PutU32(p + 4, (uint32_t)tileCount);
+  p += 8;
+  const PixelColor *pixels = stack->layers[layer].pixels;
+  for (int ty = 0; ty < stack->tilesY; ty++) {
+    for (int tx = 0; tx < stack->tilesX; tx++) {
+      if (!tileMask[ty * stack->tilesX + tx]) continue;
+      int x0 = tx * PIXEL_TILE_SIZE, y0 = ty * PIXEL_TILE_SIZE;
+      int width = stack->width - x0 < PIXEL_TILE_SIZE ? stack->width - x0 : PIXEL_TILE_SIZE;
+      int height = stack->height - y0 < PIXEL_TILE_SIZE ? stack->height - y0 : PIXEL_TILE_SIZE;
+      PutU16(p, (uint32_t)tx);
+      PutU16(p + 2, (uint32_t)ty);
+      p += TILE_HEADER_SIZE;
+      for (int y = 0; y < height; y++) {
+        memcpy(p, pixels + (size_t)(y0 + y) * (size_t)stack->width + x0, (size_t)width * sizeof(PixelColor));
+        p += (size_t)width * sizeof(PixelColor);
+      }
+    }
+  }
+  SealRecord(job, 0);
+  return Enqueue(journal, job);
+}
+
+// Replace the journal with a single snapshot of stack, in the background.
+// Records queued afterwards are appended to the new file.
+bool PixelJournalCompact(PixelJournal *journal, const PixelLayerStack *stack) {
+  return journal && Enqueue(journal, EncodeSnapshot(stack, true));
+}
+
+// Block until every queued record is written and fsynced.
+bool PixelJournalFlush(PixelJournal *journal) {
+  if (!journal) return false;
+  pthread_mutex_lock(&journal->lock);
+  journal->syncRequested = true;
+  pthread_cond_broadcast(&journal->changed);
+  while (journal->writtenCount != journal->queuedCount || journal->unsynced) {
+    pthread_cond_wait(&journal->changed, &journal->lock);
+  }
+  bool ok = !journal->failed;
+  pthread_mutex_unlock(&journal->lock);
+  return ok;
+}
+
+// Journal size once queued records land; used to decide when to compact.
+size_t PixelJournalSize(PixelJournal *journal) {
+  if (!journal) return 0;
+  pthread_mutex_lock(&journal->lock);
+  size_t size = journal->size;
+  pthread_mutex_unlock(&journal->lock);
+  return size;
+}
+
+// Rebuild a layer stack from a snapshot payload; false if it is malformed.
+static bool ApplySnapshot(PixelLayerStack *stack, const unsigned char *p, size_t size) {
+  if (size < SNAPSHOT_HEADER_SIZE) return false;
+  uint32_t width = GetU32(p), height = GetU32(p + 4), layerCount = GetU32(p + 8), active = GetU32(p + 12);
+  if (width == 0 || height == 0 || width > MAX_SIDE || height > MAX_SIDE) return false;
+  if (layerCount == 0 || layerCount > MAX_LAYERS || active >= layerCount) return false;
+  size_t layerBytes = (size_t)width * (size_t)height * sizeof(PixelColor);
+  if (size != SNAPSHOT_HEADER_SIZE + (size_t)layerCount * (LAYER_HEADER_SIZE + layerBytes)) return false;
+
+  PixelLayerStack restored;
+  if (!PixelLayerStackInit(&restored, (int)width, (int)height)) return false;
+  p += SNAPSHOT_HEADER_SIZE;
+  for (uint32_t i = 0; i < layerCount; i++) {
+    char name[PIXEL_LAYER_NAME_SIZE];
+    memcpy(name, p + 4, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+    int index = PixelLayerStackAddLayer(&restored, name);
+    if (index < 0) {
+      PixelLayerStackFree(&restored);
+      return false;
+    }
+    PixelLayer *layer = &restored.layers[index];
+    layer->visible = p[0] != 0;
+    layer->opacity = p[1];
+    layer->blendMode = p[2] < PIXEL_BLEND_COUNT ? (PixelBlendMode)p[2] : PIXEL_BLEND_NORMAL;
+    memcpy(layer->pixels, p + LAYER_HEADER_SIZE, layerBytes);
+    p += LAYER_HEADER_SIZE + layerBytes;
+  }
+  restored.activeLayer = (int)active;
+  PixelLayerStackRecountColors(&restored);
+  PixelLayerStackMarkAllDirty(&restored);
+  PixelLayerStackFree(stack);
+  *stack = restored;
+  return true;
+}
+
+// Copy tile pixels into one layer; returns the tile count or -1 if malformed.
+static int ApplyTiles(PixelLayerStack *stack, const unsigned char *p, size_t size) {
+  if (size < 8) return -1;
+  uint32_t layerIndex = GetU32(p), tileCount = GetU32(p + 4);
+  if (layerIndex >= (uint32_t)stack->layerCount) return -1;
+  PixelColor *pixels = stack->layers[layerIndex].pixels;
+  size_t pos = 8;
+  for (uint32_t i = 0; i < tileCount; i++) {
+    if (size - pos < TILE_HEADER_SIZE) return -1;
+    uint32_t tx = GetU16(p + pos), ty = GetU16(p + pos + 2);
+    pos += TILE_HEADER_SIZE;
+    if (tx >= (uint32_t)stack->tilesX || ty >= (uint32_t)stack->tilesY) return -1;
+    int x0 = (int)tx * PIXEL_TILE_SIZE, y0 = (int)ty * PIXEL_TILE_SIZE;
+    int width = stack->width - x0 < PIXEL_TILE_SIZE ? stack->width - x0 : PIXEL_TILE_SIZE;
+    int height = stack->height - y0 < PIXEL_TILE_SIZE ? stack->height - y0 : PIXEL_TILE_SIZE;
+    size_t rowBytes = (size_t)width * sizeof(PixelColor);
+    if (size - pos < rowBytes * (size_t)height) return -1;
+    PixelLayerStackBeginEdit(stack, (int)layerIndex, x0, y0, width, height);
+    for (int y = 0; y < height; y++) {
+      memcpy(pixels + (size_t)(y0 + y) * (size_t)stack->width + x0, p + pos, rowBytes);
+      pos += rowBytes;
+    }
+    PixelLayerStackEndEdit(stack, (int)layerIndex, x0, y0, width, height);
+  }
+  return pos == size ? (int)tileCount : -1;
+}
+
+// Replace stack with the journal's last snapshot plus the tile records after
+// it. Returns false if the file is missing or holds no complete snapshot.
+bool PixelJournalRecover(const char *path, PixelLayerStack *stack, PixelJournalRecovery *info) {
+  PixelJournalRecovery result = {0};
+  if (info) *info = result;
+  if (!path || !stack) return false;
+
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return false;
+  unsigned char *data = NULL;
+  long length = -1;
+  if (fseek(fp, 0, SEEK_END) == 0) length = ftell(fp);
+  if (length >= FILE_HEADER_SIZE && fseek(fp, 0, SEEK_SET) == 0) {
+    data = (unsigned char *)malloc((size_t)length);
+    if (data && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(fp);
+  if (!data) return false;
+
+  size_t size = (size_t)length;
+  bool valid = memcmp(data, "PXJL", 4) == 0 && GetU32(data + 4) == PIXEL_JOURNAL_VERSION;
+  size_t pos = FILE_HEADER_SIZE;
+  while (valid && pos < size) {
+    if (size - pos < RECORD_HEADER_SIZE) {
+      result.truncated = true;
+      break;
+    }
+    uint32_t type = GetU32(data + pos), payloadSize = GetU32(data + pos + 4), checksum = GetU32(data + pos + 8);
+    const unsigned char *payload = data + pos + RECORD_HEADER_SIZE;
+    if (size - pos - RECORD_HEADER_SIZE < payloadSize || Checksum(payload, payloadSize) != checksum) {
+      result.truncated = true;
+      break;
+    }
+    pos += RECORD_HEADER_SIZE + payloadSize;
+
+    if (type == RECORD_SNAPSHOT) {
+      if (!ApplySnapshot(stack, payload, payloadSize)) continue;
+      result.snapshotCount++;
+      result.tileRecordCount = 0;
+      result.tileCount = 0;
+    } else if (type == RECORD_TILES && result.snapshotCount > 0) {
+      int tiles = ApplyTiles(stack, payload, payloadSize);
+      if (tiles < 0) continue;
+      result.tileRecordCount++;
+      result.tileCount += tiles;
+    }
+  }
+  free(data);
+  if (info) *info = result;
+  return result.snapshotCount > 0;
+}
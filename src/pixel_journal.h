@@ -0,0 +1,36 @@
+#ifndef PIXEL_JOURNAL_H
+#define PIXEL_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_layers.h"
+
+#define PIXEL_JOURNAL_VERSION 1
+#define PIXEL_JOURNAL_SYNC_INTERVAL_MS 250  // Appends are fsynced together at most this often
+
+// Crash-safe autosave: an append-only file of checksummed records written by
+// a background thread. A snapshot record holds every layer; tile records
+// after it hold the tiles each stroke changed. Recovery applies the last
+// snapshot plus the tiles that follow it and stops at the first torn record.
+typedef struct PixelJournal PixelJournal;
+
+// What a recovery found, for logging and tests.
+typedef struct {
+  int snapshotCount;               // Snapshot records read
+  int tileRecordCount;             // Tile records applied after the last snapshot
+  int tileCount;                   // Tiles restored by those records
+  bool truncated;                  // File ended in a torn or corrupt record
+} PixelJournalRecovery;
+
+PixelJournal *PixelJournalOpen(const char *path, const PixelLayerStack *stack);
+void PixelJournalClose(PixelJournal *journal, bool discard);
+bool PixelJournalWriteSnapshot(PixelJournal *journal, const PixelLayerStack *stack);
+bool PixelJournalWriteTiles(PixelJournal *journal, const PixelLayerStack *stack, int layer,
+                            const unsigned char *tileMask);
+bool PixelJournalCompact(PixelJournal *journal, const PixelLayerStack *stack);
+bool PixelJournalFlush(PixelJournal *journal);
+size_t PixelJournalSize(PixelJournal *journal);
+bool PixelJournalRecover(const char *path, PixelLayerStack *stack, PixelJournalRecovery *info);
+
+#endif
@@ -0,0 +1,434 @@
+#include "pixel_layers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static int MinInt(int a, int b) { return a < b ? a : b; }
+static int MaxInt(int a, int b) { return a > b ? a : b; }
+
+// Rounded a * b / 255 for 8-bit operands, matching the SIMD kernel bit for bit.
+static unsigned int MulDiv255(unsigned int a, unsigned int b) {
+  unsigned int t = a * b + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+static bool ValidLayer(const PixelLayerStack *stack, int index) {
+  return stack && index >= 0 && index < stack->layerCount;
+}
+
+// Add or remove one layer's pixels inside a rectangle from the color counts.
+static void CountRect(PixelLayerStack *stack, int index, int x, int y, int width, int height, bool add) {
+  int x0 = MaxInt(x, 0);
+  int y0 = MaxInt(y, 0);
+  int x1 = MinInt(x + width, stack->width);
+  int y1 = MinInt(y + height, stack->height);
+  if (x0 >= x1 || y0 >= y1) return;
+  for (int row = y0; row < y1; row++) {
+    const PixelColor *span = stack->layers[index].pixels + (size_t)row * (size_t)stack->width + x0;
+    if (!add) PixelHistogramRemovePixels(&stack->colors, span, (size_t)(x1 - x0));
+    else if (!PixelHistogramAddPixels(&stack->colors, span, (size_t)(x1 - x0))) stack->colorsStale = true;
+  }
+}
+
+// Allocate an empty stack with all tiles dirty so the first flatten is complete.
+bool PixelLayerStackInit(PixelLayerStack *stack, int width, int height) {
+  if (!stack || width <= 0 || height <= 0) return false;
+  *stack = (PixelLayerStack){0};
+
+  stack->width = width;
+  stack->height = height;
+  stack->tilesX = (width + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+  stack->tilesY = (height + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+
+  size_t tileCount = (size_t)stack->tilesX * (size_t)stack->tilesY;
+  stack->flattened = (PixelColor *)calloc((size_t)width * (size_t)height, sizeof(PixelColor));
+  stack->tileDirty = (unsigned char *)calloc(tileCount, 1);
+  stack->dirtyList = (int *)malloc(tileCount * sizeof(int));
+  stack->jobList = (int *)malloc(tileCount * sizeof(int));
+  if (!stack->flattened || !stack->tileDirty || !stack->dirtyList || !stack->jobList) {
+    PixelLayerStackFree(stack);
+    return false;
+  }
+
+  PixelLayerStackMarkAllDirty(stack);
+  return true;
+}
+
+// Release all layers and cached composite data.
+void PixelLayerStackFree(PixelLayerStack *stack) {
+  if (!stack) return;
+  for (int i = 0; i < stack->layerCount; i++) free(stack->layers[i].pixels);
+  free(stack->layers);
+  free(stack->flattened);
+  free(stack->tileDirty);
+  free(stack->dirtyList);
+  free(stack->jobList);
+  PixelHistogramFree(&stack->colors);
+  *stack = (PixelLayerStack){0};
+}
+
+// Append a blank, visible, opaque layer on top and make it active.
+int PixelLayerStackAddLayer(PixelLayerStack *stack, const char *name) {
+  if (!stack || !stack->flattened) return -1;
+
+  if (stack->layerCount == stack->layerCapacity) {
+    int capacity = stack->layerCapacity > 0 ? stack->layerCapacity * 2 : 4;
+    PixelLayer *layers = (PixelLayer *)realloc(stack->layers, (size_t)capacity * sizeof(PixelLayer));
+    if (!layers) return -1;
+    stack->layers = layers;
+    stack->layerCapacity = capacity;
+  }
+
+  PixelLayer layer = {0};
+  layer.pixels = (PixelColor *)calloc((size_t)stack->width * (size_t)stack->height, sizeof(PixelColor));
+  if (!layer.pixels) return -1;
+  layer.visible = true;
+  layer.opacity = 255;
+  layer.blendMode = PIXEL_BLEND_NORMAL;
+  if (name) snprintf(layer.name, sizeof(layer.name), "%s", name);
+  else snprintf(layer.name, sizeof(layer.name), "Layer %d", stack->layerCount + 1);
+
+  int index = stack->layerCount++;
+  stack->layers[index] = layer;
+  stack->activeLayer = index;
+  // A blank normal layer cannot change the composite, so nothing is dirtied.
+  return index;
+}
+
+// Remove a layer and keep the active index pointing at a valid layer.
+bool PixelLayerStackRemoveLayer(PixelLayerStack *stack, int index) {
+  if (!ValidLayer(stack, index)) return false;
+
+  CountRect(stack, index, 0, 0, stack->width, stack->height, false);
+  free(stack->layers[index].pixels);
+  memmove(&stack->layers[index], &stack->layers[index + 1],
+          (size_t)(stack->layerCount - index - 1) * sizeof(PixelLayer));
+  stack->layerCount--;
+
+  if (stack->activeLayer >= stack->layerCount) stack->activeLayer = stack->layerCount - 1;
+  if (stack->activeLayer < 0) stack->activeLayer = 0;
+  PixelLayerStackMarkAllDirty(stack);
+  return true;
+}
+
+// Reorder a layer, shifting the layers in between by one slot.
+bool PixelLayerStackMoveLayer(PixelLayerStack *stack, int from, int to) {
+  if (!ValidLayer(stack, from) || !ValidLayer(stack, to)) return false;
+  if (from == to) return true;
+
+  PixelLayer moved = stack->layers[from];
+  if (from < to) {
+    memmove(&stack->layers[from], &stack->layers[from + 1], (size_t)(to - from) * sizeof(PixelLayer));
+  } else {
+    memmove(&stack->layers[to + 1], &stack->layers[to], (size_t)(from - to) * sizeof(PixelLayer));
+  }
+  stack->layers[to] = moved;
+
+  if (stack->activeLayer == from) stack->activeLayer = to;
+  PixelLayerStackMarkAllDirty(stack);
+  return true;
+}
+
+void PixelLayerStackSetVisible(PixelLayerStack *stack, int index, bool visible) {
+  if (!ValidLayer(stack, index) || stack->layers[index].visible == visible) return;
+  stack->layers[index].visible = visible;
+  PixelLayerStackMarkAllDirty(stack);
+}
+
+void PixelLayerStackSetOpacity(PixelLayerStack *stack, int index, unsigned char opacity) {
+  if (!ValidLayer(stack, index) || stack->layers[index].opacity == opacity) return;
+  stack->layers[index].opacity = opacity;
+  PixelLayerStackMarkAllDirty(stack);
+}
+
+void PixelLayerStackSetBlendMode(PixelLayerStack *stack, int index, PixelBlendMode mode) {
+  if (!ValidLayer(stack, index) || mode < 0 || mode >= PIXEL_BLEND_COUNT) return;
+  if (stack->layers[index].blendMode == mode) return;
+  stack->layers[index].blendMode = mode;
+  PixelLayerStackMarkAllDirty(stack);
+}
+
+// Reset one layer to transparent pixels.
+void PixelLayerStackClearLayer(PixelLayerStack *stack, int index) {
+  if (!ValidLayer(stack, index)) return;
+  CountRect(stack, index, 0, 0, stack->width, stack->height, false);
+  memset(stack->layers[index].pixels, 0, (size_t)stack->width * (size_t)stack->height * sizeof(PixelColor));
+  PixelLayerStackMarkAllDirty(stack);
+}
+
+// Paint into one layer and invalidate only the tiles under the brush.
+void PixelLayerStackPaintBrush(PixelLayerStack *stack, int index, int gx, int gy, PixelColor color, int brushSize) {
+  PixelLayerStackPaintBrushMasked(stack, index, gx, gy, color, brushSize, NULL);
+}
+
+// Same, but only pixels inside the selection mask (when not NULL) change.
+void PixelLayerStackPaintBrushMasked(PixelLayerStack *stack, int index, int gx, int gy, PixelColor color, int brushSize,
+                                     const PixelMask *mask) {
+  if (!ValidLayer(stack, index) || brushSize <= 0) return;
+  if (mask && (mask->width != stack->width || mask->height != stack->height)) return;
+  int x = gx - brushSize / 2;
+  int y = gy - brushSize / 2;
+  PixelLayerStackBeginEdit(stack, index, x, y, brushSize, brushSize);
+  if (mask) PixelMaskPaintBrush(mask, stack->layers[index].pixels, gx, gy, color, brushSize);
+  else PixelPaintBrushEx(stack->layers[index].pixels, stack->width, stack->height, gx, gy, color, brushSize);
+  PixelLayerStackEndEdit(stack, index, x, y, brushSize, brushSize);
+}
+
+// Bracket a direct write to a layer's pixels: Begin uncounts the rectangle's
+// old colors, End counts the new ones and invalidates its tiles. The cost is
+// the rectangle's area, so color queries never have to scan the canvas.
+void PixelLayerStackBeginEdit(PixelLayerStack *stack, int index, int x, int y, int width, int height) {
+  if (!ValidLayer(stack, index)) return;
+  CountRect(stack, index, x, y, width, height, false);
+}
+
+void PixelLayerStackEndEdit(PixelLayerStack *stack, int index, int x, int y, int width, int height) {
+  if (!ValidLayer(stack, index)) return;
+  CountRect(stack, index, x, y, width, height, true);
+  PixelLayerStackMarkDirty(stack, x, y, width, height);
+}
+
+// Rebuild the color counts from every layer, for pixels replaced wholesale.
+void PixelLayerStackRecountColors(PixelLayerStack *stack) {
+  if (!stack) return;
+  PixelHistogramClear(&stack->colors);
+  stack->colorsStale = false;
+  for (int i = 0; i < stack->layerCount; i++) CountRect(stack, i, 0, 0, stack->width, stack->height, true);
+}
+
+// Queue every tile overlapping the pixel rectangle for recompositing.
+void PixelLayerStackMarkDirty(PixelLayerStack *stack, int x, int y, int width, int height) {
+  if (!stack || !stack->tileDirty || width <= 0 || height <= 0) return;
+
+  int x0 = MaxInt(x, 0);
+  int y0 = MaxInt(y, 0);
+  int x1 = MinInt(x + width, stack->width);
+  int y1 = MinInt(y + height, stack->height);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  for (int ty = y0 / PIXEL_TILE_SIZE; ty <= (y1 - 1) / PIXEL_TILE_SIZE; ty++) {
+    for (int tx = x0 / PIXEL_TILE_SIZE; tx <= (x1 - 1) / PIXEL_TILE_SIZE; tx++) {
+      int tile = ty * stack->tilesX + tx;
+      if (stack->tileDirty[tile]) continue;
+      stack->tileDirty[tile] = 1;
+      stack->dirtyList[stack->dirtyCount++] = tile;
+    }
+  }
+}
+
+void PixelLayerStackMarkAllDirty(PixelLayerStack *stack) {
+  if (!stack) return;
+  PixelLayerStackMarkDirty(stack, 0, 0, stack->width, stack->height);
+}
+
+//------------------------------------------------------------------------------------
+// Premultiplied-alpha span kernels
+//------------------------------------------------------------------------------------
+// dst holds a premultiplied accumulator, src is a straight-alpha layer span.
+static void BlendSpanScalar(PixelColor *dst, const PixelColor *src, int count, unsigned int opacity, PixelBlendMode mode) {
+  for (int i = 0; i < count; i++) {
+    unsigned int sa = MulDiv255(src[i].a, opacity);
+    if (sa == 0) continue;
+
+    unsigned int s[4] = {MulDiv255(src[i].r, sa), MulDiv255(src[i].g, sa), MulDiv255(src[i].b, sa), sa};
+    unsigned int d[4] = {dst[i].r, dst[i].g, dst[i].b, dst[i].a};
+    unsigned int out[4];
+
+    for (int c = 0; c < 4; c++) {
+      unsigned int normal = s[c] + MulDiv255(d[c], 255 - sa);
+      if (mode == PIXEL_BLEND_MULTIPLY) {
+        out[c] = MulDiv255(s[c], d[c]) + MulDiv255(s[c], 255 - d[3]) + MulDiv255(d[c], 255 - sa);
+      } else if (mode == PIXEL_BLEND_ADD && c < 3) {
+        out[c] = s[c] + d[c];
+      } else {
+        out[c] = normal;
+      }
+      if (out[c] > 255) out[c] = 255;
+    }
+
+    dst[i] = (PixelColor){(unsigned char)out[0], (unsigned char)out[1], (unsigned char)out[2], (unsigned char)out[3]};
+  }
+}
+
+#if defined(__SSE2__)
+static inline __m128i MulDiv255Epi16(__m128i a, __m128i b) {
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m128i BroadcastAlphaEpi16(__m128i v) {
+  v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Blend two pixels held as 16-bit lanes, same math as BlendSpanScalar.
+static inline __m128i BlendPairEpi16(__m128i d, __m128i src, __m128i opacity, PixelBlendMode mode) {
+  const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  const __m128i full = _mm_set1_epi16(255);
+
+  __m128i sa = MulDiv255Epi16(BroadcastAlphaEpi16(src), opacity);
+  __m128i s = MulDiv255Epi16(src, sa);
+  s = _mm_or_si128(_mm_andnot_si128(alphaMask, s), _mm_and_si128(alphaMask, sa));
+
+  __m128i invSa = _mm_sub_epi16(full, sa);
+  __m128i normal = _mm_add_epi16(s, MulDiv255Epi16(d, invSa));
+  if (mode == PIXEL_BLEND_MULTIPLY) {
+    __m128i invDa = _mm_sub_epi16(full, BroadcastAlphaEpi16(d));
+    return _mm_add_epi16(_mm_add_epi16(MulDiv255Epi16(s, d), MulDiv255Epi16(s, invDa)),
+                         MulDiv255Epi16(d, invSa));
+  }
+  if (mode == PIXEL_BLEND_ADD) {
+    __m128i add = _mm_add_epi16(s, d);
+    return _mm_or_si128(_mm_andnot_si128(alphaMask, add), _mm_and_si128(alphaMask, normal));
+  }
+  return normal;
+}
+
+static void BlendSpanSimd(PixelColor *dst, const PixelColor *src, int count, unsigned int opacity, PixelBlendMode mode) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i vOpacity = _mm_set1_epi16((short)opacity);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s8 = _mm_loadu_si128((const __m128i *)(src + i));
+    // Fully transparent source spans leave the accumulator untouched.
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(s8, 24), zero)) == 0xFFFF) continue;
+
+    __m128i d8 = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i lo = BlendPairEpi16(_mm_unpacklo_epi8(d8, zero), _mm_unpacklo_epi8(s8, zero), vOpacity, mode);
+    __m128i hi = BlendPairEpi16(_mm_unpackhi_epi8(d8, zero), _mm_unpackhi_epi8(s8, zero), vOpacity, mode);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  BlendSpanScalar(dst + i, src + i, count - i, opacity, mode);
+}
+#endif
+
+static void BlendSpan(PixelColor *dst, const PixelColor *src, int count, unsigned int opacity, PixelBlendMode mode) {
+#if defined(__SSE2__)
+  BlendSpanSimd(dst, src, count, opacity, mode);
+#else
+  BlendSpanScalar(dst, src, count, opacity, mode);
+#endif
+}
+
+// Convert premultiplied accumulator back to straight alpha for display/export.
+static void UnpremultiplySpan(PixelColor *dst, const PixelColor *src, int count) {
+  for (int i = 0; i < count; i++) {
+    unsigned int a = src[i].a;
+    if (a == 0) {
+      dst[i] = PIXEL_BLANK;
+    } else if (a == 255) {
+      dst[i] = src[i];
+    } else {
+      unsigned int r = (src[i].r * 255u + a / 2) / a;
+      unsigned int g = (src[i].g * 255u + a / 2) / a;
+      unsigned int b = (src[i].b * 255u + a / 2) / a;
+      dst[i] = (PixelColor){(unsigned char)MinInt((int)r, 255), (unsigned char)MinInt((int)g, 255),
+                            (unsigned char)MinInt((int)b, 255), (unsigned char)a};
+    }
+  }
+}
+
+// Recomposite one tile of the flattened cache from all visible layers.
+// Touches only that tile's pixels, so distinct tiles may run concurrently.
+void PixelLayerStackCompositeTile(PixelLayerStack *stack, int tileIndex) {
+  if (!stack || !stack->flattened || tileIndex < 0 || tileIndex >= stack->tilesX * stack->tilesY) return;
+
+  int x0 = (tileIndex % stack->tilesX) * PIXEL_TILE_SIZE;
+  int y0 = (tileIndex / stack->tilesX) * PIXEL_TILE_SIZE;
+  int w = MinInt(PIXEL_TILE_SIZE, stack->width - x0);
+  int h = MinInt(PIXEL_TILE_SIZE, stack->height - y0);
+
+  PixelColor acc[PIXEL_TILE_SIZE];
+  for (int y = y0; y < y0 + h; y++) {
+    size_t rowOffset = (size_t)y * (size_t)stack->width + (size_t)x0;
+    memset(acc, 0, sizeof(acc));
+    for (int l = 0; l < stack->layerCount; l++) {
+      const PixelLayer *layer = &stack->layers[l];
+      if (!layer->visible || layer->opacity == 0) continue;
+      BlendSpan(acc, layer->pixels + rowOffset, w, layer->opacity, layer->blendMode);
+    }
+    UnpremultiplySpan(stack->flattened + rowOffset, acc, w);
+  }
+}
+
+static void MarkTileComposited(PixelLayerStack *stack, int tile) {
+  stack->tileDirty[tile] = 0;
+
+  int y0 = (tile / stack->tilesX) * PIXEL_TILE_SIZE;
+  int y1 = MinInt(y0 + PIXEL_TILE_SIZE, stack->height);
+  if (stack->changedY0 >= stack->changedY1) {
+    stack->changedY0 = y0;
+    stack->changedY1 = y1;
+  } else {
+    stack->changedY0 = MinInt(stack->changedY0, y0);
+    stack->changedY1 = MaxInt(stack->changedY1, y1);
+  }
+}
+
+// Bring the flattened cache up to date, recompositing only stale tiles.
+const PixelColor *PixelLayerStackFlatten(PixelLayerStack *stack) {
+  if (!stack || !stack->flattened) return NULL;
+
+  for (int i = 0; i < stack->dirtyCount; i++) {
+    PixelLayerStackCompositeTile(stack, stack->dirtyList[i]);
+    MarkTileComposited(stack, stack->dirtyList[i]);
+  }
+  stack->dirtyCount = 0;
+  return stack->flattened;
+}
+
+static void CompositeTileJob(void *user, int tile) {
+  PixelLayerStackCompositeTile((PixelLayerStack *)user, tile);
+}
+
+// Recomposite the stale tiles overlapping a visible rectangle on the worker
+// pool and wait only for those; tiles outside stay queued for a later call.
+// Layers must not be modified while this runs.
+const PixelColor *PixelLayerStackFlattenRect(PixelLayerStack *stack, PixelJobPool *pool, int x, int y, int width, int height) {
+  if (!stack || !stack->flattened) return NULL;
+
+  int tx0 = MaxInt(x, 0) / PIXEL_TILE_SIZE;
+  int ty0 = MaxInt(y, 0) / PIXEL_TILE_SIZE;
+  int tx1 = (MinInt(x + width, stack->width) + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+  int ty1 = (MinInt(y + height, stack->height) + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+
+  int jobCount = 0;
+  int kept = 0;
+  for (int i = 0; i < stack->dirtyCount; i++) {
+    int tile = stack->dirtyList[i];
+    int tx = tile % stack->tilesX;
+    int ty = tile / stack->tilesX;
+    if (tx >= tx0 && tx < tx1 && ty >= ty0 && ty < ty1) stack->jobList[jobCount++] = tile;
+    else stack->dirtyList[kept++] = tile;
+  }
+  stack->dirtyCount = kept;
+
+  PixelJobPoolParallelFor(pool, stack->jobList, jobCount, CompositeTileJob, stack);
+  for (int i = 0; i < jobCount; i++) MarkTileComposited(stack, stack->jobList[i]);
+  return stack->flattened;
+}
+
+// Report and reset the band of flattened rows changed since the last call.
+// Full-width rows are contiguous in memory, ready for a partial texture upload.
+bool PixelLayerStackTakeChangedRows(PixelLayerStack *stack, int *y0, int *y1) {
+  if (!stack || stack->changedY0 >= stack->changedY1) return false;
+  if (y0) *y0 = stack->changedY0;
+  if (y1) *y1 = stack->changedY1;
+  stack->changedY0 = 0;
+  stack->changedY1 = 0;
+  return true;
+}
+
+const char *PixelBlendModeName(PixelBlendMode mode) {
+  switch (mode) {
+    case PIXEL_BLEND_MULTIPLY: return "Multiply";
+    case PIXEL_BLEND_ADD: return "Add";
+    default: return "Normal";
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef PIXEL_LAYERS_H
+#define PIXEL_LAYERS_H
+
+#include <stdbool.h>
+
+#include "pixel_core.h"
+#include "pixel_histogram.h"
+#include "pixel_jobs.h"
+#include "pixel_selection.h"
+
+#define PIXEL_TILE_SIZE 16
+#define PIXEL_LAYER_NAME_SIZE 32
+
+typedef enum {
+  PIXEL_BLEND_NORMAL = 0,
+  PIXEL_BLEND_MULTIPLY,
+  PIXEL_BLEND_ADD,
+  PIXEL_BLEND_COUNT
+} PixelBlendMode;
+
+typedef struct {
+  PixelColor *pixels;              // Straight-alpha pixels, width * height
+  bool visible;
+  unsigned char opacity;           // 0 (transparent) .. 255 (opaque)
+  PixelBlendMode blendMode;
+  char name[PIXEL_LAYER_NAME_SIZE];
+} PixelLayer;
+
+// Layers ordered bottom to top with a tile-cached flattened composite.
+typedef struct {
+  int width;
+  int height;
+  int tilesX;
+  int tilesY;
+  PixelLayer *layers;
+  int layerCount;
+  int layerCapacity;
+  int activeLayer;
+  PixelColor *flattened;           // Straight-alpha composite of visible layers
+  unsigned char *tileDirty;        // 1 when the flattened tile is stale
+  int *dirtyList;                  // Stale tile indices, tileDirty dedupes entries
+  int dirtyCount;
+  int *jobList;                    // Scratch tile list handed to the worker pool
+  int changedY0;                   // Flattened rows updated since last take,
+  int changedY1;                   // empty when changedY0 >= changedY1
+  PixelHistogram colors;           // Pixels per color over all layers, kept current by every edit
+  bool colorsStale;                // A count failed for lack of memory; colors is short until a recount
+} PixelLayerStack;
+
+bool PixelLayerStackInit(PixelLayerStack *stack, int width, int height);
+void PixelLayerStackFree(PixelLayerStack *stack);
+int PixelLayerStackAddLayer(PixelLayerStack *stack, const char *name);
+bool PixelLayerStackRemoveLayer(PixelLayerStack *stack, int index);
+bool PixelLayerStackMoveLayer(PixelLayerStack *stack, int from, int to);
+void PixelLayerStackSetVisible(PixelLayerStack *stack, int index, bool visible);
+void PixelLayerStackSetOpacity(PixelLayerStack *stack, int index, unsigned char opacity);
+void PixelLayerStackSetBlendMode(PixelLayerStack *stack, int index, PixelBlendMode mode);
+void PixelLayerStackClearLayer(PixelLayerStack *stack, int index);
+void PixelLayerStackPaintBrush(PixelLayerStack *stack, int index, int gx, int gy, PixelColor color, int brushSize);
+void PixelLayerStackPaintBrushMasked(PixelLayerStack *stack, int index, int gx, int gy, PixelColor color, int brushSize,
+                                     const PixelMask *mask);
+void PixelLayerStackBeginEdit(PixelLayerStack *stack, int index, int x, int y, int width, int height);
+void PixelLayerStackEndEdit(PixelLayerStack *stack, int index, int x, int y, int width, int height);
+void PixelLayerStackRecountColors(PixelLayerStack *stack);
+void PixelLayerStackMarkDirty(PixelLayerStack *stack, int x, int y, int width, int height);
+void PixelLayerStackMarkAllDirty(PixelLayerStack *stack);
+void PixelLayerStackCompositeTile(PixelLayerStack *stack, int tileIndex);
+const PixelColor *PixelLayerStackFlatten(PixelLayerStack *stack);
+const PixelColor *PixelLayerStackFlattenRect(PixelLayerStack *stack, PixelJobPool *pool, int x, int y, int width, int height);
+bool PixelLayerStackTakeChangedRows(PixelLayerStack *stack, int *y0, int *y1);
+const char *PixelBlendModeName(PixelBlendMode mode);
+
+#endif
@@ -0,0 +1,424 @@
+#include "pixel_library.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixel_jobs.h"
+#include "pixel_palette.h"
+
+#define MAX_PROJECT_SIZE 4096
+#define THUMB_BYTES ((size_t)PIXEL_THUMB_SIZE * PIXEL_THUMB_SIZE * sizeof(PixelColor))
+
+// Cache file layout, native endianness (the cache never leaves the machine):
+//   ThumbHeader
+//   ThumbEntry[entryCount]      sorted by file name
+//   char[stringBytes]           source directory, then NUL-terminated file names
+//   PixelColor[entryCount][PIXEL_THUMB_SIZE * PIXEL_THUMB_SIZE]
+// Only the header, entries and strings are read up front; each thumbnail is
+// read on demand from its fixed offset.
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t thumbSize;
+  uint32_t stringBytes;
+  uint32_t reserved;
+} ThumbHeader;
+
+typedef struct {
+  int64_t mtime;
+  int64_t size;
+  uint32_t nameOffset;
+  uint32_t reserved;
+} ThumbEntry;
+
+enum { THUMB_EMPTY = 0, THUMB_QUEUED, THUMB_READY, THUMB_FAILED };
+
+struct PixelLibrary {
+  char *dirPath;
+  char *cachePath;
+  int workerCount;
+  PixelPaletteFile *files;
+  int fileCount;
+
+  // Cache index; cacheFile is read by the library thread only
+  FILE *cacheFile;
+  uint32_t cacheCount;
+  long thumbOffset;                // Where the thumbnail array starts in cacheFile
+  int *cacheSlot;                  // Per file: matching cache entry, or -1
+
+  pthread_t thread;
+  bool threadStarted;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  PixelColor **thumbs;             // Per file; immutable once its state is THUMB_READY
+  unsigned char *state;
+  int wantFirst;                   // Latest visible range [wantFirst, wantEnd)
+  int wantEnd;
+  bool working;                    // The thread holds a batch
+  bool stop;
+  bool exited;                     // The thread has refreshed the cache and returned
+  PixelLibraryStats stats;
+};
+
+typedef struct {
+  PixelLibrary *library;
+  const int *files;                // Batch slot -> file index
+  PixelColor **out;                // Batch slot -> rendered thumbnail or NULL
+} RenderBatch;
+
+static const char kThumbMagic[4] = {'P', 'X', 'T', 'C'};
+
+static char *CopyString(const char *text) {
+  if (!text) return NULL;
+  size_t length = strlen(text) + 1;
+  char *copy = (char *)malloc(length);
+  if (copy) memcpy(copy, text, length);
+  return copy;
+}
+
+static bool IsProjectFile(const char *fileName) {
+  const char *dot = strrchr(fileName, '.');
+  return dot && dot != fileName && strcmp(dot, ".txt") == 0;
+}
+
+// Read the cache index and match each listed file to an entry with the same
+// name, mtime and size. A missing or corrupt cache simply matches nothing.
+static void OpenCache(PixelLibrary *library) {
+  FILE *fp = library->cachePath ? fopen(library->cachePath, "rb") : NULL;
+  if (!fp) return;
+  ThumbHeader header;
+  long fileSize = -1;
+  bool ok = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, kThumbMagic, sizeof(kThumbMagic)) == 0 &&
+            header.version == PIXEL_THUMB_CACHE_VERSION && header.thumbSize == PIXEL_THUMB_SIZE &&
+            header.stringBytes > 0 && fseek(fp, 0, SEEK_END) == 0 && (fileSize = ftell(fp)) > 0;
+  uint64_t indexBytes = ok ? (uint64_t)header.entryCount * sizeof(ThumbEntry) + header.stringBytes : 0;
+  ok = ok && sizeof(ThumbHeader) + indexBytes + (uint64_t)header.entryCount * THUMB_BYTES == (uint64_t)fileSize;
+  unsigned char *index = ok ? (unsigned char *)malloc((size_t)indexBytes) : NULL;
+  ok = ok && index && fseek(fp, (long)sizeof(ThumbHeader), SEEK_SET) == 0 &&
+       fread(index, 1, (size_t)indexBytes, fp) == (size_t)indexBytes;
+
+  const ThumbEntry *entries = (const ThumbEntry *)index;
+  const char *strings = ok ? (const char *)(entries + header.entryCount) : NULL;
+  ok = ok && strings[header.stringBytes - 1] == '\0' && strcmp(strings, library->dirPath) == 0;
+  for (uint32_t i = 0; ok && i < header.entryCount; i++) ok = entries[i].nameOffset < header.stringBytes;
+  if (!ok) {
+    free(index);
+    fclose(fp);
+    return;
+  }
+
+  for (int i = 0; i < library->fileCount; i++) {
+    const PixelPaletteFile *file = &library->files[i];
+    uint32_t lo = 0, hi = header.entryCount;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      int order = strcmp(strings + entries[mid].nameOffset, file->fileName);
+      if (order == 0) {
+        if (entries[mid].mtime == file->mtime && entries[mid].size == file->size) library->cacheSlot[i] = (int)mid;
+        break;
+      }
+      if (order < 0) lo = mid + 1;
+      else hi = mid;
+    }
+  }
+  free(index);
+  library->cacheFile = fp;
+  library->cacheCount = header.entryCount;
+  library->thumbOffset = (long)(sizeof(ThumbHeader) + indexBytes);
+}
+
+static PixelColor *ReadCachedThumb(PixelLibrary *library, int slot) {
+  PixelColor *thumb = (PixelColor *)malloc(THUMB_BYTES);
+  if (!thumb) return NULL;
+  if (fseek(library->cacheFile, library->thumbOffset + (long)((size_t)slot * THUMB_BYTES), SEEK_SET) != 0 ||
+      fread(thumb, 1, THUMB_BYTES, library->cacheFile) != THUMB_BYTES) {
+    free(thumb);
+    return NULL;
+  }
+  return thumb;
+}
+
+// Load a project and sample it down (or up) to a thumbnail, nearest pixel.
+static PixelColor *RenderThumb(const char *path) {
+  int grid = PixelCanvasTextGridSize(path);
+  if (grid <= 0 || grid > MAX_PROJECT_SIZE) return NULL;
+  PixelColor *canvas = (PixelColor *)calloc((size_t)grid * (size_t)grid, sizeof(PixelColor));
+  PixelColor *thumb = canvas ? (PixelColor *)malloc(THUMB_BYTES) : NULL;
+  if (!thumb || !PixelLoadCanvasText(path, canvas, grid)) {
+    free(canvas);
+    free(thumb);
+    return NULL;
+  }
+  for (int y = 0; y < PIXEL_THUMB_SIZE; y++) {
+    const PixelColor *row = canvas + (size_t)(y * grid / PIXEL_THUMB_SIZE) * (size_t)grid;
+    for (int x = 0; x < PIXEL_THUMB_SIZE; x++) thumb[y * PIXEL_THUMB_SIZE + x] = row[x * grid / PIXEL_THUMB_SIZE];
+  }
+  free(canvas);
+  return thumb;
+}
+
+static void RenderJob(void *user, int item) {
+  RenderBatch *batch = (RenderBatch *)user;
+  batch->out[item] = RenderThumb(batch->library->files[batch->files[item]].path);
+}
+
+// Write every thumbnail that is still valid, from memory or the old cache.
+static bool WriteCache(PixelLibrary *library) {
+  uint32_t entryCount = 0, stringBytes = (uint32_t)strlen(library->dirPath) + 1;
+  for (int i = 0; i < library->fileCount; i++) {
+    if (library->state[i] != THUMB_READY && library->cacheSlot[i] < 0) continue;
+    entryCount++;
+    stringBytes += (uint32_t)strlen(library->files[i].fileName) + 1;
+  }
+
+  char tempPath[1024];
+  int written = snprintf(tempPath, sizeof(tempPath), "%s.tmp", library->cachePath);
+  if (written <= 0 || (size_t)written >= sizeof(tempPath)) return false;
+  FILE *fp = fopen(tempPath, "wb");
+  if (!fp) return false;
+
+  ThumbHeader header = {{'P', 'X', 'T', 'C'}, PIXEL_THUMB_CACHE_VERSION, entryCount, PIXEL_THUMB_SIZE, stringBytes, 0};
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  uint32_t nameOffset = (uint32_t)strlen(library->dirPath) + 1;
+  for (int i = 0; ok && i < library->fileCount; i++) {
+    if (library->state[i] != THUMB_READY && library->cacheSlot[i] < 0) continue;
+    ThumbEntry entry = {library->files[i].mtime, library->files[i].size, nameOffset, 0};
+    ok = fwrite(&entry, sizeof(entry), 1, fp) == 1;
+    nameOffset += (uint32_t)strlen(library->files[i].fileName) + 1;
+  }
+  ok = ok && fwrite(library->dirPath, 1, strlen(library->dirPath) + 1, fp) == strlen(library->dirPath) + 1;
+  for (int i = 0; ok && i < library->fileCount; i++) {
+    if (library->state[i] != THUMB_READY && library->cacheSlot[i] < 0) continue;
+    size_t length = strlen(library->files[i].fileName) + 1;
+    ok = fwrite(library->files[i].fileName, 1, length, fp) == length;
+  }
+  for (int i = 0; ok && i < library->fileCount; i++) {
+    if (library->state[i] == THUMB_READY) {
+      ok = fwrite(library->thumbs[i], 1, THUMB_BYTES, fp) == THUMB_BYTES;
+    } else if (library->cacheSlot[i] >= 0) {
+      PixelColor *thumb = ReadCachedThumb(library, library->cacheSlot[i]);
+      ok = thumb && fwrite(thumb, 1, THUMB_BYTES, fp) == THUMB_BYTES;
+      free(thumb);
+    }
+  }
+
+  // The old cache is closed before the rename replaces it
+  if (library->cacheFile) fclose(library->cacheFile);
+  library->cacheFile = NULL;
+  if (!ok) {
+    fclose(fp);
+    remove(tempPath);
+    return false;
+  }
+  return PixelCommitTempFile(fp, tempPath, library->cachePath);
+}
+
+// Deleted or changed files leave stale entries behind even when nothing was rendered.
+static bool CacheOutdated(const PixelLibrary *library) {
+  uint32_t validCount = 0;
+  for (int i = 0; i < library->fileCount; i++) {
+    if (library->state[i] == THUMB_READY || library->cacheSlot[i] >= 0) validCount++;
+  }
+  return library->stats.generatedCount > 0 || validCount != library->cacheCount;
+}
+
+static void *LibraryMain(void *arg) {
+  PixelLibrary *library = (PixelLibrary *)arg;
+  PixelJobPool *pool = NULL;
+  int files[PIXEL_THUMB_BATCH], render[PIXEL_THUMB_BATCH];
+  PixelColor *out[PIXEL_THUMB_BATCH];
+  bool cached[PIXEL_THUMB_BATCH];
+
+  pthread_mutex_lock(&library->lock);
+  for (;;) {
+    // Only the latest visible range is served, so fast scrolling never
+    // leaves work queued for rows that are already gone
+    int count = 0;
+    while (!library->stop) {
+      for (int i = library->wantFirst; i < library->wantEnd && count < PIXEL_THUMB_BATCH; i++) {
+        if (library->state[i] != THUMB_EMPTY) continue;
+        library->state[i] = THUMB_QUEUED;
+        files[count++] = i;
+      }
+      if (count > 0) break;
+      pthread_cond_wait(&library->changed, &library->lock);
+    }
+    if (library->stop) break;
+    library->working = true;
+    pthread_mutex_unlock(&library->lock);
+
+    int renderCount = 0;
+    for (int i = 0; i < count; i++) {
+      int slot = library->cacheSlot[files[i]];
+      out[i] = slot >= 0 ? ReadCachedThumb(library, slot) : NULL;
+      cached[i] = out[i] != NULL;
+      // An unreadable entry is left out of the rewritten cache instead of failing it
+      if (slot >= 0 && !cached[i]) library->cacheSlot[files[i]] = -1;
+      if (!cached[i]) render[renderCount++] = i;
+    }
+    if (renderCount > 1 && !pool) pool = PixelJobPoolCreate(library->workerCount);
+    RenderBatch batch = {library, files, out};
+    PixelJobPoolParallelFor(pool, render, renderCount, RenderJob, &batch);
+
+    pthread_mutex_lock(&library->lock);
+    for (int i = 0; i < count; i++) {
+      library->thumbs[files[i]] = out[i];
+      library->state[files[i]] = out[i] ? THUMB_READY : THUMB_FAILED;
+      if (cached[i]) library->stats.cachedCount++;
+      else if (out[i]) library->stats.generatedCount++;
+    }
+    library->working = false;
+    pthread_cond_broadcast(&library->changed);
+  }
+  pthread_mutex_unlock(&library->lock);
+  PixelJobPoolDestroy(pool);
+
+  // Refresh the cache here rather than in Close, so the UI thread never waits on the write.
+  // Once stopped, no thumbnail or cache slot changes, so they are read without the lock
+  bool written = library->cachePath && CacheOutdated(library) && WriteCache(library);
+  pthread_mutex_lock(&library->lock);
+  library->stats.cacheWritten = written;
+  library->exited = true;
+  pthread_cond_broadcast(&library->changed);
+  pthread_mutex_unlock(&library->lock);
+  return NULL;
+}
+
+// List dirPath and start the thumbnail thread. cachePath may be NULL;
+// workerCount follows PixelJobPoolCreate (negative means one per spare CPU).
+PixelLibrary *PixelLibraryOpen(const char *dirPath, const char *cachePath, int workerCount) {
+  if (!dirPath) return NULL;
+  PixelLibrary *library = (PixelLibrary *)calloc(1, sizeof(PixelLibrary));
+  if (!library) return NULL;
+  library->dirPath = CopyString(dirPath);
+  library->cachePath = CopyString(cachePath);
+  library->workerCount = workerCount;
+  pthread_mutex_init(&library->lock, NULL);
+  pthread_cond_init(&library->changed, NULL);
+
+  library->fileCount = PixelListDirFiles(dirPath, IsProjectFile, &library->files);
+  size_t slots = (size_t)(library->fileCount > 0 ? library->fileCount : 1);
+  library->cacheSlot = (int *)malloc(slots * sizeof(int));
+  library->thumbs = (PixelColor **)calloc(slots, sizeof(PixelColor *));
+  library->state = (unsigned char *)calloc(slots, 1);
+  if (!library->dirPath || (cachePath && !library->cachePath) || !library->cacheSlot || !library->thumbs ||
+      !library->state) {
+    PixelLibraryClose(library, NULL);
+    return NULL;
+  }
+  for (int i = 0; i < library->fileCount; i++) library->cacheSlot[i] = -1;
+  OpenCache(library);
+  library->stats.fileCount = library->fileCount;
+
+  if (pthread_create(&library->thread, NULL, LibraryMain, library) != 0) {
+    PixelLibraryClose(library, NULL);
+    return NULL;
+  }
+  library->threadStarted = true;
+  return library;
+}
+
+// Stop serving requests and let the thread refresh the cache file in the
+// background. PixelLibraryBusy stays true until it is done.
+void PixelLibraryStop(PixelLibrary *library) {
+  if (!library) return;
+  pthread_mutex_lock(&library->lock);
+  library->stop = true;
+  pthread_cond_broadcast(&library->changed);
+  pthread_mutex_unlock(&library->lock);
+}
+
+// Stop the thread, wait for its cache refresh and free everything. stats,
+// if given, receives the session's final counts.
+void PixelLibraryClose(PixelLibrary *library, PixelLibraryStats *stats) {
+  if (!library) return;
+  PixelLibraryStop(library);
+  if (library->threadStarted) pthread_join(library->thread, NULL);
+
+  if (stats) *stats = library->stats;
+  if (library->cacheFile) fclose(library->cacheFile);
+  for (int i = 0; library->thumbs && i < library->fileCount; i++) free(library->thumbs[i]);
+  free(library->thumbs);
+  free(library->state);
+  free(library->cacheSlot);
+  PixelPaletteFreeFileList(library->files, library->fileCount);
+  pthread_cond_destroy(&library->changed);
+  pthread_mutex_destroy(&library->lock);
+  free(library->dirPath);
+  free(library->cachePath);
+  free(library);
+}
+
+int PixelLibraryCount(const PixelLibrary *library) {
+  return library ? library->fileCount : 0;
+}
+
+const char *PixelLibraryFileName(const PixelLibrary *library, int index) {
+  if (!library || index < 0 || index >= library->fileCount) return NULL;
+  return library->files[index].fileName;
+}
+
+// Ask for the thumbnails of [first, end), typically the rows on screen.
+// Replaces the previous request; finished thumbnails stay available.
+void PixelLibraryRequest(PixelLibrary *library, int first, int end) {
+  if (!library) return;
+  if (first < 0) first = 0;
+  if (end > library->fileCount) end = library->fileCount;
+  if (end < first) end = first;
+  pthread_mutex_lock(&library->lock);
+  library->wantFirst = first;
+  library->wantEnd = end;
+  pthread_cond_broadcast(&library->changed);
+  pthread_mutex_unlock(&library->lock);
+}
+
+// Thumbnail pixels (PIXEL_THUMB_SIZE squared), or NULL until it is ready or
+// if the project could not be read. Valid until PixelLibraryClose.
+const PixelColor *PixelLibraryThumbnail(PixelLibrary *library, int index) {
+  if (!library || index < 0 || index >= library->fileCount) return NULL;
+  pthread_mutex_lock(&library->lock);
+  const PixelColor *thumb = library->state[index] == THUMB_READY ? library->thumbs[index] : NULL;
+  pthread_mutex_unlock(&library->lock);
+  return thumb;
+}
+
+static bool RequestPending(const PixelLibrary *library) {
+  if (library->stop) return library->threadStarted && !library->exited;
+  if (library->working) return true;
+  for (int i = library->wantFirst; i < library->wantEnd; i++) {
+    if (library->state[i] == THUMB_EMPTY) return true;
+  }
+  return false;
+}
+
+// True while thumbnails of the requested range are still being produced, or
+// after a stop while the cache file is being refreshed.
+bool PixelLibraryBusy(PixelLibrary *library) {
+  if (!library) return false;
+  pthread_mutex_lock(&library->lock);
+  bool busy = RequestPending(library);
+  pthread_mutex_unlock(&library->lock);
+  return busy;
+}
+
+// Block until every thumbnail of the requested range is ready or failed, or
+// after a stop until the cache file is refreshed.
+void PixelLibraryWait(PixelLibrary *library) {
+  if (!library) return;
+  pthread_mutex_lock(&library->lock);
+  while (RequestPending(library)) pthread_cond_wait(&library->changed, &library->lock);
+  pthread_mutex_unlock(&library->lock);
+}
+
+PixelLibraryStats PixelLibraryGetStats(PixelLibrary *library) {
+  PixelLibraryStats stats = {0};
+  if (!library) return stats;
+  pthread_mutex_lock(&library->lock);
+  stats = library->stats;
+  pthread_mutex_unlock(&library->lock);
+  return stats;
+}
@@ -0,0 +1,39 @@
+#ifndef PIXEL_LIBRARY_H
+#define PIXEL_LIBRARY_H
+
+#include <stdbool.h>
+
+#include "pixel_core.h"
+
+#define PIXEL_THUMB_SIZE 32            // Thumbnails are PIXEL_THUMB_SIZE squared RGBA
+#define PIXEL_THUMB_CACHE_VERSION 1
+#define PIXEL_THUMB_BATCH 32           // Thumbnails a worker batch produces at most
+
+// What a library session did, for logging and tests.
+typedef struct {
+  int fileCount;                   // Projects found in the directory
+  int cachedCount;                 // Thumbnails read from the cache file
+  int generatedCount;              // Thumbnails rendered because they were new or changed
+  bool cacheWritten;               // Cache was rewritten after the stop
+} PixelLibraryStats;
+
+// Project browser model. Open lists the directory's .txt projects and reads
+// the thumbnail cache index; no thumbnail is produced until it is requested.
+// A library thread serves the latest requested range (the rows on screen):
+// cached thumbnails are read straight from the cache file, keyed by path,
+// mtime and size, and the rest are rendered on a worker pool. When stopped,
+// the thread writes every valid thumbnail back into the one cache file.
+typedef struct PixelLibrary PixelLibrary;
+
+PixelLibrary *PixelLibraryOpen(const char *dirPath, const char *cachePath, int workerCount);
+void PixelLibraryStop(PixelLibrary *library);
+void PixelLibraryClose(PixelLibrary *library, PixelLibraryStats *stats);
+int PixelLibraryCount(const PixelLibrary *library);
+const char *PixelLibraryFileName(const PixelLibrary *library, int index);
+void PixelLibraryRequest(PixelLibrary *library, int first, int end);
+const PixelColor *PixelLibraryThumbnail(PixelLibrary *library, int index);
+bool PixelLibraryBusy(PixelLibrary *library);
+void PixelLibraryWait(PixelLibrary *library);
+PixelLibraryStats PixelLibraryGetStats(PixelLibrary *library);
+
+#endif
@@ -0,0 +1,133 @@
+#include "pixel_live.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+struct PixelLivePublisher {
+  char name[256];
+  PixelLiveHeader *header;
+  size_t mappedBytes;
+  int width;
+  int height;
+  PixelLiveRect previousDirty;     // Changed by the last publish; the back buffer lacks it too
+};
+
+static PixelLiveRect UnionRect(PixelLiveRect a, PixelLiveRect b) {
+  if (a.width <= 0 || a.height <= 0) return b;
+  if (b.width <= 0 || b.height <= 0) return a;
+  int32_t x0 = a.x < b.x ? a.x : b.x;
+  int32_t y0 = a.y < b.y ? a.y : b.y;
+  int32_t x1 = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+  int32_t y1 = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+  return (PixelLiveRect){x0, y0, x1 - x0, y1 - y0};
+}
+
+#if defined(_WIN32)
+// POSIX shared memory only; the link is not available on Windows builds.
+PixelLivePublisher *PixelLivePublisherCreate(const char *name, int width, int height) {
+  (void)name;
+  (void)width;
+  (void)height;
+  return NULL;
+}
+#else
+// Create (or take over) the segment called name, e.g. PIXEL_LIVE_DEFAULT_NAME.
+// Readers of a previous session see their segment closed and reopen.
+PixelLivePublisher *PixelLivePublisherCreate(const char *name, int width, int height) {
+  if (!name || name[0] != '/' || width <= 0 || height <= 0) return NULL;
+  PixelLivePublisher *publisher = (PixelLivePublisher *)calloc(1, sizeof(PixelLivePublisher));
+  if (!publisher || strlen(name) >= sizeof(publisher->name)) {
+    free(publisher);
+    return NULL;
+  }
+  snprintf(publisher->name, sizeof(publisher->name), "%s", name);
+
+  // Buffers start on cache lines so row copies and readers never share one with the header
+  size_t bufferBytes = (size_t)width * (size_t)height * sizeof(PixelColor);
+  size_t firstOffset = (sizeof(PixelLiveHeader) + 63) & ~(size_t)63;
+  size_t secondOffset = (firstOffset + bufferBytes + 63) & ~(size_t)63;
+  size_t totalBytes = secondOffset + bufferBytes;
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  void *mapping = MAP_FAILED;
+  if (fd >= 0 && ftruncate(fd, (off_t)totalBytes) == 0) {
+    mapping = mmap(NULL, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (fd >= 0) close(fd);
+  if (mapping == MAP_FAILED) {
+    if (fd >= 0) shm_unlink(name);
+    free(publisher);
+    return NULL;
+  }
+
+  // The new segment is zero filled: generation 0 means no frame yet
+  PixelLiveHeader *header = (PixelLiveHeader *)mapping;
+  header->version = PIXEL_LIVE_VERSION;
+  header->width = (uint32_t)width;
+  header->height = (uint32_t)height;
+  header->bufferOffset[0] = firstOffset;
+  header->bufferOffset[1] = secondOffset;
+  atomic_thread_fence(memory_order_release);
+  header->magic = PIXEL_LIVE_MAGIC;
+
+  publisher->header = header;
+  publisher->mappedBytes = totalBytes;
+  publisher->width = width;
+  publisher->height = height;
+  return publisher;
+}
+#endif
+
+// Publish canvas (the full width x height image) as the next frame; the
+// rectangle is what changed since the previous publish. The back buffer is
+// two frames old, so it takes this rectangle and the previous one.
+bool PixelLivePublish(PixelLivePublisher *publisher, const PixelColor *canvas, int x, int y, int width, int height) {
+  if (!publisher || !canvas) return false;
+  int x0 = x < 0 ? 0 : x;
+  int y0 = y < 0 ? 0 : y;
+  int x1 = x + width > publisher->width ? publisher->width : x + width;
+  int y1 = y + height > publisher->height ? publisher->height : y + height;
+  if (x1 <= x0 || y1 <= y0) return false;
+
+  PixelLiveHeader *header = publisher->header;
+  uint64_t next = atomic_load_explicit(&header->generation, memory_order_relaxed) + 1;
+  int buffer = (int)(next & 1);
+  PixelLiveRect dirty = {x0, y0, x1 - x0, y1 - y0};
+  PixelLiveRect copy = UnionRect(dirty, publisher->previousDirty);
+  if (next <= 2) copy = (PixelLiveRect){0, 0, publisher->width, publisher->height};  // Never written yet
+
+  atomic_store_explicit(&header->writing, next, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  PixelColor *pixels = (PixelColor *)((unsigned char *)header + header->bufferOffset[buffer]);
+  for (int row = copy.y; row < copy.y + copy.height; row++) {
+    size_t offset = (size_t)row * (size_t)publisher->width + (size_t)copy.x;
+    memcpy(pixels + offset, canvas + offset, (size_t)copy.width * sizeof(PixelColor));
+  }
+  header->dirty[buffer] = dirty;
+  atomic_store_explicit(&header->generation, next, memory_order_release);
+  publisher->previousDirty = dirty;
+  return true;
+}
+
+uint64_t PixelLivePublisherGeneration(const PixelLivePublisher *publisher) {
+  return publisher ? atomic_load_explicit(&publisher->header->generation, memory_order_relaxed) : 0;
+}
+
+// Mark the segment closed and remove its name; mapped readers keep the last frame.
+void PixelLivePublisherDestroy(PixelLivePublisher *publisher) {
+  if (!publisher) return;
+#if !defined(_WIN32)
+  atomic_store_explicit(&publisher->header->closed, 1, memory_order_release);
+  munmap(publisher->header, publisher->mappedBytes);
+  shm_unlink(publisher->name);
+#endif
+  free(publisher);
+}
@@ -0,0 +1,21 @@
+#ifndef PIXEL_LIVE_H
+#define PIXEL_LIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pixel_core.h"
+#include "pixel_live_client.h"
+
+// Live link: publishes the flattened canvas into a POSIX shared-memory
+// segment (layout in pixel_live_client.h) so another local process can show
+// it while it is painted. Each publish copies only the dirty rows into the
+// back buffer, then flips the generation; nothing touches the filesystem.
+typedef struct PixelLivePublisher PixelLivePublisher;
+
+PixelLivePublisher *PixelLivePublisherCreate(const char *name, int width, int height);
+bool PixelLivePublish(PixelLivePublisher *publisher, const PixelColor *canvas, int x, int y, int width, int height);
+uint64_t PixelLivePublisherGeneration(const PixelLivePublisher *publisher);
+void PixelLivePublisherDestroy(PixelLivePublisher *publisher);
+
+#endif
@@ -0,0 +1,99 @@
+#include "pixel_live_client.h"
+
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct PixelLiveView {
+  const PixelLiveHeader *header;
+  size_t mappedBytes;
+  uint64_t lastGeneration;         // Generation of the last acquired frame
+};
+
+#if defined(_WIN32)
+// POSIX shared memory only; the link is not available on Windows builds.
+PixelLiveView *PixelLiveViewOpen(const char *name) {
+  (void)name;
+  return NULL;
+}
+#else
+// Map the segment an editor publishes under name (PIXEL_LIVE_DEFAULT_NAME
+// unless it was started with another). NULL when nothing is published.
+PixelLiveView *PixelLiveViewOpen(const char *name) {
+  int fd = shm_open(name ? name : PIXEL_LIVE_DEFAULT_NAME, O_RDONLY, 0);
+  if (fd < 0) return NULL;
+  struct stat info;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(PixelLiveHeader)) {
+    mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) return NULL;
+
+  // A short or foreign segment must fail here, before st_size - bufferBytes could wrap
+  const PixelLiveHeader *header = (const PixelLiveHeader *)mapping;
+  uint64_t pixelCount = (uint64_t)header->width * header->height;
+  bool valid = header->magic == PIXEL_LIVE_MAGIC && header->version == PIXEL_LIVE_VERSION && header->width > 0 &&
+               header->height > 0 && pixelCount <= (uint64_t)info.st_size / 4;
+  uint64_t bufferBytes = pixelCount * 4;
+  for (int i = 0; i < 2 && valid; i++) {
+    valid = header->bufferOffset[i] >= sizeof(PixelLiveHeader) &&
+            header->bufferOffset[i] <= (uint64_t)info.st_size - bufferBytes;
+  }
+  PixelLiveView *view = valid ? (PixelLiveView *)calloc(1, sizeof(PixelLiveView)) : NULL;
+  if (!view) {
+    munmap(mapping, (size_t)info.st_size);
+    return NULL;
+  }
+  view->header = header;
+  view->mappedBytes = (size_t)info.st_size;
+  return view;
+}
+#endif
+
+// Take the newest frame if it is newer than the last one taken. Read what
+// you need, then check Intact; if the editor overtook you, acquire again.
+bool PixelLiveViewAcquire(PixelLiveView *view, PixelLiveFrame *frame) {
+  if (!view || !frame) return false;
+  const PixelLiveHeader *header = view->header;
+  uint64_t generation = atomic_load_explicit(&header->generation, memory_order_acquire);
+  if (generation == 0 || generation == view->lastGeneration) return false;
+
+  int buffer = (int)(generation & 1);
+  frame->pixels = (const uint8_t *)header + header->bufferOffset[buffer];
+  frame->width = (int)header->width;
+  frame->height = (int)header->height;
+  frame->generation = generation;
+  frame->dirty = header->dirty[buffer];
+  if (generation != view->lastGeneration + 1) {
+    frame->dirty = (PixelLiveRect){0, 0, (int32_t)header->width, (int32_t)header->height};
+  }
+  view->lastGeneration = generation;
+  return true;
+}
+
+// True if nothing overwrote frame's buffer while it was being read.
+bool PixelLiveViewIntact(const PixelLiveView *view, const PixelLiveFrame *frame) {
+  if (!view || !frame) return false;
+  atomic_thread_fence(memory_order_acquire);
+  uint64_t writing = atomic_load_explicit(&view->header->writing, memory_order_relaxed);
+  return writing <= frame->generation + 1;
+}
+
+// True once the editor has stopped publishing; reopen to follow a new session.
+bool PixelLiveViewClosed(const PixelLiveView *view) {
+  return !view || atomic_load_explicit(&view->header->closed, memory_order_acquire) != 0;
+}
+
+void PixelLiveViewClose(PixelLiveView *view) {
+  if (!view) return;
+#if !defined(_WIN32)
+  munmap((void *)view->header, view->mappedBytes);
+#endif
+  free(view);
+}
@@ -0,0 +1,56 @@
+#ifndef PIXEL_LIVE_CLIENT_H
+#define PIXEL_LIVE_CLIENT_H
+
+// Reader side of the editor's live link. This header and pixel_live_client.c
+// depend on nothing else in the editor, so a game can compile them in as is.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIXEL_LIVE_MAGIC 0x4B4C5850u   // "PXLK" little-endian
+#define PIXEL_LIVE_VERSION 1
+#define PIXEL_LIVE_DEFAULT_NAME "/pixel-editor-live"
+
+typedef struct {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+} PixelLiveRect;
+
+// Shared-memory segment: this header, then two width * height RGBA8 buffers
+// at bufferOffset. Frame N lives in buffer N & 1, so the editor writes one
+// buffer while readers use the other. writing runs ahead of generation while
+// a frame is being written; a reader whose frame is older than writing - 1
+// may have seen it overwritten.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint64_t bufferOffset[2];
+  _Atomic uint64_t generation;     // Last complete frame; 0 until the first publish
+  _Atomic uint64_t writing;        // Frame being written; equals generation when idle
+  PixelLiveRect dirty[2];          // Per buffer: what changed since the frame before it
+  _Atomic uint32_t closed;         // Set when the editor stops publishing
+} PixelLiveHeader;
+
+// A frame handed out by Acquire; pixels point straight into the mapping.
+typedef struct {
+  const uint8_t *pixels;           // RGBA8, width * 4 bytes per row
+  int width;
+  int height;
+  uint64_t generation;
+  PixelLiveRect dirty;             // Whole frame when frames were skipped since the last Acquire
+} PixelLiveFrame;
+
+typedef struct PixelLiveView PixelLiveView;
+
+PixelLiveView *PixelLiveViewOpen(const char *name);
+bool PixelLiveViewAcquire(PixelLiveView *view, PixelLiveFrame *frame);
+bool PixelLiveViewIntact(const PixelLiveView *view, const PixelLiveFrame *frame);
+bool PixelLiveViewClosed(const PixelLiveView *view);
+void PixelLiveViewClose(PixelLiveView *view);
+
+#endif
@@ -0,0 +1,394 @@
+#include "pixel_palette.h"
+
+#include "pixel_palette_import.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static uint32_t HashName(const char *name) {
+  uint32_t hash = 2166136261u;  // FNV-1a
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) hash = (hash ^ *p) * 16777619u;
+  return hash;
+}
+
+static bool ValidPalette(const PixelPaletteRegistry *registry, int index) {
+  return registry && index >= 0 && index < registry->count;
+}
+
+// Double the bucket table and reinsert every palette.
+static bool GrowBuckets(PixelPaletteRegistry *registry) {
+  int bucketCount = registry->bucketCount > 0 ? registry->bucketCount * 2 : 64;
+  int *buckets = (int *)calloc((size_t)bucketCount, sizeof(int));
+  if (!buckets) return false;
+
+  for (int i = 0; i < registry->count; i++) {
+    uint32_t slot = HashName(registry->names[i]) & (uint32_t)(bucketCount - 1);
+    while (buckets[slot] != 0) slot = (slot + 1) & (uint32_t)(bucketCount - 1);
+    buckets[slot] = i + 1;
+  }
+  free(registry->buckets);
+  registry->buckets = buckets;
+  registry->bucketCount = bucketCount;
+  return true;
+}
+
+// Copy a name into the arena, rebasing existing name pointers if it moves.
+static const char *StoreName(PixelPaletteRegistry *registry, const char *name) {
+  size_t length = strlen(name) + 1;
+  if (registry->nameArenaSize + length > registry->nameArenaCapacity) {
+    size_t capacity = registry->nameArenaCapacity > 0 ? registry->nameArenaCapacity * 2 : 1024;
+    while (capacity < registry->nameArenaSize + length) capacity *= 2;
+    char *arena = (char *)realloc(registry->nameArena, capacity);
+    if (!arena) return NULL;
+    for (int i = 0; i < registry->count; i++) registry->names[i] = arena + (registry->names[i] - registry->nameArena);
+    registry->nameArena = arena;
+    registry->nameArenaCapacity = capacity;
+  }
+
+  char *stored = registry->nameArena + registry->nameArenaSize;
+  memcpy(stored, name, length);
+  registry->nameArenaSize += length;
+  return stored;
+}
+
+static bool ReserveColors(PixelPaletteRegistry *registry, size_t extra) {
+  if (registry->colorCount + extra <= registry->colorCapacity) return true;
+  size_t capacity = registry->colorCapacity > 0 ? registry->colorCapacity * 2 : 256;
+  while (capacity < registry->colorCount + extra) capacity *= 2;
+  PixelColor *colors = (PixelColor *)realloc(registry->colors, capacity * sizeof(PixelColor));
+  if (!colors) return false;
+  registry->colors = colors;
+  registry->colorCapacity = capacity;
+  return true;
+}
+
+// Register the colors already appended at colorOffset under name. A lazy
+// palette has no colors yet and remembers sourcePath to parse on demand.
+static int CommitPalette(PixelPaletteRegistry *registry, const char *name, size_t colorOffset, const char *sourcePath) {
+  int count = (int)(registry->colorCount - colorOffset);
+  if ((count <= 0 && !sourcePath) || PixelPaletteRegistryFind(registry, name) >= 0) {
+    registry->colorCount = colorOffset;
+    return -1;
+  }
+
+  if (registry->count == registry->capacity) {
+    int capacity = registry->capacity > 0 ? registry->capacity * 2 : 16;
+    PixelPaletteEntry *entries =
+        (PixelPaletteEntry *)realloc(registry->entries, (size_t)capacity * sizeof(PixelPaletteEntry));
+    if (entries) registry->entries = entries;
+    const char **names = (const char **)realloc(registry->names, (size_t)capacity * sizeof(const char *));
+    if (names) registry->names = names;
+    if (!entries || !names) {
+      registry->colorCount = colorOffset;
+      return -1;
+    }
+    registry->capacity = capacity;
+  }
+  if ((registry->count + 1) * 2 > registry->bucketCount && !GrowBuckets(registry)) {
+    registry->colorCount = colorOffset;
+    return -1;
+  }
+
+  size_t pathOffset = PIXEL_PALETTE_NO_PATH;
+  size_t arenaSize = registry->nameArenaSize;
+  if (sourcePath) {
+    const char *storedPath = StoreName(registry, sourcePath);
+    if (!storedPath) {
+      registry->colorCount = colorOffset;
+      return -1;
+    }
+    pathOffset = (size_t)(storedPath - registry->nameArena);
+  }
+  const char *stored = StoreName(registry, name);
+  if (!stored) {
+    registry->colorCount = colorOffset;
+    registry->nameArenaSize = arenaSize;  // Drop the path stored above
+    return -1;
+  }
+
+  int index = registry->count++;
+  registry->entries[index] = (PixelPaletteEntry){colorOffset, count, pathOffset, sourcePath == NULL};
+  registry->names[index] = stored;
+
+  uint32_t slot = HashName(name) & (uint32_t)(registry->bucketCount - 1);
+  while (registry->buckets[slot] != 0) slot = (slot + 1) & (uint32_t)(registry->bucketCount - 1);
+  registry->buckets[slot] = index + 1;
+  return index;
+}
+
+void PixelPaletteRegistryInit(PixelPaletteRegistry *registry) {
+  if (registry) *registry = (PixelPaletteRegistry){0};
+}
+
+// Release all palettes; the registry can be reused after another Init.
+void PixelPaletteRegistryFree(PixelPaletteRegistry *registry) {
+  if (!registry) return;
+  free(registry->entries);
+  free(registry->names);
+  free(registry->colors);
+  free(registry->nameArena);
+  free(registry->buckets);
+  *registry = (PixelPaletteRegistry){0};
+}
+
+// Append a palette and return its index, or -1 if empty, unnamed or already registered.
+int PixelPaletteRegistryAdd(PixelPaletteRegistry *registry, const char *name, const PixelColor *colors, int count) {
+  if (!registry || !name || name[0] == '\0' || !colors || count <= 0) return -1;
+  if (!ReserveColors(registry, (size_t)count)) return -1;
+
+  size_t offset = registry->colorCount;
+  memcpy(registry->colors + offset, colors, (size_t)count * sizeof(PixelColor));
+  registry->colorCount += (size_t)count;
+  return CommitPalette(registry, name, offset, NULL);
+}
+
+// Register a palette by name only; its colors are parsed from path when first needed.
+int PixelPaletteRegistryAddLazy(PixelPaletteRegistry *registry, const char *name, const char *path) {
+  if (!registry || !name || name[0] == '\0' || !path) return -1;
+  return CommitPalette(registry, name, registry->colorCount, path);
+}
+
+// Fill in the colors of a lazy palette; a no-op once it is loaded.
+bool PixelPaletteRegistrySetColors(PixelPaletteRegistry *registry, int index, const PixelColor *colors, int count) {
+  if (!ValidPalette(registry, index)) return false;
+  PixelPaletteEntry *entry = &registry->entries[index];
+  if (entry->loaded) return true;
+  if (!colors || count <= 0 || !ReserveColors(registry, (size_t)count)) return false;
+
+  memcpy(registry->colors + registry->colorCount, colors, (size_t)count * sizeof(PixelColor));
+  entry->colorOffset = registry->colorCount;
+  entry->colorCount = count;
+  entry->loaded = true;
+  registry->colorCount += (size_t)count;
+  return true;
+}
+
+// Parse a lazy palette's source file now if nothing has delivered its colors yet.
+bool PixelPaletteRegistryEnsureLoaded(PixelPaletteRegistry *registry, int index) {
+  if (!ValidPalette(registry, index)) return false;
+  PixelPaletteEntry *entry = &registry->entries[index];
+  if (entry->loaded) return true;
+
+  PixelColor *colors = NULL;
+  int count = 0;
+  bool ok = PixelPaletteParseFile(registry->nameArena + entry->pathOffset, &colors, &count) &&
+            PixelPaletteRegistrySetColors(registry, index, colors, count);
+  free(colors);
+  return ok;
+}
+
+bool PixelPaletteLoaded(const PixelPaletteRegistry *registry, int index) {
+  return ValidPalette(registry, index) && registry->entries[index].loaded;
+}
+
+// Return the index of the palette registered under name, or -1.
+int PixelPaletteRegistryFind(const PixelPaletteRegistry *registry, const char *name) {
+  if (!registry || !name || registry->bucketCount == 0) return -1;
+
+  uint32_t mask = (uint32_t)(registry->bucketCount - 1);
+  for (uint32_t slot = HashName(name) & mask; registry->buckets[slot] != 0; slot = (slot + 1) & mask) {
+    int index = registry->buckets[slot] - 1;
+    if (strcmp(registry->names[index], name) == 0) return index;
+  }
+  return -1;
+}
+
+// Colors of one palette, or NULL while it is still lazy; valid until the next add.
+const PixelColor *PixelPaletteColors(const PixelPaletteRegistry *registry, int index, int *count) {
+  if (!ValidPalette(registry, index)) {
+    if (count) *count = 0;
+    return NULL;
+  }
+  const PixelPaletteEntry *entry = &registry->entries[index];
+  if (count) *count = entry->loaded ? entry->colorCount : 0;
+  return entry->loaded ? registry->colors + entry->colorOffset : NULL;
+}
+
+const char *PixelPaletteName(const PixelPaletteRegistry *registry, int index) {
+  return ValidPalette(registry, index) ? registry->names[index] : NULL;
+}
+
+// All names in index order, suitable for list widgets; valid until the next add.
+const char *const *PixelPaletteRegistryNames(const PixelPaletteRegistry *registry) {
+  return registry ? registry->names : NULL;
+}
+
+// Palette name for a source file: its basename without extension. Swatch
+// images also drop a Lospec scale suffix ("pico-8-8x.png" -> "pico-8"), so
+// they share a name with the text file of the same palette.
+void PixelPaletteNameFromPath(const char *path, char *out, size_t outSize) {
+  if (!out || outSize == 0) return;
+  const char *base = path ? path : "";
+  for (const char *p = base; *p; p++) {
+    if (*p == '/' || *p == '\\') base = p + 1;
+  }
+  snprintf(out, outSize, "%s", base);
+  char *dot = strrchr(out, '.');
+  if (!dot || dot == out) return;
+  bool image = strcmp(dot, ".png") == 0 || strcmp(dot, ".PNG") == 0;
+  *dot = '\0';
+
+  char *end = dot;
+  if (image && end - out > 2 && end[-1] == 'x' && isdigit((unsigned char)end[-2])) {
+    char *p = end - 2;
+    while (p > out && isdigit((unsigned char)p[-1])) p--;
+    if (p > out + 1 && p[-1] == '-') p[-1] = '\0';
+  }
+}
+
+// Parse any importable palette file into a new array owned by the caller.
+// Touches no shared state, so it can run on any thread.
+bool PixelPaletteParseFile(const char *path, PixelColor **outColors, int *outCount) {
+  if (!path || !outColors || !outCount) return false;
+  *outColors = NULL;
+  *outCount = 0;
+
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return false;
+  long size = -1;
+  if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+  if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+    fclose(fp);
+    return false;
+  }
+  unsigned char *data = (unsigned char *)malloc(size > 0 ? (size_t)size : 1);
+  bool ok = data && fread(data, 1, (size_t)size, fp) == (size_t)size;
+  fclose(fp);
+
+  // Most palettes fit the stack buffer; larger ones are parsed again at full size.
+  PixelColor stackColors[256];
+  int count = ok ? PixelPaletteImport(path, data, (size_t)size, stackColors, 256) : -1;
+  PixelColor *colors = count > 0 ? (PixelColor *)malloc((size_t)count * sizeof(PixelColor)) : NULL;
+  if (colors && count <= 256) memcpy(colors, stackColors, (size_t)count * sizeof(PixelColor));
+  else if (colors) PixelPaletteImport(path, data, (size_t)size, colors, count);
+  free(data);
+
+  if (count < 0 || (count > 0 && !colors)) {
+    free(colors);
+    return false;
+  }
+  *outColors = colors;
+  *outCount = count;
+  return true;
+}
+
+// Load one palette file named after the file's basename.
+int PixelPaletteRegistryLoadFile(PixelPaletteRegistry *registry, const char *path) {
+  if (!registry || !path) return -1;
+
+  char name[PIXEL_PALETTE_NAME_MAX];
+  PixelPaletteNameFromPath(path, name, sizeof(name));
+
+  PixelColor *colors = NULL;
+  int count = 0;
+  if (!PixelPaletteParseFile(path, &colors, &count)) return -1;
+  int index = PixelPaletteRegistryAdd(registry, name, colors, count);
+  free(colors);
+  return index;
+}
+
+// Re-read a palette file after it changed on disk. A palette already registered
+// under its name takes the new colors (in place when they fit, otherwise
+// appended, leaving the old ones unused until Free); an unknown one is added.
+int PixelPaletteRegistryReloadFile(PixelPaletteRegistry *registry, const char *path) {
+  if (!registry || !path) return -1;
+
+  char name[PIXEL_PALETTE_NAME_MAX];
+  PixelPaletteNameFromPath(path, name, sizeof(name));
+  int index = PixelPaletteRegistryFind(registry, name);
+  if (index < 0) return PixelPaletteRegistryLoadFile(registry, path);
+
+  PixelColor *colors = NULL;
+  int count = 0;
+  if (!PixelPaletteParseFile(path, &colors, &count)) return -1;
+  PixelPaletteEntry *entry = &registry->entries[index];
+  if (entry->loaded && count <= entry->colorCount) {
+    memcpy(registry->colors + entry->colorOffset, colors, (size_t)count * sizeof(PixelColor));
+    entry->colorCount = count;
+  } else if (count > 0 && ReserveColors(registry, (size_t)count)) {
+    entry->loaded = false;
+    PixelPaletteRegistrySetColors(registry, index, colors, count);
+  } else {
+    index = -1;
+  }
+  free(colors);
+  return index;
+}
+
+static int CompareFiles(const void *a, const void *b) {
+  return strcmp(((const PixelPaletteFile *)a)->fileName, ((const PixelPaletteFile *)b)->fileName);
+}
+
+// List the importable palettes in dirPath sorted by file name, with their size and mtime.
+// Sorting keeps palette indices stable across runs and filesystems.
+int PixelPaletteListDir(const char *dirPath, PixelPaletteFile **outFiles) {
+  return PixelListDirFiles(dirPath, PixelPaletteHasImporter, outFiles);
+}
+
+// List the regular files in dirPath whose names pass accept, sorted by file name.
+int PixelListDirFiles(const char *dirPath, bool (*accept)(const char *fileName), PixelPaletteFile **outFiles) {
+  if (!dirPath || !accept || !outFiles) return 0;
+  *outFiles = NULL;
+
+  DIR *dir = opendir(dirPath);
+  if (!dir) return 0;
+
+  PixelPaletteFile *files = NULL;
+  int fileCount = 0, fileCapacity = 0;
+  size_t dirLength = strlen(dirPath);
+  struct dirent *item;
+  while ((item = readdir(dir)) != NULL) {
+    if (!accept(item->d_name)) continue;
+
+    size_t length = dirLength + strlen(item->d_name) + 2;
+    char *path = (char *)malloc(length);
+    if (!path) break;
+    snprintf(path, length, "%s/%s", dirPath, item->d_name);
+
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+      free(path);
+      continue;
+    }
+    if (fileCount == fileCapacity) {
+      int capacity = fileCapacity > 0 ? fileCapacity * 2 : 64;
+      PixelPaletteFile *grown = (PixelPaletteFile *)realloc(files, (size_t)capacity * sizeof(PixelPaletteFile));
+      if (!grown) {
+        free(path);
+        break;
+      }
+      files = grown;
+      fileCapacity = capacity;
+    }
+    files[fileCount++] = (PixelPaletteFile){path, path + dirLength + 1, (long long)info.st_mtime, (long long)info.st_size};
+  }
+  closedir(dir);
+
+  if (fileCount > 1) qsort(files, (size_t)fileCount, sizeof(PixelPaletteFile), CompareFiles);
+  *outFiles = files;
+  return fileCount;
+}
+
+void PixelPaletteFreeFileList(PixelPaletteFile *files, int count) {
+  for (int i = 0; files && i < count; i++) free(files[i].path);
+  free(files);
+}
+
+// Load every importable palette in dirPath in name order and return how many were added.
+int PixelPaletteRegistryLoadDir(PixelPaletteRegistry *registry, const char *dirPath) {
+  if (!registry || !dirPath) return 0;
+
+  PixelPaletteFile *files = NULL;
+  int fileCount = PixelPaletteListDir(dirPath, &files);
+  int added = 0;
+  for (int i = 0; i < fileCount; i++) {
+    if (PixelPaletteRegistryLoadFile(registry, files[i].path) >= 0) added++;
+  }
+  PixelPaletteFreeFileList(files, fileCount);
+  return added;
+}
@@ -0,0 +1,71 @@
+#ifndef PIXEL_PALETTE_H
+#define PIXEL_PALETTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_core.h"
+
+#define PIXEL_PALETTE_NAME_MAX 256
+
+#define PIXEL_PALETTE_NO_PATH ((size_t)-1)
+
+// Location of one palette inside the registry's shared arrays.
+typedef struct {
+  size_t colorOffset;
+  int colorCount;
+  size_t pathOffset;               // Source file in nameArena for lazy palettes
+  bool loaded;                     // False until the colors have been parsed
+} PixelPaletteEntry;
+
+// Growable palette list. Colors of every palette live back to back in one
+// array and names in one string arena, so a 5-color palette costs 5 colors.
+// Names are hashed for O(1) lookup; the first palette registered under a
+// name wins. Lazy palettes are listed by name before their colors exist.
+typedef struct {
+  PixelPaletteEntry *entries;
+  const char **names;              // Per-palette name pointers into nameArena
+  int count;
+  int capacity;
+
+  PixelColor *colors;
+  size_t colorCount;
+  size_t colorCapacity;
+
+  char *nameArena;
+  size_t nameArenaSize;
+  size_t nameArenaCapacity;
+
+  int *buckets;                    // Open addressing, palette index + 1, 0 = empty
+  int bucketCount;                 // Power of two, at least twice count
+} PixelPaletteRegistry;
+
+// Palette source file found by a directory scan.
+typedef struct {
+  char *path;
+  const char *fileName;            // Points into path
+  long long mtime;
+  long long size;
+} PixelPaletteFile;
+
+void PixelPaletteRegistryInit(PixelPaletteRegistry *registry);
+void PixelPaletteRegistryFree(PixelPaletteRegistry *registry);
+int PixelPaletteRegistryAdd(PixelPaletteRegistry *registry, const char *name, const PixelColor *colors, int count);
+int PixelPaletteRegistryAddLazy(PixelPaletteRegistry *registry, const char *name, const char *path);
+bool PixelPaletteRegistrySetColors(PixelPaletteRegistry *registry, int index, const PixelColor *colors, int count);
+bool PixelPaletteRegistryEnsureLoaded(PixelPaletteRegistry *registry, int index);
+bool PixelPaletteLoaded(const PixelPaletteRegistry *registry, int index);
+int PixelPaletteRegistryFind(const PixelPaletteRegistry *registry, const char *name);
+const PixelColor *PixelPaletteColors(const PixelPaletteRegistry *registry, int index, int *count);
+const char *PixelPaletteName(const PixelPaletteRegistry *registry, int index);
+const char *const *PixelPaletteRegistryNames(const PixelPaletteRegistry *registry);
+void PixelPaletteNameFromPath(const char *path, char *out, size_t outSize);
+bool PixelPaletteParseFile(const char *path, PixelColor **outColors, int *outCount);
+int PixelPaletteRegistryLoadFile(PixelPaletteRegistry *registry, const char *path);
+int PixelPaletteRegistryReloadFile(PixelPaletteRegistry *registry, const char *path);
+int PixelPaletteRegistryLoadDir(PixelPaletteRegistry *registry, const char *dirPath);
+int PixelPaletteListDir(const char *dirPath, PixelPaletteFile **outFiles);
+int PixelListDirFiles(const char *dirPath, bool (*accept)(const char *fileName), PixelPaletteFile **outFiles);
+void PixelPaletteFreeFileList(PixelPaletteFile *files, int count);
+
+#endif
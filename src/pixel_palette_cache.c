@@ -0,0 +1,230 @@
+#include "pixel_palette_cache.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cache blob layout, native endianness (the cache never leaves the machine):
+//   CacheHeader
+//   CacheEntry[fileCount]       sorted by file name
+//   PixelColor[colorCount]      every palette back to back
+//   char[stringBytes]           source directory, then NUL-terminated file names
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t fileCount;
+  uint32_t colorCount;
+  uint32_t stringBytes;
+  uint32_t reserved;
+} CacheHeader;
+
+typedef struct {
+  int64_t mtime;
+  int64_t size;
+  uint32_t nameOffset;
+  uint32_t colorOffset;
+  uint32_t colorCount;             // 0 for files without any colors
+  uint32_t reserved;
+} CacheEntry;
+
+struct PixelPaletteCache {
+  unsigned char *blob;
+  const CacheEntry *entries;
+  const PixelColor *colors;
+  const char *strings;
+  uint32_t fileCount;
+};
+
+static const char kCacheMagic[4] = {'P', 'X', 'P', 'C'};
+
+// Read the whole cache in one call and check that every offset stays inside it.
+// Returns NULL when the cache is missing, corrupt or built for another directory.
+PixelPaletteCache *PixelPaletteCacheOpen(const char *cachePath, const char *dirPath) {
+  if (!cachePath || !dirPath) return NULL;
+  FILE *fp = fopen(cachePath, "rb");
+  if (!fp) return NULL;
+
+  long size = -1;
+  if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+  if (size < (long)sizeof(CacheHeader) || fseek(fp, 0, SEEK_SET) != 0) {
+    fclose(fp);
+    return NULL;
+  }
+  unsigned char *blob = (unsigned char *)malloc((size_t)size);
+  bool ok = blob && fread(blob, 1, (size_t)size, fp) == (size_t)size;
+  fclose(fp);
+
+  const CacheHeader *header = (const CacheHeader *)blob;
+  ok = ok && memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) == 0 &&
+       header->version == PIXEL_PALETTE_CACHE_VERSION &&
+       sizeof(CacheHeader) + (uint64_t)header->fileCount * sizeof(CacheEntry) +
+               (uint64_t)header->colorCount * sizeof(PixelColor) + header->stringBytes ==
+           (uint64_t)size &&
+       header->stringBytes > 0;
+  PixelPaletteCache *view = ok ? (PixelPaletteCache *)malloc(sizeof(PixelPaletteCache)) : NULL;
+  ok = ok && view;
+  if (ok) {
+    view->blob = blob;
+    view->entries = (const CacheEntry *)(blob + sizeof(CacheHeader));
+    view->colors = (const PixelColor *)(view->entries + header->fileCount);
+    view->strings = (const char *)(view->colors + header->colorCount);
+    view->fileCount = header->fileCount;
+    ok = view->strings[header->stringBytes - 1] == '\0' && strcmp(view->strings, dirPath) == 0;
+    for (uint32_t i = 0; ok && i < header->fileCount; i++) {
+      const CacheEntry *entry = &view->entries[i];
+      ok = entry->nameOffset < header->stringBytes &&
+           (uint64_t)entry->colorOffset + entry->colorCount <= header->colorCount;
+    }
+  }
+  if (!ok) {
+    free(blob);
+    free(view);
+    return NULL;
+  }
+  return view;
+}
+
+void PixelPaletteCacheClose(PixelPaletteCache *cache) {
+  if (!cache) return;
+  free(cache->blob);
+  free(cache);
+}
+
+int PixelPaletteCacheFileCount(const PixelPaletteCache *cache) {
+  return cache ? (int)cache->fileCount : 0;
+}
+
+static const CacheEntry *FindCacheEntry(const PixelPaletteCache *view, const char *fileName) {
+  uint32_t lo = 0, hi = view->fileCount;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    int order = strcmp(view->strings + view->entries[mid].nameOffset, fileName);
+    if (order == 0) return &view->entries[mid];
+    if (order < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return NULL;
+}
+
+// Colors cached for file, if the entry's mtime and size still match it.
+bool PixelPaletteCacheLookup(const PixelPaletteCache *cache, const PixelPaletteFile *file, const PixelColor **colors,
+                             int *count) {
+  const CacheEntry *entry = (cache && file) ? FindCacheEntry(cache, file->fileName) : NULL;
+  if (!entry || entry->mtime != file->mtime || entry->size != file->size) return false;
+  *colors = cache->colors + entry->colorOffset;
+  *count = (int)entry->colorCount;
+  return true;
+}
+
+// Serialize one color list per file (count 0 for empty files) and swap the
+// cache in with a rename. files must be sorted as PixelPaletteListDir returns them.
+bool PixelPaletteCacheWrite(const char *cachePath, const char *dirPath, const PixelPaletteFile *files, int fileCount,
+                            const PixelColor *const *fileColors, const int *fileColorCounts) {
+  if (!cachePath || !dirPath || fileCount < 0) return false;
+  CacheHeader header = {{'P', 'X', 'P', 'C'}, PIXEL_PALETTE_CACHE_VERSION, (uint32_t)fileCount, 0, 0, 0};
+  header.stringBytes = (uint32_t)strlen(dirPath) + 1;
+  for (int i = 0; i < fileCount; i++) {
+    header.colorCount += (uint32_t)fileColorCounts[i];
+    header.stringBytes += (uint32_t)strlen(files[i].fileName) + 1;
+  }
+
+  size_t size = sizeof(CacheHeader) + (size_t)fileCount * sizeof(CacheEntry) +
+                (size_t)header.colorCount * sizeof(PixelColor) + header.stringBytes;
+  unsigned char *blob = (unsigned char *)malloc(size);
+  if (!blob) return false;
+
+  CacheEntry *entries = (CacheEntry *)(blob + sizeof(CacheHeader));
+  PixelColor *colors = (PixelColor *)(entries + fileCount);
+  char *strings = (char *)(colors + header.colorCount);
+  memcpy(blob, &header, sizeof(header));
+
+  size_t stringOffset = strlen(dirPath) + 1;
+  memcpy(strings, dirPath, stringOffset);
+  uint32_t colorOffset = 0;
+  for (int i = 0; i < fileCount; i++) {
+    int count = fileColorCounts[i];
+    const PixelColor *source = fileColors[i];
+    size_t nameLength = strlen(files[i].fileName) + 1;
+    entries[i] = (CacheEntry){files[i].mtime, files[i].size, (uint32_t)stringOffset, colorOffset, (uint32_t)count, 0};
+    if (count > 0) memcpy(colors + colorOffset, source, (size_t)count * sizeof(PixelColor));
+    memcpy(strings + stringOffset, files[i].fileName, nameLength);
+    colorOffset += (uint32_t)count;
+    stringOffset += nameLength;
+  }
+
+  // A crash mid-write leaves the previous cache intact.
+  char tempPath[1024];
+  int written = snprintf(tempPath, sizeof(tempPath), "%s.tmp", cachePath);
+  bool ok = written > 0 && (size_t)written < sizeof(tempPath);
+  FILE *fp = ok ? fopen(tempPath, "wb") : NULL;
+  if (fp) {
+    ok = fwrite(blob, 1, size, fp) == size;
+    ok = (fclose(fp) == 0) && ok;
+#if defined(_WIN32)
+    if (ok) remove(cachePath);
+#endif
+    ok = ok && rename(tempPath, cachePath) == 0;
+    if (!ok) remove(tempPath);
+  } else {
+    ok = false;
+  }
+  free(blob);
+  return ok;
+}
+
+// Load every palette in dirPath, taking unchanged files (same mtime and size)
+// from the cache blob and parsing only new or modified ones. The cache is
+// rewritten whenever the directory no longer matches it. Returns palettes added.
+int PixelPaletteRegistryLoadDirCached(PixelPaletteRegistry *registry, const char *dirPath, const char *cachePath,
+                                      PixelPaletteCacheStats *stats) {
+  PixelPaletteCacheStats local = {0};
+  if (!stats) stats = &local;
+  *stats = (PixelPaletteCacheStats){0};
+  if (!registry || !dirPath) return 0;
+  if (!cachePath) return PixelPaletteRegistryLoadDir(registry, dirPath);
+
+  PixelPaletteFile *files = NULL;
+  int fileCount = PixelPaletteListDir(dirPath, &files);
+  int *paletteIndex = (int *)malloc((size_t)(fileCount > 0 ? fileCount : 1) * sizeof(int));
+  if (!paletteIndex) {
+    PixelPaletteFreeFileList(files, fileCount);
+    return 0;
+  }
+
+  PixelPaletteCache *cache = PixelPaletteCacheOpen(cachePath, dirPath);
+  int added = 0;
+  for (int i = 0; i < fileCount; i++) {
+    const PixelColor *cached = NULL;
+    int cachedCount = 0;
+    if (PixelPaletteCacheLookup(cache, &files[i], &cached, &cachedCount)) {
+      char name[PIXEL_PALETTE_NAME_MAX];
+      PixelPaletteNameFromPath(files[i].fileName, name, sizeof(name));
+      paletteIndex[i] = PixelPaletteRegistryAdd(registry, name, cached, cachedCount);
+      stats->cachedCount++;
+    } else {
+      paletteIndex[i] = PixelPaletteRegistryLoadFile(registry, files[i].path);
+      stats->parsedCount++;
+    }
+    if (paletteIndex[i] >= 0) added++;
+  }
+  stats->fileCount = fileCount;
+
+  // Deleted files leave stale entries behind even when nothing was parsed.
+  bool stale = !cache || stats->parsedCount > 0 || PixelPaletteCacheFileCount(cache) != fileCount;
+  PixelPaletteCacheClose(cache);
+  if (stale) {
+    const PixelColor **fileColors = (const PixelColor **)malloc((size_t)(fileCount > 0 ? fileCount : 1) * sizeof(*fileColors));
+    int *fileColorCounts = (int *)malloc((size_t)(fileCount > 0 ? fileCount : 1) * sizeof(int));
+    if (fileColors && fileColorCounts) {
+      for (int i = 0; i < fileCount; i++) fileColors[i] = PixelPaletteColors(registry, paletteIndex[i], &fileColorCounts[i]);
+      stats->cacheWritten = PixelPaletteCacheWrite(cachePath, dirPath, files, fileCount, fileColors, fileColorCounts);
+    }
+    free(fileColors);
+    free(fileColorCounts);
+  }
+
+  free(paletteIndex);
+  PixelPaletteFreeFileList(files, fileCount);
+  return added;
+}
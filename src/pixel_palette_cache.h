@@ -0,0 +1,31 @@
+#ifndef PIXEL_PALETTE_CACHE_H
+#define PIXEL_PALETTE_CACHE_H
+
+#include <stdbool.h>
+
+#include "pixel_palette.h"
+
+#define PIXEL_PALETTE_CACHE_VERSION 1
+
+// What a cached directory load did, for logging and tests.
+typedef struct {
+  int fileCount;                   // Palette files found in the directory
+  int cachedCount;                 // Files served from the cache blob
+  int parsedCount;                 // Files re-parsed because they were new or changed
+  bool cacheWritten;               // Cache was rewritten to match the directory
+} PixelPaletteCacheStats;
+
+// Validated, read-only view of a cache blob.
+typedef struct PixelPaletteCache PixelPaletteCache;
+
+PixelPaletteCache *PixelPaletteCacheOpen(const char *cachePath, const char *dirPath);
+void PixelPaletteCacheClose(PixelPaletteCache *cache);
+int PixelPaletteCacheFileCount(const PixelPaletteCache *cache);
+bool PixelPaletteCacheLookup(const PixelPaletteCache *cache, const PixelPaletteFile *file, const PixelColor **colors,
+                             int *count);
+bool PixelPaletteCacheWrite(const char *cachePath, const char *dirPath, const PixelPaletteFile *files, int fileCount,
+                            const PixelColor *const *fileColors, const int *fileColorCounts);
+int PixelPaletteRegistryLoadDirCached(PixelPaletteRegistry *registry, const char *dirPath, const char *cachePath,
+                                      PixelPaletteCacheStats *stats);
+
+#endif
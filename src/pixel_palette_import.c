@@ -0,0 +1,281 @@
+#include "pixel_palette_import.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// Forward-only cursor over one text line at a time.
+typedef struct {
+  const unsigned char *data;
+  size_t size;
+  size_t pos;
+} TextCursor;
+
+// Return the next line without its terminator, or false at the end.
+static bool NextLine(TextCursor *cursor, const unsigned char **line, size_t *length) {
+  if (cursor->pos >= cursor->size) return false;
+  size_t start = cursor->pos;
+  while (cursor->pos < cursor->size && cursor->data[cursor->pos] != '\n') cursor->pos++;
+  size_t end = cursor->pos;
+  if (cursor->pos < cursor->size) cursor->pos++;
+  if (end > start && cursor->data[end - 1] == '\r') end--;
+  while (start < end && isspace(cursor->data[start])) start++;
+  *line = cursor->data + start;
+  *length = end - start;
+  return true;
+}
+
+static int HexDigit(unsigned char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = (unsigned char)tolower(c);
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Read digitCount hex digits as one value; fails on any non-hex digit.
+static bool ParseHex(const unsigned char *text, size_t length, int digitCount, unsigned int *value) {
+  if (length < (size_t)digitCount) return false;
+  unsigned int result = 0;
+  for (int i = 0; i < digitCount; i++) {
+    int digit = HexDigit(text[i]);
+    if (digit < 0) return false;
+    result = result << 4 | (unsigned int)digit;
+  }
+  *value = result;
+  return true;
+}
+
+// Read up to count whitespace-separated decimal bytes from a line.
+static bool ParseDecimalBytes(const unsigned char *text, size_t length, int count, unsigned char *values) {
+  size_t pos = 0;
+  for (int i = 0; i < count; i++) {
+    while (pos < length && isspace(text[pos])) pos++;
+    if (pos >= length || !isdigit(text[pos])) return false;
+    unsigned int value = 0;
+    while (pos < length && isdigit(text[pos])) {
+      value = value * 10 + (unsigned int)(text[pos++] - '0');
+      if (value > 255) return false;
+    }
+    values[i] = (unsigned char)value;
+  }
+  return true;
+}
+
+static bool StartsWith(const unsigned char *data, size_t size, const char *prefix) {
+  size_t length = strlen(prefix);
+  return size >= length && memcmp(data, prefix, length) == 0;
+}
+
+static void Emit(PixelColor *out, int capacity, int *count, PixelColor color) {
+  if (*count < capacity) out[*count] = color;
+  (*count)++;
+}
+
+// Paint.NET: ';' comments and one AARRGGBB hex value per line.
+static int ParsePaintNet(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  TextCursor cursor = {data, size, 0};
+  const unsigned char *line;
+  size_t length;
+  int count = 0;
+  while (NextLine(&cursor, &line, &length)) {
+    unsigned int argb;
+    if (length == 0 || line[0] == ';' || !ParseHex(line, length, 8, &argb)) continue;
+    Emit(out, capacity, &count,
+         (PixelColor){(unsigned char)(argb >> 16), (unsigned char)(argb >> 8), (unsigned char)argb,
+                      (unsigned char)(argb >> 24)});
+  }
+  return count;
+}
+
+// Lospec HEX: one RRGGBB value per line, optionally prefixed with '#'.
+static int ParseHexList(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  TextCursor cursor = {data, size, 0};
+  const unsigned char *line;
+  size_t length;
+  int count = 0;
+  while (NextLine(&cursor, &line, &length)) {
+    if (length > 0 && line[0] == '#') {
+      line++;
+      length--;
+    }
+    unsigned int rgb;
+    if (!ParseHex(line, length, 6, &rgb)) continue;
+    Emit(out, capacity, &count, (PixelColor){(unsigned char)(rgb >> 16), (unsigned char)(rgb >> 8), (unsigned char)rgb, 255});
+  }
+  return count;
+}
+
+static bool DetectGimp(const unsigned char *data, size_t size) {
+  return StartsWith(data, size, "GIMP Palette");
+}
+
+// GIMP: magic line, optional Name:/Columns: headers and '#' comments, then "R G B [name]".
+static int ParseGimp(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  TextCursor cursor = {data, size, 0};
+  const unsigned char *line;
+  size_t length;
+  if (!NextLine(&cursor, &line, &length)) return -1;
+
+  int count = 0;
+  while (NextLine(&cursor, &line, &length)) {
+    unsigned char rgb[3];
+    if (length == 0 || line[0] == '#' || !ParseDecimalBytes(line, length, 3, rgb)) continue;
+    Emit(out, capacity, &count, (PixelColor){rgb[0], rgb[1], rgb[2], 255});
+  }
+  return count;
+}
+
+static bool DetectJasc(const unsigned char *data, size_t size) {
+  return StartsWith(data, size, "JASC-PAL");
+}
+
+// JASC-PAL: magic, version, declared color count, then "R G B" lines.
+static int ParseJasc(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  TextCursor cursor = {data, size, 0};
+  const unsigned char *line;
+  size_t length;
+  if (!NextLine(&cursor, &line, &length) || !NextLine(&cursor, &line, &length)) return -1;
+  if (!NextLine(&cursor, &line, &length)) return -1;
+
+  int declared = 0;
+  for (size_t i = 0; i < length && isdigit(line[i]) && declared <= 65536; i++) declared = declared * 10 + (line[i] - '0');
+  int count = 0;
+  while (count < declared && NextLine(&cursor, &line, &length)) {
+    unsigned char rgb[3];
+    if (!ParseDecimalBytes(line, length, 3, rgb)) continue;
+    Emit(out, capacity, &count, (PixelColor){rgb[0], rgb[1], rgb[2], 255});
+  }
+  return count;
+}
+
+// Adobe Color Table: 256 RGB triples, optionally followed by a big-endian
+// used-color count and transparent index.
+static int ParseAct(const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  if (size != 768 && size != 772) return -1;
+  int declared = 256;
+  if (size == 772) {
+    declared = data[768] << 8 | data[769];
+    if (declared <= 0 || declared > 256) declared = 256;
+  }
+  int count = 0;
+  for (int i = 0; i < declared; i++) {
+    Emit(out, capacity, &count, (PixelColor){data[i * 3], data[i * 3 + 1], data[i * 3 + 2], 255});
+  }
+  return count;
+}
+
+static const PixelPaletteImporter kBuiltinImporters[] = {
+    {"GIMP Palette", ".gpl", DetectGimp, ParseGimp},
+    {"JASC-PAL", ".pal", DetectJasc, ParseJasc},
+    {"Paint.NET", ".txt", NULL, ParsePaintNet},
+    {"HEX", ".hex", NULL, ParseHexList},
+    {"Adobe Color Table", ".act", NULL, ParseAct},
+};
+
+static PixelPaletteImporter registeredImporters[PIXEL_PALETTE_MAX_IMPORTERS];
+static int registeredImporterCount = 0;
+
+// Add an importer (e.g. one backed by an image decoder). Register before any
+// palette loading starts; lookups from loader threads are not synchronized.
+bool PixelPaletteRegisterImporter(const PixelPaletteImporter *importer) {
+  if (!importer || !importer->parse || !importer->extensions) return false;
+  if (registeredImporterCount == PIXEL_PALETTE_MAX_IMPORTERS) return false;
+  registeredImporters[registeredImporterCount++] = *importer;
+  return true;
+}
+
+static int ImporterCount(void) {
+  return (int)(sizeof(kBuiltinImporters) / sizeof(kBuiltinImporters[0])) + registeredImporterCount;
+}
+
+static const PixelPaletteImporter *ImporterAt(int index) {
+  int builtinCount = (int)(sizeof(kBuiltinImporters) / sizeof(kBuiltinImporters[0]));
+  return index < builtinCount ? &kBuiltinImporters[index] : &registeredImporters[index - builtinCount];
+}
+
+// Case-insensitive match of the path's extension against a space-separated list.
+static bool MatchesExtension(const char *path, const char *extensions) {
+  const char *dot = path ? strrchr(path, '.') : NULL;
+  if (!dot || strchr(dot, '/') || strchr(dot, '\\')) return false;
+  size_t length = strlen(dot);
+
+  for (const char *p = extensions; *p;) {
+    while (*p == ' ') p++;
+    size_t itemLength = strcspn(p, " ");
+    if (itemLength == length) {
+      size_t i = 0;
+      while (i < length && tolower((unsigned char)dot[i]) == (unsigned char)p[i]) i++;
+      if (i == length) return true;
+    }
+    p += itemLength;
+  }
+  return false;
+}
+
+// Magic bytes win over the extension, so a GIMP palette saved as .txt still imports.
+const PixelPaletteImporter *PixelPaletteFindImporter(const char *path, const unsigned char *data, size_t size) {
+  for (int i = 0; data && i < ImporterCount(); i++) {
+    const PixelPaletteImporter *importer = ImporterAt(i);
+    if (importer->detect && importer->detect(data, size)) return importer;
+  }
+  for (int i = 0; i < ImporterCount(); i++) {
+    const PixelPaletteImporter *importer = ImporterAt(i);
+    if (!importer->detect && MatchesExtension(path, importer->extensions)) return importer;
+  }
+  return NULL;
+}
+
+// True if some importer claims the path's extension; used to filter directory scans.
+bool PixelPaletteHasImporter(const char *path) {
+  for (int i = 0; i < ImporterCount(); i++) {
+    if (MatchesExtension(path, ImporterAt(i)->extensions)) return true;
+  }
+  return false;
+}
+
+// Detect the format and parse; same contract as PixelPaletteParseFn.
+int PixelPaletteImport(const char *path, const unsigned char *data, size_t size, PixelColor *out, int capacity) {
+  if (!data || capacity < 0 || (capacity > 0 && !out)) return -1;
+  const PixelPaletteImporter *importer = PixelPaletteFindImporter(path, data, size);
+  return importer ? importer->parse(data, size, out, capacity) : -1;
+}
+
+// Smallest run of equal pixels along the first row and column: the cell size
+// unless every cell repeats its neighbor.
+static int SwatchCellSize(const PixelColor *pixels, int width, int height) {
+  int cell = width < height ? width : height;
+  int run = 1;
+  for (int x = 1; x <= width; x++) {
+    if (x < width && PixelColorEqual(pixels[x], pixels[x - 1])) {
+      run++;
+      continue;
+    }
+    if (run < cell) cell = run;
+    run = 1;
+  }
+  run = 1;
+  for (int y = 1; y <= height; y++) {
+    if (y < height && PixelColorEqual(pixels[(size_t)y * width], pixels[(size_t)(y - 1) * width])) {
+      run++;
+      continue;
+    }
+    if (run < cell) cell = run;
+    run = 1;
+  }
+  while (cell > 1 && (width % cell != 0 || height % cell != 0)) cell--;
+  return cell;
+}
+
+// Read a swatch image (Lospec 1x/8x strips or grids) by sampling the center
+// pixel of each cell in row-major order. Fully transparent cells are padding.
+int PixelPaletteFromSwatchImage(const PixelColor *pixels, int width, int height, PixelColor *out, int capacity) {
+  if (!pixels || width <= 0 || height <= 0) return -1;
+  int cell = SwatchCellSize(pixels, width, height);
+  int count = 0;
+  for (int y = cell / 2; y < height; y += cell) {
+    for (int x = cell / 2; x < width; x += cell) {
+      PixelColor color = pixels[(size_t)y * width + x];
+      if (color.a != 0) Emit(out, capacity, &count, color);
+    }
+  }
+  return count;
+}
@@ -0,0 +1,34 @@
+#ifndef PIXEL_PALETTE_IMPORT_H
+#define PIXEL_PALETTE_IMPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_core.h"
+
+#define PIXEL_PALETTE_MAX_IMPORTERS 16
+
+// Returns true if data starts with this format's magic bytes.
+typedef bool (*PixelPaletteDetectFn)(const unsigned char *data, size_t size);
+
+// Single pass over data without allocating. Writes at most capacity colors
+// to out and returns how many the file holds (so a larger buffer can be
+// retried), or -1 if data is not valid for this format.
+typedef int (*PixelPaletteParseFn)(const unsigned char *data, size_t size, PixelColor *out, int capacity);
+
+// One palette file format. Formats with magic bytes are chosen by content
+// first; formats without are chosen by extension.
+typedef struct {
+  const char *name;
+  const char *extensions;          // Space-separated, lowercase, e.g. ".pal .jasc"
+  PixelPaletteDetectFn detect;     // NULL if the format has no magic bytes
+  PixelPaletteParseFn parse;
+} PixelPaletteImporter;
+
+bool PixelPaletteRegisterImporter(const PixelPaletteImporter *importer);
+const PixelPaletteImporter *PixelPaletteFindImporter(const char *path, const unsigned char *data, size_t size);
+bool PixelPaletteHasImporter(const char *path);
+int PixelPaletteImport(const char *path, const unsigned char *data, size_t size, PixelColor *out, int capacity);
+int PixelPaletteFromSwatchImage(const PixelColor *pixels, int width, int height, PixelColor *out, int capacity);
+
+#endif
@@ -0,0 +1,106 @@
+#include "pixel_palette_layout.h"
+
+#include <stddef.h>
+
+static int FloorToInt(float value) {
+  int truncated = (int)value;
+  return (value < (float)truncated) ? truncated - 1 : truncated;
+}
+
+void PixelPaletteLayoutInit(PixelPaletteLayout *layout, PixelLayoutRect bounds, float cellSize, float columnGap) {
+  if (!layout) return;
+  *layout = (PixelPaletteLayout){0};
+  layout->bounds = bounds;
+  layout->cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+  layout->columnGap = columnGap > 0.0f ? columnGap : 0.0f;
+  layout->rows = FloorToInt(bounds.height / layout->cellSize);
+  if (layout->rows < 1) layout->rows = 1;
+  // The last visible column needs no gap after it
+  layout->visibleColumns = FloorToInt((bounds.width + layout->columnGap) / (layout->cellSize + layout->columnGap));
+  if (layout->visibleColumns < 1) layout->visibleColumns = 1;
+}
+
+// Columns needed for the whole palette.
+int PixelPaletteLayoutColumns(const PixelPaletteLayout *layout) {
+  if (!layout || layout->count <= 0) return 0;
+  return (layout->count + layout->rows - 1) / layout->rows;
+}
+
+int PixelPaletteLayoutMaxScroll(const PixelPaletteLayout *layout) {
+  int extra = PixelPaletteLayoutColumns(layout) - (layout ? layout->visibleColumns : 0);
+  return extra > 0 ? extra : 0;
+}
+
+// Change the palette size (e.g. on a palette switch), keeping the scroll in range.
+void PixelPaletteLayoutSetCount(PixelPaletteLayout *layout, int count) {
+  if (!layout) return;
+  layout->count = count > 0 ? count : 0;
+  int maxScroll = PixelPaletteLayoutMaxScroll(layout);
+  if (layout->scrollColumn > maxScroll) layout->scrollColumn = maxScroll;
+}
+
+// Scroll by whole columns; returns true if the visible swatches changed.
+bool PixelPaletteLayoutScroll(PixelPaletteLayout *layout, int columns) {
+  if (!layout) return false;
+  int scroll = layout->scrollColumn + columns;
+  int maxScroll = PixelPaletteLayoutMaxScroll(layout);
+  if (scroll > maxScroll) scroll = maxScroll;
+  if (scroll < 0) scroll = 0;
+  bool changed = scroll != layout->scrollColumn;
+  layout->scrollColumn = scroll;
+  return changed;
+}
+
+// Scroll just enough to bring a swatch into view.
+void PixelPaletteLayoutScrollTo(PixelPaletteLayout *layout, int index) {
+  if (!layout || index < 0 || index >= layout->count) return;
+  int column = index / layout->rows;
+  if (column < layout->scrollColumn) layout->scrollColumn = column;
+  else if (column >= layout->scrollColumn + layout->visibleColumns) {
+    layout->scrollColumn = column - layout->visibleColumns + 1;
+  }
+}
+
+// Swatch index under a screen point, or -1 over gaps, empty cells and
+// anything outside the panel. One division per axis.
+int PixelPaletteLayoutHitTest(const PixelPaletteLayout *layout, float px, float py) {
+  if (!layout) return -1;
+  float dx = px - layout->bounds.x;
+  float dy = py - layout->bounds.y;
+  if (dx < 0.0f || dy < 0.0f) return -1;
+
+  float pitch = layout->cellSize + layout->columnGap;
+  int column = FloorToInt(dx / pitch);
+  int row = FloorToInt(dy / layout->cellSize);
+  if (column >= layout->visibleColumns || row >= layout->rows) return -1;
+  if (dx - (float)column * pitch >= layout->cellSize) return -1;
+
+  int index = (layout->scrollColumn + column) * layout->rows + row;
+  return index < layout->count ? index : -1;
+}
+
+// Screen rectangle of a swatch; false if it is scrolled out of view.
+bool PixelPaletteLayoutCellRect(const PixelPaletteLayout *layout, int index, PixelLayoutRect *rect) {
+  if (!layout || index < 0 || index >= layout->count) return false;
+  int column = index / layout->rows - layout->scrollColumn;
+  int row = index % layout->rows;
+  if (column < 0 || column >= layout->visibleColumns) return false;
+  if (rect) {
+    *rect = (PixelLayoutRect){layout->bounds.x + (float)column * (layout->cellSize + layout->columnGap),
+                              layout->bounds.y + (float)row * layout->cellSize, layout->cellSize, layout->cellSize};
+  }
+  return true;
+}
+
+// Indices [first, end) of the swatches currently in view.
+void PixelPaletteLayoutVisibleRange(const PixelPaletteLayout *layout, int *first, int *end) {
+  int start = 0, stop = 0;
+  if (layout) {
+    start = layout->scrollColumn * layout->rows;
+    stop = start + layout->visibleColumns * layout->rows;
+    if (stop > layout->count) stop = layout->count;
+    if (start > stop) start = stop;
+  }
+  if (first) *first = start;
+  if (end) *end = stop;
+}
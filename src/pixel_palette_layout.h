@@ -0,0 +1,36 @@
+#ifndef PIXEL_PALETTE_LAYOUT_H
+#define PIXEL_PALETTE_LAYOUT_H
+
+#include <stdbool.h>
+
+typedef struct {
+  float x;
+  float y;
+  float width;
+  float height;
+} PixelLayoutRect;
+
+// Swatch panel geometry. Swatches fill columns top to bottom, columns run
+// left to right, and the panel scrolls horizontally one column at a time.
+// Every query is plain arithmetic, independent of the palette size.
+typedef struct {
+  PixelLayoutRect bounds;          // Visible panel area on screen
+  float cellSize;                  // Square swatch size, including its padding
+  float columnGap;                 // Space between columns
+  int rows;                        // Swatches per column
+  int visibleColumns;              // Whole columns that fit in bounds
+  int count;                       // Swatches in the palette
+  int scrollColumn;                // First visible column
+} PixelPaletteLayout;
+
+void PixelPaletteLayoutInit(PixelPaletteLayout *layout, PixelLayoutRect bounds, float cellSize, float columnGap);
+void PixelPaletteLayoutSetCount(PixelPaletteLayout *layout, int count);
+int PixelPaletteLayoutColumns(const PixelPaletteLayout *layout);
+int PixelPaletteLayoutMaxScroll(const PixelPaletteLayout *layout);
+bool PixelPaletteLayoutScroll(PixelPaletteLayout *layout, int columns);
+void PixelPaletteLayoutScrollTo(PixelPaletteLayout *layout, int index);
+int PixelPaletteLayoutHitTest(const PixelPaletteLayout *layout, float px, float py);
+bool PixelPaletteLayoutCellRect(const PixelPaletteLayout *layout, int index, PixelLayoutRect *rect);
+void PixelPaletteLayoutVisibleRange(const PixelPaletteLayout *layout, int *first, int *end);
+
+#endif
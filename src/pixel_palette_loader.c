@@ -0,0 +1,221 @@
+#include "pixel_palette_loader.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixel_jobs.h"
+#include "pixel_palette_cache.h"
+
+typedef struct {
+  const PixelColor *colors;        // Points into the cache blob or parsedColors
+  int count;
+  PixelColor *parsedColors;        // Owned, for files parsed by the loader
+  int paletteIndex;                // Registry index, written by the UI thread only
+} LoaderRecord;
+
+struct PixelPaletteLoader {
+  char *dirPath;
+  char *cachePath;
+  int workerCount;
+  pthread_t thread;
+  bool threadStarted;
+
+  // Written by the loader thread before namesReady is set, read-only afterwards.
+  PixelPaletteFile *files;
+  int fileCount;
+  LoaderRecord *records;
+  PixelPaletteCache *cache;
+
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  bool namesReady;
+  bool namesTaken;                 // UI thread has listed every palette
+  bool finished;
+  bool cancel;
+  int *ready;                      // Records parsed since the last drain
+  int readyCount;
+};
+
+static char *CopyString(const char *text) {
+  if (!text) return NULL;
+  size_t length = strlen(text) + 1;
+  char *copy = (char *)malloc(length);
+  if (copy) memcpy(copy, text, length);
+  return copy;
+}
+
+static void ParseJob(void *user, int item) {
+  PixelPaletteLoader *loader = (PixelPaletteLoader *)user;
+  pthread_mutex_lock(&loader->lock);
+  bool cancel = loader->cancel;
+  pthread_mutex_unlock(&loader->lock);
+  if (cancel) return;
+
+  LoaderRecord *record = &loader->records[item];
+  PixelColor *colors = NULL;
+  int count = 0;
+  PixelPaletteParseFile(loader->files[item].path, &colors, &count);
+
+  pthread_mutex_lock(&loader->lock);
+  record->parsedColors = colors;
+  record->colors = colors;
+  record->count = count;
+  loader->ready[loader->readyCount++] = item;
+  pthread_mutex_unlock(&loader->lock);
+}
+
+static void SetFinished(PixelPaletteLoader *loader) {
+  pthread_mutex_lock(&loader->lock);
+  loader->namesReady = true;
+  loader->finished = true;
+  pthread_cond_broadcast(&loader->changed);
+  pthread_mutex_unlock(&loader->lock);
+}
+
+static void *LoaderMain(void *arg) {
+  PixelPaletteLoader *loader = (PixelPaletteLoader *)arg;
+  loader->fileCount = PixelPaletteListDir(loader->dirPath, &loader->files);
+  size_t slots = (size_t)(loader->fileCount > 0 ? loader->fileCount : 1);
+  loader->records = (LoaderRecord *)calloc(slots, sizeof(LoaderRecord));
+  loader->ready = (int *)malloc(slots * sizeof(int));
+  int *pending = (int *)malloc(slots * sizeof(int));
+  if (!loader->records || !loader->ready || !pending) {
+    loader->fileCount = 0;
+    free(pending);
+    SetFinished(loader);
+    return NULL;
+  }
+
+  // Cached files are complete right away; the rest are listed lazily.
+  loader->cache = PixelPaletteCacheOpen(loader->cachePath, loader->dirPath);
+  int pendingCount = 0;
+  for (int i = 0; i < loader->fileCount; i++) {
+    LoaderRecord *record = &loader->records[i];
+    record->paletteIndex = -1;
+    if (!PixelPaletteCacheLookup(loader->cache, &loader->files[i], &record->colors, &record->count)) {
+      pending[pendingCount++] = i;
+    }
+  }
+
+  pthread_mutex_lock(&loader->lock);
+  loader->namesReady = true;
+  pthread_cond_broadcast(&loader->changed);
+  pthread_mutex_unlock(&loader->lock);
+
+  PixelJobPool *pool = pendingCount > 1 ? PixelJobPoolCreate(loader->workerCount) : NULL;
+  PixelJobPoolParallelFor(pool, pending, pendingCount, ParseJob, loader);
+  PixelJobPoolDestroy(pool);
+  free(pending);
+
+  // Refresh the cache so the next start needs no parsing at all.
+  pthread_mutex_lock(&loader->lock);
+  bool cancel = loader->cancel;
+  pthread_mutex_unlock(&loader->lock);
+  bool stale = !loader->cache || pendingCount > 0 || PixelPaletteCacheFileCount(loader->cache) != loader->fileCount;
+  if (!cancel && stale && loader->cachePath) {
+    const PixelColor **fileColors = (const PixelColor **)malloc(slots * sizeof(*fileColors));
+    int *fileColorCounts = (int *)malloc(slots * sizeof(int));
+    if (fileColors && fileColorCounts) {
+      for (int i = 0; i < loader->fileCount; i++) {
+        fileColors[i] = loader->records[i].colors;
+        fileColorCounts[i] = loader->records[i].count;
+      }
+      PixelPaletteCacheWrite(loader->cachePath, loader->dirPath, loader->files, loader->fileCount, fileColors,
+                             fileColorCounts);
+    }
+    free(fileColors);
+    free(fileColorCounts);
+  }
+
+  SetFinished(loader);
+  return NULL;
+}
+
+// Start loading dirPath in the background. cachePath may be NULL; workerCount
+// follows PixelJobPoolCreate (negative means one per spare CPU).
+PixelPaletteLoader *PixelPaletteLoaderStart(const char *dirPath, const char *cachePath, int workerCount) {
+  if (!dirPath) return NULL;
+  PixelPaletteLoader *loader = (PixelPaletteLoader *)calloc(1, sizeof(PixelPaletteLoader));
+  if (!loader) return NULL;
+
+  loader->dirPath = CopyString(dirPath);
+  loader->cachePath = CopyString(cachePath);
+  loader->workerCount = workerCount;
+  pthread_mutex_init(&loader->lock, NULL);
+  pthread_cond_init(&loader->changed, NULL);
+  if (!loader->dirPath || (cachePath && !loader->cachePath) ||
+      pthread_create(&loader->thread, NULL, LoaderMain, loader) != 0) {
+    PixelPaletteLoaderDestroy(loader);
+    return NULL;
+  }
+  loader->threadStarted = true;
+  return loader;
+}
+
+// Move finished work into the registry; call from the thread that owns it.
+// Returns the number of palettes that were listed or received colors.
+int PixelPaletteLoaderDrain(PixelPaletteLoader *loader, PixelPaletteRegistry *registry) {
+  if (!loader || !registry) return 0;
+  int changed = 0;
+
+  pthread_mutex_lock(&loader->lock);
+  if (loader->namesReady && !loader->namesTaken) {
+    for (int i = 0; i < loader->fileCount; i++) {
+      LoaderRecord *record = &loader->records[i];
+      char name[PIXEL_PALETTE_NAME_MAX];
+      PixelPaletteNameFromPath(loader->files[i].fileName, name, sizeof(name));
+      if (record->colors) record->paletteIndex = PixelPaletteRegistryAdd(registry, name, record->colors, record->count);
+      else record->paletteIndex = PixelPaletteRegistryAddLazy(registry, name, loader->files[i].path);
+      if (record->paletteIndex >= 0) changed++;
+    }
+    loader->namesTaken = true;
+  }
+  if (loader->namesTaken) {
+    for (int i = 0; i < loader->readyCount; i++) {
+      const LoaderRecord *record = &loader->records[loader->ready[i]];
+      if (record->paletteIndex < 0 || PixelPaletteLoaded(registry, record->paletteIndex)) continue;
+      if (PixelPaletteRegistrySetColors(registry, record->paletteIndex, record->colors, record->count)) changed++;
+    }
+    loader->readyCount = 0;
+  }
+  pthread_mutex_unlock(&loader->lock);
+  return changed;
+}
+
+// True once every result has been drained and the loader can be destroyed.
+bool PixelPaletteLoaderFinished(PixelPaletteLoader *loader) {
+  if (!loader) return true;
+  pthread_mutex_lock(&loader->lock);
+  bool finished = loader->finished && loader->namesTaken && loader->readyCount == 0;
+  pthread_mutex_unlock(&loader->lock);
+  return finished;
+}
+
+// Block until the directory scan is done, so a Drain lists every palette.
+void PixelPaletteLoaderWait(PixelPaletteLoader *loader) {
+  if (!loader) return;
+  pthread_mutex_lock(&loader->lock);
+  while (!loader->namesReady) pthread_cond_wait(&loader->changed, &loader->lock);
+  pthread_mutex_unlock(&loader->lock);
+}
+
+// Cancel outstanding parsing, join the loader thread and free its results.
+void PixelPaletteLoaderDestroy(PixelPaletteLoader *loader) {
+  if (!loader) return;
+  pthread_mutex_lock(&loader->lock);
+  loader->cancel = true;
+  pthread_mutex_unlock(&loader->lock);
+  if (loader->threadStarted) pthread_join(loader->thread, NULL);
+
+  for (int i = 0; loader->records && i < loader->fileCount; i++) free(loader->records[i].parsedColors);
+  free(loader->records);
+  free(loader->ready);
+  PixelPaletteCacheClose(loader->cache);
+  PixelPaletteFreeFileList(loader->files, loader->fileCount);
+  pthread_cond_destroy(&loader->changed);
+  pthread_mutex_destroy(&loader->lock);
+  free(loader->dirPath);
+  free(loader->cachePath);
+  free(loader);
+}
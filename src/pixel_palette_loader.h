@@ -0,0 +1,22 @@
+#ifndef PIXEL_PALETTE_LOADER_H
+#define PIXEL_PALETTE_LOADER_H
+
+#include <stdbool.h>
+
+#include "pixel_palette.h"
+
+// Background palette library loader. A loader thread scans the directory and
+// reads the cache, then parses uncached files on its own worker pool. The UI
+// thread owns the registry and pulls results in with Drain: every palette is
+// listed by name as soon as the scan finishes (colors still lazy), and colors
+// stream in as files are parsed. Selecting a palette before its colors arrive
+// parses it on the spot with PixelPaletteRegistryEnsureLoaded.
+typedef struct PixelPaletteLoader PixelPaletteLoader;
+
+PixelPaletteLoader *PixelPaletteLoaderStart(const char *dirPath, const char *cachePath, int workerCount);
+int PixelPaletteLoaderDrain(PixelPaletteLoader *loader, PixelPaletteRegistry *registry);
+bool PixelPaletteLoaderFinished(PixelPaletteLoader *loader);
+void PixelPaletteLoaderWait(PixelPaletteLoader *loader);
+void PixelPaletteLoaderDestroy(PixelPaletteLoader *loader);
+
+#endif
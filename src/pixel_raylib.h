@@ -0,0 +1,31 @@
+#ifndef PIXEL_RAYLIB_H
+#define PIXEL_RAYLIB_H
+
+// Thin adapter between headless core pixel types and raylib.
+// Only the editor includes this; pixel_core stays free of raylib/GL/X11.
+
+#include "raylib.h"
+#include "pixel_core.h"
+
+_Static_assert(sizeof(PixelColor) == sizeof(Color), "PixelColor must match raylib Color layout");
+
+static inline Color PixelToRaylibColor(PixelColor c) {
+  return (Color){c.r, c.g, c.b, c.a};
+}
+
+static inline PixelColor PixelFromRaylibColor(Color c) {
+  return (PixelColor){c.r, c.g, c.b, c.a};
+}
+
+// Borrow a core pixel buffer as an RGBA8 raylib Image (no copy, never UnloadImage it).
+static inline Image PixelImageView(const PixelColor *pixels, int width, int height) {
+  return (Image){
+      .data = (void *)pixels,
+      .width = width,
+      .height = height,
+      .mipmaps = 1,
+      .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+  };
+}
+
+#endif
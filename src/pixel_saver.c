@@ -0,0 +1,176 @@
+#include "pixel_saver.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixel_startup.h"
+
+typedef struct SaveJob {
+  char path[PIXEL_SAVER_PATH_SIZE];
+  PixelColor *canvas;              // Private copy taken at submit time
+  size_t canvasBytes;
+  int gridSize;
+  struct SaveJob *next;
+} SaveJob;
+
+struct PixelSaver {
+  pthread_t thread;
+  bool threadStarted;
+
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  SaveJob *head;                   // Saves not started yet, oldest first
+  SaveJob *tail;
+  bool saving;                     // The thread is writing a save it already took
+  bool stop;
+  PixelSaveEvent *events;          // Finished saves not yet polled, oldest first
+  int eventCount;
+  int eventCapacity;
+  PixelColor *spare;               // Finished job's copy, kept so repeat saves skip fresh page faults
+  size_t spareBytes;
+};
+
+static void *SaverMain(void *arg) {
+  PixelSaver *saver = (PixelSaver *)arg;
+  pthread_mutex_lock(&saver->lock);
+  for (;;) {
+    while (!saver->head && !saver->stop) pthread_cond_wait(&saver->changed, &saver->lock);
+    SaveJob *job = saver->head;
+    if (!job) break;  // Stopping with nothing left to write
+    saver->head = job->next;
+    if (!saver->head) saver->tail = NULL;
+    saver->saving = true;
+    pthread_mutex_unlock(&saver->lock);
+
+    PixelSaveEvent event = {{0}, false, 0, 0.0};
+    memcpy(event.path, job->path, sizeof(event.path));
+    double start = PixelStartupNow();
+    event.ok = PixelSaveCanvasTextEx(job->path, job->canvas, job->gridSize, &event.bytesWritten);
+    event.seconds = PixelStartupNow() - start;
+
+    pthread_mutex_lock(&saver->lock);
+    if (!saver->spare) {
+      saver->spare = job->canvas;
+      saver->spareBytes = job->canvasBytes;
+    } else {
+      free(job->canvas);
+    }
+    free(job);
+    if (saver->eventCount == saver->eventCapacity) {
+      int capacity = saver->eventCapacity > 0 ? saver->eventCapacity * 2 : 4;
+      PixelSaveEvent *events = (PixelSaveEvent *)realloc(saver->events, (size_t)capacity * sizeof(PixelSaveEvent));
+      if (events) {
+        saver->events = events;
+        saver->eventCapacity = capacity;
+      }
+    }
+    if (saver->eventCount < saver->eventCapacity) saver->events[saver->eventCount++] = event;
+    saver->saving = false;
+    pthread_cond_broadcast(&saver->changed);
+  }
+  pthread_mutex_unlock(&saver->lock);
+  return NULL;
+}
+
+PixelSaver *PixelSaverCreate(void) {
+  PixelSaver *saver = (PixelSaver *)calloc(1, sizeof(PixelSaver));
+  if (!saver) return NULL;
+  pthread_mutex_init(&saver->lock, NULL);
+  pthread_cond_init(&saver->changed, NULL);
+  if (pthread_create(&saver->thread, NULL, SaverMain, saver) != 0) {
+    PixelSaverDestroy(saver);
+    return NULL;
+  }
+  saver->threadStarted = true;
+  return saver;
+}
+
+// Queue a save of canvas to path. The pixels are copied, so the caller may
+// keep editing; false if the path is too long or memory runs out.
+bool PixelSaverSubmit(PixelSaver *saver, const char *path, const PixelColor *canvas, int gridSize) {
+  if (!saver || !path || !canvas || gridSize <= 0 || strlen(path) >= PIXEL_SAVER_PATH_SIZE) return false;
+  SaveJob *job = (SaveJob *)calloc(1, sizeof(SaveJob));
+  if (!job) return false;
+  size_t bytes = (size_t)gridSize * (size_t)gridSize * sizeof(PixelColor);
+
+  // Reuse the last save's buffer when it is the same size; copying into
+  // memory already mapped is several times faster than into a fresh block
+  pthread_mutex_lock(&saver->lock);
+  if (saver->spare && saver->spareBytes == bytes) {
+    job->canvas = saver->spare;
+    saver->spare = NULL;
+  }
+  pthread_mutex_unlock(&saver->lock);
+  if (!job->canvas) job->canvas = (PixelColor *)malloc(bytes);
+  if (!job->canvas) {
+    free(job);
+    return false;
+  }
+  snprintf(job->path, sizeof(job->path), "%s", path);
+  memcpy(job->canvas, canvas, bytes);
+  job->canvasBytes = bytes;
+  job->gridSize = gridSize;
+
+  pthread_mutex_lock(&saver->lock);
+  if (saver->tail) saver->tail->next = job;
+  else saver->head = job;
+  saver->tail = job;
+  pthread_cond_broadcast(&saver->changed);
+  pthread_mutex_unlock(&saver->lock);
+  return true;
+}
+
+// Take the oldest completion event; false when none is waiting.
+bool PixelSaverPoll(PixelSaver *saver, PixelSaveEvent *event) {
+  if (!saver || !event) return false;
+  pthread_mutex_lock(&saver->lock);
+  bool found = saver->eventCount > 0;
+  if (found) {
+    *event = saver->events[0];
+    saver->eventCount--;
+    memmove(saver->events, saver->events + 1, (size_t)saver->eventCount * sizeof(PixelSaveEvent));
+  }
+  pthread_mutex_unlock(&saver->lock);
+  return found;
+}
+
+// True while a save is queued or being written.
+bool PixelSaverBusy(PixelSaver *saver) {
+  if (!saver) return false;
+  pthread_mutex_lock(&saver->lock);
+  bool busy = saver->head != NULL || saver->saving;
+  pthread_mutex_unlock(&saver->lock);
+  return busy;
+}
+
+// Block until every submitted save has finished.
+void PixelSaverWait(PixelSaver *saver) {
+  if (!saver) return;
+  pthread_mutex_lock(&saver->lock);
+  while (saver->head || saver->saving) pthread_cond_wait(&saver->changed, &saver->lock);
+  pthread_mutex_unlock(&saver->lock);
+}
+
+// Finish the saves already submitted, then stop the thread.
+void PixelSaverDestroy(PixelSaver *saver) {
+  if (!saver) return;
+  pthread_mutex_lock(&saver->lock);
+  saver->stop = true;
+  pthread_cond_broadcast(&saver->changed);
+  pthread_mutex_unlock(&saver->lock);
+  if (saver->threadStarted) pthread_join(saver->thread, NULL);
+
+  while (saver->head) {
+    SaveJob *next = saver->head->next;
+    free(saver->head->canvas);
+    free(saver->head);
+    saver->head = next;
+  }
+  pthread_cond_destroy(&saver->changed);
+  pthread_mutex_destroy(&saver->lock);
+  free(saver->events);
+  free(saver->spare);
+  free(saver);
+}
@@ -0,0 +1,31 @@
+#ifndef PIXEL_SAVER_H
+#define PIXEL_SAVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pixel_core.h"
+
+#define PIXEL_SAVER_PATH_SIZE 1024
+
+// Background project saves. Submit copies the canvas and returns at once; a
+// saver thread encodes it, writes "<path>.tmp", fsyncs and renames it over
+// path. Saves run one at a time in submission order, and each one produces
+// a completion event the UI thread collects with Poll.
+typedef struct PixelSaver PixelSaver;
+
+typedef struct {
+  char path[PIXEL_SAVER_PATH_SIZE];
+  bool ok;
+  size_t bytesWritten;             // File size; 0 when the save failed
+  double seconds;                  // Encode plus write time, excluding time spent queued
+} PixelSaveEvent;
+
+PixelSaver *PixelSaverCreate(void);
+bool PixelSaverSubmit(PixelSaver *saver, const char *path, const PixelColor *canvas, int gridSize);
+bool PixelSaverPoll(PixelSaver *saver, PixelSaveEvent *event);
+bool PixelSaverBusy(PixelSaver *saver);
+void PixelSaverWait(PixelSaver *saver);
+void PixelSaverDestroy(PixelSaver *saver);
+
+#endif
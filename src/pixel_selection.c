@@ -0,0 +1,514 @@
+#include "pixel_selection.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static int MinInt(int a, int b) { return a < b ? a : b; }
+static int MaxInt(int a, int b) { return a > b ? a : b; }
+
+static int PopCount64(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  for (; word; word &= word - 1) count++;
+  return count;
+#endif
+}
+
+static int LowestBit(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  int bit = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+static int HighestBit(uint64_t word) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(word);
+#else
+  int bit = 63;
+  while (!(word >> bit)) bit--;
+  return bit;
+#endif
+}
+
+static size_t WordCount(const PixelMask *mask) {
+  return (size_t)mask->wordsPerRow * (size_t)mask->height;
+}
+
+static uint64_t *Row(const PixelMask *mask, int y) {
+  return mask->words + (size_t)y * (size_t)mask->wordsPerRow;
+}
+
+// Bits of the last word in a row that lie inside the mask.
+static uint64_t TailBits(const PixelMask *mask) {
+  int used = mask->width & 63;
+  return used ? (UINT64_C(1) << used) - 1 : ~UINT64_C(0);
+}
+
+// Set pixels [x0, x1) of row y; the span must already be clipped.
+static void SetSpan(PixelMask *mask, int y, int x0, int x1) {
+  if (x0 >= x1) return;
+  uint64_t *row = Row(mask, y);
+  int first = x0 >> 6, last = (x1 - 1) >> 6;
+  uint64_t head = ~UINT64_C(0) << (x0 & 63);
+  uint64_t tail = ~UINT64_C(0) >> (63 - ((x1 - 1) & 63));
+  if (first == last) {
+    row[first] |= head & tail;
+    return;
+  }
+  row[first] |= head;
+  for (int i = first + 1; i < last; i++) row[i] = ~UINT64_C(0);
+  row[last] |= tail;
+}
+
+static void SetBit(PixelMask *mask, int x, int y) {
+  if (x < 0 || y < 0 || x >= mask->width || y >= mask->height) return;
+  Row(mask, y)[x >> 6] |= UINT64_C(1) << (x & 63);
+}
+
+bool PixelMaskInit(PixelMask *mask, int width, int height) {
+  if (!mask || width <= 0 || height <= 0) return false;
+  *mask = (PixelMask){0};
+  int wordsPerRow = (width + 63) / 64;
+  uint64_t *words = (uint64_t *)calloc((size_t)wordsPerRow * (size_t)height, sizeof(uint64_t));
+  if (!words) return false;
+  *mask = (PixelMask){words, width, height, wordsPerRow};
+  return true;
+}
+
+void PixelMaskFree(PixelMask *mask) {
+  if (!mask) return;
+  free(mask->words);
+  *mask = (PixelMask){0};
+}
+
+void PixelMaskClear(PixelMask *mask) {
+  if (mask && mask->words) memset(mask->words, 0, WordCount(mask) * sizeof(uint64_t));
+}
+
+void PixelMaskSelectAll(PixelMask *mask) {
+  PixelMaskClear(mask);
+  PixelMaskInvert(mask);
+}
+
+bool PixelMaskGet(const PixelMask *mask, int x, int y) {
+  if (!mask || !mask->words || x < 0 || y < 0 || x >= mask->width || y >= mask->height) return false;
+  return (Row(mask, y)[x >> 6] >> (x & 63)) & 1;
+}
+
+bool PixelMaskEmpty(const PixelMask *mask) {
+  if (!mask || !mask->words) return true;
+  size_t count = WordCount(mask);
+  for (size_t i = 0; i < count; i++) {
+    if (mask->words[i]) return false;
+  }
+  return true;
+}
+
+size_t PixelMaskCount(const PixelMask *mask) {
+  if (!mask || !mask->words) return 0;
+  size_t count = WordCount(mask), total = 0;
+  for (size_t i = 0; i < count; i++) total += (size_t)PopCount64(mask->words[i]);
+  return total;
+}
+
+// Smallest rectangle holding every selected pixel; false when nothing is selected.
+bool PixelMaskBounds(const PixelMask *mask, int *x, int *y, int *width, int *height) {
+  if (!mask || !mask->words) return false;
+  int x0 = mask->width, y0 = mask->height, x1 = -1, y1 = -1;
+  for (int row = 0; row < mask->height; row++) {
+    const uint64_t *words = Row(mask, row);
+    for (int i = 0; i < mask->wordsPerRow; i++) {
+      if (!words[i]) continue;
+      x0 = MinInt(x0, i * 64 + LowestBit(words[i]));
+      break;
+    }
+    for (int i = mask->wordsPerRow - 1; i >= 0; i--) {
+      if (!words[i]) continue;
+      x1 = MaxInt(x1, i * 64 + HighestBit(words[i]));
+      if (y0 == mask->height) y0 = row;
+      y1 = row;
+      break;
+    }
+  }
+  if (x1 < 0) return false;
+  if (x) *x = x0;
+  if (y) *y = y0;
+  if (width) *width = x1 - x0 + 1;
+  if (height) *height = y1 - y0 + 1;
+  return true;
+}
+
+// Replace the mask with a rectangle, clipped to the canvas.
+void PixelMaskRect(PixelMask *mask, int x, int y, int width, int height) {
+  PixelMaskClear(mask);
+  if (!mask || !mask->words) return;
+  int x0 = MaxInt(x, 0), y0 = MaxInt(y, 0);
+  int x1 = MinInt(x + width, mask->width), y1 = MinInt(y + height, mask->height);
+  for (int row = y0; row < y1; row++) SetSpan(mask, row, x0, x1);
+}
+
+static int CompareFloats(const void *a, const void *b) {
+  float fa = *(const float *)a, fb = *(const float *)b;
+  return (fa > fb) - (fa < fb);
+}
+
+// Replace the mask with a closed polygon through pixel centers (a lasso). The
+// interior is filled a scanline at a time by the even-odd rule, sampling
+// pixel centers; the traced outline itself is always included.
+bool PixelMaskPolygon(PixelMask *mask, const PixelMaskPoint *points, int count) {
+  PixelMaskClear(mask);
+  if (!mask || !mask->words || !points || count <= 0) return false;
+  float *crossings = (float *)malloc((size_t)count * sizeof(float));
+  if (!crossings) return false;
+
+  int minY = points[0].y, maxY = points[0].y;
+  for (int i = 1; i < count; i++) {
+    minY = MinInt(minY, points[i].y);
+    maxY = MaxInt(maxY, points[i].y);
+  }
+  minY = MaxInt(minY, 0);
+  maxY = MinInt(maxY, mask->height - 1);
+
+  for (int y = minY; y <= maxY; y++) {
+    // Vertices sit at pixel centers, so row y samples exactly at y; half-open
+    // edges keep a vertex on the scanline from being counted twice
+    int found = 0;
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+      const PixelMaskPoint *a = &points[i], *b = &points[j];
+      if ((a->y <= y) == (b->y <= y)) continue;
+      crossings[found++] = (float)a->x + (float)(y - a->y) * (float)(b->x - a->x) / (float)(b->y - a->y);
+    }
+    qsort(crossings, (size_t)found, sizeof(float), CompareFloats);
+    for (int i = 0; i + 1 < found; i += 2) {
+      int x0 = (int)ceilf(crossings[i]);
+      int x1 = (int)floorf(crossings[i + 1]) + 1;
+      SetSpan(mask, y, MaxInt(x0, 0), MinInt(x1, mask->width));
+    }
+  }
+  free(crossings);
+
+  for (int i = 0; i < count; i++) {
+    // Bresenham along each edge, closing back to the first point
+    const PixelMaskPoint *a = &points[i], *b = &points[(i + 1) % count];
+    int x = a->x, y = a->y;
+    int dx = abs(b->x - x), dy = -abs(b->y - y);
+    int sx = x < b->x ? 1 : -1, sy = y < b->y ? 1 : -1;
+    int error = dx + dy;
+    for (;;) {
+      SetBit(mask, x, y);
+      if (x == b->x && y == b->y) break;
+      int twice = 2 * error;
+      if (twice >= dy) {
+        error += dy;
+        x += sx;
+      }
+      if (twice <= dx) {
+        error += dx;
+        y += sy;
+      }
+    }
+  }
+  return true;
+}
+
+static bool ColorWithin(PixelColor a, PixelColor b, int tolerance) {
+  return abs(a.r - b.r) <= tolerance && abs(a.g - b.g) <= tolerance && abs(a.b - b.b) <= tolerance &&
+         abs(a.a - b.a) <= tolerance;
+}
+
+// Replace the mask with the region connected to (x, y) whose colors are
+// within tolerance of the seed on every channel (4-connected span fill).
+bool PixelMaskMagicWand(PixelMask *mask, const PixelColor *canvas, int x, int y, int tolerance) {
+  PixelMaskClear(mask);
+  if (!mask || !mask->words || !canvas || x < 0 || y < 0 || x >= mask->width || y >= mask->height) return false;
+  PixelColor seed = canvas[(size_t)y * (size_t)mask->width + (size_t)x];
+
+  int stackCapacity = 64, stackCount = 0;
+  PixelMaskPoint *stack = (PixelMaskPoint *)malloc((size_t)stackCapacity * sizeof(PixelMaskPoint));
+  if (!stack) return false;
+  stack[stackCount++] = (PixelMaskPoint){x, y};
+  bool ok = true;
+  while (ok && stackCount > 0) {
+    PixelMaskPoint next = stack[--stackCount];
+    int py = next.y, left = next.x, right = next.x;
+    const PixelColor *row = canvas + (size_t)py * (size_t)mask->width;
+    if (PixelMaskGet(mask, left, py) || !ColorWithin(row[left], seed, tolerance)) continue;
+    while (left > 0 && !PixelMaskGet(mask, left - 1, py) && ColorWithin(row[left - 1], seed, tolerance)) left--;
+    while (right + 1 < mask->width && !PixelMaskGet(mask, right + 1, py) &&
+           ColorWithin(row[right + 1], seed, tolerance)) {
+      right++;
+    }
+    SetSpan(mask, py, left, right + 1);
+
+    // Seed the first pixel of every matching run above and below the span
+    for (int ny = py - 1; ny <= py + 1; ny += 2) {
+      if (ny < 0 || ny >= mask->height) continue;
+      const PixelColor *neighbor = canvas + (size_t)ny * (size_t)mask->width;
+      bool inRun = false;
+      for (int nx = left; nx <= right; nx++) {
+        bool match = !PixelMaskGet(mask, nx, ny) && ColorWithin(neighbor[nx], seed, tolerance);
+        if (match && !inRun) {
+          if (stackCount == stackCapacity) {
+            int capacity = stackCapacity * 2;
+            PixelMaskPoint *grown = (PixelMaskPoint *)realloc(stack, (size_t)capacity * sizeof(PixelMaskPoint));
+            if (!grown) {
+              ok = false;
+              break;
+            }
+            stack = grown;
+            stackCapacity = capacity;
+          }
+          stack[stackCount++] = (PixelMaskPoint){nx, ny};
+        }
+        inRun = match;
+      }
+    }
+  }
+  free(stack);
+  return ok;
+}
+
+static void CombineWordsScalar(uint64_t *dst, const uint64_t *src, size_t count, PixelMaskOp op) {
+  switch (op) {
+    case PIXEL_MASK_UNION:
+      for (size_t i = 0; i < count; i++) dst[i] |= src[i];
+      break;
+    case PIXEL_MASK_INTERSECT:
+      for (size_t i = 0; i < count; i++) dst[i] &= src[i];
+      break;
+    case PIXEL_MASK_SUBTRACT:
+      for (size_t i = 0; i < count; i++) dst[i] &= ~src[i];
+      break;
+    default:
+      memcpy(dst, src, count * sizeof(uint64_t));
+      break;
+  }
+}
+
+#if defined(__SSE2__)
+// Two words per instruction; the masks are far larger than cache, so this
+// runs at memory bandwidth either way but halves the instruction count.
+static void CombineWordsSimd(uint64_t *dst, const uint64_t *src, size_t count, PixelMaskOp op) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    if (op == PIXEL_MASK_UNION) d = _mm_or_si128(d, s);
+    else if (op == PIXEL_MASK_INTERSECT) d = _mm_and_si128(d, s);
+    else d = _mm_andnot_si128(s, d);
+    _mm_storeu_si128((__m128i *)(dst + i), d);
+  }
+  CombineWordsScalar(dst + i, src + i, count - i, op);
+}
+#endif
+
+// Apply src to dst; both masks must be the same size.
+void PixelMaskCombine(PixelMask *dst, const PixelMask *src, PixelMaskOp op) {
+  if (!dst || !src || !dst->words || !src->words || dst->width != src->width || dst->height != src->height) return;
+#if defined(__SSE2__)
+  if (op != PIXEL_MASK_REPLACE) {
+    CombineWordsSimd(dst->words, src->words, WordCount(dst), op);
+    return;
+  }
+#endif
+  CombineWordsScalar(dst->words, src->words, WordCount(dst), op);
+}
+
+void PixelMaskInvert(PixelMask *mask) {
+  if (!mask || !mask->words) return;
+  size_t count = WordCount(mask);
+  for (size_t i = 0; i < count; i++) mask->words[i] = ~mask->words[i];
+  uint64_t tail = TailBits(mask);
+  for (int y = 0; y < mask->height; y++) Row(mask, y)[mask->wordsPerRow - 1] &= tail;
+}
+
+// PixelPaintBrushEx clipped to the selection: unselected pixels keep their color.
+void PixelMaskPaintBrush(const PixelMask *mask, PixelColor *canvas, int gx, int gy, PixelColor color, int brushSize) {
+  if (!mask || !mask->words || !canvas || brushSize <= 0) return;
+  int x0 = MaxInt(gx - brushSize / 2, 0), y0 = MaxInt(gy - brushSize / 2, 0);
+  int x1 = MinInt(gx - brushSize / 2 + brushSize, mask->width);
+  int y1 = MinInt(gy - brushSize / 2 + brushSize, mask->height);
+  for (int y = y0; y < y1; y++) {
+    const uint64_t *row = Row(mask, y);
+    PixelColor *out = canvas + (size_t)y * (size_t)mask->width;
+    for (int x = x0; x < x1; x++) {
+      if ((row[x >> 6] >> (x & 63)) & 1) out[x] = color;
+    }
+  }
+}
+
+// Unpack to one color per pixel, e.g. for an overlay texture.
+void PixelMaskExpand(const PixelMask *mask, PixelColor *out, PixelColor selected, PixelColor unselected) {
+  if (!mask || !mask->words || !out) return;
+  for (int y = 0; y < mask->height; y++) {
+    const uint64_t *row = Row(mask, y);
+    for (int x = 0; x < mask->width; x++) *out++ = (row[x >> 6] >> (x & 63)) & 1 ? selected : unselected;
+  }
+}
+
+// First x in [x, end) whose bit equals set, or end; whole words are skipped at once.
+static int NextBit(const uint64_t *row, int x, int end, bool set) {
+  while (x < end) {
+    uint64_t word = set ? row[x >> 6] : ~row[x >> 6];
+    word &= ~UINT64_C(0) << (x & 63);
+    if (word) return MinInt((x & ~63) + LowestBit(word), end);
+    x = (x & ~63) + 64;
+  }
+  return end;
+}
+
+// Copy the masked pixels of src (srcX, srcY origin) to dst as runs: each run
+// of set bits is one memcpy. Rows are clipped to the destination first.
+static void BlitMaskedSpans(const PixelMask *mask, const PixelColor *src, PixelColor *dst, int dstWidth, int dstHeight,
+                            int dstX, int dstY) {
+  int y0 = MaxInt(0, -dstY), y1 = MinInt(mask->height, dstHeight - dstY);
+  int x0 = MaxInt(0, -dstX), x1 = MinInt(mask->width, dstWidth - dstX);
+  for (int y = y0; y < y1; y++) {
+    const uint64_t *row = Row(mask, y);
+    const PixelColor *in = src + (size_t)y * (size_t)mask->width;
+    PixelColor *out = dst + (size_t)(y + dstY) * (size_t)dstWidth + dstX;
+    for (int x = NextBit(row, x0, x1, true); x < x1;) {
+      int end = NextBit(row, x, x1, false);
+      memcpy(out + x, in + x, (size_t)(end - x) * sizeof(PixelColor));
+      x = NextBit(row, end, x1, true);
+    }
+  }
+}
+
+// Cut the selected pixels out of canvas (leaving them transparent) into a
+// floating buffer at the same position; floating must not hold pixels yet.
+// False if nothing is selected.
+bool PixelFloatingLift(PixelFloating *floating, PixelColor *canvas, int width, int height, const PixelMask *selection) {
+  if (!floating || !canvas || !selection || selection->width != width || selection->height != height) return false;
+  *floating = (PixelFloating){0};
+  int bx, by, bw, bh;
+  if (!PixelMaskBounds(selection, &bx, &by, &bw, &bh) || !PixelMaskInit(&floating->mask, bw, bh)) return false;
+  floating->pixels = (PixelColor *)calloc((size_t)bw * (size_t)bh, sizeof(PixelColor));
+  if (!floating->pixels) {
+    PixelFloatingFree(floating);
+    return false;
+  }
+  floating->x = bx;
+  floating->y = by;
+
+  for (int y = 0; y < bh; y++) {
+    const uint64_t *row = Row(selection, by + y);
+    PixelColor *source = canvas + (size_t)(by + y) * (size_t)width;
+    PixelColor *out = floating->pixels + (size_t)y * (size_t)bw - bx;
+    for (int x = NextBit(row, bx, bx + bw, true); x < bx + bw;) {
+      int end = NextBit(row, x, bx + bw, false);
+      memcpy(out + x, source + x, (size_t)(end - x) * sizeof(PixelColor));
+      memset(source + x, 0, (size_t)(end - x) * sizeof(PixelColor));
+      SetSpan(&floating->mask, y, x - bx, end - bx);
+      x = NextBit(row, end, bx + bw, true);
+    }
+  }
+  return true;
+}
+
+// Write the lifted pixels at the floating position; transparent ones replace
+// what is below too, so a move carries pixels exactly. Off-canvas parts are dropped.
+void PixelFloatingBlit(const PixelFloating *floating, PixelColor *canvas, int width, int height) {
+  if (!floating || !floating->pixels || !canvas) return;
+  BlitMaskedSpans(&floating->mask, floating->pixels, canvas, width, height, floating->x, floating->y);
+}
+
+// Make selection the floating mask at its current position.
+void PixelFloatingPlaceMask(const PixelFloating *floating, PixelMask *selection) {
+  PixelMaskClear(selection);
+  if (!floating || !floating->pixels || !selection || !selection->words) return;
+  const PixelMask *mask = &floating->mask;
+  for (int y = MaxInt(0, -floating->y); y < MinInt(mask->height, selection->height - floating->y); y++) {
+    const uint64_t *row = Row(mask, y);
+    int x0 = MaxInt(0, -floating->x), x1 = MinInt(mask->width, selection->width - floating->x);
+    for (int x = NextBit(row, x0, x1, true); x < x1;) {
+      int end = NextBit(row, x, x1, false);
+      SetSpan(selection, y + floating->y, x + floating->x, end + floating->x);
+      x = NextBit(row, end, x1, true);
+    }
+  }
+}
+
+// Mirror the buffer left to right or top to bottom; false if memory runs out.
+bool PixelFloatingFlip(PixelFloating *floating, bool horizontal) {
+  if (!floating || !floating->pixels) return false;
+  PixelMask *mask = &floating->mask;
+  if (horizontal) {
+    PixelMask flipped;
+    if (!PixelMaskInit(&flipped, mask->width, mask->height)) return false;
+    PixelFlipHorizontal(floating->pixels, mask->width, mask->width, mask->height);
+    for (int y = 0; y < mask->height; y++) {
+      const uint64_t *row = Row(mask, y);
+      for (int x = NextBit(row, 0, mask->width, true); x < mask->width; x = NextBit(row, x + 1, mask->width, true)) {
+        SetBit(&flipped, mask->width - 1 - x, y);
+      }
+    }
+    PixelMaskFree(mask);
+    *mask = flipped;
+    return true;
+  }
+
+  PixelFlipVertical(floating->pixels, mask->width, mask->width, mask->height);
+  for (int top = 0, bottom = mask->height - 1; top < bottom; top++, bottom--) {
+    uint64_t *a = Row(mask, top), *b = Row(mask, bottom);
+    for (int i = 0; i < mask->wordsPerRow; i++) {
+      uint64_t swap = a[i];
+      a[i] = b[i];
+      b[i] = swap;
+    }
+  }
+  return true;
+}
+
+// Turn the buffer a quarter about its center in one blocked pass over the
+// pixels. False if memory runs out, leaving the floating unchanged.
+bool PixelFloatingRotate(PixelFloating *floating, bool clockwise) {
+  if (!floating || !floating->pixels) return false;
+  const PixelMask *mask = &floating->mask;
+  int width = mask->width, height = mask->height;
+  PixelMask rotatedMask;
+  if (!PixelMaskInit(&rotatedMask, height, width)) return false;
+  PixelColor *rotated = (PixelColor *)malloc((size_t)width * (size_t)height * sizeof(PixelColor));
+  if (!rotated) {
+    PixelMaskFree(&rotatedMask);
+    return false;
+  }
+
+  PixelTransformCanvasCopy(rotated, floating->pixels, width, height,
+                           clockwise ? PIXEL_TRANSFORM_ROTATE_90 : PIXEL_TRANSFORM_ROTATE_270);
+  for (int y = 0; y < height; y++) {
+    const uint64_t *row = Row(mask, y);
+    for (int x = NextBit(row, 0, width, true); x < width; x = NextBit(row, x + 1, width, true)) {
+      SetBit(&rotatedMask, clockwise ? height - 1 - y : y, clockwise ? x : width - 1 - x);
+    }
+  }
+
+  free(floating->pixels);
+  PixelMaskFree(&floating->mask);
+  floating->pixels = rotated;
+  floating->mask = rotatedMask;
+  floating->x += (width - height) / 2;
+  floating->y += (height - width) / 2;
+  return true;
+}
+
+void PixelFloatingFree(PixelFloating *floating) {
+  if (!floating) return;
+  free(floating->pixels);
+  PixelMaskFree(&floating->mask);
+  *floating = (PixelFloating){0};
+}
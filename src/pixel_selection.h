@@ -0,0 +1,66 @@
+#ifndef PIXEL_SELECTION_H
+#define PIXEL_SELECTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pixel_core.h"
+
+// How a new shape combines with the existing selection.
+typedef enum {
+  PIXEL_MASK_REPLACE = 0,
+  PIXEL_MASK_UNION,
+  PIXEL_MASK_INTERSECT,
+  PIXEL_MASK_SUBTRACT
+} PixelMaskOp;
+
+// Selection as one bit per pixel: bit x & 63 of word x >> 6 in the row. Rows
+// start on a word and the bits past width stay zero, so masks of the same
+// size combine word by word. An 8192x8192 mask is 8 MB.
+typedef struct {
+  uint64_t *words;
+  int width;
+  int height;
+  int wordsPerRow;
+} PixelMask;
+
+typedef struct {
+  int x;
+  int y;
+} PixelMaskPoint;
+
+bool PixelMaskInit(PixelMask *mask, int width, int height);
+void PixelMaskFree(PixelMask *mask);
+void PixelMaskClear(PixelMask *mask);
+void PixelMaskSelectAll(PixelMask *mask);
+bool PixelMaskGet(const PixelMask *mask, int x, int y);
+bool PixelMaskEmpty(const PixelMask *mask);
+size_t PixelMaskCount(const PixelMask *mask);
+bool PixelMaskBounds(const PixelMask *mask, int *x, int *y, int *width, int *height);
+void PixelMaskRect(PixelMask *mask, int x, int y, int width, int height);
+bool PixelMaskPolygon(PixelMask *mask, const PixelMaskPoint *points, int count);
+bool PixelMaskMagicWand(PixelMask *mask, const PixelColor *canvas, int x, int y, int tolerance);
+void PixelMaskCombine(PixelMask *dst, const PixelMask *src, PixelMaskOp op);
+void PixelMaskInvert(PixelMask *mask);
+void PixelMaskPaintBrush(const PixelMask *mask, PixelColor *canvas, int gx, int gy, PixelColor color, int brushSize);
+void PixelMaskExpand(const PixelMask *mask, PixelColor *out, PixelColor selected, PixelColor unselected);
+
+// Selected pixels lifted out of a canvas so they can be moved, flipped and
+// rotated before being written back. The buffer covers the selection's
+// bounds; mask marks which of its pixels were lifted.
+typedef struct {
+  PixelColor *pixels;              // mask.width * mask.height
+  PixelMask mask;
+  int x;                           // Canvas position of the buffer's top-left pixel
+  int y;
+} PixelFloating;
+
+bool PixelFloatingLift(PixelFloating *floating, PixelColor *canvas, int width, int height, const PixelMask *selection);
+void PixelFloatingBlit(const PixelFloating *floating, PixelColor *canvas, int width, int height);
+void PixelFloatingPlaceMask(const PixelFloating *floating, PixelMask *selection);
+bool PixelFloatingFlip(PixelFloating *floating, bool horizontal);
+bool PixelFloatingRotate(PixelFloating *floating, bool clockwise);
+void PixelFloatingFree(PixelFloating *floating);
+
+#endif
@@ -0,0 +1,107 @@
+#include "pixel_startup.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define MakeOneDirectory(path) _mkdir(path)
+#else
+#define MakeOneDirectory(path) mkdir(path, 0755)
+#endif
+
+// Monotonic clock in seconds; only differences are meaningful.
+double PixelStartupNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+void PixelStartupProfileInit(PixelStartupProfile *profile) {
+  if (!profile) return;
+  memset(profile, 0, sizeof(*profile));
+  profile->startSeconds = PixelStartupNow();
+}
+
+// End the current phase. Marks past the phase limit are dropped.
+void PixelStartupMark(PixelStartupProfile *profile, const char *phase) {
+  if (!profile || profile->phaseCount == PIXEL_STARTUP_MAX_PHASES) return;
+  profile->phases[profile->phaseCount++] = (PixelStartupPhase){phase ? phase : "?", PixelStartupNow()};
+}
+
+double PixelStartupPhaseMs(const PixelStartupProfile *profile, int index) {
+  if (!profile || index < 0 || index >= profile->phaseCount) return 0.0;
+  double begin = index > 0 ? profile->phases[index - 1].endSeconds : profile->startSeconds;
+  return (profile->phases[index].endSeconds - begin) * 1000.0;
+}
+
+// Time from Init to the last mark.
+double PixelStartupElapsedMs(const PixelStartupProfile *profile) {
+  if (!profile || profile->phaseCount == 0) return 0.0;
+  return (profile->phases[profile->phaseCount - 1].endSeconds - profile->startSeconds) * 1000.0;
+}
+
+void PixelStartupDump(const PixelStartupProfile *profile, FILE *out) {
+  if (!profile || !out) return;
+  fprintf(out, "startup phases (ms):\n");
+  for (int i = 0; i < profile->phaseCount; i++) {
+    double at = (profile->phases[i].endSeconds - profile->startSeconds) * 1000.0;
+    fprintf(out, "  %-24s %8.2f  (at %8.2f)\n", profile->phases[i].name, PixelStartupPhaseMs(profile, i), at);
+  }
+  fprintf(out, "  %-24s %8.2f\n", "total", PixelStartupElapsedMs(profile));
+}
+
+static bool IsDirectory(const char *path) {
+  struct stat info;
+  return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Create path and any missing parents. The common case, where it already
+// exists, costs a single stat instead of one mkdir per component.
+bool PixelMakeDirectories(const char *path) {
+  if (!path || path[0] == '\0') return false;
+  if (IsDirectory(path)) return true;
+
+  size_t length = strlen(path);
+  char *buffer = (char *)malloc(length + 1);
+  if (!buffer) return false;
+  memcpy(buffer, path, length + 1);
+
+  bool ok = true;
+  for (size_t i = 1; i <= length && ok; i++) {
+    if (i < length && buffer[i] != '/' && buffer[i] != '\\') continue;
+    if (buffer[i - 1] == '/' || buffer[i - 1] == '\\' || buffer[i - 1] == ':') continue;
+    char separator = buffer[i];
+    buffer[i] = '\0';
+    if (MakeOneDirectory(buffer) != 0 && errno != EEXIST) ok = false;
+    buffer[i] = separator;
+  }
+  free(buffer);
+  return ok && IsDirectory(path);
+}
+
+// Per-user application directory ("<base>/pixel") from the platform
+// environment: LOCALAPPDATA or APPDATA on Windows, XDG_DATA_HOME or
+// ~/.local/share elsewhere. Returns false if none is set or it does not fit.
+bool PixelUserDataDir(char *out, size_t size) {
+  if (!out || size == 0) return false;
+  int written = -1;
+#if defined(_WIN32)
+  const char *base = getenv("LOCALAPPDATA");
+  if (!base || base[0] == '\0') base = getenv("APPDATA");
+  if (base && base[0] != '\0') written = snprintf(out, size, "%s/pixel", base);
+#else
+  const char *xdgData = getenv("XDG_DATA_HOME");
+  const char *home = getenv("HOME");
+  if (xdgData && xdgData[0] != '\0') written = snprintf(out, size, "%s/pixel", xdgData);
+  else if (home && home[0] != '\0') written = snprintf(out, size, "%s/.local/share/pixel", home);
+#endif
+  if (written < 0 || (size_t)written >= size) {
+    out[0] = '\0';
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,33 @@
+#ifndef PIXEL_STARTUP_H
+#define PIXEL_STARTUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PIXEL_STARTUP_MAX_PHASES 32
+
+// One timed launch phase; it began where the previous phase ended.
+typedef struct {
+  const char *name;                // Static string, not copied
+  double endSeconds;               // Monotonic time the phase finished
+} PixelStartupPhase;
+
+// Launch timeline: a start time plus one timestamp per finished phase.
+typedef struct {
+  double startSeconds;
+  PixelStartupPhase phases[PIXEL_STARTUP_MAX_PHASES];
+  int phaseCount;
+} PixelStartupProfile;
+
+double PixelStartupNow(void);
+void PixelStartupProfileInit(PixelStartupProfile *profile);
+void PixelStartupMark(PixelStartupProfile *profile, const char *phase);
+double PixelStartupPhaseMs(const PixelStartupProfile *profile, int index);
+double PixelStartupElapsedMs(const PixelStartupProfile *profile);
+void PixelStartupDump(const PixelStartupProfile *profile, FILE *out);
+
+bool PixelMakeDirectories(const char *path);
+bool PixelUserDataDir(char *out, size_t size);
+
+#endif
@@ -6,18 +6,30 @@ void PixelUiLogicInit(PixelUiLogic *ui) {
   *ui = (PixelUiLogic){0};
 }
 
-// Open a specific dialog, closing others and focusing text input.
+// True while any filename dialog or the library browser is shown.
+bool PixelUiLogicDialogOpen(const PixelUiLogic *ui) {
+  if (!ui) return false;
+  return ui->showSavePngDialog || ui->showSaveTxtDialog || ui->showLoadTxtDialog || ui->showSaveGifDialog ||
+         ui->showLibraryBrowser;
+}
+
+// Open a specific dialog, closing others and focusing text input (the
+// library browser has none).
 void PixelUiLogicOpenDialog(PixelUiLogic *ui, PixelDialogType dialogType) {
   if (!ui) return;
   ui->showSavePngDialog = false;
   ui->showSaveTxtDialog = false;
   ui->showLoadTxtDialog = false;
+  ui->showSaveGifDialog = false;
+  ui->showLibraryBrowser = false;
   ui->showQuitConfirm = false;
-  ui->textInputEditMode = true;
+  ui->textInputEditMode = dialogType != PIXEL_DIALOG_LIBRARY;
 
   if (dialogType == PIXEL_DIALOG_SAVE_PNG) ui->showSavePngDialog = true;
   else if (dialogType == PIXEL_DIALOG_SAVE_TXT) ui->showSaveTxtDialog = true;
   else if (dialogType == PIXEL_DIALOG_LOAD_TXT) ui->showLoadTxtDialog = true;
+  else if (dialogType == PIXEL_DIALOG_SAVE_GIF) ui->showSaveGifDialog = true;
+  else if (dialogType == PIXEL_DIALOG_LIBRARY) ui->showLibraryBrowser = true;
 }
 
 // Open quit confirmation and block all text dialogs.
@@ -26,6 +38,8 @@ void PixelUiLogicOpenQuitConfirm(PixelUiLogic *ui) {
   ui->showSavePngDialog = false;
   ui->showSaveTxtDialog = false;
   ui->showLoadTxtDialog = false;
+  ui->showSaveGifDialog = false;
+  ui->showLibraryBrowser = false;
   ui->textInputEditMode = false;
   ui->showQuitConfirm = true;
 }
@@ -36,6 +50,8 @@ void PixelUiLogicCloseDialog(PixelUiLogic *ui, PixelDialogType dialogType) {
   if (dialogType == PIXEL_DIALOG_SAVE_PNG) ui->showSavePngDialog = false;
   else if (dialogType == PIXEL_DIALOG_SAVE_TXT) ui->showSaveTxtDialog = false;
   else if (dialogType == PIXEL_DIALOG_LOAD_TXT) ui->showLoadTxtDialog = false;
+  else if (dialogType == PIXEL_DIALOG_SAVE_GIF) ui->showSaveGifDialog = false;
+  else if (dialogType == PIXEL_DIALOG_LIBRARY) ui->showLibraryBrowser = false;
   ui->textInputEditMode = false;
 }
 
@@ -50,3 +66,31 @@ void PixelUiLogicAcceptQuit(PixelUiLogic *ui) {
   if (!ui) return;
   ui->shouldQuit = true;
 }
+
+// Start owing a frame so the first one is always drawn.
+void PixelRedrawInit(PixelRedrawState *redraw) {
+  if (!redraw) return;
+  redraw->owedFrames = PIXEL_REDRAW_SETTLE_FRAMES;
+}
+
+// Something visible changed, or an input event woke the loop.
+void PixelRedrawInvalidate(PixelRedrawState *redraw) {
+  if (!redraw) return;
+  redraw->owedFrames = PIXEL_REDRAW_SETTLE_FRAMES;
+}
+
+// Call after each drawn frame. busy means the next frame differs without any
+// input (animation playing, background work to poll). Returns true if the
+// loop may block until the next input event.
+bool PixelRedrawFrameDone(PixelRedrawState *redraw, bool busy) {
+  if (!redraw) return false;
+  if (busy) {
+    redraw->owedFrames = PIXEL_REDRAW_SETTLE_FRAMES;
+    return false;
+  }
+  if (redraw->owedFrames > 0) {
+    redraw->owedFrames--;
+    return false;
+  }
+  return true;
+}
@@ -7,23 +7,41 @@ typedef enum {
   PIXEL_DIALOG_NONE = 0,
   PIXEL_DIALOG_SAVE_PNG,
   PIXEL_DIALOG_SAVE_TXT,
-  PIXEL_DIALOG_LOAD_TXT
+  PIXEL_DIALOG_LOAD_TXT,
+  PIXEL_DIALOG_SAVE_GIF,
+  PIXEL_DIALOG_LIBRARY
 } PixelDialogType;
 
 typedef struct {
   bool showSavePngDialog;
   bool showSaveTxtDialog;
   bool showLoadTxtDialog;
+  bool showSaveGifDialog;
+  bool showLibraryBrowser;
   bool textInputEditMode;
   bool showQuitConfirm;
   bool shouldQuit;
 } PixelUiLogic;
 
+// Frames drawn after input or an invalidation before the loop may block
+// again, so hover and press states settle on screen.
+#define PIXEL_REDRAW_SETTLE_FRAMES 1
+
+// Decides whether the render loop can sleep until the next input event.
+typedef struct {
+  int owedFrames;                  // Frames still to draw before sleeping
+} PixelRedrawState;
+
 void PixelUiLogicInit(PixelUiLogic *ui);
+bool PixelUiLogicDialogOpen(const PixelUiLogic *ui);
 void PixelUiLogicOpenDialog(PixelUiLogic *ui, PixelDialogType dialogType);
 void PixelUiLogicOpenQuitConfirm(PixelUiLogic *ui);
 void PixelUiLogicCloseDialog(PixelUiLogic *ui, PixelDialogType dialogType);
 void PixelUiLogicCancelQuit(PixelUiLogic *ui);
 void PixelUiLogicAcceptQuit(PixelUiLogic *ui);
 
+void PixelRedrawInit(PixelRedrawState *redraw);
+void PixelRedrawInvalidate(PixelRedrawState *redraw);
+bool PixelRedrawFrameDone(PixelRedrawState *redraw, bool busy);
+
 #endif
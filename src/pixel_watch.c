@@ -0,0 +1,350 @@
+#include "pixel_watch.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixel_palette.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define PENDING_MAX 128                // Distinct files one burst may hold before it is flushed early
+#define BURST_MAX_MS 200               // A burst that never goes quiet is flushed after this long
+
+typedef struct {
+  PixelPaletteFile *files;         // Last listing, sorted by name
+  int fileCount;
+} DirSnapshot;
+
+struct PixelWatcher {
+  char **dirs;
+  int dirCount;
+  bool polling;
+  pthread_t thread;
+  bool threadStarted;
+  DirSnapshot *snapshots;          // Polling backend: listed before Start returns, so no early change is missed
+
+  // Lock-free ring: the watcher thread only advances head, the UI thread only tail
+  PixelWatchEvent ring[PIXEL_WATCH_QUEUE_SIZE];
+  atomic_uint head;
+  atomic_uint tail;
+  atomic_bool overflow;            // Set when the ring was full; reported once it drains
+
+  // Watcher thread only: the burst being coalesced
+  PixelWatchEvent pending[PENDING_MAX];
+  int pendingCount;
+
+  pthread_mutex_t lock;            // Guards stop for the polling backend's timed wait, and the wake hook
+  pthread_cond_t changed;
+  bool stop;
+  PixelWatchWakeFn wake;
+  void *wakeUser;
+#if defined(__linux__)
+  int inotifyFd;
+  int *watchIds;                   // Per directory
+  int wakeFds[2];                  // Written to by Stop to interrupt poll()
+#endif
+};
+
+static double Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static void Push(PixelWatcher *watcher, const PixelWatchEvent *event) {
+  unsigned head = atomic_load_explicit(&watcher->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&watcher->tail, memory_order_acquire);
+  if (head - tail == PIXEL_WATCH_QUEUE_SIZE) {
+    atomic_store_explicit(&watcher->overflow, true, memory_order_release);
+    return;
+  }
+  watcher->ring[head & (PIXEL_WATCH_QUEUE_SIZE - 1)] = *event;
+  atomic_store_explicit(&watcher->head, head + 1, memory_order_release);
+}
+
+static void Wake(PixelWatcher *watcher) {
+  pthread_mutex_lock(&watcher->lock);
+  PixelWatchWakeFn wake = watcher->wake;
+  void *user = watcher->wakeUser;
+  pthread_mutex_unlock(&watcher->lock);
+  if (wake) wake(user);
+}
+
+static void FlushPending(PixelWatcher *watcher) {
+  if (watcher->pendingCount == 0) return;
+  for (int i = 0; i < watcher->pendingCount; i++) Push(watcher, &watcher->pending[i]);
+  watcher->pendingCount = 0;
+  Wake(watcher);
+}
+
+// Fold one raw change into the burst; the latest kind for a file wins.
+static void AddPending(PixelWatcher *watcher, int dir, PixelWatchKind kind, const char *fileName) {
+  if (strlen(fileName) >= PIXEL_WATCH_NAME_SIZE) return;
+  for (int i = 0; i < watcher->pendingCount; i++) {
+    PixelWatchEvent *event = &watcher->pending[i];
+    if (event->dir == dir && strcmp(event->fileName, fileName) == 0) {
+      event->kind = kind;
+      return;
+    }
+  }
+  if (watcher->pendingCount == PENDING_MAX) FlushPending(watcher);
+  PixelWatchEvent *event = &watcher->pending[watcher->pendingCount++];
+  event->dir = dir;
+  event->kind = kind;
+  snprintf(event->fileName, sizeof(event->fileName), "%s", fileName);
+}
+
+static bool AcceptAnyFile(const char *fileName) {
+  return fileName[0] != '.';
+}
+
+// Diff a fresh listing against the previous one; both are sorted by name.
+static void ScanDir(PixelWatcher *watcher, int dir, DirSnapshot *snapshot) {
+  PixelPaletteFile *files = NULL;
+  int count = PixelListDirFiles(watcher->dirs[dir], AcceptAnyFile, &files);
+  int i = 0, j = 0;
+  while (i < snapshot->fileCount || j < count) {
+    int order = i == snapshot->fileCount ? 1 : (j == count ? -1 : strcmp(snapshot->files[i].fileName, files[j].fileName));
+    if (order < 0) {
+      AddPending(watcher, dir, PIXEL_WATCH_REMOVED, snapshot->files[i++].fileName);
+    } else if (order > 0) {
+      AddPending(watcher, dir, PIXEL_WATCH_CHANGED, files[j++].fileName);
+    } else {
+      if (snapshot->files[i].mtime != files[j].mtime || snapshot->files[i].size != files[j].size) {
+        AddPending(watcher, dir, PIXEL_WATCH_CHANGED, files[j].fileName);
+      }
+      i++;
+      j++;
+    }
+  }
+  PixelPaletteFreeFileList(snapshot->files, snapshot->fileCount);
+  snapshot->files = files;
+  snapshot->fileCount = count;
+}
+
+// Fallback: rescan every directory on a timer. A scan is a burst of its own.
+static void PollLoop(PixelWatcher *watcher) {
+  pthread_mutex_lock(&watcher->lock);
+  while (!watcher->stop) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += (long)PIXEL_WATCH_POLL_MS * 1000000L;
+    until.tv_sec += until.tv_nsec / 1000000000L;
+    until.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&watcher->changed, &watcher->lock, &until);
+    if (watcher->stop) break;
+    pthread_mutex_unlock(&watcher->lock);
+
+    for (int i = 0; i < watcher->dirCount; i++) ScanDir(watcher, i, &watcher->snapshots[i]);
+    FlushPending(watcher);
+    pthread_mutex_lock(&watcher->lock);
+  }
+  pthread_mutex_unlock(&watcher->lock);
+}
+
+#if defined(__linux__)
+// Read inotify events until the burst goes quiet, then publish it. Files
+// are reported once closed after writing or renamed in, never half written.
+static void InotifyLoop(PixelWatcher *watcher) {
+  union {
+    struct inotify_event event;
+    char bytes[4096];
+  } buffer;
+  struct pollfd fds[2] = {{watcher->inotifyFd, POLLIN, 0}, {watcher->wakeFds[0], POLLIN, 0}};
+  double burstStart = 0.0;
+
+  for (;;) {
+    int timeout = -1;
+    if (watcher->pendingCount > 0) {
+      int left = BURST_MAX_MS - (int)((Now() - burstStart) * 1000.0);
+      timeout = left < PIXEL_WATCH_COALESCE_MS ? (left > 0 ? left : 0) : PIXEL_WATCH_COALESCE_MS;
+    }
+    int ready = poll(fds, 2, timeout);
+    if (ready < 0 && errno != EINTR) break;
+    if (fds[1].revents) break;  // Stop
+    if (ready <= 0 || !(fds[0].revents & POLLIN)) {
+      if (ready == 0 && watcher->pendingCount > 0) FlushPending(watcher);
+      continue;
+    }
+
+    ssize_t length = read(watcher->inotifyFd, buffer.bytes, sizeof(buffer.bytes));
+    if (length <= 0) continue;
+    if (watcher->pendingCount == 0) burstStart = Now();
+    for (char *p = buffer.bytes; p < buffer.bytes + length;) {
+      const struct inotify_event *event = (const struct inotify_event *)p;
+      p += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        atomic_store_explicit(&watcher->overflow, true, memory_order_release);
+        Wake(watcher);
+        continue;
+      }
+      int dir = -1;
+      for (int i = 0; i < watcher->dirCount && dir < 0; i++) {
+        if (watcher->watchIds[i] == event->wd) dir = i;
+      }
+      if (dir < 0 || event->len == 0 || (event->mask & IN_ISDIR) || event->name[0] == '.') continue;
+      bool removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+      AddPending(watcher, dir, removed ? PIXEL_WATCH_REMOVED : PIXEL_WATCH_CHANGED, event->name);
+    }
+    if ((Now() - burstStart) * 1000.0 >= BURST_MAX_MS) FlushPending(watcher);
+  }
+}
+#endif
+
+static void *WatcherMain(void *arg) {
+  PixelWatcher *watcher = (PixelWatcher *)arg;
+#if defined(__linux__)
+  if (!watcher->polling) {
+    InotifyLoop(watcher);
+    return NULL;
+  }
+#endif
+  PollLoop(watcher);
+  return NULL;
+}
+
+// Watch dirs (missing ones are skipped silently). forcePolling selects the
+// fallback even where inotify is available, e.g. for network filesystems.
+PixelWatcher *PixelWatcherStart(const char *const *dirs, int dirCount, bool forcePolling) {
+  if (!dirs || dirCount <= 0) return NULL;
+  PixelWatcher *watcher = (PixelWatcher *)calloc(1, sizeof(PixelWatcher));
+  if (!watcher) return NULL;
+  atomic_init(&watcher->head, 0);
+  atomic_init(&watcher->tail, 0);
+  atomic_init(&watcher->overflow, false);
+  pthread_mutex_init(&watcher->lock, NULL);
+  pthread_cond_init(&watcher->changed, NULL);
+  watcher->polling = true;
+#if defined(__linux__)
+  watcher->inotifyFd = -1;
+  watcher->wakeFds[0] = watcher->wakeFds[1] = -1;
+#endif
+
+  watcher->dirs = (char **)calloc((size_t)dirCount, sizeof(char *));
+  if (!watcher->dirs) {
+    PixelWatcherStop(watcher);
+    return NULL;
+  }
+  watcher->dirCount = dirCount;
+  for (int i = 0; i < dirCount; i++) {
+    size_t length = strlen(dirs[i]) + 1;
+    watcher->dirs[i] = (char *)malloc(length);
+    if (!watcher->dirs[i]) {
+      PixelWatcherStop(watcher);
+      return NULL;
+    }
+    memcpy(watcher->dirs[i], dirs[i], length);
+  }
+
+#if defined(__linux__)
+  watcher->watchIds = (int *)malloc((size_t)dirCount * sizeof(int));
+  if (!forcePolling && watcher->watchIds && pipe(watcher->wakeFds) == 0) {
+    watcher->inotifyFd = inotify_init1(IN_CLOEXEC);
+    for (int i = 0; i < dirCount; i++) {
+      watcher->watchIds[i] = watcher->inotifyFd < 0 ? -1 :
+          inotify_add_watch(watcher->inotifyFd, watcher->dirs[i],
+                            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR);
+    }
+    watcher->polling = watcher->inotifyFd < 0;
+  }
+#else
+  (void)forcePolling;
+#endif
+
+  if (watcher->polling) {
+    watcher->snapshots = (DirSnapshot *)calloc((size_t)dirCount, sizeof(DirSnapshot));
+    if (!watcher->snapshots) {
+      PixelWatcherStop(watcher);
+      return NULL;
+    }
+    for (int i = 0; i < dirCount; i++) {
+      watcher->snapshots[i].fileCount = PixelListDirFiles(watcher->dirs[i], AcceptAnyFile, &watcher->snapshots[i].files);
+    }
+  }
+
+  if (pthread_create(&watcher->thread, NULL, WatcherMain, watcher) != 0) {
+    PixelWatcherStop(watcher);
+    return NULL;
+  }
+  watcher->threadStarted = true;
+  return watcher;
+}
+
+// Have wake (NULL for none) called whenever new events are queued.
+void PixelWatcherSetWake(PixelWatcher *watcher, PixelWatchWakeFn wake, void *user) {
+  if (!watcher) return;
+  pthread_mutex_lock(&watcher->lock);
+  watcher->wake = wake;
+  watcher->wakeUser = user;
+  pthread_mutex_unlock(&watcher->lock);
+}
+
+// Take the next coalesced change; call from one thread only. After an
+// overflow event the caller should rescan, as some changes were dropped.
+bool PixelWatcherPoll(PixelWatcher *watcher, PixelWatchEvent *event) {
+  if (!watcher || !event) return false;
+  unsigned tail = atomic_load_explicit(&watcher->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&watcher->head, memory_order_acquire);
+  if (tail == head) {
+    if (!atomic_exchange_explicit(&watcher->overflow, false, memory_order_acq_rel)) return false;
+    *event = (PixelWatchEvent){-1, PIXEL_WATCH_OVERFLOW, {0}};
+    return true;
+  }
+  *event = watcher->ring[tail & (PIXEL_WATCH_QUEUE_SIZE - 1)];
+  atomic_store_explicit(&watcher->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+// True while events (or an overflow) wait to be polled; call from the polling thread.
+bool PixelWatcherPending(const PixelWatcher *watcher) {
+  if (!watcher) return false;
+  unsigned tail = atomic_load_explicit(&watcher->tail, memory_order_relaxed);
+  return atomic_load_explicit(&watcher->head, memory_order_acquire) != tail ||
+         atomic_load_explicit(&watcher->overflow, memory_order_acquire);
+}
+
+// True when changes are found by rescanning rather than by notification.
+bool PixelWatcherPolling(const PixelWatcher *watcher) {
+  return watcher && watcher->polling;
+}
+
+void PixelWatcherStop(PixelWatcher *watcher) {
+  if (!watcher) return;
+  pthread_mutex_lock(&watcher->lock);
+  watcher->stop = true;
+  pthread_cond_broadcast(&watcher->changed);
+  pthread_mutex_unlock(&watcher->lock);
+#if defined(__linux__)
+  if (watcher->wakeFds[1] >= 0) {
+    char byte = 0;
+    ssize_t written = write(watcher->wakeFds[1], &byte, 1);
+    (void)written;  // A full pipe already holds a wakeup
+  }
+#endif
+  if (watcher->threadStarted) pthread_join(watcher->thread, NULL);
+
+#if defined(__linux__)
+  if (watcher->inotifyFd >= 0) close(watcher->inotifyFd);
+  if (watcher->wakeFds[0] >= 0) close(watcher->wakeFds[0]);
+  if (watcher->wakeFds[1] >= 0) close(watcher->wakeFds[1]);
+  free(watcher->watchIds);
+#endif
+  for (int i = 0; watcher->snapshots && i < watcher->dirCount; i++) {
+    PixelPaletteFreeFileList(watcher->snapshots[i].files, watcher->snapshots[i].fileCount);
+  }
+  free(watcher->snapshots);
+  for (int i = 0; watcher->dirs && i < watcher->dirCount; i++) free(watcher->dirs[i]);
+  free(watcher->dirs);
+  pthread_cond_destroy(&watcher->changed);
+  pthread_mutex_destroy(&watcher->lock);
+  free(watcher);
+}
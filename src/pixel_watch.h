@@ -0,0 +1,40 @@
+#ifndef PIXEL_WATCH_H
+#define PIXEL_WATCH_H
+
+#include <stdbool.h>
+
+#define PIXEL_WATCH_NAME_SIZE 128
+#define PIXEL_WATCH_QUEUE_SIZE 256     // Events the UI may fall behind by before an overflow (power of two)
+#define PIXEL_WATCH_COALESCE_MS 15     // A burst ends after this long without further changes
+#define PIXEL_WATCH_POLL_MS 250        // Scan interval of the polling fallback
+
+typedef enum {
+  PIXEL_WATCH_CHANGED = 0,         // Created, rewritten or renamed into the directory
+  PIXEL_WATCH_REMOVED,             // Deleted or renamed away
+  PIXEL_WATCH_OVERFLOW             // Events were lost; rescan every watched directory
+} PixelWatchKind;
+
+typedef struct {
+  int dir;                         // Index into the directories given to Start
+  PixelWatchKind kind;
+  char fileName[PIXEL_WATCH_NAME_SIZE];
+} PixelWatchEvent;
+
+// Directory watcher. A watcher thread uses inotify on Linux and otherwise
+// (or with forcePolling) compares directory listings by mtime and size. Each
+// burst of changes is coalesced to one event per file, then pushed to the UI
+// thread through a single-producer, single-consumer lock-free ring.
+typedef struct PixelWatcher PixelWatcher;
+
+// Called on the watcher thread after a burst is queued, e.g. to wake a UI
+// loop that blocks until the next input event.
+typedef void (*PixelWatchWakeFn)(void *user);
+
+PixelWatcher *PixelWatcherStart(const char *const *dirs, int dirCount, bool forcePolling);
+void PixelWatcherSetWake(PixelWatcher *watcher, PixelWatchWakeFn wake, void *user);
+bool PixelWatcherPoll(PixelWatcher *watcher, PixelWatchEvent *event);
+bool PixelWatcherPending(const PixelWatcher *watcher);
+bool PixelWatcherPolling(const PixelWatcher *watcher);
+void PixelWatcherStop(PixelWatcher *watcher);
+
+#endif
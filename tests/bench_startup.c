@@ -0,0 +1,97 @@
+// Headless cold-start benchmark: the non-GL launch work (user data paths,
+// palette library) timed against a budget, so regressions fail in CI.
+//
+// Usage: bench_startup <palettes-dir> [budget-ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pixel_palette.h"
+#include "pixel_palette_cache.h"
+#include "pixel_palette_loader.h"
+#include "pixel_startup.h"
+
+#define DEFAULT_BUDGET_MS 100.0
+#define DEFAULT_PALETTE "pico-8"
+
+// Same steps as the editor, minus the window and font: resolve and create
+// the user data dir, show the default palette, then list the library.
+static bool RunStartup(PixelStartupProfile *profile, const char *palettesDir) {
+  char appDir[512], libraryDir[600], cachePath[600];
+  if (!PixelUserDataDir(appDir, sizeof(appDir))) return false;
+  snprintf(libraryDir, sizeof(libraryDir), "%s/library", appDir);
+  snprintf(cachePath, sizeof(cachePath), "%s/palette-cache.bin", appDir);
+  if (!PixelMakeDirectories(libraryDir)) return false;
+  PixelStartupMark(profile, "paths");
+
+  PixelPaletteRegistry registry;
+  PixelPaletteRegistryInit(&registry);
+  char defaultPath[600];
+  snprintf(defaultPath, sizeof(defaultPath), "%s/%s.txt", palettesDir, DEFAULT_PALETTE);
+  PixelPaletteRegistryLoadFile(&registry, defaultPath);
+  PixelPaletteLoader *loader = PixelPaletteLoaderStart(palettesDir, cachePath, -1);
+  PixelStartupMark(profile, "default palette");
+
+  PixelPaletteLoaderWait(loader);
+  PixelPaletteLoaderDrain(loader, &registry);
+  bool ok = registry.count > 0;
+  PixelStartupMark(profile, "palette names");
+
+  // Not part of the budget in the editor (it happens behind the first
+  // frames), but joining here keeps the cache write out of the next run.
+  PixelPaletteLoaderDestroy(loader);
+  PixelPaletteRegistryFree(&registry);
+  return ok;
+}
+
+static void RemoveUserDir(const char *root) {
+  const char *paths[] = {".local/share/pixel/palette-cache.bin", ".local/share/pixel/library", ".local/share/pixel",
+                         ".local/share", ".local", ""};
+  for (int i = 0; i < 6; i++) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", root, paths[i]);
+    if (i == 0) unlink(path);
+    else rmdir(path);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <palettes-dir> [budget-ms]\n", argv[0]);
+    return 2;
+  }
+  double budgetMs = argc > 2 ? atof(argv[2]) : DEFAULT_BUDGET_MS;
+
+  // A fresh HOME makes the first run a true cold start: no user dirs, no cache.
+  char root[] = "/tmp/pixel-bench-XXXXXX";
+  if (!mkdtemp(root)) return 1;
+  setenv("HOME", root, 1);
+  unsetenv("XDG_DATA_HOME");
+
+  PixelStartupProfile cold, warm;
+  PixelStartupProfileInit(&cold);
+  bool ok = RunStartup(&cold, argv[1]);
+  PixelStartupProfileInit(&warm);
+  ok = RunStartup(&warm, argv[1]) && ok;
+  RemoveUserDir(root);
+
+  printf("cold start\n");
+  PixelStartupDump(&cold, stdout);
+  printf("warm start\n");
+  PixelStartupDump(&warm, stdout);
+  if (!ok) {
+    fprintf(stderr, "startup failed: no palettes loaded from %s\n", argv[1]);
+    return 1;
+  }
+
+  double coldMs = PixelStartupElapsedMs(&cold);
+  double warmMs = PixelStartupElapsedMs(&warm);
+  if (coldMs > budgetMs || warmMs > budgetMs) {
+    fprintf(stderr, "startup over budget: cold %.2f ms, warm %.2f ms, budget %.2f ms\n", coldMs, warmMs, budgetMs);
+    return 1;
+  }
+  printf("within budget: cold %.2f ms, warm %.2f ms, budget %.2f ms\n", coldMs, warmMs, budgetMs);
+  return 0;
+}
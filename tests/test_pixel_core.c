@@ -1,11 +1,34 @@
+#include <fcntl.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
+#include <utime.h>
 
+#include "pixel_anim.h"
 #include "pixel_core.h"
+#include "pixel_gif.h"
+#include "pixel_grid.h"
+#include "pixel_jobs.h"
+#include "pixel_journal.h"
+#include "pixel_layers.h"
+#include "pixel_library.h"
+#include "pixel_live.h"
+#include "pixel_palette.h"
+#include "pixel_palette_cache.h"
+#include "pixel_palette_import.h"
+#include "pixel_palette_layout.h"
+#include "pixel_palette_loader.h"
+#include "pixel_saver.h"
+#include "pixel_selection.h"
+#include "pixel_startup.h"
 #include "pixel_ui_logic.h"
+#include "pixel_watch.h"
 
 static int failures = 0;
 
@@ -16,18 +39,18 @@ static int failures = 0;
   } \
 } while (0)
 
-static bool ColorEq(Color a, Color b) {
-  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+static bool ColorEq(PixelColor a, PixelColor b) {
+  return PixelColorEqual(a, b);
 }
 
-static Color *AllocCanvas(int grid) {
-  return (Color *)calloc((size_t)grid * (size_t)grid, sizeof(Color));
+static PixelColor *AllocCanvas(int grid) {
+  return (PixelColor *)calloc((size_t)grid * (size_t)grid, sizeof(PixelColor));
 }
 
-static void FillPattern(Color *canvas, int grid) {
+static void FillPattern(PixelColor *canvas, int grid) {
   for (int y = 0; y < grid; y++) {
     for (int x = 0; x < grid; x++) {
-      canvas[y * grid + x] = (Color){
+      canvas[y * grid + x] = (PixelColor){
           (unsigned char)(x * 10 + y),
           (unsigned char)(x + y * 10),
           (unsigned char)(x * y),
@@ -65,8 +88,8 @@ static void TestBuildFilePath(void) {
 
 static void TestPaintBrushClamp(void) {
   int grid = 5;
-  Color *canvas = AllocCanvas(grid);
-  Color red = {255, 0, 0, 255};
+  PixelColor *canvas = AllocCanvas(grid);
+  PixelColor red = {255, 0, 0, 255};
   PixelPaintBrush(canvas, grid, 0, 0, red, 3);
 
   int painted = 0;
@@ -81,8 +104,8 @@ static void TestPaintBrushClamp(void) {
 
 static void TestSaveLoadRoundTrip(void) {
   int grid = 16;
-  Color *a = AllocCanvas(grid);
-  Color *b = AllocCanvas(grid);
+  PixelColor *a = AllocCanvas(grid);
+  PixelColor *b = AllocCanvas(grid);
   FillPattern(a, grid);
 
   char path[] = "/tmp/pixel-core-roundtrip-XXXXXX";
@@ -102,9 +125,58 @@ static void TestSaveLoadRoundTrip(void) {
   free(b);
 }
 
+static void TestBackgroundSave(void) {
+  char dir[] = "/tmp/pixel-saver-XXXXXX";
+  EXPECT_TRUE(mkdtemp(dir) != NULL);
+  char path[256], tempPath[512], missingPath[512];
+  snprintf(path, sizeof(path), "%s/sprite.txt", dir);
+  snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+  snprintf(missingPath, sizeof(missingPath), "%s/missing/sprite.txt", dir);
+
+  int grid = 64;
+  PixelColor *a = AllocCanvas(grid);
+  PixelColor *b = AllocCanvas(grid);
+  FillPattern(a, grid);
+  EXPECT_TRUE(PixelSaveCanvasText(path, b, grid));  // Blank file the save replaces
+
+  PixelSaver *saver = PixelSaverCreate();
+  EXPECT_TRUE(saver != NULL);
+  if (!saver) return;
+  EXPECT_TRUE(PixelSaverSubmit(saver, path, a, grid));
+  memset(a, 0, (size_t)grid * grid * sizeof(PixelColor));  // The saver works from its own copy
+  EXPECT_TRUE(PixelSaverSubmit(saver, missingPath, b, grid));
+  PixelSaverWait(saver);
+  EXPECT_TRUE(!PixelSaverBusy(saver));
+
+  PixelSaveEvent event;
+  EXPECT_TRUE(PixelSaverPoll(saver, &event));
+  EXPECT_TRUE(event.ok && strcmp(event.path, path) == 0 && event.seconds >= 0.0);
+  FILE *fp = fopen(path, "rb");
+  EXPECT_TRUE(fp != NULL);
+  if (fp) {
+    fseek(fp, 0, SEEK_END);
+    EXPECT_TRUE(event.bytesWritten == (size_t)ftell(fp));
+    fclose(fp);
+  }
+  EXPECT_TRUE(access(tempPath, F_OK) != 0);
+  FillPattern(a, grid);
+  EXPECT_TRUE(PixelLoadCanvasText(path, b, grid));
+  EXPECT_TRUE(memcmp(a, b, (size_t)grid * grid * sizeof(PixelColor)) == 0);
+
+  EXPECT_TRUE(PixelSaverPoll(saver, &event));
+  EXPECT_TRUE(!event.ok && event.bytesWritten == 0 && strcmp(event.path, missingPath) == 0);
+  EXPECT_TRUE(!PixelSaverPoll(saver, &event));
+  PixelSaverDestroy(saver);
+
+  unlink(path);
+  rmdir(dir);
+  free(a);
+  free(b);
+}
+
 static void TestLoadParsesRowsByIndex(void) {
   int grid = 4;
-  Color *canvas = AllocCanvas(grid);
+  PixelColor *canvas = AllocCanvas(grid);
 
   char path[] = "/tmp/pixel-core-rows-XXXXXX";
   int fd = mkstemp(path);
@@ -121,14 +193,1496 @@ static void TestLoadParsesRowsByIndex(void) {
   fclose(fp);
 
   EXPECT_TRUE(PixelLoadCanvasText(path, canvas, grid));
-  EXPECT_TRUE(ColorEq(canvas[2 * grid + 0], (Color){1, 2, 3, 255}));
-  EXPECT_TRUE(ColorEq(canvas[0 * grid + 0], (Color){13, 14, 15, 255}));
-  EXPECT_TRUE(ColorEq(canvas[1 * grid + 0], (Color){0, 0, 0, 0}));
+  EXPECT_TRUE(ColorEq(canvas[2 * grid + 0], (PixelColor){1, 2, 3, 255}));
+  EXPECT_TRUE(ColorEq(canvas[0 * grid + 0], (PixelColor){13, 14, 15, 255}));
+  EXPECT_TRUE(ColorEq(canvas[1 * grid + 0], (PixelColor){0, 0, 0, 0}));
 
   unlink(path);
   free(canvas);
 }
 
+static void TestLayerBlendModes(void) {
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, 8, 4));
+  int bottom = PixelLayerStackAddLayer(&stack, "fill");
+  int top = PixelLayerStackAddLayer(&stack, "shade");
+  EXPECT_TRUE(bottom == 0 && top == 1 && stack.activeLayer == 1);
+
+  for (int i = 0; i < 8 * 4; i++) {
+    stack.layers[bottom].pixels[i] = (PixelColor){200, 100, 50, 255};
+    stack.layers[top].pixels[i] = (PixelColor){128, 255, 0, 255};
+  }
+  stack.layers[top].pixels[5] = PIXEL_BLANK;
+  PixelLayerStackMarkAllDirty(&stack);
+
+  const PixelColor *flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], (PixelColor){128, 255, 0, 255}));
+  EXPECT_TRUE(ColorEq(flat[5], (PixelColor){200, 100, 50, 255}));
+
+  PixelLayerStackSetBlendMode(&stack, top, PIXEL_BLEND_MULTIPLY);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], (PixelColor){100, 100, 0, 255}));
+  EXPECT_TRUE(ColorEq(flat[5], (PixelColor){200, 100, 50, 255}));
+
+  PixelLayerStackSetBlendMode(&stack, top, PIXEL_BLEND_ADD);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], (PixelColor){255, 255, 50, 255}));
+
+  PixelLayerStackSetBlendMode(&stack, top, PIXEL_BLEND_NORMAL);
+  PixelLayerStackSetOpacity(&stack, top, 0);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], (PixelColor){200, 100, 50, 255}));
+
+  PixelLayerStackSetOpacity(&stack, top, 255);
+  PixelLayerStackSetVisible(&stack, bottom, false);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[5], PIXEL_BLANK));
+
+  PixelLayerStackFree(&stack);
+}
+
+static void TestLayerHalfAlphaComposite(void) {
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, 4, 1));
+  PixelLayerStackAddLayer(&stack, NULL);
+  for (int i = 0; i < 4; i++) stack.layers[0].pixels[i] = (PixelColor){255, 0, 0, 128};
+
+  const PixelColor *flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[3], (PixelColor){255, 0, 0, 128}));
+
+  PixelLayerStackAddLayer(&stack, NULL);
+  for (int i = 0; i < 4; i++) stack.layers[1].pixels[i] = (PixelColor){0, 0, 255, 128};
+  PixelLayerStackMarkAllDirty(&stack);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(flat[0].a == 192);
+  EXPECT_TRUE(flat[0].b > flat[0].r && flat[0].r > 0);
+
+  PixelLayerStackFree(&stack);
+}
+
+static void TestLayerDirtyTiles(void) {
+  int size = PIXEL_TILE_SIZE * 4;
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, size, size));
+  PixelLayerStackAddLayer(&stack, NULL);
+  PixelLayerStackAddLayer(&stack, NULL);
+  PixelLayerStackFlatten(&stack);
+
+  int y0 = -1, y1 = -1;
+  EXPECT_TRUE(PixelLayerStackTakeChangedRows(&stack, &y0, &y1));
+  EXPECT_TRUE(y0 == 0 && y1 == size);
+  EXPECT_TRUE(!PixelLayerStackTakeChangedRows(&stack, &y0, &y1));
+
+  PixelColor red = {255, 0, 0, 255};
+  PixelLayerStackPaintBrush(&stack, 0, PIXEL_TILE_SIZE + 1, PIXEL_TILE_SIZE * 2 + 1, red, 1);
+  EXPECT_TRUE(stack.dirtyCount == 1);
+
+  // Unmarked writes stay invisible until their tile is invalidated.
+  stack.layers[0].pixels[0] = red;
+  const PixelColor *flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[(PIXEL_TILE_SIZE * 2 + 1) * size + PIXEL_TILE_SIZE + 1], red));
+  EXPECT_TRUE(ColorEq(flat[0], PIXEL_BLANK));
+  EXPECT_TRUE(PixelLayerStackTakeChangedRows(&stack, &y0, &y1));
+  EXPECT_TRUE(y0 == PIXEL_TILE_SIZE * 2 && y1 == PIXEL_TILE_SIZE * 3);
+
+  EXPECT_TRUE(PixelLayerStackMoveLayer(&stack, 0, 1));
+  EXPECT_TRUE(stack.dirtyCount == 16);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], red));
+
+  EXPECT_TRUE(PixelLayerStackRemoveLayer(&stack, 1));
+  EXPECT_TRUE(stack.layerCount == 1 && stack.activeLayer == 0);
+  flat = PixelLayerStackFlatten(&stack);
+  EXPECT_TRUE(ColorEq(flat[0], PIXEL_BLANK));
+
+  PixelLayerStackFree(&stack);
+}
+
+static void CountJob(void *user, int item) {
+  int *hits = (int *)user;
+  __atomic_fetch_add(&hits[item], 1, __ATOMIC_RELAXED);
+}
+
+static void TestJobPoolRunsEveryItemOnce(void) {
+  enum { COUNT = 1000 };
+  static int items[COUNT];
+  static int hits[COUNT];
+  for (int i = 0; i < COUNT; i++) items[i] = COUNT - 1 - i;
+
+  PixelJobPool *pool = PixelJobPoolCreate(3);
+  EXPECT_TRUE(pool != NULL);
+  EXPECT_TRUE(PixelJobPoolWorkerCount(pool) == 3);
+
+  for (int round = 0; round < 20; round++) {
+    memset(hits, 0, sizeof(hits));
+    PixelJobPoolParallelFor(pool, items, COUNT - round, CountJob, hits);
+    int ok = 1;
+    for (int i = 0; i < COUNT; i++) {
+      int expected = (i >= round) ? 1 : 0;
+      if (hits[i] != expected) ok = 0;
+    }
+    EXPECT_TRUE(ok);
+  }
+
+  PixelJobPoolDestroy(pool);
+}
+
+static void TestLayerFlattenRectParallel(void) {
+  int size = PIXEL_TILE_SIZE * 8;
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, size, size));
+  for (int l = 0; l < 3; l++) {
+    PixelLayerStackAddLayer(&stack, NULL);
+    FillPattern(stack.layers[l].pixels, size);
+  }
+  PixelLayerStackSetBlendMode(&stack, 1, PIXEL_BLEND_MULTIPLY);
+  PixelLayerStackSetOpacity(&stack, 2, 100);
+
+  PixelColor *serial = AllocCanvas(size);
+  memcpy(serial, PixelLayerStackFlatten(&stack), (size_t)size * size * sizeof(PixelColor));
+
+  PixelJobPool *pool = PixelJobPoolCreate(2);
+  PixelLayerStackSetVisible(&stack, 0, false);
+  PixelLayerStackSetVisible(&stack, 0, true);
+  PixelLayerStackTakeChangedRows(&stack, NULL, NULL);
+
+  // Only the visible quarter is composited; the rest stays queued.
+  PixelLayerStackFlattenRect(&stack, pool, 0, 0, size / 2, size / 2);
+  EXPECT_TRUE(stack.dirtyCount == 64 - 16);
+  int y0 = 0, y1 = 0;
+  EXPECT_TRUE(PixelLayerStackTakeChangedRows(&stack, &y0, &y1));
+  EXPECT_TRUE(y0 == 0 && y1 == size / 2);
+
+  const PixelColor *flat = PixelLayerStackFlattenRect(&stack, pool, 0, 0, size, size);
+  EXPECT_TRUE(stack.dirtyCount == 0);
+  EXPECT_TRUE(memcmp(flat, serial, (size_t)size * size * sizeof(PixelColor)) == 0);
+
+  PixelJobPoolDestroy(pool);
+  PixelLayerStackFree(&stack);
+  free(serial);
+}
+
+static bool FrameDecodesTo(const PixelAnim *anim, int frame, const PixelColor *expected, int size) {
+  PixelColor *plane = AllocCanvas(size);
+  PixelColor *planes[1] = {plane};
+  PixelAnimDecodeFrame(anim, frame, planes, NULL, NULL);
+  bool same = memcmp(plane, expected, (size_t)size * size * sizeof(PixelColor)) == 0;
+  free(plane);
+  return same;
+}
+
+static void CountDecodedTile(void *user, int plane, int x, int y, int width, int height) {
+  (void)plane;
+  (void)x;
+  (void)y;
+  *(int *)user += width * height;
+}
+
+static void TestAnimDeltaStorage(void) {
+  int size = PIXEL_TILE_SIZE * 4;
+  PixelAnim anim;
+  EXPECT_TRUE(PixelAnimInit(&anim, size, size, 1, 0));
+  EXPECT_TRUE(anim.frameCount == 1 && anim.fps == 1);
+  EXPECT_TRUE(PixelAnimStoredTileCount(&anim) == 0);
+
+  PixelColor *key = AllocCanvas(size);
+  FillPattern(key, size);
+  PixelColor *planes[1] = {key};
+  EXPECT_TRUE(PixelAnimStoreFrame(&anim, 0, planes));
+  EXPECT_TRUE(PixelAnimStoredTileCount(&anim) == 16);
+
+  // Each delta touches one pixel, so it costs exactly one tile.
+  PixelColor *frames[5];
+  for (int i = 0; i < 5; i++) {
+    frames[i] = AllocCanvas(size);
+    memcpy(frames[i], key, (size_t)size * size * sizeof(PixelColor));
+    frames[i][i * PIXEL_TILE_SIZE * 3] = (PixelColor){1, 2, 3, 4};
+    PixelColor *deltaPlanes[1] = {frames[i]};
+    EXPECT_TRUE(PixelAnimInsertFrame(&anim, i + 1, false, deltaPlanes) == i + 1);
+  }
+  EXPECT_TRUE(anim.frameCount == 6);
+  EXPECT_TRUE(PixelAnimStoredTileCount(&anim) == 16 + 5);
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(FrameDecodesTo(&anim, i + 1, frames[i], size));
+
+  // Editing the keyframe must not leak into frames that depended on it.
+  PixelColor *edited = AllocCanvas(size);
+  memcpy(edited, key, (size_t)size * size * sizeof(PixelColor));
+  PixelPaintBrushEx(edited, size, size, size - 1, size - 1, (PixelColor){9, 9, 9, 255}, 1);
+  PixelColor *editedPlanes[1] = {edited};
+  EXPECT_TRUE(PixelAnimStoreFrameRect(&anim, 0, editedPlanes, size - 1, size - 1, 1, 1));
+  EXPECT_TRUE(FrameDecodesTo(&anim, 0, edited, size));
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(FrameDecodesTo(&anim, i + 1, frames[i], size));
+
+  // Promoting, demoting and deleting keyframes keep every frame's content.
+  EXPECT_TRUE(PixelAnimSetKeyframe(&anim, 3, true));
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(FrameDecodesTo(&anim, i + 1, frames[i], size));
+  EXPECT_TRUE(PixelAnimSetKeyframe(&anim, 3, false));
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(FrameDecodesTo(&anim, i + 1, frames[i], size));
+  EXPECT_TRUE(PixelAnimDeleteFrame(&anim, 0));
+  EXPECT_TRUE(anim.frames[0].keyframe);
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(FrameDecodesTo(&anim, i, frames[i], size));
+
+  // Decoding only rewrites tiles that differ from what the plane holds.
+  PixelColor *view = AllocCanvas(size);
+  PixelColor *viewPlanes[1] = {view};
+  int decodedPixels = 0;
+  PixelAnimDecodeFrame(&anim, 0, viewPlanes, CountDecodedTile, &decodedPixels);
+  EXPECT_TRUE(decodedPixels == size * size);
+  decodedPixels = 0;
+  EXPECT_TRUE(PixelAnimDecodeFrame(&anim, 1, viewPlanes, CountDecodedTile, &decodedPixels) == 2);
+  EXPECT_TRUE(decodedPixels == 2 * PIXEL_TILE_SIZE * PIXEL_TILE_SIZE);
+
+  free(view);
+  free(edited);
+  for (int i = 0; i < 5; i++) free(frames[i]);
+  free(key);
+  PixelAnimFree(&anim);
+}
+
+static void TestAnimPlanesAndPlayback(void) {
+  int size = PIXEL_TILE_SIZE;
+  PixelAnim anim;
+  EXPECT_TRUE(PixelAnimInit(&anim, size, size, 1, 10));
+  EXPECT_TRUE(PixelAnimInsertFrame(&anim, 1, false, NULL) == 1);
+  EXPECT_TRUE(PixelAnimInsertFrame(&anim, 2, true, NULL) == 2);
+
+  EXPECT_TRUE(PixelAnimInsertPlane(&anim, 1));
+  EXPECT_TRUE(anim.planeCount == 2);
+  PixelColor *bottom = AllocCanvas(size);
+  PixelColor *top = AllocCanvas(size);
+  top[0] = (PixelColor){255, 0, 0, 255};
+  PixelColor *planes[2] = {bottom, top};
+  EXPECT_TRUE(PixelAnimStoreFrame(&anim, 1, planes));
+  EXPECT_TRUE(PixelAnimStoredTileCount(&anim) == 1);
+  EXPECT_TRUE(PixelAnimMovePlane(&anim, 1, 0));
+  EXPECT_TRUE(PixelAnimRemovePlane(&anim, 1));
+  EXPECT_TRUE(anim.planeCount == 1 && PixelAnimStoredTileCount(&anim) == 1);
+  EXPECT_TRUE(FrameDecodesTo(&anim, 1, top, size));
+
+  anim.currentFrame = 0;
+  EXPECT_TRUE(!PixelAnimAdvance(&anim, 0.5));
+  anim.playing = true;
+  EXPECT_TRUE(!PixelAnimAdvance(&anim, 0.05));
+  EXPECT_TRUE(PixelAnimAdvance(&anim, 0.06));
+  EXPECT_TRUE(anim.currentFrame == 1);
+  EXPECT_TRUE(PixelAnimAdvance(&anim, 0.2));
+  EXPECT_TRUE(anim.currentFrame == 0);
+
+  free(bottom);
+  free(top);
+  PixelAnimFree(&anim);
+}
+
+// Minimal GIF LZW decoder used to check the encoder round trip.
+static int DecodeLzw(const unsigned char *data, size_t size, unsigned char *out, int outCap) {
+  int minCodeSize = data[0];
+  unsigned char bytes[1 << 16];
+  size_t byteCount = 0;
+  for (size_t p = 1; p < size && data[p] != 0; p += (size_t)data[p] + 1) {
+    memcpy(bytes + byteCount, data + p + 1, data[p]);
+    byteCount += data[p];
+  }
+
+  static unsigned short prefix[4096];
+  static unsigned char suffix[4096];
+  static unsigned char stack[4096];
+  int clearCode = 1 << minCodeSize, codeSize = minCodeSize + 1, next = clearCode + 2;
+  int prev = -1, written = 0;
+  unsigned char first = 0;
+  size_t bitPos = 0;
+  while (bitPos + (size_t)codeSize <= byteCount * 8) {
+    int code = 0;
+    for (int i = 0; i < codeSize; i++, bitPos++) code |= ((bytes[bitPos / 8] >> (bitPos % 8)) & 1) << i;
+    if (code == clearCode) {
+      codeSize = minCodeSize + 1;
+      next = clearCode + 2;
+      prev = -1;
+      continue;
+    }
+    if (code == clearCode + 1) break;
+
+    int depth = 0, cur = code;
+    if (prev >= 0 && code == next) {
+      stack[depth++] = first;
+      cur = prev;
+    }
+    while (cur >= clearCode) {
+      stack[depth++] = suffix[cur];
+      cur = prefix[cur];
+    }
+    stack[depth++] = (unsigned char)cur;
+    first = (unsigned char)cur;
+    while (depth > 0 && written < outCap) out[written++] = stack[--depth];
+
+    if (prev >= 0 && next < 4096) {
+      prefix[next] = (unsigned short)prev;
+      suffix[next] = first;
+      next++;
+      if (next == (1 << codeSize) && codeSize < 12) codeSize++;
+    }
+    prev = code;
+  }
+  return written;
+}
+
+static void TestGifEncodeRoundTrip(void) {
+  enum { W = 40, H = 30 };
+  PixelColor palette[3] = {{255, 0, 0, 255}, {0, 255, 0, 255}, {0, 0, 255, 255}};
+  PixelColor *a = AllocCanvas(W);
+  PixelColor *b = AllocCanvas(W);
+  for (int i = 0; i < W * H; i++) {
+    a[i] = (i % 7 == 0) ? PIXEL_BLANK : palette[(i / 3) % 3];
+    b[i] = a[i];
+  }
+  b[5 * W + 7] = (PixelColor){250, 10, 5, 255};
+  b[6 * W + 9] = palette[2];
+
+  const PixelColor *frames[3] = {a, b, b};
+  PixelGifOptions options = {.palette = palette, .paletteCount = 3, .fps = 10};
+  PixelJobPool *pool = PixelJobPoolCreate(2);
+  unsigned char *gif = NULL;
+  size_t size = 0;
+  EXPECT_TRUE(PixelGifEncode(frames, 3, W, H, &options, pool, &gif, &size));
+  EXPECT_TRUE(size > 13 && memcmp(gif, "GIF89a", 6) == 0 && gif[size - 1] == 0x3B);
+  EXPECT_TRUE(gif[6] == W && gif[8] == H && (gif[10] & 0x80) && (gif[10] & 7) == 1);
+
+  // Global table (4 entries), NETSCAPE loop block, then frame 0's extension.
+  size_t p = 13 + 12 + 19;
+  EXPECT_TRUE(gif[p] == 0x21 && gif[p + 1] == 0xF9 && (gif[p + 3] & 1) && gif[p + 6] == 3);
+  p += 8;
+  EXPECT_TRUE(gif[p] == 0x2C);
+  static unsigned char indices[W * H];
+  EXPECT_TRUE(DecodeLzw(gif + p + 10, size - p - 10, indices, W * H) == W * H);
+  int mismatches = 0;
+  for (int i = 0; i < W * H; i++) {
+    int expected = (i % 7 == 0) ? 3 : (i / 3) % 3;
+    if (indices[i] != expected) mismatches++;
+  }
+  EXPECT_TRUE(mismatches == 0);
+  free(gif);
+
+  // Per-frame tables drop the global table; cropping keeps later frames tiny.
+  options.perFramePalette = true;
+  EXPECT_TRUE(PixelGifEncode(frames, 3, W, H, &options, NULL, &gif, &size));
+  EXPECT_TRUE((gif[10] & 0x80) == 0);
+  EXPECT_TRUE(size < 13 + 19 + 2 * (8 + 10 + 12 + 64) + W * H);
+  free(gif);
+
+  PixelJobPoolDestroy(pool);
+  free(a);
+  free(b);
+}
+
+static bool LayersEqual(const PixelLayerStack *a, const PixelLayerStack *b) {
+  if (a->width != b->width || a->height != b->height || a->layerCount != b->layerCount) return false;
+  if (a->activeLayer != b->activeLayer) return false;
+  for (int i = 0; i < a->layerCount; i++) {
+    const PixelLayer *la = &a->layers[i], *lb = &b->layers[i];
+    if (la->visible != lb->visible || la->opacity != lb->opacity || la->blendMode != lb->blendMode) return false;
+    if (strcmp(la->name, lb->name) != 0) return false;
+    if (memcmp(la->pixels, lb->pixels, (size_t)a->width * a->height * sizeof(PixelColor)) != 0) return false;
+  }
+  return true;
+}
+
+static void TestAutosaveJournal(void) {
+  char path[] = "/tmp/pixel-journal-XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_TRUE(fd >= 0);
+  close(fd);
+
+  // 40x24 leaves partial tiles on the right and bottom edges.
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, 40, 24));
+  PixelLayerStackAddLayer(&stack, "Sky");
+  PixelLayerStackAddLayer(&stack, "Ink");
+  PixelLayerStackSetOpacity(&stack, 1, 128);
+  PixelLayerStackSetBlendMode(&stack, 1, PIXEL_BLEND_MULTIPLY);
+  PixelJournal *journal = PixelJournalOpen(path, &stack);
+  EXPECT_TRUE(journal != NULL);
+  if (!journal) return;
+  EXPECT_TRUE(PixelJournalFlush(journal));
+  size_t snapshotSize = PixelJournalSize(journal);
+
+  unsigned char mask[6];
+  PixelColor red = {255, 0, 0, 255}, blue = {0, 0, 255, 255};
+  memset(mask, 0, sizeof(mask));
+  PixelLayerStackPaintBrush(&stack, 1, 39, 23, red, 1);
+  mask[5] = 1;
+  EXPECT_TRUE(PixelJournalWriteTiles(journal, &stack, 1, mask));
+  memset(mask, 0, sizeof(mask));
+  PixelLayerStackPaintBrush(&stack, 0, 2, 2, blue, 3);
+  PixelLayerStackPaintBrush(&stack, 0, 20, 2, blue, 1);
+  mask[0] = mask[1] = 1;
+  EXPECT_TRUE(PixelJournalWriteTiles(journal, &stack, 0, mask));
+  EXPECT_TRUE(PixelJournalFlush(journal));
+  EXPECT_TRUE(PixelJournalSize(journal) > snapshotSize);
+
+  PixelLayerStack restored;
+  PixelJournalRecovery info;
+  EXPECT_TRUE(PixelLayerStackInit(&restored, 1, 1));
+  EXPECT_TRUE(PixelJournalRecover(path, &restored, &info));
+  EXPECT_TRUE(info.snapshotCount == 1 && info.tileRecordCount == 2 && info.tileCount == 3 && !info.truncated);
+  EXPECT_TRUE(LayersEqual(&stack, &restored));
+
+  // A torn final record is dropped; everything before it survives.
+  EXPECT_TRUE(truncate(path, (off_t)PixelJournalSize(journal) - 5) == 0);
+  EXPECT_TRUE(PixelJournalRecover(path, &restored, &info));
+  EXPECT_TRUE(info.tileRecordCount == 1 && info.truncated);
+  EXPECT_TRUE(ColorEq(restored.layers[1].pixels[23 * 40 + 39], red));
+  EXPECT_TRUE(ColorEq(restored.layers[0].pixels[2 * 40 + 2], PIXEL_BLANK));
+
+  // Compaction swaps in a single snapshot; later appends land in the new file.
+  EXPECT_TRUE(PixelJournalCompact(journal, &stack));
+  PixelLayerStackPaintBrush(&stack, 0, 30, 20, red, 1);
+  memset(mask, 0, sizeof(mask));
+  mask[4] = 1;
+  EXPECT_TRUE(PixelJournalWriteTiles(journal, &stack, 0, mask));
+  EXPECT_TRUE(PixelJournalFlush(journal));
+  EXPECT_TRUE(PixelJournalRecover(path, &restored, &info));
+  EXPECT_TRUE(info.snapshotCount == 1 && info.tileRecordCount == 1 && !info.truncated);
+  EXPECT_TRUE(LayersEqual(&stack, &restored));
+
+  PixelJournalClose(journal, true);
+  EXPECT_TRUE(access(path, F_OK) != 0);
+  EXPECT_TRUE(!PixelJournalRecover(path, &restored, &info));
+  PixelLayerStackFree(&restored);
+  PixelLayerStackFree(&stack);
+}
+
+static void TestGridLines(void) {
+  PixelGridSpec spec = {16, 16, 10.0f, 40.0f, 32.0f, 0, 0.0f, 0.0f, 1000.0f, 1000.0f};
+  PixelGridLine lines[64];
+  int count = PixelGridBuild(&spec, lines, 64);
+  EXPECT_TRUE(count == 34);
+  int vertical = 0;
+  for (int i = 0; i < count && i < 64; i++) {
+    if (lines[i].vertical) vertical++;
+    EXPECT_TRUE(lines[i].alpha == 255 && lines[i].length == 512.0f);
+    // Each boundary exactly once.
+    for (int j = 0; j < i; j++) {
+      EXPECT_TRUE(lines[i].vertical != lines[j].vertical || lines[i].x != lines[j].x || lines[i].y != lines[j].y);
+    }
+  }
+  EXPECT_TRUE(vertical == 17);
+  EXPECT_TRUE(PixelGridBuild(&spec, lines, 4) == 34);
+
+  // Major lines on tile boundaries; tiny cells keep only the majors.
+  spec.majorEvery = 8;
+  count = PixelGridBuild(&spec, lines, 64);
+  int majors = 0;
+  for (int i = 0; i < count; i++) majors += lines[i].major;
+  EXPECT_TRUE(count == 34 && majors == 6);
+  spec.cellSize = 2.0f;
+  count = PixelGridBuild(&spec, lines, 64);
+  EXPECT_TRUE(count == 6);
+  for (int i = 0; i < count; i++) EXPECT_TRUE(lines[i].major && lines[i].alpha == 255);
+
+  // Majors fade too once tiles get small; the border always stays.
+  spec.cellSize = 0.25f;
+  EXPECT_TRUE(PixelGridBuild(&spec, lines, 64) == 4);
+  spec.majorEvery = 5;
+  spec.cellSize = 1.0f;
+  EXPECT_TRUE(PixelGridBuild(&spec, lines, 64) == 10);
+
+  // Partial fade between the thresholds.
+  spec.majorEvery = 0;
+  spec.cellSize = 5.5f;
+  PixelGridBuild(&spec, lines, 64);
+  EXPECT_TRUE(lines[1].alpha == 128 && lines[0].alpha == 255);
+
+  // Only lines inside the clip region, clipped to it.
+  spec.cellSize = 32.0f;
+  spec.clipX = 10.0f + 4 * 32.0f;
+  spec.clipY = 40.0f + 100.0f;
+  spec.clipWidth = 64.0f;
+  spec.clipHeight = 50.0f;
+  count = PixelGridBuild(&spec, lines, 64);
+  EXPECT_TRUE(count == 3 + 1);
+  EXPECT_TRUE(lines[0].vertical && lines[0].x == 138.0f && lines[0].y == 140.0f && lines[0].length == 50.0f);
+  EXPECT_TRUE(!lines[3].vertical && lines[3].y == 40.0f + 4 * 32.0f && lines[3].length == 64.0f);
+}
+
+static void TestPaletteRegistry(void) {
+  PixelPaletteRegistry registry;
+  PixelPaletteRegistryInit(&registry);
+
+  // Far past the old 16 palette cap, with varied sizes sharing one color array.
+  char name[32];
+  PixelColor colors[300];
+  for (int i = 0; i < 2500; i++) {
+    int count = 1 + i % 300;
+    for (int c = 0; c < count; c++) colors[c] = (PixelColor){(unsigned char)i, (unsigned char)c, 7, 255};
+    snprintf(name, sizeof(name), "palette-%d", i);
+    EXPECT_TRUE(PixelPaletteRegistryAdd(&registry, name, colors, count) == i);
+  }
+  EXPECT_TRUE(registry.count == 2500);
+  EXPECT_TRUE(PixelPaletteRegistryAdd(&registry, "palette-42", colors, 3) == -1);
+  EXPECT_TRUE(PixelPaletteRegistryAdd(&registry, "empty", colors, 0) == -1);
+
+  int count = 0;
+  int index = PixelPaletteRegistryFind(&registry, "palette-2301");
+  const PixelColor *found = PixelPaletteColors(&registry, index, &count);
+  EXPECT_TRUE(index == 2301 && count == 1 + 2301 % 300);
+  EXPECT_TRUE(found[count - 1].r == (unsigned char)2301 && found[count - 1].g == (unsigned char)(count - 1));
+  EXPECT_TRUE(strcmp(PixelPaletteRegistryNames(&registry)[2301], "palette-2301") == 0);
+  EXPECT_TRUE(PixelPaletteRegistryFind(&registry, "missing") == -1);
+  EXPECT_TRUE(PixelPaletteColors(&registry, 2500, &count) == NULL && count == 0);
+
+  // Paint.NET files skip comments and take their name from the file.
+  const char *path = "test_palette_registry.txt";
+  FILE *fp = fopen(path, "w");
+  EXPECT_TRUE(fp != NULL);
+  if (fp) {
+    fputs(";paint.net Palette File\n;Colors: 2\nFF1A2B3C\nFFFFFFFF\n", fp);
+    fclose(fp);
+  }
+  index = PixelPaletteRegistryLoadFile(&registry, path);
+  found = PixelPaletteColors(&registry, index, &count);
+  EXPECT_TRUE(index == 2500 && count == 2 && strcmp(PixelPaletteName(&registry, index), "test_palette_registry") == 0);
+  EXPECT_TRUE(found && ColorEq(found[0], (PixelColor){0x1A, 0x2B, 0x3C, 255}));
+  remove(path);
+
+  PixelPaletteRegistryFree(&registry);
+}
+
+static void WritePaletteFile(const char *dir, const char *fileName, const char *body) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", dir, fileName);
+  FILE *fp = fopen(path, "w");
+  if (!fp) return;
+  fputs(body, fp);
+  fclose(fp);
+}
+
+static void TestLibraryThumbnails(void) {
+  char dir[] = "/tmp/pixel-library-XXXXXX";
+  EXPECT_TRUE(mkdtemp(dir) != NULL);
+  char path[512], cachePath[512];
+  snprintf(cachePath, sizeof(cachePath), "%s/thumbs.bin", dir);
+  PixelColor *small = AllocCanvas(16);
+  PixelColor *large = AllocCanvas(64);
+  FillPattern(small, 16);
+  FillPattern(large, 64);
+  snprintf(path, sizeof(path), "%s/a.txt", dir);
+  EXPECT_TRUE(PixelSaveCanvasText(path, small, 16));
+  snprintf(path, sizeof(path), "%s/b.txt", dir);
+  EXPECT_TRUE(PixelSaveCanvasText(path, large, 64));
+  snprintf(path, sizeof(path), "%s/c.txt", dir);
+  EXPECT_TRUE(PixelSaveCanvasText(path, small, 8));
+  WritePaletteFile(dir, "broken.txt", "not a project\n");
+  WritePaletteFile(dir, "notes.md", "ignored\n");
+
+  // Nothing is produced until requested; thumbnails sample the nearest pixel.
+  PixelLibrary *library = PixelLibraryOpen(dir, cachePath, 2);
+  EXPECT_TRUE(library != NULL);
+  if (!library) return;
+  EXPECT_TRUE(PixelLibraryCount(library) == 4);
+  EXPECT_TRUE(strcmp(PixelLibraryFileName(library, 2), "broken.txt") == 0);
+  EXPECT_TRUE(PixelLibraryThumbnail(library, 0) == NULL);
+  PixelLibraryRequest(library, 0, 2);
+  PixelLibraryWait(library);
+  const PixelColor *thumbA = PixelLibraryThumbnail(library, 0);
+  const PixelColor *thumbB = PixelLibraryThumbnail(library, 1);
+  EXPECT_TRUE(thumbA && thumbB && !PixelLibraryThumbnail(library, 3));
+  if (!thumbA || !thumbB) return;
+  EXPECT_TRUE(ColorEq(thumbA[5 * PIXEL_THUMB_SIZE + 7], small[2 * 16 + 3]));
+  EXPECT_TRUE(ColorEq(thumbB[5 * PIXEL_THUMB_SIZE + 7], large[10 * 64 + 14]));
+  PixelColor savedB[PIXEL_THUMB_SIZE * PIXEL_THUMB_SIZE];
+  memcpy(savedB, thumbB, sizeof(savedB));
+  PixelLibraryRequest(library, 0, 4);
+  PixelLibraryWait(library);
+  EXPECT_TRUE(PixelLibraryThumbnail(library, 2) == NULL && PixelLibraryThumbnail(library, 3) != NULL);
+
+  // A stopped library writes the cache on its own thread; Close only joins it.
+  PixelLibraryStop(library);
+  PixelLibraryWait(library);
+  EXPECT_TRUE(!PixelLibraryBusy(library) && PixelLibraryGetStats(library).cacheWritten);
+  EXPECT_TRUE(PixelLibraryThumbnail(library, 3) != NULL);
+  PixelLibraryStats stats;
+  PixelLibraryClose(library, &stats);
+  EXPECT_TRUE(stats.fileCount == 4 && stats.generatedCount == 3 && stats.cachedCount == 0 && stats.cacheWritten);
+
+  // Reopening reads only what is requested from the cache and keeps the rest.
+  library = PixelLibraryOpen(dir, cachePath, 2);
+  PixelLibraryRequest(library, 1, 2);
+  PixelLibraryWait(library);
+  EXPECT_TRUE(PixelLibraryThumbnail(library, 1) && memcmp(PixelLibraryThumbnail(library, 1), savedB, sizeof(savedB)) == 0);
+  PixelLibraryClose(library, &stats);
+  EXPECT_TRUE(stats.cachedCount == 1 && stats.generatedCount == 0 && !stats.cacheWritten);
+
+  // A changed file is rendered again; unchanged ones still come from the cache.
+  snprintf(path, sizeof(path), "%s/c.txt", dir);
+  EXPECT_TRUE(PixelSaveCanvasText(path, small, 4));
+  library = PixelLibraryOpen(dir, cachePath, 2);
+  PixelLibraryRequest(library, 0, 4);
+  PixelLibraryWait(library);
+  PixelLibraryClose(library, &stats);
+  EXPECT_TRUE(stats.cachedCount == 2 && stats.generatedCount == 1 && stats.cacheWritten);
+
+  // Cached thumbnails that can no longer be read are rendered again or, when
+  // that fails too, dropped; either way the cache is still rewritten.
+  struct stat info;
+  snprintf(path, sizeof(path), "%s/a.txt", dir);
+  EXPECT_TRUE(stat(path, &info) == 0);
+  library = PixelLibraryOpen(dir, cachePath, 2);
+  EXPECT_TRUE(truncate(cachePath, 64) == 0);
+  FILE *garbled = fopen(path, "wb");
+  for (off_t i = 0; garbled && i < info.st_size; i++) fputc('x', garbled);
+  if (garbled) fclose(garbled);
+  struct utimbuf times = {info.st_atime, info.st_mtime};
+  EXPECT_TRUE(utime(path, &times) == 0);
+  PixelLibraryRequest(library, 0, 4);
+  PixelLibraryWait(library);
+  EXPECT_TRUE(PixelLibraryThumbnail(library, 0) == NULL && PixelLibraryThumbnail(library, 1) != NULL);
+  PixelLibraryClose(library, &stats);
+  EXPECT_TRUE(stats.cachedCount == 0 && stats.generatedCount == 2 && stats.cacheWritten);
+
+  const char *names[] = {"a.txt", "b.txt", "c.txt", "broken.txt", "notes.md", "thumbs.bin"};
+  for (int i = 0; i < 6; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    unlink(path);
+  }
+
+  // Many projects parsed on several workers at once each keep their own rows.
+  enum { PROJECTS = 24 };
+  for (int i = 0; i < PROJECTS; i++) {
+    for (int p = 0; p < 64 * 64; p++) {
+      large[p] = (PixelColor){(unsigned char)(p % 64 * 4), (unsigned char)(p / 64 * 4), (unsigned char)(i * 10), 255};
+    }
+    snprintf(path, sizeof(path), "%s/p%02d.txt", dir, i);
+    EXPECT_TRUE(PixelSaveCanvasText(path, large, 64));
+  }
+  library = PixelLibraryOpen(dir, NULL, 4);
+  EXPECT_TRUE(library && PixelLibraryCount(library) == PROJECTS);
+  PixelLibraryRequest(library, 0, PROJECTS);
+  PixelLibraryWait(library);
+  bool intact = true;
+  for (int i = 0; i < PROJECTS; i++) {
+    const PixelColor *thumb = PixelLibraryThumbnail(library, i);
+    int project = -1;
+    intact = intact && thumb && sscanf(PixelLibraryFileName(library, i), "p%d.txt", &project) == 1;
+    for (int t = 0; intact && t < PIXEL_THUMB_SIZE * PIXEL_THUMB_SIZE; t++) {
+      int x = t % PIXEL_THUMB_SIZE * 2, y = t / PIXEL_THUMB_SIZE * 2;
+      PixelColor expected = {(unsigned char)(x * 4), (unsigned char)(y * 4), (unsigned char)(project * 10), 255};
+      intact = ColorEq(thumb[t], expected);
+    }
+  }
+  EXPECT_TRUE(intact);
+  PixelLibraryClose(library, NULL);
+  for (int i = 0; i < PROJECTS; i++) {
+    snprintf(path, sizeof(path), "%s/p%02d.txt", dir, i);
+    unlink(path);
+  }
+  rmdir(dir);
+  free(small);
+  free(large);
+}
+
+static void SleepMs(long ms) {
+  struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+  nanosleep(&delay, NULL);
+}
+
+// Collect watcher events until want of them arrived or two seconds passed.
+static int WaitWatchEvents(PixelWatcher *watcher, PixelWatchEvent *events, int want) {
+  int count = 0;
+  for (int waited = 0; count < want && waited < 2000; waited += 5) {
+    while (count < want && PixelWatcherPoll(watcher, &events[count])) count++;
+    if (count < want) SleepMs(5);
+  }
+  return count;
+}
+
+static void CountWake(void *user) {
+  atomic_fetch_add((atomic_int *)user, 1);
+}
+
+static void TestFileWatcher(void) {
+  char dir[] = "/tmp/pixel-watch-XXXXXX";
+  EXPECT_TRUE(mkdtemp(dir) != NULL);
+  char path[512];
+  const char *dirs[] = {dir};
+
+  // Both backends report each changed file; inotify coalesces a burst of
+  // rewrites into one event per file. Hidden files are never reported.
+  for (int polling = 0; polling < 2; polling++) {
+    PixelWatcher *watcher = PixelWatcherStart(dirs, 1, polling == 1);
+    EXPECT_TRUE(watcher != NULL);
+    if (!watcher) return;
+    EXPECT_TRUE(polling == 0 || PixelWatcherPolling(watcher));
+    PixelWatchEvent events[8];
+    EXPECT_TRUE(!PixelWatcherPoll(watcher, &events[0]));
+
+    WritePaletteFile(dir, ".hidden", "x\n");
+    // Polling compares mtime (whole seconds) and size, so each pass leaves a.txt a different size
+    const char *last = polling ? "FF102030\nFF405060\n" : "FF102030\nFF405060\nFF708090\n";
+    for (int i = 0; i < 3; i++) WritePaletteFile(dir, "a.txt", i == 2 ? last : "FF000000\n");
+    WritePaletteFile(dir, "b.txt", "FFFFFFFF\n");
+    int count = WaitWatchEvents(watcher, events, 2);
+    EXPECT_TRUE(count == 2);
+    bool sawA = false, sawB = false;
+    for (int i = 0; i < count; i++) {
+      EXPECT_TRUE(events[i].dir == 0 && events[i].kind == PIXEL_WATCH_CHANGED);
+      sawA = sawA || strcmp(events[i].fileName, "a.txt") == 0;
+      sawB = sawB || strcmp(events[i].fileName, "b.txt") == 0;
+    }
+    EXPECT_TRUE(sawA && sawB);
+    if (!PixelWatcherPolling(watcher)) {
+      SleepMs(50);
+      EXPECT_TRUE(!PixelWatcherPoll(watcher, &events[0]));
+    }
+
+    snprintf(path, sizeof(path), "%s/b.txt", dir);
+    unlink(path);
+    count = WaitWatchEvents(watcher, events, 1);
+    EXPECT_TRUE(count == 1 && events[0].kind == PIXEL_WATCH_REMOVED && strcmp(events[0].fileName, "b.txt") == 0);
+    PixelWatcherStop(watcher);
+  }
+
+  // A sleeping render loop is woken when a file changes and stays busy until
+  // the events are drained.
+  PixelRedrawState redraw;
+  PixelRedrawInit(&redraw);
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, false) && PixelRedrawFrameDone(&redraw, false));
+  PixelWatcher *watcher = PixelWatcherStart(dirs, 1, false);
+  atomic_int wakes = 0;
+  PixelWatcherSetWake(watcher, CountWake, &wakes);
+  EXPECT_TRUE(watcher && !PixelWatcherPending(watcher));
+  WritePaletteFile(dir, "a.txt", "FF000000\n");
+  for (int waited = 0; atomic_load(&wakes) == 0 && waited < 2000; waited += 5) SleepMs(5);
+  EXPECT_TRUE(atomic_load(&wakes) > 0 && PixelWatcherPending(watcher));
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, PixelWatcherPending(watcher)));
+  PixelWatchEvent event;
+  while (PixelWatcherPoll(watcher, &event)) continue;
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, PixelWatcherPending(watcher)));
+  EXPECT_TRUE(PixelRedrawFrameDone(&redraw, PixelWatcherPending(watcher)));
+  PixelWatcherStop(watcher);
+  WritePaletteFile(dir, "a.txt", "FF102030\nFF405060\n");
+
+  // A reloaded palette keeps its index and takes the file's new colors.
+  PixelPaletteRegistry registry;
+  PixelPaletteRegistryInit(&registry);
+  snprintf(path, sizeof(path), "%s/a.txt", dir);
+  int index = PixelPaletteRegistryLoadFile(&registry, path);
+  int count = 0;
+  EXPECT_TRUE(index == 0 && PixelPaletteColors(&registry, 0, &count) && count == 2);
+  WritePaletteFile(dir, "a.txt", "FF000000\nFF0000FF\nFFFFFFFF\n");
+  EXPECT_TRUE(PixelPaletteRegistryReloadFile(&registry, path) == index);
+  const PixelColor *colors = PixelPaletteColors(&registry, index, &count);
+  EXPECT_TRUE(count == 3 && ColorEq(colors[1], (PixelColor){0, 0, 255, 255}));
+  WritePaletteFile(dir, "a.txt", "FF102030\n");
+  EXPECT_TRUE(PixelPaletteRegistryReloadFile(&registry, path) == index);
+  colors = PixelPaletteColors(&registry, index, &count);
+  EXPECT_TRUE(count == 1 && ColorEq(colors[0], (PixelColor){0x10, 0x20, 0x30, 255}));
+  WritePaletteFile(dir, "c.txt", "FFFFFFFF\n");
+  snprintf(path, sizeof(path), "%s/c.txt", dir);
+  EXPECT_TRUE(PixelPaletteRegistryReloadFile(&registry, path) == 1 && registry.count == 2);
+  PixelPaletteRegistryFree(&registry);
+
+  const char *names[] = {"a.txt", "c.txt", ".hidden"};
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+}
+
+static void TestLiveLink(void) {
+  char name[64];
+  snprintf(name, sizeof(name), "/pixel-test-live-%d", (int)getpid());
+  EXPECT_TRUE(PixelLiveViewOpen(name) == NULL);
+  PixelColor *canvas = AllocCanvas(16);
+  FillPattern(canvas, 16);
+  PixelLivePublisher *publisher = PixelLivePublisherCreate(name, 16, 16);
+  EXPECT_TRUE(publisher != NULL);
+  if (!publisher) {
+    free(canvas);
+    return;
+  }
+
+  // Nothing to acquire before the first publish; then frames map zero-copy.
+  PixelLiveView *view = PixelLiveViewOpen(name);
+  EXPECT_TRUE(view != NULL);
+  if (!view) return;
+  PixelLiveFrame frame;
+  EXPECT_TRUE(!PixelLiveViewAcquire(view, &frame));
+  EXPECT_TRUE(PixelLivePublish(publisher, canvas, 0, 0, 16, 16));
+  EXPECT_TRUE(PixelLiveViewAcquire(view, &frame) && frame.generation == 1 && frame.width == 16);
+  EXPECT_TRUE(memcmp(frame.pixels, canvas, 16 * 16 * sizeof(PixelColor)) == 0);
+  EXPECT_TRUE(PixelLiveViewIntact(view, &frame) && !PixelLiveViewAcquire(view, &frame));
+
+  // Each publish reports its dirty rectangle and fills the back buffer from
+  // the last two, so alternating buffers both stay current.
+  for (int i = 0; i < 3; i++) {
+    canvas[5 * 16 + i] = (PixelColor){1, 2, 3, 255};
+    EXPECT_TRUE(PixelLivePublish(publisher, canvas, i, 5, 1, 1));
+    EXPECT_TRUE(PixelLiveViewAcquire(view, &frame) && frame.generation == (uint64_t)(2 + i));
+    EXPECT_TRUE(frame.dirty.x == i && frame.dirty.y == 5 && frame.dirty.width == 1 && frame.dirty.height == 1);
+    EXPECT_TRUE(memcmp(frame.pixels, canvas, 16 * 16 * sizeof(PixelColor)) == 0);
+  }
+
+  // A reader overtaken by two publishes must retry; skipped frames mark everything dirty.
+  PixelLivePublish(publisher, canvas, 0, 0, 1, 1);
+  EXPECT_TRUE(PixelLiveViewIntact(view, &frame));
+  PixelLivePublish(publisher, canvas, 0, 0, 1, 1);
+  EXPECT_TRUE(!PixelLiveViewIntact(view, &frame));
+  EXPECT_TRUE(PixelLiveViewAcquire(view, &frame) && frame.generation == 6 && frame.dirty.width == 16);
+  EXPECT_TRUE(!PixelLivePublish(publisher, canvas, 16, 0, 4, 4));
+
+  EXPECT_TRUE(!PixelLiveViewClosed(view));
+  PixelLivePublisherDestroy(publisher);
+  EXPECT_TRUE(PixelLiveViewClosed(view));
+  PixelLiveViewClose(view);
+  EXPECT_TRUE(PixelLiveViewOpen(name) == NULL);
+  free(canvas);
+
+  // A segment too short for the frame size its header claims is refused.
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  EXPECT_TRUE(fd >= 0 && ftruncate(fd, (off_t)sizeof(PixelLiveHeader)) == 0);
+  PixelLiveHeader *header = fd >= 0 ? (PixelLiveHeader *)mmap(NULL, sizeof(PixelLiveHeader), PROT_READ | PROT_WRITE,
+                                                              MAP_SHARED, fd, 0)
+                                    : MAP_FAILED;
+  if (fd >= 0) close(fd);
+  EXPECT_TRUE(header != MAP_FAILED);
+  if (header != MAP_FAILED) {
+    header->magic = PIXEL_LIVE_MAGIC;
+    header->version = PIXEL_LIVE_VERSION;
+    header->width = 4096;
+    header->height = 4096;
+    header->bufferOffset[0] = header->bufferOffset[1] = sizeof(PixelLiveHeader);
+    munmap(header, sizeof(PixelLiveHeader));
+    EXPECT_TRUE(PixelLiveViewOpen(name) == NULL);
+  }
+  shm_unlink(name);
+}
+
+static void SetMaskBit(PixelMask *mask, int x, int y) {
+  mask->words[(size_t)y * (size_t)mask->wordsPerRow + (size_t)(x >> 6)] |= UINT64_C(1) << (x & 63);
+}
+
+static void TestSelectionMasks(void) {
+  // 130 columns spans three words per row, with a partial last word.
+  PixelMask mask, shape;
+  EXPECT_TRUE(PixelMaskInit(&mask, 130, 40) && PixelMaskInit(&shape, 130, 40));
+  EXPECT_TRUE(mask.wordsPerRow == 3 && PixelMaskEmpty(&mask));
+  PixelMaskRect(&mask, 60, 5, 10, 4);
+  EXPECT_TRUE(PixelMaskCount(&mask) == 40 && PixelMaskGet(&mask, 63, 5) && PixelMaskGet(&mask, 64, 8));
+  EXPECT_TRUE(!PixelMaskGet(&mask, 59, 5) && !PixelMaskGet(&mask, 70, 5) && !PixelMaskGet(&mask, 60, 9));
+  int x = 0, y = 0, width = 0, height = 0;
+  EXPECT_TRUE(PixelMaskBounds(&mask, &x, &y, &width, &height) && x == 60 && y == 5 && width == 10 && height == 4);
+
+  // Boolean ops, including the word-wise SIMD path and the padding bits.
+  PixelMaskRect(&shape, 65, 0, 100, 40);
+  PixelMask work;
+  EXPECT_TRUE(PixelMaskInit(&work, 130, 40));
+  PixelMaskCombine(&work, &mask, PIXEL_MASK_REPLACE);
+  PixelMaskCombine(&work, &shape, PIXEL_MASK_INTERSECT);
+  EXPECT_TRUE(PixelMaskCount(&work) == 20 && PixelMaskGet(&work, 65, 5) && !PixelMaskGet(&work, 64, 5));
+  PixelMaskCombine(&work, &mask, PIXEL_MASK_REPLACE);
+  PixelMaskCombine(&work, &shape, PIXEL_MASK_SUBTRACT);
+  EXPECT_TRUE(PixelMaskCount(&work) == 20 && PixelMaskGet(&work, 64, 5) && !PixelMaskGet(&work, 65, 5));
+  PixelMaskCombine(&work, &shape, PIXEL_MASK_UNION);
+  EXPECT_TRUE(PixelMaskCount(&work) == 20 + 65 * 40);
+  PixelMaskInvert(&work);
+  EXPECT_TRUE(PixelMaskCount(&work) == 130 * 40 - 20 - 65 * 40 && (work.words[2] >> 2) == 0);
+  PixelMaskSelectAll(&work);
+  EXPECT_TRUE(PixelMaskCount(&work) == 130 * 40);
+  PixelMaskInvert(&work);
+  EXPECT_TRUE(PixelMaskEmpty(&work) && !PixelMaskBounds(&work, NULL, NULL, NULL, NULL));
+
+  // Lasso: a diamond is filled between its edges, outline included.
+  PixelMaskPoint diamond[] = {{10, 10}, {20, 20}, {10, 30}, {0, 20}};
+  EXPECT_TRUE(PixelMaskPolygon(&work, diamond, 4));
+  EXPECT_TRUE(PixelMaskGet(&work, 10, 20) && PixelMaskGet(&work, 10, 10) && PixelMaskGet(&work, 20, 20));
+  EXPECT_TRUE(PixelMaskGet(&work, 5, 15) && !PixelMaskGet(&work, 4, 15) && !PixelMaskGet(&work, 1, 12));
+  EXPECT_TRUE(PixelMaskCount(&work) == 221);
+  PixelMaskPoint line[] = {{100, 2}, {129, 2}};
+  EXPECT_TRUE(PixelMaskPolygon(&work, line, 2) && PixelMaskCount(&work) == 30);
+
+  // Magic wand: 4-connected pixels within tolerance of the seed only.
+  PixelColor *canvas = (PixelColor *)calloc(130 * 40, sizeof(PixelColor));
+  for (int i = 0; i < 130 * 40; i++) canvas[i] = (PixelColor){200, 0, 0, 255};
+  for (int row = 0; row < 40; row++) canvas[row * 130 + 50] = (PixelColor){0, 0, 255, 255};  // Wall
+  canvas[3 * 130 + 10] = (PixelColor){210, 5, 0, 255};
+  canvas[4 * 130 + 11] = (PixelColor){0, 255, 0, 255};
+  EXPECT_TRUE(PixelMaskMagicWand(&work, canvas, 0, 0, 16));
+  EXPECT_TRUE(PixelMaskCount(&work) == 50 * 40 - 1 && PixelMaskGet(&work, 10, 3) && !PixelMaskGet(&work, 11, 4));
+  EXPECT_TRUE(PixelMaskMagicWand(&work, canvas, 0, 0, 0) && PixelMaskCount(&work) == 50 * 40 - 2);
+  EXPECT_TRUE(PixelMaskMagicWand(&work, canvas, 129, 39, 16) && PixelMaskCount(&work) == 79 * 40);
+
+  // Painting is clipped to the selection.
+  PixelMaskRect(&work, 2, 2, 2, 2);
+  PixelMaskPaintBrush(&work, canvas, 2, 2, (PixelColor){1, 2, 3, 255}, 5);
+  EXPECT_TRUE(ColorEq(canvas[2 * 130 + 2], (PixelColor){1, 2, 3, 255}));
+  EXPECT_TRUE(ColorEq(canvas[3 * 130 + 3], (PixelColor){1, 2, 3, 255}));
+  EXPECT_TRUE(ColorEq(canvas[1 * 130 + 2], (PixelColor){200, 0, 0, 255}));
+  EXPECT_TRUE(ColorEq(canvas[2 * 130 + 4], (PixelColor){200, 0, 0, 255}));
+
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, 130, 40));
+  PixelLayerStackAddLayer(&stack, NULL);
+  PixelLayerStackPaintBrushMasked(&stack, 0, 4, 4, (PixelColor){9, 9, 9, 255}, 9, &work);
+  EXPECT_TRUE(ColorEq(stack.layers[0].pixels[3 * 130 + 3], (PixelColor){9, 9, 9, 255}));
+  EXPECT_TRUE(stack.layers[0].pixels[4 * 130 + 4].a == 0);
+  PixelLayerStackFree(&stack);
+
+  PixelColor overlay[130 * 40];
+  PixelMaskExpand(&work, overlay, (PixelColor){1, 1, 1, 1}, PIXEL_BLANK);
+  EXPECT_TRUE(overlay[2 * 130 + 3].a == 1 && overlay[2 * 130 + 4].a == 0);
+  free(canvas);
+  PixelMaskFree(&work);
+  PixelMaskFree(&shape);
+  PixelMaskFree(&mask);
+}
+
+// Where source pixel (x, y) of a width x height canvas lands, and the result's row length.
+static int TransformedIndex(PixelTransform transform, int x, int y, int width, int height) {
+  switch (transform) {
+    case PIXEL_TRANSFORM_FLIP_HORIZONTAL: return y * width + (width - 1 - x);
+    case PIXEL_TRANSFORM_FLIP_VERTICAL: return (height - 1 - y) * width + x;
+    case PIXEL_TRANSFORM_ROTATE_90: return x * height + (height - 1 - y);
+    case PIXEL_TRANSFORM_ROTATE_180: return (height - 1 - y) * width + (width - 1 - x);
+    case PIXEL_TRANSFORM_ROTATE_270: return (width - 1 - x) * height + y;
+    default: return x * height + y;
+  }
+}
+
+static void TestCanvasTransforms(void) {
+  // Square and ragged shapes exercise the in-place, register-block and edge paths of every transform.
+  const int shapes[][2] = {{64, 64}, {37, 37}, {70, 45}, {13, 66}, {9, 1}, {1, 1}};
+  for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+    int w = shapes[s][0], h = shapes[s][1];
+    size_t count = (size_t)w * (size_t)h;
+    PixelColor *src = (PixelColor *)malloc(count * sizeof(PixelColor));
+    PixelColor *copy = (PixelColor *)malloc(count * sizeof(PixelColor));
+    PixelColor *inPlace = (PixelColor *)malloc(count * sizeof(PixelColor));
+    unsigned char *indexed = (unsigned char *)malloc(count);
+    unsigned char *indexedCopy = (unsigned char *)malloc(count);
+    unsigned char *indexedInPlace = (unsigned char *)malloc(count);
+    for (size_t i = 0; i < count; i++) {
+      src[i] = (PixelColor){(unsigned char)i, (unsigned char)(i >> 8), (unsigned char)s, 255};
+      indexed[i] = (unsigned char)(i * 7 + s);
+    }
+    for (int t = PIXEL_TRANSFORM_FLIP_HORIZONTAL; t <= PIXEL_TRANSFORM_TRANSPOSE; t++) {
+      PixelTransform transform = (PixelTransform)t;
+      PixelTransformCanvasCopy(copy, src, w, h, transform);
+      memcpy(inPlace, src, count * sizeof(PixelColor));
+      EXPECT_TRUE(PixelTransformCanvas(inPlace, w, h, transform));
+      PixelTransformIndexedCopy(indexedCopy, indexed, w, h, transform);
+      memcpy(indexedInPlace, indexed, count);
+      EXPECT_TRUE(PixelTransformIndexed(indexedInPlace, w, h, transform));
+      bool same = true;
+      for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+          int to = TransformedIndex(transform, x, y, w, h);
+          same = same && ColorEq(copy[to], src[y * w + x]) && ColorEq(inPlace[to], src[y * w + x]);
+          same = same && indexedCopy[to] == indexed[y * w + x] && indexedInPlace[to] == indexed[y * w + x];
+        }
+      }
+      EXPECT_TRUE(same);
+    }
+    free(src);
+    free(copy);
+    free(inPlace);
+    free(indexed);
+    free(indexedCopy);
+    free(indexedInPlace);
+  }
+  EXPECT_TRUE(PixelTransformSwapsAxes(PIXEL_TRANSFORM_ROTATE_270) && !PixelTransformSwapsAxes(PIXEL_TRANSFORM_ROTATE_180));
+}
+
+static void TestColorReplace(void) {
+  // Lengths around the four-pixel blocks; only exact RGBA matches change.
+  const PixelColor a = {200, 10, 10, 255}, b = {10, 200, 10, 255}, c = {10, 10, 200, 255};
+  for (int count = 0; count < 11; count++) {
+    PixelColor pixels[11];
+    size_t expected = 0;
+    for (int i = 0; i < count; i++) {
+      pixels[i] = i % 3 == 0 ? a : (i % 3 == 1 ? c : (PixelColor){200, 10, 10, 254});
+      expected += i % 3 == 0;
+    }
+    EXPECT_TRUE(PixelReplaceColor(pixels, (size_t)count, a, b) == expected);
+    bool replaced = true;
+    for (int i = 0; i < count; i++) {
+      replaced = replaced && ColorEq(pixels[i], i % 3 == 0 ? b : (i % 3 == 1 ? c : (PixelColor){200, 10, 10, 254}));
+    }
+    EXPECT_TRUE(replaced);
+  }
+
+  // A palette swap trades colors at the same index in one pass: a and b
+  // exchange places, duplicates map by their first index, strays stay put.
+  const PixelColor from[] = {a, b, c, a};
+  const PixelColor to[] = {b, a, c, PIXEL_BLANK};
+  PixelColor pixels[] = {a, a, b, c, PIXEL_BLANK, a, (PixelColor){1, 2, 3, 255}, b};
+  size_t changed = 0;
+  EXPECT_TRUE(PixelSwapPalette(pixels, 8, from, to, 4, &changed) && changed == 5);
+  EXPECT_TRUE(ColorEq(pixels[0], b) && ColorEq(pixels[1], b) && ColorEq(pixels[2], a) && ColorEq(pixels[3], c));
+  EXPECT_TRUE(pixels[4].a == 0 && ColorEq(pixels[5], b) && ColorEq(pixels[6], (PixelColor){1, 2, 3, 255}));
+  EXPECT_TRUE(ColorEq(pixels[7], a));
+
+  // Large palettes grow the table past its first size.
+  PixelColor big[300], shifted[300], canvas[600];
+  for (int i = 0; i < 300; i++) big[i] = (PixelColor){(unsigned char)i, (unsigned char)(i >> 8), 77, 255};
+  for (int i = 0; i < 300; i++) shifted[i] = big[(i + 1) % 300];
+  for (int i = 0; i < 600; i++) canvas[i] = big[i % 300];
+  EXPECT_TRUE(PixelSwapPalette(canvas, 600, big, shifted, 300, &changed) && changed == 600);
+  EXPECT_TRUE(ColorEq(canvas[0], big[1]) && ColorEq(canvas[299], big[0]) && ColorEq(canvas[599], big[0]));
+
+  unsigned char map[256], indexed[7] = {0, 1, 2, 3, 4, 5, 255};
+  for (int i = 0; i < 256; i++) map[i] = (unsigned char)(255 - i);
+  PixelRemapIndexed(indexed, 7, map);
+  EXPECT_TRUE(indexed[0] == 255 && indexed[5] == 250 && indexed[6] == 0);
+}
+
+// True when the stack's running counts equal a fresh count of every layer.
+static bool HistogramMatchesLayers(const PixelLayerStack *stack) {
+  PixelHistogram fresh;
+  PixelHistogramInit(&fresh);
+  size_t area = (size_t)stack->width * (size_t)stack->height;
+  for (int i = 0; i < stack->layerCount; i++) PixelHistogramAddPixels(&fresh, stack->layers[i].pixels, area);
+  bool match = fresh.total == stack->colors.total;
+  for (int i = 0; i < stack->layerCount && match; i++) {
+    for (size_t p = 0; p < area && match; p++) {
+      PixelColor color = stack->layers[i].pixels[p];
+      match = PixelHistogramCount(&fresh, color) == PixelHistogramCount(&stack->colors, color);
+    }
+  }
+  PixelHistogramFree(&fresh);
+  return match;
+}
+
+static void BeginStackTile(void *user, int plane, int x, int y, int width, int height) {
+  PixelLayerStackBeginEdit((PixelLayerStack *)user, plane, x, y, width, height);
+}
+
+static void EndStackTile(void *user, int plane, int x, int y, int width, int height) {
+  PixelLayerStackEndEdit((PixelLayerStack *)user, plane, x, y, width, height);
+}
+
+static void TestColorHistogram(void) {
+  const PixelColor red = {255, 0, 0, 255}, green = {0, 255, 0, 255}, blue = {0, 0, 255, 255};
+  PixelHistogram histogram;
+  PixelHistogramInit(&histogram);
+  EXPECT_TRUE(PixelHistogramCount(&histogram, red) == 0);
+  EXPECT_TRUE(PixelHistogramAdd(&histogram, red, 5) && PixelHistogramAdd(&histogram, PIXEL_BLANK, 9));
+  PixelHistogramRemove(&histogram, red, 2);
+  PixelHistogramRemove(&histogram, green, 4);
+  EXPECT_TRUE(PixelHistogramCount(&histogram, red) == 3 && histogram.total == 3);
+  EXPECT_TRUE(PixelHistogramCount(&histogram, PIXEL_BLANK) == 0 && PixelHistogramCount(&histogram, green) == 0);
+
+  // Thousands of colors come and go; emptied ones are dropped on a rehash.
+  for (int i = 1; i <= 3000; i++) PixelHistogramAdd(&histogram, (PixelColor){i & 255, i >> 8, 7, 255}, (size_t)i);
+  for (int i = 1; i <= 3000; i += 2) PixelHistogramRemove(&histogram, (PixelColor){i & 255, i >> 8, 7, 255}, (size_t)i);
+  for (int i = 1; i <= 3000; i++) PixelHistogramAdd(&histogram, (PixelColor){i & 255, i >> 8, 9, 255}, 1);
+  bool counted = histogram.total == 3 + 1500 * 1501 + 3000;
+  for (int i = 1; i <= 3000; i++) {
+    size_t kept = PixelHistogramCount(&histogram, (PixelColor){i & 255, i >> 8, 7, 255});
+    counted = counted && kept == (size_t)(i % 2 ? 0 : i);
+    counted = counted && PixelHistogramCount(&histogram, (PixelColor){i & 255, i >> 8, 9, 255}) == 1;
+  }
+  EXPECT_TRUE(counted && PixelHistogramCount(&histogram, red) == 3);
+  const PixelColor run[] = {red, red, PIXEL_BLANK, green};
+  EXPECT_TRUE(PixelHistogramAddPixels(&histogram, run, 4) && PixelHistogramCount(&histogram, red) == 5);
+  PixelHistogramRemovePixels(&histogram, run, 4);
+  PixelHistogramClear(&histogram);
+  EXPECT_TRUE(histogram.total == 0 && PixelHistogramCount(&histogram, red) == 0);
+  PixelHistogramFree(&histogram);
+
+  // Every edit path keeps the stack's counts equal to a full recount.
+  PixelLayerStack stack;
+  EXPECT_TRUE(PixelLayerStackInit(&stack, 37, 29));
+  int bottom = PixelLayerStackAddLayer(&stack, NULL);
+  int top = PixelLayerStackAddLayer(&stack, NULL);
+  PixelLayerStackPaintBrush(&stack, bottom, 0, 0, red, 5);
+  PixelLayerStackPaintBrush(&stack, bottom, 36, 28, green, 4);
+  PixelLayerStackPaintBrush(&stack, top, 1, 1, green, 3);
+  PixelLayerStackPaintBrush(&stack, top, 2, 2, PIXEL_BLANK, 1);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack) && PixelHistogramCount(&stack.colors, red) == 9);
+
+  PixelMask mask;
+  EXPECT_TRUE(PixelMaskInit(&mask, 37, 29));
+  PixelMaskRect(&mask, 10, 10, 3, 30);
+  PixelLayerStackPaintBrushMasked(&stack, top, 11, 12, blue, 6, &mask);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack) && PixelHistogramCount(&stack.colors, blue) == 15);
+  PixelMaskFree(&mask);
+
+  PixelLayerStackBeginEdit(&stack, bottom, 30, 20, 10, 10);
+  for (int y = 20; y < 29; y++) stack.layers[bottom].pixels[y * 37 + 33] = blue;
+  PixelLayerStackEndEdit(&stack, bottom, 30, 20, 10, 10);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack));
+
+  // Counts marked short by a failed add are whole again after a recount.
+  EXPECT_TRUE(!stack.colorsStale);
+  PixelHistogramClear(&stack.colors);
+  stack.colorsStale = true;
+  PixelLayerStackRecountColors(&stack);
+  EXPECT_TRUE(!stack.colorsStale && HistogramMatchesLayers(&stack));
+
+  // Palette queries: duplicates count once, strays are reported most used first.
+  const PixelColor palette[] = {red, blue, red, PIXEL_BLANK};
+  size_t usage[4];
+  size_t off = PixelHistogramPaletteUsage(&stack.colors, palette, 4, usage);
+  EXPECT_TRUE(off == PixelHistogramCount(&stack.colors, green) && usage[0] == 9 && usage[2] == 9 && usage[3] == 0);
+  EXPECT_TRUE(usage[1] == PixelHistogramCount(&stack.colors, blue));
+  PixelLayerStackPaintBrush(&stack, top, 20, 5, (PixelColor){1, 2, 3, 255}, 1);
+  PixelColor strays[1];
+  size_t strayCounts[1];
+  EXPECT_TRUE(PixelHistogramOffPalette(&stack.colors, palette, 4, strays, strayCounts, 1) == 2);
+  EXPECT_TRUE(ColorEq(strays[0], green) && strayCounts[0] == off);
+
+  // Frame decodes recount only the tiles they rewrite.
+  PixelAnim anim;
+  PixelColor *planes[2] = {stack.layers[bottom].pixels, stack.layers[top].pixels};
+  EXPECT_TRUE(PixelAnimInit(&anim, 37, 29, 2, 12));
+  EXPECT_TRUE(PixelAnimStoreFrame(&anim, 0, planes) && PixelAnimInsertFrame(&anim, 1, true, NULL) == 1);
+  size_t painted = stack.colors.total;
+  EXPECT_TRUE(PixelAnimDecodeFrameEx(&anim, 1, planes, BeginStackTile, EndStackTile, &stack) > 0);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack) && stack.colors.total == 0);
+  EXPECT_TRUE(PixelAnimDecodeFrameEx(&anim, 0, planes, BeginStackTile, EndStackTile, &stack) > 0);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack) && stack.colors.total == painted);
+  PixelAnimFree(&anim);
+
+  PixelLayerStackClearLayer(&stack, top);
+  EXPECT_TRUE(HistogramMatchesLayers(&stack) && PixelHistogramCount(&stack.colors, blue) == 9);
+  PixelLayerStackRemoveLayer(&stack, bottom);
+  EXPECT_TRUE(stack.colors.total == 0);
+  PixelLayerStackFree(&stack);
+}
+
+static void TestFloatingSelection(void) {
+  // Blocked transpose across partial tiles, and in-place flips.
+  int w = 70, h = 45;
+  PixelColor *src = (PixelColor *)malloc((size_t)w * h * sizeof(PixelColor));
+  PixelColor *dst = (PixelColor *)malloc((size_t)w * h * sizeof(PixelColor));
+  for (int i = 0; i < w * h; i++) src[i] = (PixelColor){(unsigned char)i, (unsigned char)(i >> 8), 7, 255};
+  PixelTransposeRect(dst, h, src, w, w, h);
+  bool same = true;
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) same = same && ColorEq(dst[x * h + y], src[y * w + x]);
+  }
+  EXPECT_TRUE(same);
+  memcpy(dst, src, (size_t)w * h * sizeof(PixelColor));
+  PixelFlipHorizontal(dst, w, w, h);
+  PixelFlipVertical(dst, w, w, h);
+  EXPECT_TRUE(ColorEq(dst[0], src[w * h - 1]) && ColorEq(dst[w + 3], src[(h - 2) * w + w - 4]));
+  free(src);
+  free(dst);
+
+  // Lifting cuts only the selected pixels; blitting writes them back as runs, clipped.
+  PixelColor *canvas = AllocCanvas(16);
+  FillPattern(canvas, 16);
+  PixelColor *original = AllocCanvas(16);
+  memcpy(original, canvas, 16 * 16 * sizeof(PixelColor));
+  PixelMask selection;
+  EXPECT_TRUE(PixelMaskInit(&selection, 16, 16));
+  PixelMaskRect(&selection, 2, 3, 4, 2);
+  SetMaskBit(&selection, 9, 4);
+  PixelFloating floating;
+  EXPECT_TRUE(PixelFloatingLift(&floating, canvas, 16, 16, &selection));
+  EXPECT_TRUE(floating.x == 2 && floating.y == 3 && floating.mask.width == 8 && floating.mask.height == 2);
+  EXPECT_TRUE(PixelMaskCount(&floating.mask) == 9 && canvas[3 * 16 + 2].a == 0 && canvas[4 * 16 + 9].a == 0);
+  EXPECT_TRUE(ColorEq(canvas[4 * 16 + 8], original[4 * 16 + 8]));
+  EXPECT_TRUE(ColorEq(floating.pixels[1 * 8 + 7], original[4 * 16 + 9]));
+
+  floating.x = 10;
+  floating.y = 14;
+  PixelFloatingBlit(&floating, canvas, 16, 16);
+  EXPECT_TRUE(ColorEq(canvas[14 * 16 + 10], original[3 * 16 + 2]) && ColorEq(canvas[15 * 16 + 13], original[4 * 16 + 5]));
+  EXPECT_TRUE(ColorEq(canvas[15 * 16 + 14], original[15 * 16 + 14]));  // Unlifted pixel of the buffer
+  PixelFloatingPlaceMask(&floating, &selection);
+  EXPECT_TRUE(PixelMaskCount(&selection) == 8 && PixelMaskGet(&selection, 13, 15) && !PixelMaskGet(&selection, 9, 4));
+
+  // Four quarter turns either way, or two flips each way, give the original back.
+  PixelFloating before;
+  EXPECT_TRUE(PixelFloatingLift(&before, original, 16, 16, &selection));
+  PixelColor lifted[8];
+  memcpy(lifted, before.pixels, sizeof(lifted));
+  EXPECT_TRUE(PixelFloatingRotate(&before, true));
+  EXPECT_TRUE(before.mask.width == 2 && before.mask.height == 4 && PixelMaskGet(&before.mask, 1, 0));
+  EXPECT_TRUE(ColorEq(before.pixels[0 * 2 + 1], lifted[0]) && ColorEq(before.pixels[3 * 2 + 0], lifted[7]));
+  EXPECT_TRUE(PixelFloatingRotate(&before, false));
+  EXPECT_TRUE(before.x == 10 && before.y == 14 && memcmp(before.pixels, lifted, sizeof(lifted)) == 0);
+  for (int i = 0; i < 4; i++) PixelFloatingRotate(&before, false);
+  EXPECT_TRUE(memcmp(before.pixels, lifted, sizeof(lifted)) == 0);
+  EXPECT_TRUE(PixelFloatingFlip(&before, true) && ColorEq(before.pixels[0], lifted[3]));
+  EXPECT_TRUE(PixelFloatingFlip(&before, false) && ColorEq(before.pixels[0], lifted[7]));
+  PixelFloatingFlip(&before, true);
+  PixelFloatingFlip(&before, false);
+  EXPECT_TRUE(memcmp(before.pixels, lifted, sizeof(lifted)) == 0 && PixelMaskCount(&before.mask) == 8);
+
+  PixelFloatingFree(&before);
+  PixelFloatingFree(&floating);
+  PixelMaskClear(&selection);
+  EXPECT_TRUE(!PixelFloatingLift(&floating, canvas, 16, 16, &selection));
+  PixelMaskFree(&selection);
+  free(canvas);
+  free(original);
+}
+
+static void TestPaletteCache(void) {
+  char dir[] = "/tmp/pixel-palette-cache-XXXXXX";
+  EXPECT_TRUE(mkdtemp(dir) != NULL);
+  char cachePath[512];
+  snprintf(cachePath, sizeof(cachePath), "%s/cache.bin", dir);
+  WritePaletteFile(dir, "b.txt", "FF000000\nFFFFFFFF\n");
+  WritePaletteFile(dir, "a.txt", ";comment\nFF102030\n");
+  WritePaletteFile(dir, "empty.txt", ";no colors\n");
+
+  PixelPaletteRegistry registry;
+  PixelPaletteCacheStats stats;
+  PixelPaletteRegistryInit(&registry);
+  EXPECT_TRUE(PixelPaletteRegistryLoadDirCached(&registry, dir, cachePath, &stats) == 2);
+  EXPECT_TRUE(stats.fileCount == 3 && stats.parsedCount == 3 && stats.cachedCount == 0 && stats.cacheWritten);
+  PixelPaletteRegistryFree(&registry);
+
+  // Second run is served entirely from the blob, in the same order.
+  PixelPaletteRegistryInit(&registry);
+  EXPECT_TRUE(PixelPaletteRegistryLoadDirCached(&registry, dir, cachePath, &stats) == 2);
+  EXPECT_TRUE(stats.parsedCount == 0 && stats.cachedCount == 3 && !stats.cacheWritten);
+  int count = 0;
+  const PixelColor *colors = PixelPaletteColors(&registry, 0, &count);
+  EXPECT_TRUE(strcmp(PixelPaletteName(&registry, 0), "a") == 0 && count == 1);
+  EXPECT_TRUE(colors && ColorEq(colors[0], (PixelColor){0x10, 0x20, 0x30, 255}));
+  PixelPaletteRegistryFree(&registry);
+
+  // A size change re-parses only that file; a deletion rewrites the cache.
+  WritePaletteFile(dir, "b.txt", "FF000000\nFFFFFFFF\nFF00FF00\n");
+  char path[512];
+  snprintf(path, sizeof(path), "%s/empty.txt", dir);
+  unlink(path);
+  PixelPaletteRegistryInit(&registry);
+  EXPECT_TRUE(PixelPaletteRegistryLoadDirCached(&registry, dir, cachePath, &stats) == 2);
+  EXPECT_TRUE(stats.parsedCount == 1 && stats.cachedCount == 1 && stats.cacheWritten);
+  PixelPaletteColors(&registry, PixelPaletteRegistryFind(&registry, "b"), &count);
+  EXPECT_TRUE(count == 3);
+  PixelPaletteRegistryFree(&registry);
+
+  // A corrupt cache is ignored and replaced.
+  FILE *fp = fopen(cachePath, "r+b");
+  if (fp) {
+    fputs("JUNK", fp);
+    fclose(fp);
+  }
+  PixelPaletteRegistryInit(&registry);
+  EXPECT_TRUE(PixelPaletteRegistryLoadDirCached(&registry, dir, cachePath, &stats) == 2);
+  EXPECT_TRUE(stats.parsedCount == 2 && stats.cacheWritten);
+  PixelPaletteRegistryFree(&registry);
+
+  const char *names[] = {"a.txt", "b.txt", "cache.bin"};
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+}
+
+static void TestPaletteLayout(void) {
+  // Editor geometry: 64px swatches, 10px gaps, 160x512 panel -> 2 columns of 8.
+  PixelPaletteLayout layout;
+  PixelPaletteLayoutInit(&layout, (PixelLayoutRect){532, 40, 160, 512}, 64, 10);
+  EXPECT_TRUE(layout.rows == 8 && layout.visibleColumns == 2);
+  PixelPaletteLayoutSetCount(&layout, 16);
+  EXPECT_TRUE(PixelPaletteLayoutMaxScroll(&layout) == 0);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 533, 41) == 0);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 63, 40 + 64 * 7 + 5) == 7);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 70, 41) == -1);  // Column gap
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 74, 41) == 8);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 531, 41) == -1);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 148, 41) == -1);  // Past the last whole column
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 533, 40 + 512) == -1);
+
+  // Hit-testing and cell rectangles agree for every visible swatch.
+  PixelPaletteLayoutSetCount(&layout, 256);
+  EXPECT_TRUE(PixelPaletteLayoutColumns(&layout) == 32 && PixelPaletteLayoutMaxScroll(&layout) == 30);
+  EXPECT_TRUE(PixelPaletteLayoutScroll(&layout, 5) && layout.scrollColumn == 5);
+  int first = 0, end = 0;
+  PixelPaletteLayoutVisibleRange(&layout, &first, &end);
+  EXPECT_TRUE(first == 40 && end == 56);
+  for (int i = 0; i < 256; i++) {
+    PixelLayoutRect rect;
+    bool visible = PixelPaletteLayoutCellRect(&layout, i, &rect);
+    EXPECT_TRUE(visible == (i >= first && i < end));
+    if (visible) EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, rect.x + rect.width / 2, rect.y + rect.height / 2) == i);
+  }
+
+  // Scrolling clamps, a smaller palette pulls the scroll back, ScrollTo reveals.
+  EXPECT_TRUE(PixelPaletteLayoutScroll(&layout, -100) && layout.scrollColumn == 0);
+  EXPECT_TRUE(PixelPaletteLayoutScroll(&layout, 100) && layout.scrollColumn == 30);
+  EXPECT_TRUE(!PixelPaletteLayoutScroll(&layout, 1));
+  PixelPaletteLayoutScrollTo(&layout, 3);
+  EXPECT_TRUE(layout.scrollColumn == 0);
+  PixelPaletteLayoutScrollTo(&layout, 255);
+  EXPECT_TRUE(layout.scrollColumn == 30);
+  PixelPaletteLayoutSetCount(&layout, 20);
+  EXPECT_TRUE(layout.scrollColumn == 1);
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 74 + 1, 40 + 64 * 4 + 1) == -1);  // Empty cell past 20
+  EXPECT_TRUE(PixelPaletteLayoutHitTest(&layout, 532 + 74 + 1, 40 + 64 * 3 + 1) == 19);
+}
+
+static void TestPaletteLazyLoading(void) {
+  char dir[] = "/tmp/pixel-palette-lazy-XXXXXX";
+  EXPECT_TRUE(mkdtemp(dir) != NULL);
+  char name[32], body[64], path[512], cachePath[512];
+  for (int i = 0; i < 40; i++) {
+    snprintf(name, sizeof(name), "p%02d.txt", i);
+    snprintf(body, sizeof(body), ";header\nFF%02X0000\nFF00%02X00\n", i, i);
+    WritePaletteFile(dir, name, body);
+  }
+  snprintf(cachePath, sizeof(cachePath), "%s/cache.bin", dir);
+
+  // Lazy entries are listed without colors and parsed on first use.
+  PixelPaletteRegistry registry;
+  PixelPaletteRegistryInit(&registry);
+  snprintf(path, sizeof(path), "%s/p07.txt", dir);
+  int lazy = PixelPaletteRegistryAddLazy(&registry, "p07", path);
+  int count = -1;
+  EXPECT_TRUE(lazy == 0 && !PixelPaletteLoaded(&registry, lazy));
+  EXPECT_TRUE(PixelPaletteColors(&registry, lazy, &count) == NULL && count == 0);
+  EXPECT_TRUE(PixelPaletteRegistryEnsureLoaded(&registry, lazy));
+  const PixelColor *colors = PixelPaletteColors(&registry, lazy, &count);
+  EXPECT_TRUE(count == 2 && colors && colors[1].g == 7);
+  PixelPaletteRegistryFree(&registry);
+
+  // Cold start: names arrive after the scan and colors stream in behind them.
+  for (int run = 0; run < 2; run++) {
+    PixelPaletteRegistryInit(&registry);
+    PixelPaletteLoader *loader = PixelPaletteLoaderStart(dir, cachePath, 3);
+    EXPECT_TRUE(loader != NULL);
+    PixelPaletteLoaderWait(loader);
+    PixelPaletteLoaderDrain(loader, &registry);
+    EXPECT_TRUE(registry.count == 40);
+    EXPECT_TRUE(PixelPaletteRegistryEnsureLoaded(&registry, 39));
+    while (!PixelPaletteLoaderFinished(loader)) PixelPaletteLoaderDrain(loader, &registry);
+    PixelPaletteLoaderDestroy(loader);
+
+    int loaded = 0;
+    for (int i = 0; i < registry.count; i++) {
+      colors = PixelPaletteColors(&registry, i, &count);
+      snprintf(name, sizeof(name), "p%02d", i);
+      if (colors && count == 2 && colors[0].r == i && strcmp(PixelPaletteName(&registry, i), name) == 0) loaded++;
+    }
+    EXPECT_TRUE(loaded == 40);
+    PixelPaletteRegistryFree(&registry);
+  }
+
+  // The loader left a complete cache behind.
+  PixelPaletteCacheStats stats;
+  PixelPaletteRegistryInit(&registry);
+  PixelPaletteRegistryLoadDirCached(&registry, dir, cachePath, &stats);
+  EXPECT_TRUE(stats.cachedCount == 40 && stats.parsedCount == 0);
+  PixelPaletteRegistryFree(&registry);
+
+  // Destroying a loader mid-flight is safe.
+  PixelPaletteLoaderDestroy(PixelPaletteLoaderStart(dir, NULL, 2));
+
+  for (int i = 0; i < 40; i++) {
+    snprintf(path, sizeof(path), "%s/p%02d.txt", dir, i);
+    unlink(path);
+  }
+  unlink(cachePath);
+  rmdir(dir);
+}
+
+static int ImportText(const char *path, const char *text, PixelColor *out, int capacity) {
+  return PixelPaletteImport(path, (const unsigned char *)text, strlen(text), out, capacity);
+}
+
+static void TestPaletteImporters(void) {
+  PixelColor colors[300];
+  EXPECT_TRUE(ImportText("a.txt", ";paint.net\r\nFF102030\r\n80FFFFFF\r\n", colors, 300) == 2);
+  EXPECT_TRUE(ColorEq(colors[0], (PixelColor){0x10, 0x20, 0x30, 255}) && colors[1].a == 0x80);
+  EXPECT_TRUE(ImportText("a.hex", "ff0000\n#00ff00\nnot-a-color\n", colors, 300) == 2);
+  EXPECT_TRUE(ColorEq(colors[1], (PixelColor){0, 255, 0, 255}));
+
+  const char *gimp = "GIMP Palette\nName: Test\nColumns: 4\n# comment\n255   0  10\tRed\n  0 128 255 Blue\n";
+  EXPECT_TRUE(ImportText("a.gpl", gimp, colors, 300) == 2);
+  EXPECT_TRUE(ColorEq(colors[0], (PixelColor){255, 0, 10, 255}) && ColorEq(colors[1], (PixelColor){0, 128, 255, 255}));
+  // Magic bytes beat the extension.
+  EXPECT_TRUE(ImportText("mislabeled.txt", gimp, colors, 300) == 2);
+  EXPECT_TRUE(ImportText("a.pal", "JASC-PAL\r\n0100\r\n2\r\n1 2 3\r\n4 5 6\r\n7 8 9\r\n", colors, 300) == 2);
+  EXPECT_TRUE(ColorEq(colors[1], (PixelColor){4, 5, 6, 255}));
+  EXPECT_TRUE(ImportText("a.pal", "RIFF", colors, 300) == -1);
+  EXPECT_TRUE(ImportText("a.unknown", "FF000000\n", colors, 300) == -1);
+
+  // ACT with a used-color count; a short buffer reports the full count.
+  unsigned char act[772] = {0};
+  for (int i = 0; i < 768; i++) act[i] = (unsigned char)i;
+  act[768] = 0;
+  act[769] = 3;
+  EXPECT_TRUE(PixelPaletteImport("a.act", act, sizeof(act), colors, 300) == 3);
+  EXPECT_TRUE(ColorEq(colors[2], (PixelColor){6, 7, 8, 255}));
+  EXPECT_TRUE(PixelPaletteImport("a.act", act, 768, colors, 2) == 256);
+  EXPECT_TRUE(PixelPaletteHasImporter("dir/X.GPL") && !PixelPaletteHasImporter("readme.md"));
+
+  // Swatch strips at 1x and 8x, and a 2x2 grid with a repeated neighbor.
+  PixelColor strip[4] = {{1, 0, 0, 255}, {2, 0, 0, 255}, {3, 0, 0, 255}, {4, 0, 0, 255}};
+  EXPECT_TRUE(PixelPaletteFromSwatchImage(strip, 4, 1, colors, 300) == 4 && colors[3].r == 4);
+  PixelColor *big = AllocCanvas(32);
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 32; x++) big[y * 32 + x] = strip[x / 8];
+  }
+  EXPECT_TRUE(PixelPaletteFromSwatchImage(big, 32, 8, colors, 300) == 4 && colors[2].r == 3);
+  for (int y = 0; y < 16; y++) {
+    for (int x = 0; x < 16; x++) big[y * 16 + x] = (y < 8 && x >= 8) ? strip[0] : strip[(y / 8) * 2 + x / 8];
+  }
+  EXPECT_TRUE(PixelPaletteFromSwatchImage(big, 16, 16, colors, 300) == 4 && colors[3].r == 4);
+  free(big);
+
+  char name[64];
+  PixelPaletteNameFromPath("palettes/pico-8-8x.png", name, sizeof(name));
+  EXPECT_TRUE(strcmp(name, "pico-8") == 0);
+  PixelPaletteNameFromPath("palettes/na16.txt", name, sizeof(name));
+  EXPECT_TRUE(strcmp(name, "na16") == 0);
+}
+
+static void TestStartupPathsAndProfile(void) {
+  char root[] = "/tmp/pixel-startup-XXXXXX";
+  EXPECT_TRUE(mkdtemp(root) != NULL);
+  char path[512];
+  snprintf(path, sizeof(path), "%s/a/b/c/", root);
+  EXPECT_TRUE(PixelMakeDirectories(path));
+  EXPECT_TRUE(PixelMakeDirectories(path));
+  snprintf(path, sizeof(path), "%s/file", root);
+  FILE *fp = fopen(path, "w");
+  if (fp) fclose(fp);
+  snprintf(path, sizeof(path), "%s/file/sub", root);
+  EXPECT_TRUE(!PixelMakeDirectories(path));
+
+  // XDG_DATA_HOME wins over HOME, and a too-small buffer fails cleanly.
+  const char *xdg = getenv("XDG_DATA_HOME");
+  char *savedXdg = xdg ? strdup(xdg) : NULL;
+  char dataDir[512];
+  setenv("XDG_DATA_HOME", root, 1);
+  EXPECT_TRUE(PixelUserDataDir(dataDir, sizeof(dataDir)));
+  snprintf(path, sizeof(path), "%s/pixel", root);
+  EXPECT_TRUE(strcmp(dataDir, path) == 0);
+  EXPECT_TRUE(!PixelUserDataDir(dataDir, 8) && dataDir[0] == '\0');
+  if (savedXdg) setenv("XDG_DATA_HOME", savedXdg, 1);
+  else unsetenv("XDG_DATA_HOME");
+  free(savedXdg);
+
+  PixelStartupProfile profile;
+  PixelStartupProfileInit(&profile);
+  EXPECT_TRUE(PixelStartupElapsedMs(&profile) == 0.0);
+  for (int i = 0; i < PIXEL_STARTUP_MAX_PHASES + 4; i++) PixelStartupMark(&profile, "phase");
+  EXPECT_TRUE(profile.phaseCount == PIXEL_STARTUP_MAX_PHASES);
+  double sum = 0.0;
+  for (int i = 0; i < profile.phaseCount; i++) {
+    EXPECT_TRUE(PixelStartupPhaseMs(&profile, i) >= 0.0);
+    sum += PixelStartupPhaseMs(&profile, i);
+  }
+  EXPECT_TRUE(sum - PixelStartupElapsedMs(&profile) < 1e-6 && PixelStartupElapsedMs(&profile) - sum < 1e-6);
+
+  const char *created[] = {"file", "a/b/c", "a/b", "a"};
+  for (int i = 0; i < 4; i++) {
+    snprintf(path, sizeof(path), "%s/%s", root, created[i]);
+    if (i == 0) unlink(path);
+    else rmdir(path);
+  }
+  rmdir(root);
+}
+
 static void TestUiDialogTransitions(void) {
   PixelUiLogic ui;
   PixelUiLogicInit(&ui);
@@ -145,8 +1699,19 @@ static void TestUiDialogTransitions(void) {
   EXPECT_TRUE(!ui.showSavePngDialog && !ui.showSaveTxtDialog);
   EXPECT_TRUE(ui.textInputEditMode);
 
+  PixelUiLogicOpenDialog(&ui, PIXEL_DIALOG_SAVE_GIF);
+  EXPECT_TRUE(ui.showSaveGifDialog && !ui.showLoadTxtDialog);
+  EXPECT_TRUE(PixelUiLogicDialogOpen(&ui));
+
+  PixelUiLogicOpenDialog(&ui, PIXEL_DIALOG_LIBRARY);
+  EXPECT_TRUE(ui.showLibraryBrowser && !ui.showSaveGifDialog && !ui.textInputEditMode);
+  EXPECT_TRUE(PixelUiLogicDialogOpen(&ui));
+  PixelUiLogicCloseDialog(&ui, PIXEL_DIALOG_LIBRARY);
+  EXPECT_TRUE(!PixelUiLogicDialogOpen(&ui));
+
   PixelUiLogicOpenQuitConfirm(&ui);
   EXPECT_TRUE(ui.showQuitConfirm);
+  EXPECT_TRUE(!PixelUiLogicDialogOpen(&ui));
   EXPECT_TRUE(!ui.showSavePngDialog && !ui.showSaveTxtDialog && !ui.showLoadTxtDialog);
   EXPECT_TRUE(!ui.textInputEditMode);
 
@@ -157,13 +1722,57 @@ static void TestUiDialogTransitions(void) {
   EXPECT_TRUE(ui.shouldQuit);
 }
 
+static void TestRedrawIdle(void) {
+  PixelRedrawState redraw;
+  PixelRedrawInit(&redraw);
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, false));
+  EXPECT_TRUE(PixelRedrawFrameDone(&redraw, false));
+  EXPECT_TRUE(PixelRedrawFrameDone(&redraw, false));
+
+  // Input owes one settle frame, then the loop sleeps again.
+  PixelRedrawInvalidate(&redraw);
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, false));
+  EXPECT_TRUE(PixelRedrawFrameDone(&redraw, false));
+
+  // Busy frames never sleep, and the frame after the work ends is still drawn.
+  for (int i = 0; i < 5; i++) EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, true));
+  EXPECT_TRUE(!PixelRedrawFrameDone(&redraw, false));
+  EXPECT_TRUE(PixelRedrawFrameDone(&redraw, false));
+}
+
 int main(void) {
   TestNormalizeBaseName();
   TestBuildFilePath();
   TestPaintBrushClamp();
   TestSaveLoadRoundTrip();
   TestLoadParsesRowsByIndex();
+  TestBackgroundSave();
+  TestLayerBlendModes();
+  TestLayerHalfAlphaComposite();
+  TestLayerDirtyTiles();
+  TestJobPoolRunsEveryItemOnce();
+  TestLayerFlattenRectParallel();
+  TestAnimDeltaStorage();
+  TestAnimPlanesAndPlayback();
+  TestGifEncodeRoundTrip();
+  TestAutosaveJournal();
+  TestGridLines();
+  TestCanvasTransforms();
+  TestColorReplace();
+  TestColorHistogram();
+  TestSelectionMasks();
+  TestFloatingSelection();
+  TestPaletteRegistry();
+  TestPaletteCache();
+  TestLibraryThumbnails();
+  TestFileWatcher();
+  TestLiveLink();
+  TestPaletteLazyLoading();
+  TestPaletteImporters();
+  TestPaletteLayout();
+  TestStartupPathsAndProfile();
   TestUiDialogTransitions();
+  TestRedrawIdle();
 
   if (failures > 0) {
     fprintf(stderr, "Tests failed: %d\n", failures);
@@ -0,0 +1,122 @@
+// Build step: bake the bundled font into a glyph atlas and the bundled
+// palettes into color arrays, written out as one C source file.
+//
+// Usage: pixel_embed <font.ttf> <palettes-dir> <output.c>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "raylib.h"
+#include "pixel_palette.h"
+
+// Same parameters raylib's LoadFont uses, so text renders identically.
+#define EMBED_FONT_SIZE 32
+#define EMBED_FONT_GLYPHS 95
+#define EMBED_FONT_PADDING 4
+
+static void WriteBytes(FILE *out, const unsigned char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) fprintf(out, "%s%u,", (i % 24 == 0) ? "\n  " : "", data[i]);
+  fprintf(out, "\n");
+}
+
+static bool WriteFont(FILE *out, const char *fontPath) {
+  int dataSize = 0;
+  unsigned char *data = LoadFileData(fontPath, &dataSize);
+  if (!data) return false;
+
+  int glyphCount = 0;
+  GlyphInfo *glyphs = LoadFontData(data, dataSize, EMBED_FONT_SIZE, NULL, EMBED_FONT_GLYPHS, FONT_DEFAULT, &glyphCount);
+  UnloadFileData(data);
+  if (!glyphs || glyphCount == 0) return false;
+
+  Rectangle *recs = NULL;
+  Image atlas = GenImageFontAtlas(glyphs, &recs, glyphCount, EMBED_FONT_SIZE, EMBED_FONT_PADDING, 0);
+  size_t pixelCount = (size_t)atlas.width * (size_t)atlas.height;
+  unsigned char *alpha = atlas.data ? (unsigned char *)malloc(pixelCount) : NULL;
+  bool grayAlpha = atlas.format == PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA;
+  if (!alpha || (!grayAlpha && atlas.format != PIXELFORMAT_UNCOMPRESSED_GRAYSCALE)) {
+    free(alpha);
+    MemFree(recs);
+    UnloadImage(atlas);
+    UnloadFontData(glyphs, glyphCount);
+    return false;
+  }
+
+  // The atlas is white with coverage in alpha (or gray), so only coverage is stored.
+  const unsigned char *pixels = (const unsigned char *)atlas.data;
+  for (size_t i = 0; i < pixelCount; i++) alpha[i] = grayAlpha ? pixels[i * 2 + 1] : pixels[i];
+
+  fprintf(out, "static const unsigned char fontAtlasAlpha[%zu] = {", pixelCount);
+  WriteBytes(out, alpha, pixelCount);
+  fprintf(out, "};\n\nstatic const PixelEmbeddedGlyph fontGlyphs[%d] = {\n", glyphCount);
+  for (int i = 0; i < glyphCount; i++) {
+    fprintf(out, "  {%d, %d, %d, %d, %d, %d, %d, %d},\n", glyphs[i].value, glyphs[i].offsetX, glyphs[i].offsetY,
+            glyphs[i].advanceX, (int)recs[i].x, (int)recs[i].y, (int)recs[i].width, (int)recs[i].height);
+  }
+  fprintf(out, "};\n\nconst PixelEmbeddedFont pixelEmbeddedFont = {%d, %d, %d, fontGlyphs, %d, %d, fontAtlasAlpha};\n\n",
+          EMBED_FONT_SIZE, glyphCount, EMBED_FONT_PADDING, atlas.width, atlas.height);
+
+  free(alpha);
+  MemFree(recs);
+  UnloadImage(atlas);
+  UnloadFontData(glyphs, glyphCount);
+  return true;
+}
+
+static bool WritePalettes(FILE *out, const char *palettesDir) {
+  PixelPaletteRegistry registry;
+  PixelPaletteRegistryInit(&registry);
+  PixelPaletteRegistryLoadDir(&registry, palettesDir);
+
+  for (int i = 0; i < registry.count; i++) {
+    int count = 0;
+    const PixelColor *colors = PixelPaletteColors(&registry, i, &count);
+    fprintf(out, "static const PixelColor palette%dColors[%d] = {\n", i, count);
+    for (int c = 0; c < count; c++) {
+      fprintf(out, "  {%u, %u, %u, %u},\n", colors[c].r, colors[c].g, colors[c].b, colors[c].a);
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  fprintf(out, "const PixelEmbeddedPalette pixelEmbeddedPalettes[] = {\n");
+  for (int i = 0; i < registry.count; i++) {
+    int count = 0;
+    PixelPaletteColors(&registry, i, &count);
+    fprintf(out, "  {\"");
+    for (const char *p = PixelPaletteName(&registry, i); *p; p++) {
+      if (*p == '"' || *p == '\\') fputc('\\', out);
+      fputc(*p, out);
+    }
+    fprintf(out, "\", palette%dColors, %d},\n", i, count);
+  }
+  if (registry.count == 0) fprintf(out, "  {\"\", NULL, 0},\n");
+  fprintf(out, "};\n\nconst int pixelEmbeddedPaletteCount = %d;\n", registry.count);
+
+  PixelPaletteRegistryFree(&registry);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    fprintf(stderr, "usage: %s <font.ttf> <palettes-dir> <output.c>\n", argv[0]);
+    return 2;
+  }
+  SetTraceLogLevel(LOG_WARNING);
+
+  FILE *out = fopen(argv[3], "w");
+  if (!out) {
+    fprintf(stderr, "pixel_embed: cannot write %s\n", argv[3]);
+    return 1;
+  }
+  fprintf(out, "// Generated by tools/pixel_embed.c from %s and %s. Do not edit.\n\n", argv[1], argv[2]);
+  fprintf(out, "#include <stddef.h>\n\n#include \"pixel_assets.h\"\n\n");
+
+  bool ok = WriteFont(out, argv[1]) && WritePalettes(out, argv[2]);
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    fprintf(stderr, "pixel_embed: failed to embed %s / %s\n", argv[1], argv[2]);
+    remove(argv[3]);
+    return 1;
+  }
+  return 0;
+}